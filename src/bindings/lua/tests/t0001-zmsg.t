@@ -41,6 +41,21 @@ subtest ('Test zmsg basics', function ()
 	ok  (equals (data, msg.data), 'returned message data is preserved')
 end)
 
+subtest ('Test zmsg field access', function ()
+	local data = { a = { b = { c = 42 } }, s = "foo", t = { 1, 2, 3 } }
+	local msg = z.req ("test.field", data)
+	is (msg:field ("s"),        "foo", 'field returns top-level value')
+	is (msg:field ("a.b.c"),    42,    'field follows dotted path')
+	ok (equals (msg:field ("a.b"), { c = 42 }), 'field returns subtable')
+	ok (equals (msg:field ("t"), { 1, 2, 3 }), 'field returns array')
+	is (msg:field ("a.x.c"),    nil,   'field returns nil for missing path')
+	is (msg:field ("s.x"),      nil,   'field returns nil for non-object')
+	ok (equals (data, msg.data), 'msg.data still works after field access')
+
+	local resp = z.resp_err ("test.resp_err", 1)
+	is (resp:field ("a"), nil, 'field returns nil with no payload')
+end)
+
 local ftypes = {
 	request = z.req,
 	response = z.resp,
@@ -37,6 +37,7 @@ local lwj_options = {
     ['stop-children-in-exec'] = "Start tasks in STOPPED state for debugger",
     ['no-pmi-server'] =         "Do not start simple-pmi server",
     ['trace-pmi-server'] =      "Log simple-pmi server protocol exchange",
+    ['no-pmi-exchange'] =       "Exchange PMI keys through the kvs",
     ['no-aggregate-task-exit'] ="Do not use aggregator for task exit messages",
 }
 
@@ -446,8 +447,8 @@ end
 local function task_status (lwj, taskid)
     if not tonumber (taskid) then return nil end
     local t = lwj[taskid]
-    if not t.exit_status then
-        return 0, (t.procdesc and "starting" or "running")
+    if not t or not t.exit_status then
+        return 0, (lwj.procdesc and "starting" or "running")
     end
     local x = t.exit_code or (t.exit_sig + 128)
     return x, exit_message (t)
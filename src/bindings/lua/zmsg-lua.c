@@ -44,6 +44,7 @@ struct zmsg_info {
     flux_msg_t *msg;
     char *tag;
     json_object *o;
+    int parsed;         /* payload has been decoded into 'o' */
 
     zi_resp_f resp;
     void *arg;
@@ -51,10 +52,14 @@ struct zmsg_info {
 
 static const char * zmsg_type_string (int typemask);
 
+/*
+ *  Take ownership of *msg (*msg is set to NULL).  The JSON payload is
+ *   not decoded until first accessed, so handlers that only look at the
+ *   tag, or at a few fields via zi:field(), skip building a full table.
+ */
 struct zmsg_info * zmsg_info_create (flux_msg_t **msg, int typemask)
 {
     const char *topic;
-    const char *json_str;
     struct zmsg_info *zi = malloc (sizeof (*zi));
     if (zi == NULL)
         return (NULL);
@@ -64,14 +69,10 @@ struct zmsg_info * zmsg_info_create (flux_msg_t **msg, int typemask)
         return (NULL);
     }
     zi->o = NULL;
-    if (flux_msg_get_json (*msg, &json_str) < 0
-                || (json_str && !(zi->o = json_tokener_parse (json_str)))) {
-        free (zi->tag);
-        free (zi);
-        return (NULL);
-    }
+    zi->parsed = 0;
 
-    zi->msg = flux_msg_copy (*msg, true);
+    zi->msg = *msg;
+    *msg = NULL;
     zi->typemask = typemask;
 
     zi->resp = NULL;
@@ -90,8 +91,30 @@ static void zmsg_info_destroy (struct zmsg_info *zi)
     free (zi);
 }
 
+/*
+ *  Decode JSON payload on first use.  Returns -1 if payload is not valid
+ *   JSON, 0 otherwise (zi->o is NULL if there is no payload).
+ */
+static int zmsg_info_parse (struct zmsg_info *zi)
+{
+    const char *json_str;
+
+    if (zi->parsed)
+        return (0);
+    if (zi->msg) {
+        if (flux_msg_get_json (zi->msg, &json_str) < 0)
+            return (-1);
+        if (json_str && !(zi->o = json_tokener_parse (json_str)))
+            return (-1);
+    }
+    zi->parsed = 1;
+    return (0);
+}
+
 const json_object *zmsg_info_json (struct zmsg_info *zi)
 {
+    if (zmsg_info_parse (zi) < 0)
+        return (NULL);
     return (zi->o);
 }
 
@@ -153,6 +176,8 @@ static int l_zmsg_info_index (lua_State *L)
         return (1);
     }
     if (strcmp (key, "data") == 0) {
+        if (zmsg_info_parse (zi) < 0)
+            return lua_pusherror (L, "zmsg: invalid JSON payload");
         return json_object_to_lua (L, zi->o);
     }
     if (strcmp (key, "errnum") == 0) {
@@ -179,10 +204,49 @@ static int l_zmsg_info_index (lua_State *L)
     return (1);
 }
 
+/*
+ *  zi:field ("a.b.c") returns the value at path a.b.c in the payload,
+ *   converting only that value to Lua.  Returns nil if any path
+ *   component is missing.
+ */
+static int l_zmsg_info_field (lua_State *L)
+{
+    struct zmsg_info *zi = l_get_zmsg_info (L, 1);
+    const char *path = luaL_checkstring (L, 2);
+    json_object *o;
+    char *cpy, *comp, *saveptr = NULL;
+
+    if (zmsg_info_parse (zi) < 0)
+        return lua_pusherror (L, "zmsg: invalid JSON payload");
+    if (!(o = zi->o)) {
+        lua_pushnil (L);
+        return (1);
+    }
+    if (!(cpy = strdup (path)))
+        return lua_pusherror (L, "zmsg: out of memory");
+    comp = strtok_r (cpy, ".", &saveptr);
+    while (comp && o) {
+        if (!json_object_object_get_ex (o, comp, &o))
+            o = NULL;
+        comp = strtok_r (NULL, ".", &saveptr);
+    }
+    free (cpy);
+    if (o == NULL) {
+        lua_pushnil (L);
+        return (1);
+    }
+    return json_object_to_lua (L, o);
+}
+
 static int l_zmsg_info_respond (lua_State *L)
 {
     struct zmsg_info *zi = l_get_zmsg_info (L, 1);
     json_object *o;
+
+    /*  Responding consumes the message, so decode the request payload
+     *   now in case it is accessed afterwards.
+     */
+    zmsg_info_parse (zi);
     lua_value_to_json (L, 2, &o);
     if (o && zi->resp)
         return ((*zi->resp) (L, zi, o, zi->arg));
@@ -202,6 +266,7 @@ static const struct luaL_Reg zmsg_methods [] = {
     { "__gc",            l_zmsg_info_destroy  },
     { "__index",         l_zmsg_info_index    },
     { "respond",         l_zmsg_info_respond  },
+    { "field",           l_zmsg_info_field    },
     { NULL,              NULL                 }
 };
 
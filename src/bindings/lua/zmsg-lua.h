@@ -12,6 +12,8 @@ struct zmsg_info;
 typedef int (*zi_resp_f) (lua_State *L,
 	struct zmsg_info *zi, json_object *resp, void *arg);
 
+/* Takes ownership of *msg and sets *msg to NULL.
+ */
 struct zmsg_info *zmsg_info_create (flux_msg_t **msg, int type);
 
 int zmsg_info_register_resp_cb (struct zmsg_info *zi, zi_resp_f f, void *arg);
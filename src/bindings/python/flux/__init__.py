@@ -10,6 +10,7 @@ __all__ = ['core',
            'kvs',
            'jsc',
            'rpc',
+           'future',
            'sec',
            'constants',
            'Flux', ]
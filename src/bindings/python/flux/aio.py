@@ -0,0 +1,71 @@
+"""
+asyncio integration for the flux python bindings (Python 3.4+)
+
+attach() registers a flux handle with an asyncio event loop, so that
+messages arriving on the handle run flux message handlers and future
+continuations from the asyncio loop.  wrap_future() converts a
+flux.future.Future into an asyncio future, e.g.
+
+    flux.aio.attach(h)
+    futures = [flux.aio.wrap_future(flux.kvs.get_async(h, k)) for k in keys]
+    values = loop.run_until_complete(asyncio.gather(*futures))
+
+Only activity on the handle is driven from the asyncio loop.  Other
+flux reactor watchers (timers, fd watchers) still require running the
+flux reactor.
+"""
+from flux.core.inner import raw
+try:
+    import asyncio
+except ImportError:  # pragma: no cover
+    # Python 2: module may be imported, but not used
+    asyncio = None
+
+__all__ = ['attach', 'detach', 'wrap_future']
+
+
+def _run_reactor(flux_handle, loop):
+    reactor = flux_handle.get_reactor()
+    flux_handle.reactor_run(reactor, raw.FLUX_REACTOR_NOWAIT)
+    # The handle fd is edge-triggered: if messages remain queued after
+    # this pass, come back rather than waiting for the next edge.
+    if flux_handle.pollevents() & raw.FLUX_POLLIN:
+        loop.call_soon(_run_reactor, flux_handle, loop)
+
+
+def attach(flux_handle, loop=None):
+    """Drive flux_handle from the asyncio event loop loop (or default)"""
+    if loop is None:
+        loop = asyncio.get_event_loop()
+    loop.add_reader(flux_handle.pollfd(), _run_reactor, flux_handle, loop)
+    # pick up anything that arrived before the reader was added
+    loop.call_soon(_run_reactor, flux_handle, loop)
+
+
+def detach(flux_handle, loop=None):
+    """Stop driving flux_handle from the asyncio event loop"""
+    if loop is None:
+        loop = asyncio.get_event_loop()
+    loop.remove_reader(flux_handle.pollfd())
+
+
+def wrap_future(future, loop=None):
+    """
+    Return an asyncio future resolved with future.get(), or with the
+    EnvironmentError it raises, once the flux future is fulfilled.
+    The flux handle must have been attached to loop.
+    """
+    if loop is None:
+        loop = asyncio.get_event_loop()
+    result = asyncio.Future(loop=loop)
+
+    def continuation(fut, _):
+        if result.cancelled():
+            return
+        try:
+            result.set_result(fut.get())
+        except EnvironmentError as err:
+            result.set_exception(err)
+
+    future.then(continuation)
+    return result
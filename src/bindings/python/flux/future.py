@@ -0,0 +1,85 @@
+import json
+from flux.wrapper import Wrapper, WrapperPimpl
+from flux.core.inner import ffi, lib, raw
+
+__all__ = ['Future']
+
+# Futures with a pending continuation, kept alive until it runs since
+# the only other reference is held by the C side.
+_PENDING = set()
+
+
+@ffi.callback('flux_continuation_f')
+def continuation_wrapper(unused, opaque_handle):
+    del unused  # unused argument
+    future = ffi.from_handle(opaque_handle)
+    _PENDING.discard(future)
+    future.then_cb(future, future.then_args)
+
+
+class Future(WrapperPimpl):
+    """
+    Wraps a flux_future_t, taking ownership of it.
+
+    Subclasses implement get_str() to return the fulfilled result as a
+    JSON string (or None).  The future may be waited on synchronously
+    with get(), or a continuation may be registered with then(), which
+    runs from the flux reactor once the result is available.
+    """
+    class InnerWrapper(Wrapper):
+
+        def __init__(self, flux_handle, handle):
+            # hold a reference for destructor ordering
+            self._flux_handle = flux_handle
+            super(self.__class__, self).__init__(
+                ffi, lib,
+                handle=handle,
+                match=ffi.typeof('flux_future_t *'),
+                prefixes=['flux_future_'],
+                destructor=raw.flux_future_destroy,)
+
+    def __init__(self, flux_handle, handle):
+        super(Future, self).__init__()
+        self.pimpl = self.InnerWrapper(flux_handle, handle)
+        self.then_cb = None
+        self.then_args = None
+        self.wargs = None
+
+    def check(self):
+        """Return True if the future has been fulfilled, without blocking"""
+        try:
+            self.pimpl.wait_for(0.0)
+        except EnvironmentError:
+            return False
+        return True
+
+    def wait_for(self, timeout=-1.0):
+        """Block until fulfilled, or raise EnvironmentError on timeout"""
+        self.pimpl.wait_for(float(timeout))
+
+    def then(self, callback, args=None, timeout=-1.0):
+        """
+        Call callback(future, args) from the reactor once fulfilled.
+        The future is kept alive until the callback has run.
+        """
+        self.then_cb = callback
+        self.then_args = args
+        if self.wargs is None:
+            self.wargs = ffi.new_handle(self)
+        _PENDING.add(self)
+        try:
+            return self.pimpl.then(float(timeout), continuation_wrapper,
+                                   self.wargs)
+        except EnvironmentError:
+            _PENDING.discard(self)
+            raise
+
+    def get_str(self):
+        self.pimpl.get(ffi.NULL)
+        return None
+
+    def get(self):
+        json_str = self.get_str()
+        if json_str is None:
+            return None
+        return json.loads(json_str)
@@ -3,6 +3,7 @@ import collections
 import errno
 from flux._kvs import ffi, lib
 from flux.wrapper import Wrapper, WrapperPimpl
+from flux.future import Future
 
 
 class KVSWrapper(Wrapper):
@@ -93,6 +94,63 @@ def watch_once(flux_handle, key):
             return json.loads(ffi.string(out_json_str[0]))
 
 
+class KVSLookupFuture(Future):
+    """A pending KVS lookup, see get_async()"""
+
+    def get_str(self):
+        valp = ffi.new('const char *[1]')
+        RAW.flux_kvs_lookup_get(self.handle, valp)
+        if valp[0] == ffi.NULL:
+            return None
+        return ffi.string(valp[0])
+
+
+class KVSCommitFuture(Future):
+    """A pending KVS commit, see put_async()"""
+    pass
+
+
+def get_async(flux_handle, key, flags=0):
+    """
+    Send a lookup request for key and return a KVSLookupFuture without
+    waiting for the response.  Call get() on the result to obtain the
+    value, or then() to be called back from the reactor.
+    """
+    return KVSLookupFuture(flux_handle,
+                           RAW.flux_kvs_lookup(flux_handle, flags, key))
+
+
+def get_many(flux_handle, keys, flags=0):
+    """
+    Look up all keys, sending every request before waiting on any of
+    the responses.  Returns a dict of key to value.
+    """
+    futures = [(key, get_async(flux_handle, key, flags)) for key in keys]
+    return dict((key, future.get()) for key, future in futures)
+
+
+def put_async(flux_handle, values, flags=0):
+    """
+    Commit all key/value pairs in the values mapping as a single
+    transaction.  Returns a KVSCommitFuture without waiting for the
+    commit to complete.  Unlike put(), this bypasses (and does not
+    commit) values staged in the handle.
+    """
+    txn = RAW.flux_kvs_txn_create()
+    try:
+        for key, value in values.items():
+            RAW.flux_kvs_txn_put(txn, 0, key, json.dumps(value))
+        handle = RAW.flux_kvs_commit(flux_handle, flags, txn)
+    finally:
+        RAW.flux_kvs_txn_destroy(txn)
+    return KVSCommitFuture(flux_handle, handle)
+
+
+def put_many(flux_handle, values, flags=0):
+    """Commit all key/value pairs in values in one round trip"""
+    put_async(flux_handle, values, flags).get()
+
+
 class KVSDir(WrapperPimpl, collections.MutableMapping):
     # pylint: disable=too-many-ancestors, too-many-public-methods
 
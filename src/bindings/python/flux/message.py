@@ -45,6 +45,7 @@ class Message(WrapperPimpl):
                  destruct=False,):
         super(Message, self).__init__()
         self.pimpl = self.InnerWrapper(type_id, handle, destruct)
+        self._payload = None
 
     @property
     def handle(self):
@@ -81,11 +82,35 @@ class Message(WrapperPimpl):
 
     @payload_str.setter
     def payload_str(self, value):
+        self._payload = None
         self.pimpl.set_json(value)
 
+    @property
+    def payload_buffer(self):
+        """
+        A read-only memoryview of the raw payload, or None.  The payload
+        is not copied, so the view is only valid while the message exists
+        and its payload is not replaced.  JSON payloads include a
+        trailing NUL.
+        """
+        if not self.pimpl.has_payload():
+            return None
+        flags = ffi.new('int [1]')
+        buf = ffi.new('const void *[1]')
+        size = ffi.new('int [1]')
+        self.pimpl.get_payload(flags, buf, size)
+        return memoryview(ffi.buffer(buf[0], size[0]))
+
     @property
     def payload(self):
-        return json.loads(self.payload_str)
+        """
+        The JSON payload decoded to python objects.  Decoding is deferred
+        until first access and the result is cached, so handlers that
+        only look at the topic never pay for it.
+        """
+        if self._payload is None:
+            self._payload = json.loads(self.payload_str)
+        return self._payload
 
     @payload.setter
     def payload(self, value):
@@ -1,48 +1,11 @@
 import json
-from flux.wrapper import Wrapper, WrapperPimpl
-from flux.core.inner import ffi, lib, raw
+from flux.future import Future
+from flux.core.inner import ffi, raw
 import flux.constants
 
 
-class RPC(WrapperPimpl):
+class RPC(Future):
     """An RPC state object"""
-    class InnerWrapper(Wrapper):
-
-        def __init__(self,
-                     flux_handle,
-                     topic,
-                     payload=None,
-                     nodeid=flux.constants.FLUX_NODEID_ANY,
-                     flags=0,
-                     handle=None):
-            # hold a reference for destructor ordering
-            self._handle = flux_handle
-            dest = raw.flux_future_destroy
-            super(self.__class__, self).__init__(ffi, lib,
-                                                 handle=handle,
-                                                 match=ffi.typeof(
-                                                     lib.flux_rpc).result,
-                                                 prefixes=[
-                                                     'flux_rpc_',
-                                                 ],
-                                                 destructor=dest,)
-            if handle is None:
-                if isinstance(flux_handle, Wrapper):
-                    flux_handle = flux_handle.handle
-
-
-                if payload is None or payload == ffi.NULL:
-                    payload = ffi.NULL
-                elif not isinstance(payload, basestring):
-                    payload = json.dumps(payload)
-
-                if isinstance(nodeid, basestring):
-                    # String version is multiple nodeids
-                    self.handle = lib.flux_rpc_multi(
-                        flux_handle, topic, payload, nodeid, flags)
-                else:
-                    self.handle = lib.flux_rpc(
-                        flux_handle, topic, payload, nodeid, flags)
 
     def __init__(self,
                  flux_handle,
@@ -51,35 +14,20 @@ class RPC(WrapperPimpl):
                  nodeid=flux.constants.FLUX_NODEID_ANY,
                  flags=0,
                  handle=None):
-        super(RPC, self).__init__()
-        self.pimpl = self.InnerWrapper(flux_handle,
-                                       topic,
-                                       payload,
-                                       nodeid,
-                                       flags,
-                                       handle)
-        self.then_args = None
-        self.then_cb = None
-
-    def check(self):
-        return bool(self.pimpl.check())
+        if handle is None:
+            if payload is None or payload == ffi.NULL:
+                payload = ffi.NULL
+            elif not isinstance(payload, basestring):
+                payload = json.dumps(payload)
+            handle = raw.flux_rpc(flux_handle, topic, payload, nodeid, flags)
+        super(RPC, self).__init__(flux_handle, handle)
 
     def completed(self):
-        return bool(self.pimpl.completed())
+        return self.check()
 
     def get_str(self):
-        j_str = ffi.new('char *[1]')
-        self.pimpl.get(j_str)
+        j_str = ffi.new('const char *[1]')
+        raw.flux_rpc_get(self.handle, j_str)
+        if j_str[0] == ffi.NULL:
+            return None
         return ffi.string(j_str[0])
-
-    def get(self):
-        return json.loads(self.get_str())
-
-    def then(self, callback, args):
-        def cb_then_wrapper(trash, arg):
-            rpc_handle = ffi.from_handle(arg)
-            callback(rpc_handle, rpc_handle.then_args)
-        # Save the callback to keep it from getting collected
-        self.then_cb = ffi.callback('flux_then_f', cb_then_wrapper)
-        self.then_args = args
-        return self.pimpl.then(self.then_cb, ffi.new_handle(self))
@@ -42,4 +42,19 @@ class TestEvent(unittest.TestCase):
         self.assertIsNotNone(evt.payload_str)
         print evt.payload_str
 
+    def test_payload_buffer(self):
+        """Access raw event payload without copying"""
+        evt = self.f.event_create("testevent.2", {'test': 'buf'})
+        buf = evt.payload_buffer
+        self.assertIsInstance(buf, memoryview)
+        self.assertEqual(buf.tobytes(), evt.payload_str + '\0')
+        self.assertIsNone(self.f.event_create("testevent.3").payload_buffer)
+
+    def test_payload_cached(self):
+        """Decoded payload is cached until the payload is replaced"""
+        evt = self.f.event_create("testevent.2", {'test': 'cache'})
+        self.assertIs(evt.payload, evt.payload)
+        evt.payload = {'test': 'new'}
+        self.assertEqual(evt.payload['test'], 'new')
+
 
@@ -40,6 +40,21 @@ class TestHandle(unittest.TestCase):
             self.assertEqual(j['seq'], 1)
             self.assertEqual(j['pad'], 'stuff')
 
+    def test_rpc_then(self):
+        """Receive a ping response in a continuation"""
+        result = {}
+
+        def cb(rpc, arg):
+            result['resp'] = rpc.get()
+            result['arg'] = arg
+            self.f.reactor_stop(self.f.get_reactor())
+        rpc = self.f.rpc_create('cmb.ping', {'seq': 2, 'pad': 'stuff'})
+        rpc.then(cb, 'myarg')
+        del rpc
+        self.f.reactor_run(self.f.get_reactor(), 0)
+        self.assertEqual(result['resp']['seq'], 2)
+        self.assertEqual(result['arg'], 'myarg')
+
     def test_get_rank(self):
       """Get flux rank"""
       rank = self.f.get_rank()
@@ -133,6 +133,29 @@ class TestKVS(unittest.TestCase):
                 self.assertEqual(v, 'bar')
                 print("passed {}".format(k))
 
+    def test_put_many_get_many(self):
+        values = dict(('pipelined.' + str(x), x) for x in range(100))
+        flux.kvs.put_many(self.f, values)
+        self.assertEqual(flux.kvs.get_many(self.f, values.keys()), values)
+
+    def test_get_many_missing(self):
+        with self.assertRaises(EnvironmentError) as err:
+            flux.kvs.get_many(self.f, ['crazykeythatclearlydoesntexist'])
+        self.assertEqual(err.exception.errno, errno.ENOENT)
+
+    def test_get_async_then(self):
+        flux.kvs.put_many(self.f, {'async.a': 1, 'async.b': 2})
+        results = {}
+
+        def cb(future, key):
+            results[key] = future.get()
+            if len(results) == 2:
+                self.f.reactor_stop(self.f.get_reactor())
+        for key in ['async.a', 'async.b']:
+            flux.kvs.get_async(self.f, key).then(cb, key)
+        self.f.reactor_run(self.f.get_reactor(), 0)
+        self.assertEqual(results, {'async.a': 1, 'async.b': 2})
+
     def test_walk(self):
         keys = ['testwalk.' + str(x) for x in range(1, 15)]
         with flux.kvs.get_dir(self.f) as kd:
@@ -80,6 +80,7 @@
 #include "exec.h"
 #include "ping.h"
 #include "rusage.h"
+#include "profile.h"
 
 /* Generally accepted max, although some go higher (IE is 2083) */
 #define ENDPOINT_MAX 2048
@@ -142,6 +143,7 @@ typedef struct {
     hello_t *hello;
     flux_t *enclosing_h;
     runlevel_t *runlevel;
+    char *hmac_nonce;           /* random per-session event HMAC salt */
 
     /* Subprocess management
      */
@@ -450,6 +452,20 @@ int main (int argc, char *argv[])
     if (attr_set_flags (ctx.attrs, "session-id", FLUX_ATTRFLAG_IMMUTABLE) < 0)
         log_err_exit ("attr_set_flags session-id");
 
+    /* With CURVE, sign multicast events with an HMAC keyed from the
+     * CURVE server secret and a nonce chosen by rank 0 at boot, rather
+     * than encoding a MUNGE credential per event.  The nonce makes the
+     * key unique to this session, so events captured from an earlier
+     * session with the same certificate cannot be replayed.
+     */
+    if (flux_sec_type_enabled (ctx.sec, FLUX_SEC_TYPE_CURVE)
+                                                    && ctx.hmac_nonce) {
+        if (flux_sec_hmac_init (ctx.sec, ctx.hmac_nonce) < 0)
+            log_msg_exit ("flux_sec_hmac_init: %s", flux_sec_errstr (ctx.sec));
+    }
+    free (ctx.hmac_nonce);
+    ctx.hmac_nonce = NULL;
+
     // Setup profiling
     setup_profiling (argv[0], ctx.rank);
 
@@ -616,6 +632,8 @@ int main (int argc, char *argv[])
         log_err_exit ("ping_initialize");
     if (rusage_initialize (ctx.h, "cmb") < 0)
         log_err_exit ("rusage_initialize");
+    if (profile_initialize (ctx.h, "cmb") < 0)
+        log_err_exit ("profile_initialize");
 
     broker_add_services (&ctx);
 
@@ -1101,6 +1119,42 @@ done:
     return (rv);
 }
 
+/* Record the duration of a bootstrap phase in attribute 'name'.
+ */
+static int boot_set_time (broker_ctx_t *ctx, const char *name, double sec)
+{
+    char buf[32];
+
+    snprintf (buf, sizeof (buf), "%.3f", sec);
+    if (attr_add (ctx->attrs, name, buf, FLUX_ATTRFLAG_IMMUTABLE) < 0) {
+        if (attr_set (ctx->attrs, name, buf, true) < 0
+                || attr_set_flags (ctx->attrs, name,
+                                   FLUX_ATTRFLAG_IMMUTABLE) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* If boot.get-batch is set, brokers are divided into batches of that many
+ * consecutive ranks, and each batch delays its PMI gets by boot.get-delay
+ * seconds more than the previous one, so that the PMI server is not hit
+ * by all brokers at once after the barrier.
+ */
+static double boot_get_stagger (broker_ctx_t *ctx)
+{
+    const char *s;
+    int batch = 0;
+    double delay = 0.01;
+
+    if (attr_get (ctx->attrs, "boot.get-batch", &s, NULL) == 0)
+        batch = strtol (s, NULL, 10);
+    if (attr_get (ctx->attrs, "boot.get-delay", &s, NULL) == 0)
+        delay = strtod (s, NULL);
+    if (batch <= 0 || delay <= 0)
+        return 0.;
+    return (ctx->rank / batch) * delay;
+}
+
 static int boot_pmi (broker_ctx_t *ctx, double *elapsed_sec)
 {
     int spawned, size, rank, appnum;
@@ -1114,7 +1168,9 @@ static int boot_pmi (broker_ctx_t *ctx, double *elapsed_sec)
     char *key = NULL;
     char *val = NULL;
     int e, rc = -1;
-    struct timespec start_time;
+    struct timespec start_time, phase_time;
+    double init_sec = 0, put_sec = 0, barrier_sec = 0, get_sec = 0;
+    double stagger_sec;
     const char *attrtbonendpoint;
     char *tbonendpoint = NULL;
     const char *attrmcastendpoint;
@@ -1256,6 +1312,8 @@ static int boot_pmi (broker_ctx_t *ctx, double *elapsed_sec)
         goto done;
     }
     val = xzmalloc (val_len);
+    init_sec = monotime_since (start_time) / 1000;
+    monotime (&phase_time);
 
     /* Bind to addresses to expand URI wildcards, so we can exchange
      * the real addresses.
@@ -1266,8 +1324,10 @@ static int boot_pmi (broker_ctx_t *ctx, double *elapsed_sec)
     }
 
     /* Write the URI of downstream facing socket under the rank (if any).
+     * Only our TBON children will read it, so leaves skip the put.
      */
-    if ((child_uri = overlay_get_child (ctx->overlay))) {
+    if (kary_childof (ctx->tbon.k, size, rank, 0) != KARY_NONE
+                && (child_uri = overlay_get_child (ctx->overlay))) {
         if (snprintf (key, key_len, "cmbd.%d.uri", rank) >= key_len) {
             log_msg ("pmi key string overflow");
             goto done;
@@ -1301,18 +1361,43 @@ static int boot_pmi (broker_ctx_t *ctx, double *elapsed_sec)
         }
     }
 
+    /* Rank 0 chooses a random nonce for the multicast event HMAC key.
+     * It need not be secret since the key also depends on the CURVE
+     * server secret, only fresh for each session.
+     */
+    if (strcasecmp (mcastendpoint, "tbon") && rank == 0) {
+        zuuid_t *uuid;
+        if (!(uuid = zuuid_new ()))
+            oom ();
+        ctx->hmac_nonce = xstrdup (zuuid_str (uuid));
+        zuuid_destroy (&uuid);
+        if ((e = PMI_KVS_Put (kvsname, "cmbd.hmac-nonce", ctx->hmac_nonce))
+                                                            != PMI_SUCCESS) {
+            log_msg ("PMI_KVS_Put: %s", pmi_strerror (e));
+            goto done;
+        }
+    }
+
     /* Puts are complete, now we synchronize and begin our gets.
      */
     if ((e = PMI_KVS_Commit (kvsname)) != PMI_SUCCESS) {
         log_msg ("PMI_KVS_Commit: %s", pmi_strerror (e));
         goto done;
     }
+    put_sec = monotime_since (phase_time) / 1000;
+    monotime (&phase_time);
     if ((e = PMI_Barrier ()) != PMI_SUCCESS) {
         log_msg ("PMI_Barrier: %s", pmi_strerror (e));
         goto done;
     }
+    barrier_sec = monotime_since (phase_time) / 1000;
+    monotime (&phase_time);
+
+    if ((stagger_sec = boot_get_stagger (ctx)) > 0)
+        usleep (stagger_sec * 1E6);
 
-    /* Read the uri of our parent, after computing its rank
+    /* Read the uri of our parent, after computing its rank.
+     * This is the only get made by brokers without a multicast relay.
      */
     if (ctx->rank > 0) {
         parent_rank = kary_parentof (ctx->tbon.k, ctx->rank);
@@ -1355,7 +1440,16 @@ static int boot_pmi (broker_ctx_t *ctx, double *elapsed_sec)
             overlay_set_event (ctx->overlay, "%s", val);
         } else
             overlay_set_event (ctx->overlay, mcastendpoint);
+        if (rank > 0) {
+            if ((e = PMI_KVS_Get (kvsname, "cmbd.hmac-nonce", val, val_len))
+                                                            != PMI_SUCCESS) {
+                log_msg ("PMI_KVS_Get: %s", pmi_strerror (e));
+                goto done;
+            }
+            ctx->hmac_nonce = xstrdup (val);
+        }
     }
+    get_sec = monotime_since (phase_time) / 1000;
     if ((e = PMI_Barrier ()) != PMI_SUCCESS) {
         log_msg ("PMI_Barrier: %s", pmi_strerror (e));
         goto done;
@@ -1364,6 +1458,16 @@ static int boot_pmi (broker_ctx_t *ctx, double *elapsed_sec)
     rc = 0;
 done:
     *elapsed_sec = monotime_since (start_time) / 1000;
+    if (rc == 0) {
+        if (boot_set_time (ctx, "boot.init-time", init_sec) < 0
+                || boot_set_time (ctx, "boot.put-time", put_sec) < 0
+                || boot_set_time (ctx, "boot.barrier-time", barrier_sec) < 0
+                || boot_set_time (ctx, "boot.get-time", get_sec) < 0
+                || boot_set_time (ctx, "boot.total-time", *elapsed_sec) < 0) {
+            log_err ("setting boot timing attributes");
+            rc = -1;
+        }
+    }
     if (id)
         free (id);
     if (clique_ranks)
@@ -29,11 +29,14 @@
 #endif
 #include <inttypes.h>
 #include <czmq.h>
+#include <jansson.h>
 #include <flux/core.h>
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/iterators.h"
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libminilzo/minilzo.h"
 
 #include "attr.h"
 #include "content-cache.h"
@@ -44,6 +47,25 @@ static const uint32_t default_cache_purge_target_size = 1024*1024*16;
 static const uint32_t default_cache_purge_old_entry = 5;
 static const uint32_t default_cache_purge_large_entry = 256;
 
+/* Clean entries that have not been used for compress_old_entry heartbeats
+ * and are at least compress_min_size bytes are LZO compressed in place.
+ * If compression would not save at least 1/8 of the size, the entry is
+ * left alone and not considered again.
+ */
+static const uint32_t default_cache_compress_old_entry = 2;
+static const uint32_t default_cache_compress_min_size = 256;
+
+/* When a loaded blob is an RFC 11 directory, the blobs of its dirref
+ * entries may be loaded speculatively, up to prefetch_limit per directory
+ * and prefetch_depth levels below the blob that was actually requested,
+ * so a KVS walk that follows finds them already cached (or in flight).
+ * Directories larger than prefetch_max_size are not examined.
+ * Prefetch is disabled by default (depth 0).
+ */
+static const uint32_t default_prefetch_depth = 0;
+static const uint32_t default_prefetch_limit = 64;
+static const uint32_t default_prefetch_max_size = 1024*1024;
+
 /* Raise the max blob size value to 1GB so that large KVS values
  * (including KVS directories) can be supported while the KVS transitions
  * to the RFC 11 treeobj data representation.
@@ -53,6 +75,19 @@ static const uint32_t default_blob_size_limit = 1048576*1024;
 
 static const uint32_t default_flush_batch_limit = 256;
 
+/* The number of outstanding flush stores (the window) adapts between
+ * flush_window_min and flush-batch-limit:  it grows by one per window of
+ * stores that complete near the fastest latency seen, and is halved when
+ * store latency exceeds flush_latency_backoff times that baseline, or on
+ * error.  The baseline is re-established every flush_latency_rebase stores
+ * so that a change in blob sizes does not pin the window at its minimum.
+ */
+static const uint32_t flush_window_min = 4;
+static const uint32_t flush_window_initial = 64;
+static const double flush_latency_grow = 2.;
+static const double flush_latency_backoff = 4.;
+static const int flush_latency_rebase = 4096;
+
 
 struct cache_entry {
     void *data;
@@ -63,9 +98,16 @@ struct cache_entry {
                                     /*   or to backing store (rank 0) */
     uint8_t load_pending:1;
     uint8_t store_pending:1;
+    uint8_t on_dirty_list:1;
+    uint8_t compressed:1;           /* data holds 'zlen' bytes of LZO */
+    uint8_t incompressible:1;
+    int depth;                      /* prefetch depth (0 = on demand) */
+    int zlen;
     zlist_t *load_requests;
     zlist_t *store_requests;
     int lastused;
+    struct cache_entry *dirty_prev; /* dirty list (dirty, !store_pending) */
+    struct cache_entry *dirty_next;
 };
 
 struct content_cache {
@@ -74,27 +116,56 @@ struct content_cache {
     uint32_t rank;
     zhash_t *entries;
     uint8_t backing:1;              /* 'content.backing' service available */
+    uint8_t backing_gc:1;           /* backing store is collecting garbage */
     char *backing_name;
     char hash_name[BLOBREF_MAX_STRING_SIZE];
     zlist_t *flush_requests;
     int epoch;
 
+    struct cache_entry *dirty_head; /* FIFO of entries awaiting a store */
+    struct cache_entry *dirty_tail;
+
     uint32_t blob_size_limit;
     uint32_t flush_batch_limit;
     uint32_t flush_batch_count;
+    uint32_t flush_window;          /* adaptive limit <= flush_batch_limit */
+    int flush_window_credit;
+    int flush_window_hold;          /* stores to wait before next backoff */
+    double flush_latency_min;       /* baseline store latency (msec) */
+    int flush_latency_count;
+    uint32_t flush_latency_us;      /* smoothed store latency */
 
     uint32_t purge_target_entries;
     uint32_t purge_target_size;
     uint32_t purge_old_entry;
     uint32_t purge_large_entry;
 
+    uint32_t compress_old_entry;
+    uint32_t compress_min_size;
+
+    uint32_t prefetch_depth;
+    uint32_t prefetch_limit;
+    uint32_t prefetch_max_size;
+    uint8_t lzo_initialized:1;
+    void *lzo_buf;
+    size_t lzo_bufsize;
+    void *lzo_wrkmem;
+
     uint32_t acct_size;             /* total size of all cache entries */
+    uint32_t acct_stored_size;      /*   as actually stored (compressed) */
+    uint32_t acct_compressed;       /* count of compressed cache entries */
+    uint32_t acct_prefetch;         /* count of prefetch loads issued */
+    uint32_t acct_load_requests;    /* load requests received */
+    uint32_t acct_load_hits;        /*   answered from cache */
+    uint32_t acct_load_coalesced;   /*   parked on a load already in flight */
+    uint32_t acct_load_misses;      /*   that started a new load */
     uint32_t acct_valid;            /* count of valid cache entries */
     uint32_t acct_dirty;            /* count of dirty cache entries */
 };
 
 static void flush_respond (content_cache_t *cache);
 static int cache_flush (content_cache_t *cache);
+static void cache_prefetch (content_cache_t *cache, struct cache_entry *e);
 
 static void message_list_destroy (zlist_t **l)
 {
@@ -154,6 +225,52 @@ error:
     return -1;
 }
 
+/* Dirty list
+ * Entries that are dirty but have no store in progress are kept on a FIFO
+ * so that flushing can find them without walking the entire cache.
+ */
+static void dirty_list_append (content_cache_t *cache, struct cache_entry *e)
+{
+    if (e->on_dirty_list)
+        return;
+    e->dirty_prev = cache->dirty_tail;
+    e->dirty_next = NULL;
+    if (cache->dirty_tail)
+        cache->dirty_tail->dirty_next = e;
+    else
+        cache->dirty_head = e;
+    cache->dirty_tail = e;
+    e->on_dirty_list = 1;
+}
+
+static void dirty_list_remove (content_cache_t *cache, struct cache_entry *e)
+{
+    if (!e->on_dirty_list)
+        return;
+    if (e->dirty_prev)
+        e->dirty_prev->dirty_next = e->dirty_next;
+    else
+        cache->dirty_head = e->dirty_next;
+    if (e->dirty_next)
+        e->dirty_next->dirty_prev = e->dirty_prev;
+    else
+        cache->dirty_tail = e->dirty_prev;
+    e->dirty_prev = e->dirty_next = NULL;
+    e->on_dirty_list = 0;
+}
+
+/* Mark an entry dirty and queue it for flushing.
+ */
+static void set_dirty (content_cache_t *cache, struct cache_entry *e)
+{
+    if (!e->dirty) {
+        e->dirty = 1;
+        cache->acct_dirty++;
+    }
+    if (!e->store_pending)
+        dirty_list_append (cache, e);
+}
+
 /* Destroy a cache entry
  */
 static void cache_entry_destroy (void *arg)
@@ -214,6 +331,82 @@ done:
     return rc;
 }
 
+/* Return the number of bytes an entry occupies in memory.
+ */
+static int cache_entry_stored_size (struct cache_entry *e)
+{
+    return e->compressed ? e->zlen : e->len;
+}
+
+/* Compress a valid, clean entry in place.
+ * Returns 1 if compressed, 0 if not worthwhile, -1 on failure with errno set.
+ */
+static int cache_entry_deflate (content_cache_t *cache, struct cache_entry *e)
+{
+    lzo_uint out_len = e->len + e->len / 16 + 64 + 3;
+    void *data;
+
+    assert (e->valid && !e->dirty && !e->store_pending && !e->compressed);
+    if (cache->lzo_bufsize < out_len) {
+        if (!(data = realloc (cache->lzo_buf, out_len))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        cache->lzo_buf = data;
+        cache->lzo_bufsize = out_len;
+    }
+    if (lzo1x_1_compress (e->data, e->len, cache->lzo_buf, &out_len,
+                          cache->lzo_wrkmem) != LZO_E_OK) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (out_len > e->len - e->len / 8) {
+        e->incompressible = 1;
+        return 0;
+    }
+    if (!(data = malloc (out_len))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy (data, cache->lzo_buf, out_len);
+    free (e->data);
+    e->data = data;
+    e->zlen = out_len;
+    e->compressed = 1;
+    cache->acct_stored_size -= e->len - e->zlen;
+    cache->acct_compressed++;
+    return 1;
+}
+
+/* Restore the uncompressed data of an entry, if compressed.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int cache_entry_inflate (content_cache_t *cache, struct cache_entry *e)
+{
+    lzo_uint out_len = e->len;
+    void *data;
+
+    if (!e->compressed)
+        return 0;
+    if (!(data = malloc (e->len))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (lzo1x_decompress_safe (e->data, e->zlen, data, &out_len, NULL)
+                                    != LZO_E_OK || out_len != e->len) {
+        free (data);
+        errno = EIO;
+        return -1;
+    }
+    free (e->data);
+    e->data = data;
+    cache->acct_stored_size += e->len - e->zlen;
+    cache->acct_compressed--;
+    e->zlen = 0;
+    e->compressed = 0;
+    return 0;
+}
+
 /* Insert a cache entry, by blobref.
  * Returns 0 on success, -1 on failure with errno set.
  * Side effect: destroys entry on failure.
@@ -228,10 +421,14 @@ static int insert_entry (content_cache_t *cache, struct cache_entry *e)
     zhash_freefn (cache->entries, e->blobref, cache_entry_destroy);
     if (e->valid) {
         cache->acct_size += e->len;
+        cache->acct_stored_size += cache_entry_stored_size (e);
         cache->acct_valid++;
     }
-    if (e->dirty)
+    if (e->dirty) {
         cache->acct_dirty++;
+        if (!e->store_pending)
+            dirty_list_append (cache, e);
+    }
     return 0;
 }
 
@@ -251,10 +448,14 @@ static void remove_entry (content_cache_t *cache, struct cache_entry *e)
 {
     if (e->valid) {
         cache->acct_size -= e->len;
+        cache->acct_stored_size -= cache_entry_stored_size (e);
         cache->acct_valid--;
     }
+    if (e->compressed)
+        cache->acct_compressed--;
     if (e->dirty)
         cache->acct_dirty--;
+    dirty_list_remove (cache, e);
     zhash_delete (cache->entries, e->blobref);
 }
 
@@ -296,6 +497,7 @@ static void cache_load_continuation (flux_future_t *f, void *arg)
         e->valid = 1;
         cache->acct_valid++;
         cache->acct_size += len;
+        cache->acct_stored_size += len;
     }
     e->lastused = cache->epoch;
     rc = 0;
@@ -307,6 +509,8 @@ done:
                         __FUNCTION__);
     if (rc < 0)
         remove_entry (cache, e);
+    else if (e->depth < cache->prefetch_depth)
+        cache_prefetch (cache, e);
     flux_future_destroy (f);
 }
 
@@ -347,6 +551,75 @@ done:
     return rc;
 }
 
+/* Prefetch
+ * If 'e' holds an RFC 11 directory, start loading the blobs referenced by
+ * its dirref entries that are not already cached.  There are no requests
+ * parked on these entries;  once loaded they are ordinary clean entries.
+ */
+static void prefetch_blobref (content_cache_t *cache, struct cache_entry *e,
+                              const char *blobref)
+{
+    struct cache_entry *e2;
+
+    if (cache->rank == 0 && !cache->backing)
+        return;
+    if (lookup_entry (cache, blobref) || blobref_validate (blobref) < 0)
+        return;
+    if (!(e2 = cache_entry_create (blobref))
+                                        || insert_entry (cache, e2) < 0) {
+        flux_log_error (cache->h, "content prefetch");
+        return; /* insert destroys 'e2' on failure */
+    }
+    e2->depth = e->depth + 1;
+    e2->lastused = cache->epoch;
+    if (cache_load (cache, e2) < 0) {
+        remove_entry (cache, e2);
+        return;
+    }
+    cache->acct_prefetch++;
+}
+
+static void cache_prefetch (content_cache_t *cache, struct cache_entry *e)
+{
+    json_t *o = NULL;
+    json_t *data;
+    json_t *entry;
+    json_t *refs;
+    json_t *ref;
+    const char *name;
+    const char *type;
+    size_t index;
+    int count = 0;
+
+    if (cache->prefetch_limit == 0 || e->len > cache->prefetch_max_size
+                                   || e->len == 0
+                                   || ((char *)e->data)[0] != '{')
+        return;
+    /* Blobs may carry a trailing NUL, hence DISABLE_EOF_CHECK.
+     */
+    if (!(o = json_loadb (e->data, e->len, JSON_DISABLE_EOF_CHECK, NULL)))
+        return;
+    if (json_unpack (o, "{s:s s:o}", "type", &type, "data", &data) < 0
+                    || strcmp (type, "dir") != 0 || !json_is_object (data))
+        goto done;
+    json_object_foreach (data, name, entry) {
+        if (json_unpack (entry, "{s:s s:o}", "type", &type,
+                                             "data", &refs) < 0
+                    || strcmp (type, "dirref") != 0 || !json_is_array (refs))
+            continue;
+        json_array_foreach (refs, index, ref) {
+            if (count == cache->prefetch_limit)
+                goto done;
+            if (!json_is_string (ref))
+                continue;
+            prefetch_blobref (cache, e, json_string_value (ref));
+            count++;
+        }
+    }
+done:
+    json_decref (o);
+}
+
 void content_load_request (flux_t *h, flux_msg_handler_t *w,
                            const flux_msg_t *msg, void *arg)
 {
@@ -356,6 +629,7 @@ void content_load_request (flux_t *h, flux_msg_handler_t *w,
     void *data = NULL;
     int len = 0;
     struct cache_entry *e;
+    bool prefetch = false;
     int saved_errno = 0;
     int rc = -1;
 
@@ -368,6 +642,7 @@ void content_load_request (flux_t *h, flux_msg_handler_t *w,
         saved_errno = errno = EPROTO;
         goto done;
     }
+    cache->acct_load_requests++;
     if (!(e = lookup_entry (cache, blobref))) {
         if (cache->rank == 0 && !cache->backing) {
             saved_errno = errno = ENOENT;
@@ -380,7 +655,23 @@ void content_load_request (flux_t *h, flux_msg_handler_t *w,
             goto done; /* insert destroys 'e' on failure */
         }
     }
+    /* A real request for a prefetched entry makes it the new origin of
+     * prefetch, so a walker stays prefetch_depth levels ahead.  If the
+     * entry is still loading, the load continuation prefetches from it.
+     */
+    if (e->depth > 0) {
+        e->depth = 0;
+        prefetch = e->valid && cache->prefetch_depth > 0;
+    }
+    /* Identical loads from this broker and its TBON children are
+     * coalesced onto one pending load, so a broadcast read costs each
+     * level of the tree one upstream request.
+     */
     if (!e->valid) {
+        if (e->load_pending)
+            cache->acct_load_coalesced++;
+        else
+            cache->acct_load_misses++;
         if (cache_load (cache, e) < 0) {
             saved_errno = errno;
             goto done;
@@ -392,6 +683,12 @@ void content_load_request (flux_t *h, flux_msg_handler_t *w,
         }
         return; /* RPC continuation will respond to msg */
     }
+    if (cache_entry_inflate (cache, e) < 0) {
+        saved_errno = errno;
+        flux_log_error (h, "content load: inflate");
+        goto done;
+    }
+    cache->acct_load_hits++;
     e->lastused = cache->epoch;
     data = e->data;
     len = e->len;
@@ -401,6 +698,8 @@ done:
     if (flux_respond_raw (h, msg, rc < 0 ? saved_errno : 0,
                                                         data, len) < 0)
         flux_log_error (h, "content load");
+    if (rc == 0 && prefetch)
+        cache_prefetch (cache, e);
 }
 
 /* Store operation
@@ -422,10 +721,49 @@ done:
  * offload rank 0 hash entries at a slower pace.
  */
 
+/* Adjust the flush window after a store completes in 'latency' msec,
+ * or fails (latency < 0).
+ */
+static void flush_window_update (content_cache_t *cache, double latency)
+{
+    uint32_t max = cache->flush_batch_limit;
+    uint32_t min = flush_window_min < max ? flush_window_min : max;
+    double avg = cache->flush_latency_us / 1000.;
+
+    if (latency >= 0) {
+        avg = avg > 0 ? avg + (latency - avg) / 8 : latency;
+        cache->flush_latency_us = avg * 1000;
+        if (cache->flush_latency_min == 0 || latency < cache->flush_latency_min
+                        || ++cache->flush_latency_count > flush_latency_rebase) {
+            cache->flush_latency_min = latency < avg ? latency : avg;
+            cache->flush_latency_count = 0;
+        }
+    }
+    if (cache->flush_window_hold > 0)
+        cache->flush_window_hold--;
+    if (latency < 0 || avg > cache->flush_latency_min * flush_latency_backoff) {
+        if (cache->flush_window_hold == 0) {
+            cache->flush_window /= 2;
+            cache->flush_window_credit = 0;
+            cache->flush_window_hold = cache->flush_batch_count;
+        }
+    } else if (latency <= cache->flush_latency_min * flush_latency_grow) {
+        if (++cache->flush_window_credit >= cache->flush_window) {
+            cache->flush_window++;
+            cache->flush_window_credit = 0;
+        }
+    }
+    if (cache->flush_window < min)
+        cache->flush_window = min;
+    if (cache->flush_window > max)
+        cache->flush_window = max;
+}
+
 static void cache_store_continuation (flux_future_t *f, void *arg)
 {
     content_cache_t *cache = arg;
     struct cache_entry *e = flux_future_aux_get (f, "entry");
+    struct timespec *t0 = flux_future_aux_get (f, "t0");
     const char *blobref;
     int saved_errno = 0;
     int rc = -1;
@@ -453,6 +791,10 @@ static void cache_store_continuation (flux_future_t *f, void *arg)
     }
     rc = 0;
 done:
+    if (rc < 0 && e->dirty)
+        dirty_list_append (cache, e);  /* retry on a later flush */
+    if (!(rc < 0 && saved_errno == ENOSYS))
+        flush_window_update (cache, rc < 0 ? -1. : monotime_since (*t0));
     if (respond_requests_raw (&e->store_requests, cache->h,
                                         rc < 0 ? saved_errno : 0,
                                         e->blobref, strlen (e->blobref) + 1) < 0)
@@ -462,21 +804,19 @@ done:
 
     /* If cache has been flushed, respond to flush requests, if any.
      * If there are still dirty entries and the number of outstanding
-     * store requests would not exceed the limit, flush more entries.
-     * Optimization: since scanning for dirty entries is a linear search,
-     * only do it when the number of outstanding store requests falls to
-     * a low water mark, here hardwired to be half of the limit.
+     * store requests is below the window, flush more entries.
      */
     if (cache->acct_dirty == 0 || (cache->rank == 0 && !cache->backing))
         flush_respond (cache);
-    else if (cache->acct_dirty - cache->flush_batch_count > 0
-            && cache->flush_batch_count <= cache->flush_batch_limit / 2)
+    else if (cache->dirty_head
+            && cache->flush_batch_count < cache->flush_window)
         (void)cache_flush (cache); /* resume flushing */
 }
 
 static int cache_store (content_cache_t *cache, struct cache_entry *e)
 {
     flux_future_t *f;
+    struct timespec *t0 = NULL;
     int saved_errno = 0;
     int flags = CONTENT_FLAG_UPSTREAM;
     int rc = -1;
@@ -486,17 +826,33 @@ static int cache_store (content_cache_t *cache, struct cache_entry *e)
     if (e->store_pending)
         return 0;
     if (cache->rank == 0) {
-        if (cache->flush_batch_count >= cache->flush_batch_limit)
+        if (cache->flush_batch_count >= cache->flush_window)
             return 0;
         flags = CONTENT_FLAG_CACHE_BYPASS;
     }
+    if (cache_entry_inflate (cache, e) < 0) {
+        saved_errno = errno;
+        flux_log_error (cache->h, "content store: inflate");
+        goto done;
+    }
     if (!(f = flux_content_store (cache->h, e->data, e->len, flags))) {
         saved_errno = errno;
         flux_log_error (cache->h, "content store");
         goto done;
     }
-    if (flux_future_aux_set (f, "entry", e, NULL) < 0) {
+    if (!(t0 = malloc (sizeof (*t0)))) {
+        saved_errno = errno = ENOMEM;
+        flux_log_error (cache->h, "content store");
+        flux_future_destroy (f);
+        goto done;
+    }
+    monotime (t0);
+    if (flux_future_aux_set (f, "entry", e, NULL) < 0
+            || flux_future_aux_set (f, "t0", t0, free) < 0) {
+        saved_errno = errno;
         flux_log_error (cache->h, "content store: flux_future_aux_set");
+        free (t0);
+        flux_future_destroy (f);
         goto done;
     }
     if (flux_future_then (f, -1., cache_store_continuation, cache) < 0) {
@@ -506,6 +862,7 @@ static int cache_store (content_cache_t *cache, struct cache_entry *e)
         goto done;
     }
     e->store_pending = 1;
+    dirty_list_remove (cache, e);
     cache->flush_batch_count++;
     rc = 0;
 done:
@@ -547,17 +904,21 @@ static void content_store_request (flux_t *h, flux_msg_handler_t *w,
             e->valid = 1;
             cache->acct_valid++;
             cache->acct_size += len;
+            cache->acct_stored_size += len;
         }
         if (respond_requests_raw (&e->load_requests, cache->h, 0,
                                                         e->data, e->len) < 0)
             flux_log_error (cache->h, "%s: error responding to load requests",
                             __FUNCTION__);
-        if (!e->dirty) {
-            e->dirty = 1;
-            cache->acct_dirty++;
-        }
+        set_dirty (cache, e);
     }
     e->lastused = cache->epoch;
+    /* While the backing store is collecting garbage, pass through stores
+     * of blobs that are clean in cache, so the collector sees they are
+     * in use again.
+     */
+    if (cache->rank == 0 && cache->backing && cache->backing_gc)
+        set_dirty (cache, e);
     if (e->dirty) {
         if (cache->rank > 0 || cache->backing) {
             if (cache_store (cache, e) < 0)
@@ -573,10 +934,8 @@ static void content_store_request (flux_t *h, flux_msg_handler_t *w,
          * cache->backing then attempt to store all its blobs.  Any of
          * those still in cache need to be marked dirty.
          */
-        if (cache->rank == 0 && !cache->backing) {
-            e->dirty = 1;
-            cache->acct_dirty++;
-        }
+        if (cache->rank == 0 && !cache->backing)
+            set_dirty (cache, e);
     }
     rc = 0;
 done:
@@ -602,34 +961,33 @@ done:
  * the cache.
  */
 
+/* Issue stores for dirty entries in FIFO order, until the window of
+ * outstanding stores is full.  cache_store() takes each entry off the
+ * dirty list, so this is O(stores issued), not O(cache size).
+ */
 static int cache_flush (content_cache_t *cache)
 {
-    struct cache_entry *e;
-    const char *key;
-    int saved_errno = 0;
     int count = 0;
     int rc = 0;
 
-    if (cache->acct_dirty - cache->flush_batch_count == 0
-            || cache->flush_batch_count >= cache->flush_batch_limit)
+    if (cache->flush_window > cache->flush_batch_limit)
+        cache->flush_window = cache->flush_batch_limit;
+    if (!cache->dirty_head || cache->flush_batch_count >= cache->flush_window)
         return 0;
 
     flux_log (cache->h, LOG_DEBUG, "content flush begin");
-    FOREACH_ZHASH (cache->entries, key, e) {
-        if (!e->dirty || e->store_pending)
-            continue;
-        if (cache_store (cache, e) < 0) {
-            saved_errno = errno;
+    while (cache->dirty_head
+                && cache->flush_batch_count < cache->flush_window) {
+        if (cache_store (cache, cache->dirty_head) < 0) {
             rc = -1;
+            break;
         }
         count++;
-        if (cache->flush_batch_count >= cache->flush_batch_limit)
-            break;
     }
-    flux_log (cache->h, LOG_DEBUG, "content flush +%d (dirty=%d pending=%d)",
-              count, cache->acct_dirty, cache->flush_batch_count);
-    if (rc < 0)
-        errno = saved_errno;
+    flux_log (cache->h, LOG_DEBUG,
+              "content flush +%d (dirty=%d pending=%d window=%d)",
+              count, cache->acct_dirty, cache->flush_batch_count,
+              cache->flush_window);
     return rc;
 }
 
@@ -657,6 +1015,7 @@ static void content_backing_request (flux_t *h, flux_msg_handler_t *w,
         (void)cache_flush (cache);
     } else if (cache->backing && !backing) {
         cache->backing = 0;
+        cache->backing_gc = 0;
         if (cache->backing_name)
             free (cache->backing_name);
         cache->backing_name = NULL;
@@ -668,6 +1027,100 @@ done:
         flux_log_error (h, "content backing");
 };
 
+/* The backing store module brackets a garbage collection with these
+ * requests.  See content_store_request().
+ */
+static void content_backing_gc_request (flux_t *h, flux_msg_handler_t *w,
+                                        const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    int active;
+    int rc = -1;
+
+    if (flux_request_unpack (msg, NULL, "{ s:b }", "active", &active) < 0)
+        goto done;
+    if (cache->rank != 0 || !cache->backing) {
+        errno = EINVAL;
+        goto done;
+    }
+    cache->backing_gc = active ? 1 : 0;
+    flux_log (h, LOG_DEBUG, "content backing store: gc %s",
+              active ? "begin" : "end");
+    rc = 0;
+done:
+    if (flux_respond (h, msg, rc < 0 ? errno : 0, NULL) < 0)
+        flux_log_error (h, "content backing-gc");
+}
+
+/* Drop clean entries for blobs the backing store has deleted, so that a
+ * later store of one is not satisfied from cache.  Rank 0 drops its own
+ * before responding, then publishes the list for the other ranks, whose
+ * write-through stores are satisfied from cache the same way.
+ */
+static int drop_entries (content_cache_t *cache, json_t *blobrefs)
+{
+    struct cache_entry *e;
+    json_t *o;
+    size_t index;
+    int count = 0;
+
+    json_array_foreach (blobrefs, index, o) {
+        if (!json_is_string (o))
+            continue;
+        e = lookup_entry (cache, json_string_value (o));
+        if (e && e->valid && !e->dirty) {
+            remove_entry (cache, e);
+            count++;
+        }
+    }
+    return count;
+}
+
+static void content_drop_request (flux_t *h, flux_msg_handler_t *w,
+                                  const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    json_t *blobrefs;
+    flux_msg_t *event = NULL;
+    int count;
+    int rc = -1;
+
+    if (flux_request_unpack (msg, NULL, "{ s:o }", "blobrefs", &blobrefs) < 0)
+        goto done;
+    if (cache->rank != 0 || !json_is_array (blobrefs)) {
+        errno = EINVAL;
+        goto done;
+    }
+    count = drop_entries (cache, blobrefs);
+    flux_log (h, LOG_DEBUG, "content drop %d/%d", count,
+              (int)json_array_size (blobrefs));
+    if (!(event = flux_event_pack ("content.drop", "{ s:O }",
+                                   "blobrefs", blobrefs))
+            || flux_send (h, event, 0) < 0)
+        goto done;
+    rc = 0;
+done:
+    if (flux_respond (h, msg, rc < 0 ? errno : 0, NULL) < 0)
+        flux_log_error (h, "content drop");
+    flux_msg_destroy (event);
+}
+
+static void content_drop_event (flux_t *h, flux_msg_handler_t *w,
+                                const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    json_t *blobrefs;
+
+    if (cache->rank == 0)
+        return;
+    if (flux_event_unpack (msg, NULL, "{ s:o }", "blobrefs", &blobrefs) < 0
+            || !json_is_array (blobrefs)) {
+        flux_log_error (h, "content drop event");
+        return;
+    }
+    (void)drop_entries (cache, blobrefs);
+}
+
 /* Forcibly drop all entries from the cache that can be dropped
  * without data loss.
  * N.B. this walks the entire cache in one go.
@@ -723,11 +1176,20 @@ static void content_stats_request (flux_t *h, flux_msg_handler_t *w,
 
     if (flux_request_decode (msg, NULL, NULL) < 0)
         goto error;
-    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i}",
+    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:i s:i s:i"
+                                   " s:{s:i s:i s:i s:i}}",
                            "count", zhash_size (cache->entries),
                            "valid", cache->acct_valid,
                            "dirty", cache->acct_dirty,
-                           "size", cache->acct_size) < 0)
+                           "size", cache->acct_size,
+                           "stored-size", cache->acct_stored_size,
+                           "compressed", cache->acct_compressed,
+                           "prefetch", cache->acct_prefetch,
+                           "load",
+                             "requests", cache->acct_load_requests,
+                             "hits", cache->acct_load_hits,
+                             "coalesced", cache->acct_load_coalesced,
+                             "misses", cache->acct_load_misses) < 0)
         flux_log_error (h, "content stats");
     return;
 error:
@@ -802,7 +1264,7 @@ done:
 static int cache_purge (content_cache_t *cache)
 {
     int after_entries = zhash_size (cache->entries);
-    int after_size = cache->acct_size;
+    int after_size = cache->acct_stored_size;
     struct cache_entry *e;
     zlist_t *purge = NULL;
     int rc = -1;
@@ -827,7 +1289,7 @@ static int cache_purge (content_cache_t *cache)
             errno = ENOMEM;
             goto done;
         }
-        after_size -= e->len;
+        after_size -= cache_entry_stored_size (e);
         after_entries--;
     }
     if (purge) {
@@ -842,6 +1304,36 @@ done:
     return rc;
 }
 
+/* Compress clean entries that have gone cold.
+ * They are transparently inflated again when next loaded or stored.
+ */
+static void cache_compress (content_cache_t *cache)
+{
+    struct cache_entry *e;
+    const char *key;
+    int count = 0;
+
+    if (!cache->lzo_initialized || cache->compress_old_entry == 0
+                                || cache->acct_dirty == cache->acct_valid)
+        return;
+    FOREACH_ZHASH (cache->entries, key, e) {
+        if (!e->valid || e->dirty || e->store_pending || e->compressed
+                      || e->incompressible)
+            continue;
+        if (e->len < cache->compress_min_size)
+            continue;
+        if (cache->epoch - e->lastused < cache->compress_old_entry)
+            continue;
+        if (cache_entry_deflate (cache, e) < 0) {
+            flux_log_error (cache->h, "content compress");
+            break;
+        }
+        count++;
+    }
+    if (count > 0)
+        flux_log (cache->h, LOG_DEBUG, "content compress: %d entries", count);
+}
+
 static void heartbeat_event (flux_t *h, flux_msg_handler_t *w,
                              const flux_msg_t *msg, void *arg)
 {
@@ -850,6 +1342,7 @@ static void heartbeat_event (flux_t *h, flux_msg_handler_t *w,
     if (flux_heartbeat_decode (msg, &cache->epoch) < 0)
         return; /* ignore mangled heartbeat */
     cache_purge (cache);
+    cache_compress (cache);
 }
 
 /* Initialization
@@ -859,6 +1352,9 @@ static struct flux_msg_handler_spec handlers[] = {
     { FLUX_MSGTYPE_REQUEST, "content.load",      content_load_request, FLUX_ROLE_USER, NULL },
     { FLUX_MSGTYPE_REQUEST, "content.store",     content_store_request, FLUX_ROLE_USER, NULL },
     { FLUX_MSGTYPE_REQUEST, "content.backing",   content_backing_request, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "content.backing-gc", content_backing_gc_request, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "content.drop",      content_drop_request, 0, NULL },
+    { FLUX_MSGTYPE_EVENT,   "content.drop",      content_drop_event, 0, NULL },
     { FLUX_MSGTYPE_REQUEST, "content.dropcache", content_dropcache_request, 0, NULL },
     { FLUX_MSGTYPE_REQUEST, "content.stats.get", content_stats_request, 0, NULL },
     { FLUX_MSGTYPE_REQUEST, "content.flush",     content_flush_request, 0, NULL },
@@ -876,6 +1372,8 @@ int content_cache_set_flux (content_cache_t *cache, flux_t *h)
         return -1;
     if (flux_event_subscribe (h, "hb") < 0)
         return -1;
+    if (flux_event_subscribe (h, "content.drop") < 0)
+        return -1;
     return 0;
 }
 
@@ -933,6 +1431,25 @@ int content_cache_register_attrs (content_cache_t *cache, attr_t *attr)
     if (attr_add_active_uint32 (attr, "content.purge-large-entry",
                 &cache->purge_large_entry, 0) < 0)
         return -1;
+    /* Compression tunables
+     */
+    if (attr_add_active_uint32 (attr, "content.compress-old-entry",
+                &cache->compress_old_entry, 0) < 0)
+        return -1;
+    if (attr_add_active_uint32 (attr, "content.compress-min-size",
+                &cache->compress_min_size, 0) < 0)
+        return -1;
+    /* Prefetch tunables
+     */
+    if (attr_add_active_uint32 (attr, "content.prefetch-depth",
+                &cache->prefetch_depth, 0) < 0)
+        return -1;
+    if (attr_add_active_uint32 (attr, "content.prefetch-limit",
+                &cache->prefetch_limit, 0) < 0)
+        return -1;
+    if (attr_add_active_uint32 (attr, "content.prefetch-max-size",
+                &cache->prefetch_max_size, 0) < 0)
+        return -1;
     /* Accounting numbers
      */
     if (attr_add_active_uint32 (attr, "content.acct-size",
@@ -944,6 +1461,12 @@ int content_cache_register_attrs (content_cache_t *cache, attr_t *attr)
     if (attr_add_active_uint32 (attr, "content.acct-valid",
                 &cache->acct_valid, FLUX_ATTRFLAG_READONLY) < 0)
         return -1;
+    if (attr_add_active_uint32 (attr, "content.acct-stored-size",
+                &cache->acct_stored_size, FLUX_ATTRFLAG_READONLY) < 0)
+        return -1;
+    if (attr_add_active_uint32 (attr, "content.acct-compressed",
+                &cache->acct_compressed, FLUX_ATTRFLAG_READONLY) < 0)
+        return -1;
     if (attr_add_active (attr, "content.acct-entries", FLUX_ATTRFLAG_READONLY,
                 content_cache_getattr, NULL, cache) < 0)
         return -1;
@@ -961,6 +1484,12 @@ int content_cache_register_attrs (content_cache_t *cache, attr_t *attr)
     if (attr_add_active_uint32 (attr, "content.flush-batch-count",
                 &cache->flush_batch_count, 0) < 0)
         return -1;
+    if (attr_add_active_uint32 (attr, "content.flush-batch-window",
+                &cache->flush_window, FLUX_ATTRFLAG_READONLY) < 0)
+        return -1;
+    if (attr_add_active_uint32 (attr, "content.flush-latency-us",
+                &cache->flush_latency_us, FLUX_ATTRFLAG_READONLY) < 0)
+        return -1;
     /* content-hash can be set on the command line
      */
     if (attr_add_active (attr, "content.hash", FLUX_ATTRFLAG_IMMUTABLE,
@@ -976,12 +1505,15 @@ void content_cache_destroy (content_cache_t *cache)
     if (cache) {
         if (cache->h) {
             (void)flux_event_unsubscribe (cache->h, "hb");
+            (void)flux_event_unsubscribe (cache->h, "content.drop");
             flux_msg_handler_delvec (handlers);
         }
         if (cache->backing_name)
             free (cache->backing_name);
         zhash_destroy (&cache->entries);
         message_list_destroy (&cache->flush_requests);
+        free (cache->lzo_buf);
+        free (cache->lzo_wrkmem);
         free (cache);
     }
 }
@@ -1001,10 +1533,19 @@ content_cache_t *content_cache_create (void)
     cache->rank = FLUX_NODEID_ANY;
     cache->blob_size_limit = default_blob_size_limit;
     cache->flush_batch_limit = default_flush_batch_limit;
+    cache->flush_window = flush_window_initial;
     cache->purge_target_entries = default_cache_purge_target_entries;
     cache->purge_target_size = default_cache_purge_target_size;
     cache->purge_old_entry = default_cache_purge_old_entry;
     cache->purge_large_entry = default_cache_purge_large_entry;
+    cache->compress_old_entry = default_cache_compress_old_entry;
+    cache->compress_min_size = default_cache_compress_min_size;
+    cache->prefetch_depth = default_prefetch_depth;
+    cache->prefetch_limit = default_prefetch_limit;
+    cache->prefetch_max_size = default_prefetch_max_size;
+    if (lzo_init () == LZO_E_OK
+                && (cache->lzo_wrkmem = malloc (LZO1X_1_MEM_COMPRESS)))
+        cache->lzo_initialized = 1;
     strcpy (cache->hash_name, "sha1");
     return cache;
 }
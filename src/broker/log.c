@@ -26,6 +26,7 @@
 #include "config.h"
 #endif
 #include <czmq.h>
+#include <jansson.h>
 
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/oom.h"
@@ -42,6 +43,11 @@ static const int default_critical_level = LOG_CRIT;
 static const int default_stderr_level = LOG_ERR;
 static const int default_level = LOG_DEBUG;
 
+/* Limits on the entries returned in one log.dmesg response.
+ */
+static const int dmesg_max_entries = 256;
+static const int dmesg_max_bytes = 65536;
+
 #define LOGBUF_MAGIC 0xe1e2e3e4
 typedef struct {
     int magic;
@@ -53,16 +59,19 @@ typedef struct {
     int critical_level;
     int stderr_level;
     int level;
-    zlist_t *buf;
+    struct logbuf_entry *ring;  // entry seq is in slot (seq % ring_size)
     int ring_size;
-    int seq;
+    int seq;                    // seq of next entry to be appended
+    int first_seq;              // seq of oldest entry in ring
     zlist_t *sleepers;
 } logbuf_t;
 
+/* Ring slots are reused, so buffers are only reallocated to grow.
+ */
 struct logbuf_entry {
     char *buf;
     int len;
-    int seq;
+    int size;
 };
 
 #define SLEEPER_MAGIC 0xe4e3e2e1
@@ -104,61 +113,80 @@ static struct sleeper *sleeper_create (flux_msg_handler_f fun,
     return s;
 }
 
-static void logbuf_entry_destroy (struct logbuf_entry *e)
+static struct logbuf_entry *logbuf_slot (logbuf_t *logbuf, int seq)
 {
-    if (e) {
-        if (e->buf)
-            free (e->buf);
-        free (e);
-    }
+    return &logbuf->ring[seq % logbuf->ring_size];
 }
 
-static struct logbuf_entry *logbuf_entry_create (const char *buf, int len)
+static int logbuf_used (logbuf_t *logbuf)
 {
-    struct logbuf_entry *e = xzmalloc (sizeof (*e));
-    e->buf = xzmalloc (len);
-    memcpy (e->buf, buf, len);
-    e->len = len;
-    return e;
+    return logbuf->seq - logbuf->first_seq;
 }
 
-static void logbuf_trim (logbuf_t *logbuf, int size)
+static void logbuf_ring_free (struct logbuf_entry *ring, int size)
 {
-    assert (logbuf->magic == LOGBUF_MAGIC);
-    struct logbuf_entry *e;
-    while (zlist_size (logbuf->buf) > size) {
-        e = zlist_pop (logbuf->buf);
-        logbuf_entry_destroy (e);
+    int i;
+
+    if (ring) {
+        for (i = 0; i < size; i++)
+            free (ring[i].buf);
+        free (ring);
     }
 }
 
-static void logbuf_clear (logbuf_t *logbuf, int seq_index)
+/* Resize ring, keeping the newest entries that fit.
+ */
+static void logbuf_resize (logbuf_t *logbuf, int size)
 {
-    struct logbuf_entry *e;
+    assert (logbuf->magic == LOGBUF_MAGIC);
+    struct logbuf_entry *ring = NULL;
+    int n = logbuf_used (logbuf);
+    int seq;
 
-    if (seq_index == -1)
-        logbuf_trim (logbuf, 0);
-    else {
-        while ((e = zlist_first (logbuf->buf)) && e->seq <= seq_index) {
-            e = zlist_pop (logbuf->buf);
-            logbuf_entry_destroy (e);
+    if (n > size)
+        n = size;
+    if (size > 0) {
+        ring = xzmalloc (size * sizeof (ring[0]));
+        for (seq = logbuf->seq - n; seq < logbuf->seq; seq++) {
+            struct logbuf_entry *e = logbuf_slot (logbuf, seq);
+            ring[seq % size] = *e;
+            e->buf = NULL;
         }
     }
+    logbuf_ring_free (logbuf->ring, logbuf->ring_size);
+    logbuf->ring = ring;
+    logbuf->ring_size = size;
+    logbuf->first_seq = logbuf->seq - n;
+}
+
+/* Discard entries up to and including seq_index (-1 = all).
+ * Buffers are retained for reuse.
+ */
+static void logbuf_clear (logbuf_t *logbuf, int seq_index)
+{
+    if (seq_index == -1 || seq_index >= logbuf->seq)
+        logbuf->first_seq = logbuf->seq;
+    else if (seq_index >= logbuf->first_seq)
+        logbuf->first_seq = seq_index + 1;
 }
 
+/* Get the oldest entry newer than seq_index.
+ */
 static int logbuf_get (logbuf_t *logbuf, int seq_index, int *seq,
                        const char **buf, int *len)
 {
-    struct logbuf_entry *e = zlist_first (logbuf->buf);
+    struct logbuf_entry *e;
+    int next = seq_index + 1;
 
-    while (e && e->seq <= seq_index)
-        e = zlist_next (logbuf->buf);
-    if (!e) {
+    if (next < logbuf->first_seq)
+        next = logbuf->first_seq;
+    if (next >= logbuf->seq) {
         errno = ENOENT;
         return -1;
     }
+    e = logbuf_slot (logbuf, next);
     if (seq)
-        *seq = e->seq;
+        *seq = next;
     if (buf)
         *buf = e->buf;
     if (len)
@@ -189,14 +217,16 @@ static int append_new_entry (logbuf_t *logbuf, const char *buf, int len)
     struct sleeper *s;
 
     if (logbuf->ring_size > 0) {
-        logbuf_trim (logbuf, logbuf->ring_size - 1);
-        e = logbuf_entry_create (buf, len);
-        e->seq = logbuf->seq++;
-        if (zlist_append (logbuf->buf, e) < 0) {
-            logbuf_entry_destroy (e);
-            errno = ENOMEM;
-            return -1;
+        if (logbuf_used (logbuf) == logbuf->ring_size)
+            logbuf->first_seq++;
+        e = logbuf_slot (logbuf, logbuf->seq);
+        if (e->size < len) {
+            e->buf = xrealloc (e->buf, len);
+            e->size = len;
         }
+        memcpy (e->buf, buf, len);
+        e->len = len;
+        logbuf->seq++;
         while ((s = zlist_pop (logbuf->sleepers))) {
             s->fun (s->h, s->w, s->msg, s->arg);
             sleeper_destroy (s);
@@ -213,9 +243,7 @@ static logbuf_t *logbuf_create (void)
     logbuf->critical_level = default_critical_level;
     logbuf->stderr_level = default_stderr_level;
     logbuf->level = default_level;
-    logbuf->ring_size = default_ring_size;
-    if (!(logbuf->buf = zlist_new ()))
-        oom();
+    logbuf_resize (logbuf, default_ring_size);
     if (!(logbuf->sleepers = zlist_new ()))
         oom();
     return logbuf;
@@ -225,10 +253,7 @@ void logbuf_destroy (logbuf_t *logbuf)
 {
     if (logbuf) {
         assert (logbuf->magic == LOGBUF_MAGIC);
-        if (logbuf->buf) {
-            logbuf_trim (logbuf, 0);
-            zlist_destroy (&logbuf->buf);
-        }
+        logbuf_ring_free (logbuf->ring, logbuf->ring_size);
         if (logbuf->sleepers) {
             struct sleeper *s;
             while ((s = zlist_pop (logbuf->sleepers)))
@@ -291,8 +316,8 @@ static int logbuf_set_ring_size (logbuf_t *logbuf, int size)
         errno = EINVAL;
         return -1;
     }
-    logbuf_trim (logbuf, size);
-    logbuf->ring_size = size;
+    if (size != logbuf->ring_size)
+        logbuf_resize (logbuf, size);
     return 0;
 }
 
@@ -339,7 +364,7 @@ static int attr_get_log (const char *name, const char **val, void *arg)
         assert (n < sizeof (s));
         *val = s;
     } else if (!strcmp (name, "log-ring-used")) {
-        n = snprintf (s, sizeof (s), "%zd", zlist_size (logbuf->buf));
+        n = snprintf (s, sizeof (s), "%d", logbuf_used (logbuf));
         assert (n < sizeof (s));
         *val = s;
     } else if (!strcmp (name, "log-count")) {
@@ -563,6 +588,68 @@ done:
     flux_respond (h, msg, rc < 0 ? errno : 0, NULL);
 }
 
+/* Encode one log entry as a JSON string.  JSON strings must be UTF-8,
+ * so if the entry is not, replace non-ASCII bytes with '?' rather than
+ * failing, so one bad entry cannot wedge a dmesg client at its seq.
+ */
+static json_t *dmesg_string (const char *buf, int len)
+{
+    json_t *o;
+    char *cpy;
+    int i;
+
+    if ((o = json_stringn (buf, len)))
+        return o;
+    cpy = xzmalloc (len + 1);
+    for (i = 0; i < len; i++)
+        cpy[i] = (buf[i] & 0x80) ? '?' : buf[i];
+    o = json_stringn (cpy, len);
+    free (cpy);
+    if (!o)
+        errno = ENOMEM;
+    return o;
+}
+
+/* Encode entries newer than seq_index, up to 'max' entries or
+ * dmesg_max_bytes total, as a JSON array.  Set *seq to the last one.
+ */
+static json_t *dmesg_encode (logbuf_t *logbuf, int seq_index, int max,
+                             int *seq)
+{
+    json_t *entries;
+    json_t *o;
+    const char *buf;
+    int len;
+    int bytes = 0;
+
+    if (!(entries = json_array ()))
+        goto nomem;
+    while (json_array_size (entries) < max && bytes < dmesg_max_bytes
+                && logbuf_get (logbuf, seq_index, &seq_index, &buf, &len) == 0) {
+        if (!(o = dmesg_string (buf, len)))
+            goto error;
+        if (json_array_append_new (entries, o) < 0) {
+            json_decref (o);
+            goto nomem;
+        }
+        bytes += len;
+    }
+    if (json_array_size (entries) == 0) {
+        errno = ENOENT;
+        goto error;
+    }
+    *seq = seq_index;
+    return entries;
+nomem:
+    errno = ENOMEM;
+error:
+    json_decref (entries);
+    return NULL;
+}
+
+/* If the request includes 'max', respond with up to that many entries
+ * in a 'bufs' array, otherwise respond with one entry in 'buf'.
+ */
 static void dmesg_request_cb (flux_t *h, flux_msg_handler_t *w,
                               const flux_msg_t *msg, void *arg)
 {
@@ -570,25 +657,41 @@ static void dmesg_request_cb (flux_t *h, flux_msg_handler_t *w,
     const char *buf;
     int len;
     int seq, follow;
+    int max = 0;
+    json_t *entries;
+    json_t *o;
 
-    if (flux_request_unpack (msg, NULL, "{ s:i s:b }",
+    if (flux_request_unpack (msg, NULL, "{ s:i s:b s?:i }",
                              "seq", &seq,
-                             "follow", &follow) < 0)
-        goto error;
-    if (logbuf_get (logbuf, seq, &seq, &buf, &len) < 0) {
-        if (follow && errno == ENOENT) {
-            if (logbuf_sleepon (logbuf, dmesg_request_cb, h, w, msg, arg) < 0)
-                goto error;
-            return; /* no reply */
-        }
+                             "follow", &follow,
+                             "max", &max) < 0)
         goto error;
+    if (max > 0) {
+        if (max > dmesg_max_entries)
+            max = dmesg_max_entries;
+        if (!(entries = dmesg_encode (logbuf, seq, max, &seq)))
+            goto nodata;
+        if (flux_respond_pack (h, msg, "{ s:i s:o }",
+                                       "seq", seq,
+                                       "bufs", entries) < 0)
+            goto error;
+        return;
     }
-    if (flux_respond_pack (h, msg, "{ s:i s:s# }",
+    if (logbuf_get (logbuf, seq, &seq, &buf, &len) < 0)
+        goto nodata;
+    if (!(o = dmesg_string (buf, len)))
+        goto error;
+    if (flux_respond_pack (h, msg, "{ s:i s:o }",
                                    "seq", seq,
-                                   "buf", buf, len) < 0)
+                                   "buf", o) < 0)
         goto error;
     return;
-
+nodata:
+    if (follow && errno == ENOENT) {
+        if (logbuf_sleepon (logbuf, dmesg_request_cb, h, w, msg, arg) < 0)
+            goto error;
+        return; /* no reply */
+    }
 error:
     flux_respond (h, msg, errno, NULL);
 }
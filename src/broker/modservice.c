@@ -50,6 +50,7 @@
 #include "modservice.h"
 #include "ping.h"
 #include "rusage.h"
+#include "profile.h"
 
 typedef struct {
     flux_t *h;
@@ -234,6 +235,8 @@ void modservice_register (flux_t *h, module_t *p)
         log_err_exit ("ping_initialize");
     if (rusage_initialize (h, module_get_name (ctx->p)) < 0)
         log_err_exit ("rusage_initialize");
+    if (profile_initialize (h, module_get_name (ctx->p)) < 0)
+        log_err_exit ("profile_initialize");
 
     register_event   (ctx, "stats.clear", stats_clear_event_cb);
 
@@ -381,7 +381,10 @@ int overlay_sendmsg_event (overlay_t *ov, const flux_msg_t *msg)
 
     if (!ov->event || !ov->event->zs)
         return 0;
-    if (ov->event_munge) {
+    if (ov->event_munge && flux_sec_hmac_enabled (ov->sec)) {
+        if (flux_msg_sendzsock_hmac (ov->event->zs, msg, ov->sec) < 0)
+            goto done;
+    } else if (ov->event_munge) {
         if (flux_msg_sendzsock_munge (ov->event->zs, msg, ov->sec) < 0)
             goto done;
     } else {
@@ -400,7 +403,10 @@ flux_msg_t *overlay_recvmsg_event (overlay_t *ov)
         errno = EINVAL;
         goto done;
     }
-    if (ov->event_munge) {
+    if (ov->event_munge && flux_sec_hmac_enabled (ov->sec)) {
+        if (!(msg = flux_msg_recvzsock_hmac (ov->event->zs, ov->sec)))
+            goto done;
+    } else if (ov->event_munge) {
         if (!(msg = flux_msg_recvzsock_munge (ov->event->zs, ov->sec)))
             goto done;
     } else {
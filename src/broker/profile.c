@@ -0,0 +1,187 @@
+/*****************************************************************************\
+ *  Copyright (c) 2017 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+
+/* profile.c - report reactor loop and message handler run times
+ *
+ * Registers <service>.profile.get and <service>.profile.clear.
+ * The data is collected by libflux (see flux_reactor_get_stats(),
+ * flux_msg_handler_stats_foreach()) for every handle.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <jansson.h>
+#include <flux/core.h>
+#include "profile.h"
+
+struct profile_context {
+    flux_msg_handler_t *w_get;
+    flux_msg_handler_t *w_clear;
+};
+
+static json_t *histogram_encode (const struct flux_histogram *hist)
+{
+    json_t *o;
+    json_t *a;
+    int i;
+
+    if (!(a = json_array ()))
+        goto nomem;
+    for (i = 0; i < FLUX_HISTOGRAM_BUCKETS; i++) {
+        json_t *n = json_integer (hist->bucket[i]);
+        if (!n || json_array_append_new (a, n) < 0) {
+            json_decref (n);
+            json_decref (a);
+            goto nomem;
+        }
+    }
+    if (!(o = json_pack ("{s:i s:f s:f s:o}",
+                         "count", hist->count,
+                         "total", hist->total,
+                         "max", hist->max,
+                         "histogram", a)))
+        goto nomem;
+    return o;
+nomem:
+    errno = ENOMEM;
+    return NULL;
+}
+
+static int handler_stats_cb (int type, const char *topic,
+                             const struct flux_histogram *hist, void *arg)
+{
+    json_t *handlers = arg;
+    json_t *o;
+
+    if (!(o = histogram_encode (hist)))
+        return -1;
+    if (json_object_set_new (o, "type",
+                             json_string (flux_msg_typestr (type))) < 0
+            || json_object_set_new (o, "topic", json_string (topic)) < 0
+            || json_array_append_new (handlers, o) < 0) {
+        json_decref (o);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+static void profile_get_cb (flux_t *h, flux_msg_handler_t *w,
+                            const flux_msg_t *msg, void *arg)
+{
+    struct flux_histogram hist;
+    json_t *reactor = NULL;
+    json_t *handlers = NULL;
+
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+    flux_reactor_get_stats (flux_get_reactor (h), &hist);
+    if (!(reactor = histogram_encode (&hist)))
+        goto error;
+    if (!(handlers = json_array ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (flux_msg_handler_stats_foreach (h, handler_stats_cb, handlers) < 0)
+        goto error;
+    if (flux_respond_pack (h, msg, "{s:o s:o}", "reactor", reactor,
+                                                "handlers", handlers) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    return;
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    json_decref (reactor);
+    json_decref (handlers);
+}
+
+static void profile_clear_cb (flux_t *h, flux_msg_handler_t *w,
+                              const flux_msg_t *msg, void *arg)
+{
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+    flux_reactor_clr_stats (flux_get_reactor (h));
+    flux_msg_handler_stats_clear (h);
+    if (flux_respond (h, msg, 0, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    return;
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
+static void profile_finalize (void *arg)
+{
+    struct profile_context *p = arg;
+    flux_msg_handler_stop (p->w_get);
+    flux_msg_handler_destroy (p->w_get);
+    flux_msg_handler_stop (p->w_clear);
+    flux_msg_handler_destroy (p->w_clear);
+    free (p);
+}
+
+static flux_msg_handler_t *handler_create (flux_t *h, const char *service,
+                                           const char *method,
+                                           flux_msg_handler_f cb, void *arg)
+{
+    struct flux_match match = FLUX_MATCH_REQUEST;
+    flux_msg_handler_t *w;
+
+    if (asprintf (&match.topic_glob, "%s.%s", service, method) < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if ((w = flux_msg_handler_create (h, match, cb, arg)))
+        flux_msg_handler_start (w);
+    free (match.topic_glob);
+    return w;
+}
+
+int profile_initialize (flux_t *h, const char *service)
+{
+    struct profile_context *p = calloc (1, sizeof (*p));
+    if (!p) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!(p->w_get = handler_create (h, service, "profile.get",
+                                     profile_get_cb, p)))
+        goto error;
+    if (!(p->w_clear = handler_create (h, service, "profile.clear",
+                                       profile_clear_cb, p)))
+        goto error;
+    flux_aux_set (h, "flux::profile", p, profile_finalize);
+    return 0;
+error:
+    if (p)
+        profile_finalize (p);
+    return -1;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
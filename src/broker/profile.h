@@ -0,0 +1,12 @@
+#ifndef BROKER_PROFILE_H
+#define BROKER_PROFILE_H
+
+#include <flux/core.h>
+
+int profile_initialize (flux_t *h, const char *service);
+
+#endif /* BROKER_PROFILE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -24,6 +24,7 @@
 #include "builtin.h"
 
 #include <unistd.h>
+#include <jansson.h>
 
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/readall.h"
@@ -129,6 +130,45 @@ static int internal_content_dropcache (optparse_t *p, int ac, char *av[])
     return (0);
 }
 
+static int internal_content_gc (optparse_t *p, int ac, char *av[])
+{
+    flux_t *h;
+    flux_future_t *f = NULL;
+    json_t *roots;
+    int n = optparse_option_index (p);
+    int marked, deleted;
+    int64_t bytes;
+
+    if (!(roots = json_array ()))
+        log_msg_exit ("json_array");
+    while (n < ac) {
+        if (blobref_validate (av[n]) < 0)
+            log_msg_exit ("%s: invalid blobref", av[n]);
+        if (json_array_append_new (roots, json_string (av[n++])) < 0)
+            log_msg_exit ("json_array_append_new");
+    }
+    if (!(h = builtin_get_flux_handle (p)))
+        log_err_exit ("flux_open");
+    if (!(f = flux_rpc_pack (h, "content-backing.gc", 0, 0,
+                             "{ s:O s:i s:b s:b }",
+                             "roots", roots,
+                             "batch", optparse_get_int (p, "batch", 1000),
+                             "kvs", !optparse_hasopt (p, "no-kvs"),
+                             "compact", optparse_hasopt (p, "compact"))))
+        log_err_exit ("content-backing.gc");
+    if (flux_rpc_get_unpack (f, "{ s:i s:i s:I }",
+                             "marked", &marked,
+                             "deleted", &deleted,
+                             "bytes", &bytes) < 0)
+        log_err_exit ("content-backing.gc");
+    printf ("marked %d, deleted %d (%lld bytes)\n",
+            marked, deleted, (long long)bytes);
+    json_decref (roots);
+    flux_future_destroy (f);
+    flux_close (h);
+    return (0);
+}
+
 static int spam_max_inflight;
 static int spam_cur_inflight;
 
@@ -205,6 +245,16 @@ static struct optparse_option store_opts[] = {
       OPTPARSE_TABLE_END,
 };
 
+static struct optparse_option gc_opts[] = {
+    { .name = "no-kvs",  .key = 'n',  .has_arg = 0,
+      .usage = "Do not treat the current KVS root as a root", },
+    { .name = "batch",  .key = 'b',  .has_arg = 1, .arginfo = "N",
+      .usage = "Mark or delete N blobs per reactor loop iteration", },
+    { .name = "compact",  .key = 'c',  .has_arg = 0,
+      .usage = "Vacuum the database after collection", },
+      OPTPARSE_TABLE_END,
+};
+
 static struct optparse_subcommand content_subcmds[] = {
     { "load",
       "[OPTIONS] BLOBREF",
@@ -234,6 +284,13 @@ static struct optparse_subcommand content_subcmds[] = {
       0,
       NULL,
     },
+    { "gc",
+      "[OPTIONS] [BLOBREF...]",
+      "Delete blobs not reachable from KVS root or BLOBREFs from backing store",
+      internal_content_gc,
+      0,
+      gc_opts,
+    },
     { "spam",
       "N [M]",
       "Store N random entries, keeping M requests in flight (default 1)",
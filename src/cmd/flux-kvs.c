@@ -816,6 +816,59 @@ static void dump_kvs_dir (kvsdir_t *dir, bool Ropt, bool dopt)
     kvsitr_destroy (itr);
 }
 
+static int name_cmp (const void *s1, const void *s2)
+{
+    return strcmp (*(const char **)s1, *(const char **)s2);
+}
+
+/* Display directory object 'dir' fetched with flux_kvs_lookup_tree().
+ * Values and (if Ropt) subdirectories are already inline, so no further
+ * lookups are needed.
+ */
+static void dump_kvs_tree (const char *key, json_t *dir, bool Ropt, bool dopt)
+{
+    json_t *data = treeobj_get_data (dir);
+    int count = treeobj_get_count (dir);
+    const char **names = xzmalloc (sizeof (names[0]) * (count + 1));
+    const char *name;
+    json_t *dirent;
+    int i = 0;
+
+    json_object_foreach (data, name, dirent)
+        names[i++] = name;
+    qsort (names, count, sizeof (names[0]), name_cmp);
+    for (i = 0; i < count; i++) {
+        char *nkey;
+        if (!strcmp (key, "."))
+            nkey = xstrdup (names[i]);
+        else
+            nkey = xasprintf ("%s.%s", key, names[i]);
+        dirent = treeobj_get_entry (dir, names[i]);
+        if (treeobj_is_symlink (dirent)) {
+            printf ("%s -> %s\n", nkey,
+                    json_string_value (treeobj_get_data (dirent)));
+        } else if (treeobj_is_dir (dirent) && Ropt) {
+            dump_kvs_tree (nkey, dirent, Ropt, dopt);
+        } else if (treeobj_is_dir (dirent) || treeobj_is_dirref (dirent)) {
+            printf ("%s.\n", nkey);
+        } else {
+            if (!dopt) {
+                void *val;
+                int len;
+                if (treeobj_decode_val (dirent, &val, &len) < 0
+                        || len < 1 || ((char *)val)[len - 1] != '\0')
+                    log_msg_exit ("%s: malformed value", nkey);
+                dump_kvs_val (nkey, val);
+                free (val);
+            }
+            else
+                printf ("%s\n", nkey);
+        }
+        free (nkey);
+    }
+    free (names);
+}
+
 int cmd_dir (optparse_t *p, int argc, char **argv)
 {
     flux_t *h = (flux_t *)optparse_get_data (p, "flux_handle");
@@ -823,7 +876,7 @@ int cmd_dir (optparse_t *p, int argc, char **argv)
     bool dopt;
     const char *key, *json_str;
     flux_future_t *f;
-    kvsdir_t *dir;
+    json_t *dir;
     int optindex;
 
     optindex = optparse_option_index (p);
@@ -836,13 +889,16 @@ int cmd_dir (optparse_t *p, int argc, char **argv)
     else
         log_msg_exit ("dir: specify zero or one directory");
 
-    if (!(f = flux_kvs_lookup (h, FLUX_KVS_READDIR, key))
+    /* Fetch the directory, its values, and (if -R) its subdirectories
+     * from one snapshot in a single request.
+     */
+    if (!(f = flux_kvs_lookup_tree (h, key, NULL, Ropt ? -1 : 0, 0))
                 || flux_kvs_lookup_get (f, &json_str) < 0)
         log_err_exit ("%s", key);
-    if (!(dir = kvsdir_create (h, NULL, key, json_str)))
-        log_err_exit ("kvsdir_create");
-    dump_kvs_dir (dir, Ropt, dopt);
-    kvsdir_destroy (dir);
+    if (!(dir = json_loads (json_str, 0, NULL)) || !treeobj_is_dir (dir))
+        log_msg_exit ("%s: malformed directory", key);
+    dump_kvs_tree (key, dir, Ropt, dopt);
+    json_decref (dir);
     flux_future_destroy (f);
     return (0);
 }
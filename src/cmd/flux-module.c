@@ -90,8 +90,11 @@ static struct optparse_option stats_opts[] =  {
     { .name = "rusage", .key = 'R', .has_arg = 0,
       .usage = "Request rusage data instead of stats",
     },
+    { .name = "profile", .key = 'P', .has_arg = 0,
+      .usage = "Request reactor/message handler profile instead of stats",
+    },
     { .name = "clear", .key = 'c', .has_arg = 0,
-      .usage = "Clear stats on target rank",
+      .usage = "Clear stats (or profile with -P) on target rank",
     },
     { .name = "clear-all", .key = 'C', .has_arg = 0,
       .usage = "Clear stats on all ranks",
@@ -639,7 +642,24 @@ int cmd_stats (optparse_t *p, int argc, char **argv)
     if (!(h = flux_open (NULL, 0)))
         log_err_exit ("flux_open");
 
-    if (optparse_hasopt (p, "clear")) {
+    if (optparse_hasopt (p, "profile")) {
+        if (optparse_hasopt (p, "clear")) {
+            topic = xasprintf ("%s.profile.clear", service);
+            if (!(f = flux_rpc (h, topic, NULL, nodeid, 0)))
+                log_err_exit ("%s", topic);
+            if (flux_future_get (f, NULL) < 0)
+                log_err_exit ("%s", topic);
+        } else {
+            topic = xasprintf ("%s.profile.get", service);
+            if (!(f = flux_rpc (h, topic, NULL, nodeid, 0)))
+                log_err_exit ("%s", topic);
+            if (flux_rpc_get (f, &json_str) < 0)
+                log_err_exit ("%s", topic);
+            if (!json_str)
+                log_errn_exit (EPROTO, "%s", topic);
+            parse_json (p, json_str);
+        }
+    } else if (optparse_hasopt (p, "clear")) {
         topic = xasprintf ("%s.stats.clear", service);
         if (!(f = flux_rpc (h, topic, NULL, nodeid, 0)))
             log_err_exit ("%s", topic);
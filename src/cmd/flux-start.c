@@ -381,7 +381,7 @@ int pmi_kvs_put (void *arg, const char *kvsname,
     return 0;
 }
 
-int pmi_kvs_get (void *arg, const char *kvsname,
+int pmi_kvs_get (void *arg, void *client, const char *kvsname,
                  const char *key, char *val, int len)
 {
     char *v = zhash_lookup (ctx.pmi.kvs, key);
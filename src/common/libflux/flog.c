@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <zmq.h>
+#include <jansson.h>
 
 #include "flog.h"
 #include "info.h"
@@ -235,20 +236,34 @@ done:
     return rc;
 }
 
+/* Max log entries requested per log.dmesg response.
+ */
+static const int dmesg_batch = 256;
+
 static flux_future_t *dmesg_rpc (flux_t *h, int seq, bool follow)
 {
     return flux_rpc_pack (h, "log.dmesg", FLUX_NODEID_ANY, 0,
-                          "{s:i s:b}", "seq", seq, "follow", follow);
+                          "{s:i s:b s:i}", "seq", seq, "follow", follow,
+                                           "max", dmesg_batch);
 }
 
 static int dmesg_rpc_get (flux_future_t *f, int *seq, flux_log_f fun, void *arg)
 {
+    json_t *bufs;
     const char *buf;
+    size_t index;
+    json_t *value;
     int rc = -1;
 
-    if (flux_rpc_get_unpack (f, "{s:i s:s}", "seq", seq, "buf", &buf) < 0)
+    if (flux_rpc_get_unpack (f, "{s:i s:o}", "seq", seq, "bufs", &bufs) < 0)
         goto done;
-    fun (buf, strlen (buf), arg);
+    json_array_foreach (bufs, index, value) {
+        if (!(buf = json_string_value (value))) {
+            errno = EPROTO;
+            goto done;
+        }
+        fun (buf, json_string_length (value), arg);
+    }
     rc = 0;
 done:
     return rc;
@@ -1652,6 +1652,63 @@ done:
     return msg;
 }
 
+int flux_msg_sendzsock_hmac (void *sock, const flux_msg_t *msg,
+                             flux_sec_t *sec)
+{
+    int rc = -1;
+    size_t size;
+    uint8_t *buf = NULL;
+    void *handle;
+
+    if (!sock || !msg || !sec) {
+        errno = EINVAL;
+        goto done;
+    }
+    size = flux_msg_encode_size (msg);
+    if (!(buf = calloc (1, size + FLUX_SEC_HMAC_SIZE))) {
+        errno = ENOMEM;
+        goto done;
+    }
+    if (flux_msg_encode (msg, buf, size) < 0)
+        goto done;
+    if (flux_sec_hmac_sign (sec, buf, size, buf + size) < 0)
+        goto done;
+    handle = zsock_resolve (sock);
+    if (zmq_send (handle, buf, size + FLUX_SEC_HMAC_SIZE, 0) < 0)
+        goto done;
+    rc = 0;
+done:
+    free (buf);
+    return rc;
+}
+
+flux_msg_t *flux_msg_recvzsock_hmac (void *sock, flux_sec_t *sec)
+{
+    flux_msg_t *msg = NULL;
+    zframe_t *zf = NULL;
+    uint8_t *buf;
+    size_t size;
+
+    if (!sock || !sec) {
+        errno = EINVAL;
+        goto done;
+    }
+    if (!(zf = zframe_recv (sock)))
+        goto done;
+    if (zframe_size (zf) < FLUX_SEC_HMAC_SIZE) {
+        errno = EPROTO;
+        goto done;
+    }
+    buf = zframe_data (zf);
+    size = zframe_size (zf) - FLUX_SEC_HMAC_SIZE;
+    if (flux_sec_hmac_verify (sec, buf, size, buf + size) < 0)
+        goto done;
+    msg = flux_msg_decode (buf, size);
+done:
+    zframe_destroy (&zf);
+    return msg;
+}
+
 int flux_msg_frames (const flux_msg_t *msg)
 {
     return zmsg_size (msg->zmsg);
@@ -111,17 +111,24 @@ int flux_msg_sendfd (int fd, const flux_msg_t *msg,
 flux_msg_t *flux_msg_recvfd (int fd, struct flux_msg_iobuf *iobuf);
 
 /* Send message to zeromq socket.
+ * The _munge variant wraps the message in a MUNGE credential, and the
+ * _hmac variant appends an HMAC computed with the session key set by
+ * flux_sec_hmac_init().
  * Returns 0 on success, -1 on failure with errno set.
  */
 int flux_msg_sendzsock (void *dest, const flux_msg_t *msg);
 int flux_msg_sendzsock_munge (void *sock, const flux_msg_t *msg,
                               flux_sec_t *sec);
+int flux_msg_sendzsock_hmac (void *sock, const flux_msg_t *msg,
+                             flux_sec_t *sec);
 
 /* Receive a message from zeromq socket.
+ * The _hmac variant fails with EKEYREJECTED if the HMAC does not verify.
  * Returns message on success, NULL on failure with errno set.
  */
 flux_msg_t *flux_msg_recvzsock (void *dest);
 flux_msg_t *flux_msg_recvzsock_munge (void *sock, flux_sec_t *sec);
+flux_msg_t *flux_msg_recvzsock_hmac (void *sock, flux_sec_t *sec);
 
 /* Initialize iobuf members.
  */
@@ -40,6 +40,7 @@
 
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/iterators.h"
+#include "src/common/libutil/monotime.h"
 
 /* Fastpath for RPCs:
  * fastpath array translates response matchtags to message handlers,
@@ -55,6 +56,12 @@ struct fastpath {
 };
 
 
+struct handler_stats {
+    int type;
+    char *topic;
+    struct flux_histogram hist;
+};
+
 struct dispatch {
     flux_t *h;
     zlist_t *handlers;
@@ -65,6 +72,7 @@ struct dispatch {
     int running_count;
     int usecount;
     zlist_t *unmatched;
+    zhash_t *stats;     // type+topic => struct handler_stats
 #if HAVE_CALIPER
     cali_id_t prof_msg_type;
     cali_id_t prof_msg_topic;
@@ -117,6 +125,7 @@ static void dispatch_usecount_decr (struct dispatch *d)
             assert (zlist_size (d->handlers_new) == 0);
             zlist_destroy (&d->handlers_new);
         }
+        zhash_destroy (&d->stats);
         flux_watcher_destroy (d->w);
         fastpath_free (&d->norm);
         fastpath_free (&d->group);
@@ -149,6 +158,8 @@ static struct dispatch *dispatch_get (flux_t *h)
             goto nomem;
         if (!(d->handlers_new = zlist_new ()))
             goto nomem;
+        if (!(d->stats = zhash_new ()))
+            goto nomem;
         d->h = h;
         d->w = flux_handle_watcher_create (r, h, FLUX_POLLIN, handle_cb, d);
         if (!d->w)
@@ -285,9 +296,56 @@ static int copy_match (struct flux_match *dst,
     return 0;
 }
 
+static void handler_stats_destroy (void *arg)
+{
+    struct handler_stats *st = arg;
+    if (st) {
+        free (st->topic);
+        free (st);
+    }
+}
+
+/* Find or create stats entry for message type and topic.
+ * Key is the type number plus topic, e.g. "1:kvs.get" for a request.
+ * Once the table is full, topics without an entry go to "(other)".
+ */
+static struct handler_stats *handler_stats_get (struct dispatch *d,
+                                                int type, const char *topic)
+{
+    struct handler_stats *st;
+    char key[128];
+
+    if (!topic)
+        topic = "";
+    snprintf (key, sizeof (key), "%d:%s", type, topic);
+    if ((st = zhash_lookup (d->stats, key)))
+        return st;
+    if (zhash_size (d->stats) >= FLUX_MSG_HANDLER_STATS_MAX) {
+        topic = "(other)";
+        snprintf (key, sizeof (key), "%d:%s", type, topic);
+    }
+    if (!(st = zhash_lookup (d->stats, key))) {
+        if (!(st = calloc (1, sizeof (*st))))
+            return NULL;
+        st->type = type;
+        if (!(st->topic = strdup (topic))) {
+            free (st);
+            return NULL;
+        }
+        zhash_update (d->stats, key, st);
+        zhash_freefn (d->stats, key, handler_stats_destroy);
+    }
+    return st;
+}
+
 static void call_handler (flux_msg_handler_t *w, const flux_msg_t *msg)
 {
+    struct dispatch *d = w->d;
+    struct handler_stats *st;
+    struct timespec t0;
+    const char *topic;
     uint32_t rolemask, matchtag;
+    int type;
 
     if (flux_msg_get_rolemask (msg, &rolemask) < 0)
         return;
@@ -299,7 +357,12 @@ static void call_handler (flux_msg_handler_t *w, const flux_msg_t *msg)
         }
         return;
     }
-    w->fn (w->d->h, w, msg, w->arg);
+    monotime (&t0);
+    w->fn (d->h, w, msg, w->arg); // N.B. 'w' may be destroyed by callback
+    if (flux_msg_get_type (msg, &type) == 0
+                && flux_msg_get_topic (msg, &topic) == 0
+                && (st = handler_stats_get (d, type, topic)))
+        flux_histogram_add (&st->hist, monotime_since (t0) * 1000);
 }
 
 static bool dispatch_message (struct dispatch *d,
@@ -600,6 +663,33 @@ void flux_msg_handler_delvec (struct flux_msg_handler_spec tab[])
     }
 }
 
+int flux_msg_handler_stats_foreach (flux_t *h, flux_msg_handler_stats_f cb,
+                                    void *arg)
+{
+    struct dispatch *d;
+    struct handler_stats *st;
+    const char *key;
+
+    if (!(d = dispatch_get (h)))
+        return -1;
+    FOREACH_ZHASH (d->stats, key, st) {
+        if (cb (st->type, st->topic, &st->hist, arg) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+void flux_msg_handler_stats_clear (flux_t *h)
+{
+    struct dispatch *d = dispatch_get (h);
+    zhash_t *stats;
+
+    if (d && (stats = zhash_new ())) {
+        zhash_destroy (&d->stats);
+        d->stats = stats;
+    }
+}
+
 int flux_dispatch_requeue (flux_t *h)
 {
     struct dispatch *d;
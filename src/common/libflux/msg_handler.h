@@ -3,6 +3,7 @@
 
 #include "message.h"
 #include "handle.h"
+#include "reactor.h"
 
 typedef struct flux_msg_handler flux_msg_handler_t;
 
@@ -42,6 +43,22 @@ void flux_msg_handler_delvec (struct flux_msg_handler_spec tab[]);
  */
 int flux_dispatch_requeue (flux_t *h);
 
+/* Message handler profiling:  the run time of each message handler call
+ * is recorded per message type and topic.  Always on.  Topics beyond the
+ * first FLUX_MSG_HANDLER_STATS_MAX are accounted under topic "(other)".
+ * The foreach callback should return 0 to continue, -1 to stop (and
+ * cause flux_msg_handler_stats_foreach() to return -1).
+ */
+#define FLUX_MSG_HANDLER_STATS_MAX 1024
+
+typedef int (*flux_msg_handler_stats_f)(int type, const char *topic,
+                                        const struct flux_histogram *hist,
+                                        void *arg);
+
+int flux_msg_handler_stats_foreach (flux_t *h, flux_msg_handler_stats_f cb,
+                                    void *arg);
+void flux_msg_handler_stats_clear (flux_t *h);
+
 #endif /* !_FLUX_CORE_MSG_HANDLER_H */
 
 /*
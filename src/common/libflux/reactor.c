@@ -38,11 +38,16 @@
 #include "src/common/libev/ev.h"
 #include "src/common/libutil/ev_zmq.h"
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
 
 struct flux_reactor {
     struct ev_loop *loop;
     int usecount;
     int errflag:1;
+    ev_prepare prof_prepare;
+    ev_check prof_check;
+    struct timespec prof_t0;
+    struct flux_histogram prof_hist;
 };
 
 struct flux_watcher {
@@ -57,6 +62,11 @@ static void reactor_usecount_decr (flux_reactor_t *r)
 {
     if (r && --r->usecount == 0) {
         if (r->loop) {
+            /* profiling watchers were unref'd at start */
+            ev_ref (r->loop);
+            ev_prepare_stop (r->loop, &r->prof_prepare);
+            ev_ref (r->loop);
+            ev_check_stop (r->loop, &r->prof_check);
             if (ev_is_default_loop (r->loop))
                 ev_default_destroy ();
             else
@@ -76,6 +86,48 @@ void flux_reactor_destroy (flux_reactor_t *r)
     reactor_usecount_decr (r);
 }
 
+void flux_histogram_add (struct flux_histogram *hist, double usec)
+{
+    int i = 0;
+
+    while (i < FLUX_HISTOGRAM_BUCKETS - 1 && usec >= (1 << i))
+        i++;
+    hist->bucket[i]++;
+    hist->count++;
+    hist->total += usec;
+    if (hist->max < usec)
+        hist->max = usec;
+}
+
+/* Loop just unblocked.
+ */
+static void prof_check_cb (struct ev_loop *loop, ev_check *w, int revents)
+{
+    flux_reactor_t *r = ev_userdata (loop);
+    monotime (&r->prof_t0);
+}
+
+/* Loop is about to block.
+ */
+static void prof_prepare_cb (struct ev_loop *loop, ev_prepare *w, int revents)
+{
+    flux_reactor_t *r = ev_userdata (loop);
+    if (monotime_isset (r->prof_t0)) {
+        flux_histogram_add (&r->prof_hist, monotime_since (r->prof_t0) * 1000);
+        memset (&r->prof_t0, 0, sizeof (r->prof_t0));
+    }
+}
+
+void flux_reactor_get_stats (flux_reactor_t *r, struct flux_histogram *hist)
+{
+    *hist = r->prof_hist;
+}
+
+void flux_reactor_clr_stats (flux_reactor_t *r)
+{
+    memset (&r->prof_hist, 0, sizeof (r->prof_hist));
+}
+
 flux_reactor_t *flux_reactor_create (int flags)
 {
     flux_reactor_t *r = calloc (1, sizeof (*r));
@@ -92,6 +144,14 @@ flux_reactor_t *flux_reactor_create (int flags)
     }
     ev_set_userdata (r->loop, r);
     r->usecount = 1;
+    /* Profiling watchers must not keep the loop alive.
+     */
+    ev_prepare_init (&r->prof_prepare, prof_prepare_cb);
+    ev_prepare_start (r->loop, &r->prof_prepare);
+    ev_unref (r->loop);
+    ev_check_init (&r->prof_check, prof_check_cb);
+    ev_check_start (r->loop, &r->prof_check);
+    ev_unref (r->loop);
     return r;
 }
 
@@ -42,6 +42,7 @@
 #include "src/common/libutil/oom.h"
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/base64.h"
+#include "src/common/libutil/sha256.h"
 
 
 #define FLUX_ZAP_DOMAIN "flux"
@@ -59,6 +60,8 @@ struct flux_sec_struct {
     char *confstr;
     uid_t uid;
     uid_t gid;
+    bool hmac_enabled;
+    uint8_t hmac_key[SHA256_BLOCK_SIZE];
 };
 
 static int checksecdirs (flux_sec_t *c, bool create);
@@ -77,7 +80,8 @@ const char *flux_sec_confstr (flux_sec_t *c)
     if (c->confstr)
         free (c->confstr);
     if (asprintf (&c->confstr, "Security: epgm=%s, tcp/ipc=%s",
-               (c->typemask & FLUX_SEC_TYPE_MUNGE) ? "MUNGE" : "off",
+               c->hmac_enabled ? "HMAC"
+             : (c->typemask & FLUX_SEC_TYPE_MUNGE) ? "MUNGE" : "off",
                (c->typemask & FLUX_SEC_TYPE_PLAIN) ? "PLAIN"
              : (c->typemask & FLUX_SEC_TYPE_CURVE) ? "CURVE" : "off") < 0)
         oom ();
@@ -109,6 +113,7 @@ void flux_sec_destroy (flux_sec_t *c)
         free (c->errstr);
         free (c->confstr);
         zactor_destroy (&c->auth);
+        memset (c->hmac_key, 0, sizeof (c->hmac_key));
         free (c);
     }
 }
@@ -590,6 +595,97 @@ done:
     return rc;
 }
 
+/* HMAC-SHA256 per RFC 2104.  The key is always SHA256_BLOCK_SIZE (32)
+ * bytes, shorter than the 64 byte hash block, so it is zero padded.
+ */
+static void hmac_sha256 (const uint8_t *key, const void *buf, size_t len,
+                         uint8_t mac[SHA256_BLOCK_SIZE])
+{
+    SHA256_CTX ctx;
+    uint8_t pad[64];
+    uint8_t inner[SHA256_BLOCK_SIZE];
+    int i;
+
+    memset (pad, 0, sizeof (pad));
+    memcpy (pad, key, SHA256_BLOCK_SIZE);
+    for (i = 0; i < sizeof (pad); i++)
+        pad[i] ^= 0x36;
+    sha256_init (&ctx);
+    sha256_update (&ctx, pad, sizeof (pad));
+    sha256_update (&ctx, buf, len);
+    sha256_final (&ctx, inner);
+
+    for (i = 0; i < sizeof (pad); i++)
+        pad[i] ^= 0x36 ^ 0x5c;
+    sha256_init (&ctx);
+    sha256_update (&ctx, pad, sizeof (pad));
+    sha256_update (&ctx, inner, sizeof (inner));
+    sha256_final (&ctx, mac);
+    memset (pad, 0, sizeof (pad));
+}
+
+int flux_sec_hmac_init (flux_sec_t *c, const char *salt)
+{
+    SHA256_CTX ctx;
+    const char *label = "flux-hmac";
+
+    if (!c || !salt || !(c->typemask & FLUX_SEC_TYPE_CURVE)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!c->srv_cert) {
+        if (checksecdirs (c, false) < 0)
+            return -1;
+        if (!(c->srv_cert = getcurve (c, "server")))
+            return -1;
+    }
+    sha256_init (&ctx);
+    sha256_update (&ctx, (const BYTE *)label, strlen (label));
+    sha256_update (&ctx, zcert_secret_key (c->srv_cert), 32);
+    sha256_update (&ctx, (const BYTE *)salt, strlen (salt));
+    sha256_final (&ctx, c->hmac_key);
+    c->hmac_enabled = true;
+    return 0;
+}
+
+bool flux_sec_hmac_enabled (flux_sec_t *c)
+{
+    return c->hmac_enabled;
+}
+
+int flux_sec_hmac_sign (flux_sec_t *c, const void *buf, size_t len,
+                        uint8_t mac[FLUX_SEC_HMAC_SIZE])
+{
+    if (!c || !c->hmac_enabled || (!buf && len > 0) || !mac) {
+        errno = EINVAL;
+        return -1;
+    }
+    hmac_sha256 (c->hmac_key, buf, len, mac);
+    return 0;
+}
+
+int flux_sec_hmac_verify (flux_sec_t *c, const void *buf, size_t len,
+                          const uint8_t mac[FLUX_SEC_HMAC_SIZE])
+{
+    uint8_t expected[FLUX_SEC_HMAC_SIZE];
+    uint8_t diff = 0;
+    int i;
+
+    if (!c || !c->hmac_enabled || (!buf && len > 0) || !mac) {
+        errno = EINVAL;
+        return -1;
+    }
+    hmac_sha256 (c->hmac_key, buf, len, expected);
+    for (i = 0; i < FLUX_SEC_HMAC_SIZE; i++) /* constant time */
+        diff |= expected[i] ^ mac[i];
+    if (diff != 0) {
+        seterrstr (c, "hmac verification failed");
+        errno = EKEYREJECTED;
+        return -1;
+    }
+    return 0;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
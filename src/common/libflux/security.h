@@ -2,6 +2,8 @@
 #define _FLUX_CORE_SECURITY_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef struct flux_sec_struct flux_sec_t;
 
@@ -110,6 +112,24 @@ int flux_sec_munge (flux_sec_t *c, const char *inbuf, size_t insize,
 int flux_sec_unmunge (flux_sec_t *c, const char *inbuf, size_t insize,
                       char **outbuf, size_t *outsize);
 
+/* Sign and verify buffers with HMAC-SHA256, using a session key known
+ * only to holders of the CURVE server secret key (the brokers).
+ * flux_sec_hmac_init() derives the key from the server secret key in
+ * 'confdir' and 'salt', so that every broker in an instance computes the
+ * same key without exchanging it.  'salt' should be chosen at random for
+ * each instance, e.g. by rank 0 at boot, so that messages signed in one
+ * instance cannot be replayed into another.  CURVE must be
+ * enabled.  Returns 0 on success, or -1 on failure with errno set.
+ * flux_sec_hmac_verify() fails with EKEYREJECTED if 'mac' does not match.
+ */
+#define FLUX_SEC_HMAC_SIZE 32
+int flux_sec_hmac_init (flux_sec_t *c, const char *salt);
+bool flux_sec_hmac_enabled (flux_sec_t *c);
+int flux_sec_hmac_sign (flux_sec_t *c, const void *buf, size_t len,
+                        uint8_t mac[FLUX_SEC_HMAC_SIZE]);
+int flux_sec_hmac_verify (flux_sec_t *c, const void *buf, size_t len,
+                          const uint8_t mac[FLUX_SEC_HMAC_SIZE]);
+
 #endif /* _FLUX_CORE_SECURITY_H */
 
 /*
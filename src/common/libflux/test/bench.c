@@ -0,0 +1,605 @@
+/* bench - microbenchmarks for libflux message primitives
+ *
+ * Usage: bench [--count N] [--sizes S,S,...] [TEST ...]
+ *
+ * Each TEST (or every test if none is named, or every test with a name
+ * beginning with TEST, e.g. "msg" or "rpc") is run once per payload size
+ * and prints a line of JSON on stdout:
+ *
+ *   {"test":s, "size":i, "ops_per_sec":f,
+ *    "latency_us":{"count":i, "min":f, "mean":f, "p50":f, "p90":f,
+ *                  "p99":f, "max":f}}
+ *
+ * For tagpool tests "size" is the number of tags held while timing,
+ * and for dispatch, the number of registered message handlers.
+ * The iteration count is scaled down for payloads larger than 4K.
+ * rpc.local requires FLUX_URI to be set, e.g. run under flux-start.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <flux/core.h>
+
+#include "src/common/libflux/tagpool.h"
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/tsample.h"
+
+struct bench {
+    const char *name;
+    void (*run)(int size, int count, tsample_t *lat);
+    const int *sizes;       /* fixed sizes, or NULL for payload sizes */
+};
+
+static int payload_sizes[16] = { 0, 64, 1024, 16384, 262144, -1 };
+static const int tagpool_depths[] = { 0, 1000, 100000, -1 };
+static const int dispatch_handlers[] = { 1, 16, 256, -1 };
+
+#define OPTIONS "c:s:"
+static const struct option longopts[] = {
+   {"count",   required_argument,   0, 'c'},
+   {"sizes",   required_argument,   0, 's'},
+   {0, 0, 0, 0},
+};
+
+static void usage (void)
+{
+    fprintf (stderr,
+"Usage: bench [--count N] [--sizes S,S,...] [TEST ...]\n"
+"Tests: msg.create msg.pack msg.unpack msg.copy msg.sendfd\n"
+"       tagpool.regular tagpool.group dispatch\n"
+"       rpc.loop rpc.shmem rpc.local\n");
+    exit (1);
+}
+
+static void report (const char *name, int size, tsample_t *s)
+{
+    double sum;
+
+    if (s->n == 0)
+        return;
+    tsample_sort (s);
+    sum = tsample_sum (s);
+    /* samples are in msec; ops_per_sec is for back to back operations */
+    printf ("{\"test\":\"%s\",\"size\":%d,\"ops_per_sec\":%.1f,"
+            "\"latency_us\":{\"count\":%d,\"min\":%.3f,\"mean\":%.3f,"
+            "\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}}\n",
+            name, size, sum > 0 ? s->n * 1E3 / sum : 0., s->n,
+            s->v[0] * 1E3, sum / s->n * 1E3,
+            tsample_percentile (s, 50) * 1E3,
+            tsample_percentile (s, 90) * 1E3,
+            tsample_percentile (s, 99) * 1E3,
+            s->v[s->n - 1] * 1E3);
+    fflush (stdout);
+}
+
+/* Return a JSON object of approximately 'size' bytes.
+ */
+static char *payload_create (int size)
+{
+    int n = size > 12 ? size - 12 : 0;
+    char *s = xzmalloc (n + 16);
+
+    strcpy (s, "{\"data\":\"");
+    memset (s + 9, 'x', n);
+    strcpy (s + 9 + n, "\"}");
+    return s;
+}
+
+static flux_msg_t *request_create (const char *topic, const char *payload)
+{
+    flux_msg_t *msg;
+
+    if (!(msg = flux_request_encode (topic, payload)))
+        log_err_exit ("flux_request_encode");
+    return msg;
+}
+
+/* msg.*
+ */
+static void msg_create (int size, int count, tsample_t *lat)
+{
+    char *payload = payload_create (size);
+    struct timespec t0;
+    flux_msg_t *msg;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        monotime (&t0);
+        msg = request_create ("bench.create", payload);
+        flux_msg_destroy (msg);
+        tsample_push (lat, monotime_since (t0));
+    }
+    free (payload);
+}
+
+static void msg_pack (int size, int count, tsample_t *lat)
+{
+    char *data = xzmalloc (size + 1);
+    struct timespec t0;
+    flux_msg_t *msg;
+    int i;
+
+    memset (data, 'x', size);
+    for (i = 0; i < count; i++) {
+        if (!(msg = flux_msg_create (FLUX_MSGTYPE_REQUEST)))
+            log_err_exit ("flux_msg_create");
+        monotime (&t0);
+        if (flux_msg_pack (msg, "{s:s}", "data", data) < 0)
+            log_err_exit ("flux_msg_pack");
+        tsample_push (lat, monotime_since (t0));
+        flux_msg_destroy (msg);
+    }
+    free (data);
+}
+
+/* Each iteration unpacks a fresh copy, so any decode caching in the
+ * message is not credited to unpack.
+ */
+static void msg_unpack (int size, int count, tsample_t *lat)
+{
+    char *payload = payload_create (size);
+    flux_msg_t *orig = request_create ("bench.unpack", payload);
+    struct timespec t0;
+    flux_msg_t *msg;
+    const char *s;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (!(msg = flux_msg_copy (orig, true)))
+            log_err_exit ("flux_msg_copy");
+        monotime (&t0);
+        if (flux_msg_unpack (msg, "{s:s}", "data", &s) < 0)
+            log_err_exit ("flux_msg_unpack");
+        tsample_push (lat, monotime_since (t0));
+        flux_msg_destroy (msg);
+    }
+    flux_msg_destroy (orig);
+    free (payload);
+}
+
+static void msg_copy (int size, int count, tsample_t *lat)
+{
+    char *payload = payload_create (size);
+    flux_msg_t *orig = request_create ("bench.copy", payload);
+    struct timespec t0;
+    flux_msg_t *msg;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        monotime (&t0);
+        if (!(msg = flux_msg_copy (orig, true)))
+            log_err_exit ("flux_msg_copy");
+        flux_msg_destroy (msg);
+        tsample_push (lat, monotime_since (t0));
+    }
+    flux_msg_destroy (orig);
+    free (payload);
+}
+
+/* Round trip over a socketpair, with a thread echoing each message back.
+ */
+static void *sendfd_echo (void *arg)
+{
+    int fd = *(int *)arg;
+    flux_msg_t *msg;
+
+    while ((msg = flux_msg_recvfd (fd, NULL))) {
+        if (flux_msg_sendfd (fd, msg, NULL) < 0)
+            log_err_exit ("flux_msg_sendfd");
+        flux_msg_destroy (msg);
+    }
+    return NULL;
+}
+
+static void msg_sendfd (int size, int count, tsample_t *lat)
+{
+    char *payload = payload_create (size);
+    flux_msg_t *msg = request_create ("bench.sendfd", payload);
+    flux_msg_t *rmsg;
+    struct timespec t0;
+    pthread_t t;
+    int fds[2];
+    int i, e;
+
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        log_err_exit ("socketpair");
+    if ((e = pthread_create (&t, NULL, sendfd_echo, &fds[1])))
+        log_errn_exit (e, "pthread_create");
+    for (i = 0; i < count; i++) {
+        monotime (&t0);
+        if (flux_msg_sendfd (fds[0], msg, NULL) < 0)
+            log_err_exit ("flux_msg_sendfd");
+        if (!(rmsg = flux_msg_recvfd (fds[0], NULL)))
+            log_err_exit ("flux_msg_recvfd");
+        tsample_push (lat, monotime_since (t0));
+        flux_msg_destroy (rmsg);
+    }
+    (void)shutdown (fds[0], SHUT_WR);
+    if ((e = pthread_join (t, NULL)))
+        log_errn_exit (e, "pthread_join");
+    close (fds[0]);
+    close (fds[1]);
+    flux_msg_destroy (msg);
+    free (payload);
+}
+
+/* tagpool.*
+ */
+static void tagpool_run (int depth, int count, int flags, tsample_t *lat)
+{
+    struct tagpool *tp;
+    uint32_t *held = xzmalloc (sizeof (held[0]) * (depth + 1));
+    struct timespec t0;
+    uint32_t tag;
+    int i;
+
+    if (!(tp = tagpool_create ()))
+        log_err_exit ("tagpool_create");
+    for (i = 0; i < depth; i++) {
+        if ((held[i] = tagpool_alloc (tp, flags)) == FLUX_MATCHTAG_NONE)
+            break;
+    }
+    depth = i;
+    for (i = 0; i < count; i++) {
+        monotime (&t0);
+        if ((tag = tagpool_alloc (tp, flags)) == FLUX_MATCHTAG_NONE)
+            log_msg_exit ("tagpool_alloc: pool exhausted");
+        tagpool_free (tp, tag);
+        tsample_push (lat, monotime_since (t0));
+    }
+    for (i = 0; i < depth; i++)
+        tagpool_free (tp, held[i]);
+    tagpool_destroy (tp);
+    free (held);
+}
+
+static void tagpool_regular (int depth, int count, tsample_t *lat)
+{
+    tagpool_run (depth, count, 0, lat);
+}
+
+static void tagpool_group (int depth, int count, tsample_t *lat)
+{
+    tagpool_run (depth, count, TAGPOOL_FLAG_GROUP, lat);
+}
+
+/* dispatch: time from flux_send() on a loop:// handle to the
+ * handler being called, with 'nhandlers' registered.
+ */
+static void dispatch_cb (flux_t *h, flux_msg_handler_t *w,
+                         const flux_msg_t *msg, void *arg)
+{
+    int *called = arg;
+    (*called)++;
+}
+
+static void dispatch (int nhandlers, int count, tsample_t *lat)
+{
+    flux_msg_handler_t **w = xzmalloc (sizeof (w[0]) * nhandlers);
+    struct flux_match match = FLUX_MATCH_REQUEST;
+    struct timespec t0;
+    flux_msg_t *msg;
+    char *topic;
+    flux_t *h;
+    int called = 0;
+    int i;
+
+    if (!(h = flux_open ("loop://", 0)))
+        log_err_exit ("flux_open loop://");
+    for (i = 0; i < nhandlers; i++) {
+        match.topic_glob = topic = xasprintf ("bench.%d", i);
+        if (!(w[i] = flux_msg_handler_create (h, match, dispatch_cb, &called)))
+            log_err_exit ("flux_msg_handler_create");
+        flux_msg_handler_start (w[i]);
+        free (topic);
+    }
+    topic = xasprintf ("bench.%d", nhandlers - 1);
+    msg = request_create (topic, NULL);
+    for (i = 0; i < count; i++) {
+        monotime (&t0);
+        if (flux_send (h, msg, 0) < 0)
+            log_err_exit ("flux_send");
+        if (flux_reactor_run (flux_get_reactor (h), FLUX_REACTOR_ONCE) < 0)
+            log_err_exit ("flux_reactor_run");
+        tsample_push (lat, monotime_since (t0));
+    }
+    if (called != count)
+        log_msg_exit ("dispatch: handler called %d of %d times",
+                      called, count);
+    flux_msg_destroy (msg);
+    free (topic);
+    for (i = 0; i < nhandlers; i++)
+        flux_msg_handler_destroy (w[i]);
+    free (w);
+    flux_close (h);
+}
+
+/* rpc.*
+ */
+static void echo_cb (flux_t *h, flux_msg_handler_t *w,
+                     const flux_msg_t *msg, void *arg)
+{
+    const char *json_str;
+
+    if (flux_request_decode (msg, NULL, &json_str) < 0
+            || flux_respond (h, msg, 0, json_str) < 0)
+        log_err_exit ("echo");
+}
+
+static void shutdown_cb (flux_t *h, flux_msg_handler_t *w,
+                         const flux_msg_t *msg, void *arg)
+{
+    flux_reactor_stop (flux_get_reactor (h));
+}
+
+static const struct flux_msg_handler_spec echo_htab[] = {
+    { FLUX_MSGTYPE_REQUEST, "bench.echo",       echo_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "bench.shutdown",   shutdown_cb, 0, NULL },
+    FLUX_MSGHANDLER_TABLE_END,
+};
+
+static void rpc_sync (flux_t *h, const char *topic, int size, int count,
+                      tsample_t *lat)
+{
+    char *payload = payload_create (size);
+    struct timespec t0;
+    flux_future_t *f;
+    const char *json_str;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        monotime (&t0);
+        if (!(f = flux_rpc (h, topic, payload, FLUX_NODEID_ANY, 0))
+                || flux_rpc_get (f, &json_str) < 0)
+            log_err_exit ("%s", topic);
+        tsample_push (lat, monotime_since (t0));
+        flux_future_destroy (f);
+    }
+    free (payload);
+}
+
+/* On loop:// the request and response are handled by the same reactor,
+ * so the next RPC is sent from the continuation of the previous one.
+ */
+struct loop_rpc {
+    flux_t *h;
+    char *payload;
+    int count;
+    struct timespec t0;
+    tsample_t *lat;
+};
+
+static void loop_rpc_send (struct loop_rpc *ctx);
+
+static void loop_rpc_continuation (flux_future_t *f, void *arg)
+{
+    struct loop_rpc *ctx = arg;
+    const char *json_str;
+
+    if (flux_rpc_get (f, &json_str) < 0)
+        log_err_exit ("bench.echo");
+    tsample_push (ctx->lat, monotime_since (ctx->t0));
+    flux_future_destroy (f);
+    if (--ctx->count > 0)
+        loop_rpc_send (ctx);
+    else
+        flux_reactor_stop (flux_get_reactor (ctx->h));
+}
+
+static void loop_rpc_send (struct loop_rpc *ctx)
+{
+    flux_future_t *f;
+
+    monotime (&ctx->t0);
+    if (!(f = flux_rpc (ctx->h, "bench.echo", ctx->payload,
+                        FLUX_NODEID_ANY, 0))
+            || flux_future_then (f, -1., loop_rpc_continuation, ctx) < 0)
+        log_err_exit ("bench.echo");
+}
+
+static void rpc_loop (int size, int count, tsample_t *lat)
+{
+    struct flux_msg_handler_spec *htab;
+    struct loop_rpc ctx;
+
+    htab = xzmalloc (sizeof (echo_htab));
+    memcpy (htab, echo_htab, sizeof (echo_htab));
+    memset (&ctx, 0, sizeof (ctx));
+    ctx.payload = payload_create (size);
+    ctx.count = count;
+    ctx.lat = lat;
+    if (!(ctx.h = flux_open ("loop://", 0)))
+        log_err_exit ("flux_open loop://");
+    if (flux_msg_handler_addvec (ctx.h, htab, NULL) < 0)
+        log_err_exit ("flux_msg_handler_addvec");
+    loop_rpc_send (&ctx);
+    if (flux_reactor_run (flux_get_reactor (ctx.h), 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    flux_msg_handler_delvec (htab);
+    flux_close (ctx.h);
+    free (ctx.payload);
+    free (htab);
+}
+
+static void *shmem_server (void *arg)
+{
+    flux_t *h = arg;
+
+    if (flux_reactor_run (flux_get_reactor (h), 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    return NULL;
+}
+
+static void rpc_shmem (int size, int count, tsample_t *lat)
+{
+    struct flux_msg_handler_spec *htab;
+    flux_t *h_srv, *h_cli;
+    flux_msg_t *msg;
+    pthread_t t;
+    char uri[64];
+    int e;
+
+    htab = xzmalloc (sizeof (echo_htab));
+    memcpy (htab, echo_htab, sizeof (echo_htab));
+    snprintf (uri, sizeof (uri), "shmem://bench-%d&bind", (int)getpid ());
+    if (!(h_srv = flux_open (uri, 0)))
+        log_err_exit ("flux_open %s", uri);
+    snprintf (uri, sizeof (uri), "shmem://bench-%d&connect", (int)getpid ());
+    if (!(h_cli = flux_open (uri, 0)))
+        log_err_exit ("flux_open %s", uri);
+    if (flux_msg_handler_addvec (h_srv, htab, NULL) < 0)
+        log_err_exit ("flux_msg_handler_addvec");
+    if ((e = pthread_create (&t, NULL, shmem_server, h_srv)))
+        log_errn_exit (e, "pthread_create");
+
+    rpc_sync (h_cli, "bench.echo", size, count, lat);
+
+    msg = request_create ("bench.shutdown", NULL);
+    if (flux_send (h_cli, msg, 0) < 0)
+        log_err_exit ("flux_send");
+    flux_msg_destroy (msg);
+    if ((e = pthread_join (t, NULL)))
+        log_errn_exit (e, "pthread_join");
+    flux_msg_handler_delvec (htab);
+    flux_close (h_cli);
+    flux_close (h_srv);
+    free (htab);
+}
+
+static void rpc_local (int size, int count, tsample_t *lat)
+{
+    flux_t *h;
+
+    if (!getenv ("FLUX_URI"))
+        return;
+    if (!(h = flux_open (NULL, 0)))
+        log_err_exit ("flux_open");
+    rpc_sync (h, "cmb.ping", size, count, lat);
+    flux_close (h);
+}
+
+static struct bench benches[] = {
+    { "msg.create",         msg_create,         NULL },
+    { "msg.pack",           msg_pack,           NULL },
+    { "msg.unpack",         msg_unpack,         NULL },
+    { "msg.copy",           msg_copy,           NULL },
+    { "msg.sendfd",         msg_sendfd,         NULL },
+    { "tagpool.regular",    tagpool_regular,    tagpool_depths },
+    { "tagpool.group",      tagpool_group,      tagpool_depths },
+    { "dispatch",           dispatch,           dispatch_handlers },
+    { "rpc.loop",           rpc_loop,           NULL },
+    { "rpc.shmem",          rpc_shmem,          NULL },
+    { "rpc.local",          rpc_local,          NULL },
+    { NULL, NULL, NULL },
+};
+
+static void parse_sizes (char *arg)
+{
+    char *tok, *saveptr = NULL;
+    int n = 0;
+
+    while ((tok = strtok_r (arg, ",", &saveptr))) {
+        if (n == sizeof (payload_sizes) / sizeof (payload_sizes[0]) - 1)
+            log_msg_exit ("too many sizes");
+        if ((payload_sizes[n++] = strtol (tok, NULL, 10)) < 0)
+            log_msg_exit ("sizes must be >= 0");
+        arg = NULL;
+    }
+    payload_sizes[n] = -1;
+}
+
+static bool selected (const char *name, const char *arg)
+{
+    return !arg || !strncmp (name, arg, strlen (arg));
+}
+
+static void check_args (int argc, char **argv)
+{
+    struct bench *b;
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        for (b = &benches[0]; b->name; b++)
+            if (selected (b->name, argv[i]))
+                break;
+        if (!b->name)
+            usage ();
+    }
+}
+
+static void run (struct bench *b, int count)
+{
+    const int *sizes = b->sizes ? b->sizes : payload_sizes;
+    tsample_t lat;
+    int i, n;
+
+    for (i = 0; sizes[i] >= 0; i++) {
+        n = count;
+        if (!b->sizes && sizes[i] > 4096) {
+            n = (int)((double)count * 4096 / sizes[i]);
+            if (n < 100)
+                n = 100;
+        }
+        memset (&lat, 0, sizeof (lat));
+        b->run (sizes[i], n, &lat);
+        report (b->name, sizes[i], &lat);
+        tsample_clear (&lat);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    struct bench *b;
+    int count = 10000;
+    int ch;
+
+    log_init ("bench");
+
+    while ((ch = getopt_long (argc, argv, OPTIONS, longopts, NULL)) != -1) {
+        switch (ch) {
+            case 'c':
+                if ((count = strtol (optarg, NULL, 10)) <= 0)
+                    log_msg_exit ("count must be > 0");
+                break;
+            case 's':
+                parse_sizes (optarg);
+                break;
+            default:
+                usage ();
+        }
+    }
+    (void)setenv ("FLUX_CONNECTOR_PATH",
+                  flux_conf_get ("connector_path", CONF_FLAG_INTREE), 0);
+
+    /* With no TEST arguments, argv[optind] is NULL, which selects all.
+     */
+    check_args (argc - optind, argv + optind);
+    for (b = &benches[0]; b->name; b++) {
+        int i = optind;
+        do {
+            if (selected (b->name, argv[i])) {
+                run (b, count);
+                break;
+            }
+        } while (++i < argc);
+    }
+
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
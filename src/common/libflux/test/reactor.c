@@ -666,6 +666,32 @@ static void reactor_destroy_early (void)
     flux_watcher_destroy (w);
 }
 
+static void test_stats (flux_reactor_t *reactor)
+{
+    struct flux_histogram hist;
+
+    memset (&hist, 0, sizeof (hist));
+    flux_histogram_add (&hist, 0.5);
+    flux_histogram_add (&hist, 1);
+    flux_histogram_add (&hist, 3);
+    flux_histogram_add (&hist, 1E9);
+    ok (hist.count == 4 && hist.max == 1E9 && hist.total == 1E9 + 4.5,
+        "flux_histogram_add updates count, max, total");
+    ok (hist.bucket[0] == 1 && hist.bucket[1] == 1 && hist.bucket[2] == 1
+        && hist.bucket[FLUX_HISTOGRAM_BUCKETS - 1] == 1,
+        "flux_histogram_add puts samples in power of 2 buckets");
+
+    /* Earlier tests ran the reactor many times.
+     */
+    flux_reactor_get_stats (reactor, &hist);
+    ok (hist.count > 0,
+        "reactor stats counted %d loop iterations", hist.count);
+    flux_reactor_clr_stats (reactor);
+    flux_reactor_get_stats (reactor, &hist);
+    ok (hist.count == 0 && hist.total == 0,
+        "flux_reactor_clr_stats cleared stats");
+}
+
 int main (int argc, char *argv[])
 {
     flux_reactor_t *reactor;
@@ -689,6 +715,7 @@ int main (int argc, char *argv[])
     test_signal (reactor);
     test_child (reactor);
     test_stat (reactor);
+    test_stats (reactor);
 
     flux_reactor_destroy (reactor);
 
@@ -13,6 +13,7 @@
 #include <czmq.h>
 
 #include "src/common/libflux/security.h"
+#include "src/common/libflux/message.h"
 #include "src/common/libtap/tap.h"
 #include "src/common/libutil/unlink_recursive.h"
 
@@ -469,6 +470,98 @@ void test_curve (void)
     unlink_recursive (path);
 }
 
+void test_hmac (void)
+{
+    flux_sec_t *sec, *sec2;
+    const char *tmp = getenv ("TMPDIR");
+    char path[PATH_MAX];
+    uint8_t mac[FLUX_SEC_HMAC_SIZE];
+    uint8_t mac2[FLUX_SEC_HMAC_SIZE];
+    const char *data = "Hello world";
+    zsock_t *zsock[2] = { NULL, NULL };
+    flux_msg_t *msg, *msg2;
+    const char *topic;
+    char *cpy;
+
+    ok ((sec = flux_sec_create (FLUX_SEC_TYPE_MUNGE, NULL)) != NULL,
+            "flux_sec_create MUNGE works");
+    errno = 0;
+    ok (flux_sec_hmac_init (sec, "42") < 0 && errno == EINVAL,
+            "flux_sec_hmac_init fails with EINVAL without CURVE");
+    ok (flux_sec_hmac_enabled (sec) == false,
+            "flux_sec_hmac_enabled returns false");
+    errno = 0;
+    ok (flux_sec_hmac_sign (sec, data, strlen (data), mac) < 0
+            && errno == EINVAL,
+            "flux_sec_hmac_sign fails with EINVAL before init");
+    flux_sec_destroy (sec);
+
+    snprintf (path, sizeof (path), "%s/sectest.XXXXXX", tmp ? tmp : "/tmp");
+    if (!mkdtemp (path))
+        BAIL_OUT ("could not create tmp directory");
+    if (!(sec = flux_sec_create (FLUX_SEC_TYPE_CURVE, path)))
+        BAIL_OUT ("flux_sec_create CURVE failed");
+    if (flux_sec_keygen (sec) < 0)
+        BAIL_OUT ("flux_sec_keygen CURVE failed");
+    ok (flux_sec_hmac_init (sec, "42") == 0,
+            "flux_sec_hmac_init CURVE works");
+    ok (flux_sec_hmac_enabled (sec) == true,
+            "flux_sec_hmac_enabled returns true");
+    ok (flux_sec_hmac_sign (sec, data, strlen (data), mac) == 0,
+            "flux_sec_hmac_sign works");
+    ok (flux_sec_hmac_verify (sec, data, strlen (data), mac) == 0,
+            "flux_sec_hmac_verify works");
+    cpy = strdup (data);
+    cpy[0] = 'J';
+    errno = 0;
+    ok (flux_sec_hmac_verify (sec, cpy, strlen (cpy), mac) < 0
+            && errno == EKEYREJECTED,
+            "flux_sec_hmac_verify fails with EKEYREJECTED on altered data");
+    free (cpy);
+
+    /* Another context with the same keys and salt derives the same key.
+     */
+    if (!(sec2 = flux_sec_create (FLUX_SEC_TYPE_CURVE, path)))
+        BAIL_OUT ("flux_sec_create CURVE failed");
+    ok (flux_sec_hmac_init (sec2, "42") == 0
+            && flux_sec_hmac_sign (sec2, data, strlen (data), mac2) == 0
+            && memcmp (mac, mac2, sizeof (mac)) == 0,
+            "same keys and salt produce the same hmac");
+    ok (flux_sec_hmac_init (sec2, "43") == 0
+            && flux_sec_hmac_verify (sec2, data, strlen (data), mac) < 0,
+            "different salt produces a different hmac");
+
+    /* Send a message between contexts with matching and mismatched keys.
+     */
+    ok ((zsock[0] = zsock_new_pair (NULL)) != NULL
+            && zsock_bind (zsock[0], "inproc://hmac") == 0
+            && (zsock[1] = zsock_new_pair (">inproc://hmac")) != NULL,
+            "created socket pair");
+    if (!(msg = flux_msg_create (FLUX_MSGTYPE_EVENT))
+            || flux_msg_set_topic (msg, "foo.bar") < 0)
+        BAIL_OUT ("could not create message");
+    ok (flux_msg_sendzsock_hmac (zsock[1], msg, sec) == 0,
+            "flux_msg_sendzsock_hmac works");
+    ok ((msg2 = flux_msg_recvzsock_hmac (zsock[0], sec)) != NULL
+            && flux_msg_get_topic (msg2, &topic) == 0
+            && !strcmp (topic, "foo.bar"),
+            "flux_msg_recvzsock_hmac works");
+    flux_msg_destroy (msg2);
+    ok (flux_msg_sendzsock_hmac (zsock[1], msg, sec) == 0,
+            "flux_msg_sendzsock_hmac works");
+    errno = 0;
+    ok (flux_msg_recvzsock_hmac (zsock[0], sec2) == NULL
+            && errno == EKEYREJECTED,
+            "flux_msg_recvzsock_hmac with wrong key fails with EKEYREJECTED");
+    flux_msg_destroy (msg);
+    zsock_destroy (&zsock[0]);
+    zsock_destroy (&zsock[1]);
+
+    flux_sec_destroy (sec2);
+    flux_sec_destroy (sec);
+    unlink_recursive (path);
+}
+
 void alarm_callback (int arg)
 {
     diag ("test timed out");
@@ -487,6 +580,7 @@ int main (int argc, char *argv[])
     test_munge ();
     test_plain ();
     test_curve ();
+    test_hmac ();
 
     done_testing ();
     return (0);
@@ -26,6 +26,7 @@
 #include "config.h"
 #endif
 #include <czmq.h>
+#include <errno.h>
 #include <stdint.h>
 #include <string.h>
 #include <limits.h>
@@ -63,6 +64,7 @@ typedef struct {
     lru_cache_t *kvs_paths;
     zlist_t *callbacks;
     int first_time;
+    int index_absent;       /* job-index module is not loaded */
     flux_t *h;
 } jscctx_t;
 
@@ -362,115 +364,109 @@ static char * lwj_key (flux_t *h, int64_t id, const char *fmt, ...)
     return (key);
 }
 
-static int extract_raw_nnodes (flux_t *h, int64_t j, int64_t *nnodes)
+static int tree_get_int64 (flux_t *h, flux_future_t *f, const char *key,
+                           int64_t *val)
+{
+    const char *json_str;
+    json_object *o = NULL;
+    int rc = -1;
+
+    if (flux_kvs_lookup_tree_get (f, key, &json_str) < 0)
+        goto done;
+    if (!(o = Jfromstr (json_str)) || !json_object_is_type (o, json_type_int)) {
+        errno = EPROTO;
+        goto done;
+    }
+    *val = json_object_get_int64 (o);
+    rc = 0;
+done:
+    Jput (o);
+    return rc;
+}
+
+static int extract_raw_nnodes (flux_t *h, flux_future_t *f, int64_t *nnodes)
 {
     int rc = 0;
-    char *key = lwj_key (h, j, ".nnodes");
-    flux_future_t *f = NULL;
 
-    if (!key || !(f = flux_kvs_lookup (h, 0, key))
-             || flux_kvs_lookup_get_unpack (f, "I", nnodes) < 0) {
-        flux_log_error (h, "extract %s", key);
+    if (tree_get_int64 (h, f, "nnodes", nnodes) < 0) {
+        flux_log_error (h, "extract nnodes");
         rc = -1;
     }
     else
-        flux_log (h, LOG_DEBUG, "extract %s: %"PRId64"", key, *nnodes);
-    free (key);
-    flux_future_destroy (f);
+        flux_log (h, LOG_DEBUG, "extract nnodes: %"PRId64"", *nnodes);
     return rc;
 }
 
-static int extract_raw_ntasks (flux_t *h, int64_t j, int64_t *ntasks)
+static int extract_raw_ntasks (flux_t *h, flux_future_t *f, int64_t *ntasks)
 {
     int rc = 0;
-    char *key = lwj_key (h, j, ".ntasks");
-    flux_future_t *f = NULL;
 
-    if (!key || !(f = flux_kvs_lookup (h, 0, key))
-             || flux_kvs_lookup_get_unpack (f, "I", ntasks) < 0) {
-        flux_log_error (h, "extract %s", key);
+    if (tree_get_int64 (h, f, "ntasks", ntasks) < 0) {
+        flux_log_error (h, "extract ntasks");
         rc = -1;
     }
     else
-        flux_log (h, LOG_DEBUG, "extract %s: %"PRId64"", key, *ntasks);
-    free (key);
-    flux_future_destroy (f);
+        flux_log (h, LOG_DEBUG, "extract ntasks: %"PRId64"", *ntasks);
     return rc;
 }
 
-static int extract_raw_walltime (flux_t *h, int64_t j, int64_t *walltime)
+static int extract_raw_walltime (flux_t *h, flux_future_t *f,
+                                 int64_t *walltime)
 {
     int rc = 0;
-    char *key = lwj_key (h, j, ".walltime");
-    flux_future_t *f = NULL;
 
-    if (!key || !(f = flux_kvs_lookup (h, 0, key))
-             || flux_kvs_lookup_get_unpack (f, "I", walltime) < 0) {
-        flux_log_error (h, "extract %s", key);
+    if (tree_get_int64 (h, f, "walltime", walltime) < 0) {
+        flux_log_error (h, "extract walltime");
         rc = -1;
     }
     else
-        flux_log (h, LOG_DEBUG, "extract %s: %"PRId64"", key, *walltime);
-    free (key);
-    flux_future_destroy (f);
+        flux_log (h, LOG_DEBUG, "extract walltime: %"PRId64"", *walltime);
     return rc;
 }
 
-static int extract_raw_rdl (flux_t *h, int64_t j, char **rdlstr)
+static int extract_raw_rdl (flux_t *h, flux_future_t *f, char **rdlstr)
 {
     int rc = 0;
-    char *key = lwj_key (h, j, ".rdl");
     const char *s;
-    flux_future_t *f = NULL;
 
-    if (!key || !(f = flux_kvs_lookup (h, 0, key))
-             || flux_kvs_lookup_get_unpack (f, "s", &s) < 0) {
-        flux_log_error (h, "extract %s", key);
+    if (flux_kvs_lookup_get_unpack (f, "s", &s) < 0) {
+        flux_log_error (h, "extract rdl");
         rc = -1;
     }
     else {
         *rdlstr = xstrdup (s);
-        flux_log (h, LOG_DEBUG, "rdl under %s extracted", key);
+        flux_log (h, LOG_DEBUG, "rdl extracted");
     }
-    free (key);
-    flux_future_destroy (f);
     return rc;
 }
 
-static int extract_raw_state (flux_t *h, int64_t j, int64_t *s)
+static int extract_raw_state (flux_t *h, flux_future_t *f, int64_t *s)
 {
     int rc = 0;
-    char *key = lwj_key (h, j, ".state");
     const char *state;
-    flux_future_t *f = NULL;
 
-    if (!key || !(f = flux_kvs_lookup (h, 0, key))
-             || flux_kvs_lookup_get_unpack (f, "s", &state) < 0) {
-        flux_log_error (h, "extract %s", key);
+    if (flux_kvs_lookup_get_unpack (f, "s", &state) < 0) {
+        flux_log_error (h, "extract state");
         rc = -1;
     }
     else {
         *s = jsc_job_state2num (state);
-        flux_log (h, LOG_DEBUG, "extract %s: %s", key, state);
+        flux_log (h, LOG_DEBUG, "extract state: %s", state);
     }
-    free (key);
-    flux_future_destroy (f);
     return rc;
 }
 
-static int extract_raw_pdesc (flux_t *h, int64_t j, int64_t i, json_object **o)
+static int extract_raw_pdesc (flux_t *h, flux_future_t *f, int64_t i,
+                              json_object **o)
 {
     int rc = 0;
-    char *json_str = NULL;
-    char *key = lwj_key (h, j, ".%ju.procdesc", i);
-    if (kvs_get (h, key, &json_str) < 0
+    const char *json_str;
+    char *key = xasprintf ("%"PRId64".procdesc", i);
+
+    if (flux_kvs_lookup_tree_get (f, key, &json_str) < 0
             || !(*o = Jfromstr (json_str))) {
         flux_log_error (h, "extract %s", key);
         rc = -1;
-        if (json_str)
-            free (json_str);
-        if (*o)
-            Jput (*o);
     }
     free (key);
     return rc;
@@ -497,48 +493,242 @@ static void add_pdescs_to_jcb (json_object **hns, json_object **ens,
     *pa = NULL;
 }
 
-static int extract_raw_pdescs (flux_t *h, int64_t j, int64_t n, json_object *jcb)
+/* Append the pdarray element for one task, adding its command and
+ * node to the exec and host name arrays.
+ */
+static void add_task_pdesc (zhash_t *eh, zhash_t *hh, json_object *ens,
+                            json_object *hns, json_object *pa, int64_t i,
+                            int64_t pid, int64_t nid, const char *cmd)
+{
+    int64_t eix, hix;
+    /* FIXME: we need a hostname service */
+    char *hnm = xasprintf ("%"PRId64, nid);
+
+    eix = build_name_array (eh, cmd, ens);
+    hix = build_name_array (hh, hnm, hns);
+    json_object_array_put_idx (pa, i, build_parray_elem (pid, eix, hix));
+    free (hnm);
+}
+
+/* Per-node records: procdesc.<k> = {"command", "nodeid", "base", "pids"}
+ * describing tasks base .. base + len(pids) - 1.  'f' is the lookup of
+ * the procdesc directory.
+ */
+static int extract_raw_node_pdescs (flux_t *h, flux_future_t *f, int64_t n,
+                                    zhash_t *eh, zhash_t *hh, json_object *ens,
+                                    json_object *hns, json_object *pa)
 {
+    int k, j, npids, pid;
+    int64_t base, nid;
+    const char *cmd;
+    const char *json_str;
+    json_object *o = NULL;
+    json_object *pids;
+    char *key = NULL;
     int rc = -1;
-    int64_t i = 0;
-    char *hnm;
+
+    for (k = 0; ; k++) {
+        key = xasprintf ("%d", k);
+        if (flux_kvs_lookup_tree_get (f, key, &json_str) < 0) {
+            if (errno == ENOENT && k > 0)
+                break;
+            flux_log_error (h, "extract procdesc.%s", key);
+            goto done;
+        }
+        if (!(o = Jfromstr (json_str))
+                || !Jget_str (o, "command", &cmd)
+                || !Jget_int64 (o, "nodeid", &nid)
+                || !Jget_int64 (o, "base", &base)
+                || !Jget_obj (o, "pids", &pids)
+                || !Jget_ar_len (pids, &npids)) {
+            flux_log (h, LOG_ERR, "extract procdesc.%s: invalid record", key);
+            goto done;
+        }
+        for (j = 0; j < npids; j++) {
+            if (base + j >= n || !Jget_ar_int (pids, j, &pid)) {
+                flux_log (h, LOG_ERR, "extract procdesc.%s: invalid pids",
+                          key);
+                goto done;
+            }
+            add_task_pdesc (eh, hh, ens, hns, pa, base + j, pid, nid, cmd);
+        }
+        Jput (o);
+        o = NULL;
+        free (key);
+        key = NULL;
+    }
+    for (j = 0; j < (int) n; j++) {
+        if (!json_object_array_get_idx (pa, j)) {
+            flux_log (h, LOG_ERR, "extract procdesc: task %d missing", j);
+            goto done;
+        }
+    }
+    rc = 0;
+done:
+    if (o)
+        Jput (o);
+    free (key);
+    return rc;
+}
+
+/* Older per-task records: <i>.procdesc = {"command", "pid", "nodeid"}
+ */
+static int extract_raw_task_pdescs (flux_t *h, flux_future_t *f, int64_t n,
+                                    zhash_t *eh, zhash_t *hh, json_object *ens,
+                                    json_object *hns, json_object *pa)
+{
+    int64_t i;
     const char *cmd = NULL;
+    json_object *o = NULL;
+
+    for (i=0; i < n; i++) {
+        int64_t pid = 0, nid = 0;
+
+        if (extract_raw_pdesc (h, f, i, &o) != 0)
+            return -1;
+        if (!fetch_rank_pdesc (o, &pid, &nid, &cmd)) {
+            Jput (o);
+            return -1;
+        }
+        add_task_pdesc (eh, hh, ens, hns, pa, i, pid, nid, cmd);
+        Jput (o);
+        o = NULL;
+    }
+    return 0;
+}
+
+/* The pdesc attribute is looked up in steps:  <path>.ntasks and the
+ * per-node records in <path>.procdesc, then only if there are none, the
+ * older per-task records one level down in the job directory.  Inlined
+ * values are capped at PDESC_MAXSIZE, since task directories may also
+ * hold e.g. task output.  The future returned by pdesc_lookup() is
+ * fulfilled once all steps are done;  errors are left in the futures of
+ * the steps, to be reported by extract_raw_pdescs().
+ */
+#define PDESC_MAXSIZE (16*1024*1024)
+
+struct pdesc_lookup {
+    char *path;
+    flux_future_t *ntasks;
+    flux_future_t *procdesc;
+    flux_future_t *tasks;
+    int pending;
+    bool done;
+};
+
+static const char *pdesc_auxkey = "jstatctl::pdesc";
+
+static void pdesc_lookup_destroy (struct pdesc_lookup *pl)
+{
+    if (pl) {
+        flux_future_destroy (pl->ntasks);
+        flux_future_destroy (pl->procdesc);
+        flux_future_destroy (pl->tasks);
+        free (pl->path);
+        free (pl);
+    }
+}
+
+static void pdesc_lookup_continuation (flux_future_t *step, void *arg)
+{
+    flux_future_t *f = arg;
+    struct pdesc_lookup *pl = flux_future_aux_get (f, pdesc_auxkey);
+    flux_t *h = flux_future_get_flux (f);
+
+    if (--pl->pending > 0)
+        return;
+    if (!pl->tasks && flux_kvs_lookup_get (pl->procdesc, NULL) < 0
+                   && errno == ENOENT) {
+        if (!(pl->tasks = flux_kvs_lookup_tree (h, pl->path, NULL, 1,
+                                                PDESC_MAXSIZE))
+                || flux_future_then (pl->tasks, -1.,
+                                     pdesc_lookup_continuation, f) < 0) {
+            flux_future_fulfill_error (f, errno);
+            return;
+        }
+        pl->pending = 1;
+        return;
+    }
+    pl->done = true;
+    flux_future_fulfill (f, NULL, NULL);
+}
+
+/* May be called once in each of the "now" and "then" contexts.
+ * Restart the lookups on the current context's handle.
+ */
+static void pdesc_lookup_init (flux_future_t *f, void *arg)
+{
+    struct pdesc_lookup *pl = flux_future_aux_get (f, pdesc_auxkey);
+    flux_t *h = flux_future_get_flux (f);
+    char *k = NULL;
+
+    if (pl->done)
+        return;
+    flux_future_destroy (pl->ntasks);
+    flux_future_destroy (pl->procdesc);
+    flux_future_destroy (pl->tasks);
+    pl->ntasks = pl->procdesc = pl->tasks = NULL;
+    pl->pending = 2;
+    k = xasprintf ("%s.ntasks", pl->path);
+    if (!(pl->ntasks = flux_kvs_lookup (h, 0, k))
+            || flux_future_then (pl->ntasks, -1.,
+                                 pdesc_lookup_continuation, f) < 0)
+        goto error;
+    free (k);
+    k = xasprintf ("%s.procdesc", pl->path);
+    if (!(pl->procdesc = flux_kvs_lookup_tree (h, k, NULL, 0, PDESC_MAXSIZE))
+            || flux_future_then (pl->procdesc, -1.,
+                                 pdesc_lookup_continuation, f) < 0)
+        goto error;
+    free (k);
+    return;
+error:
+    free (k);
+    flux_future_fulfill_error (f, errno);
+}
+
+static flux_future_t *pdesc_lookup (flux_t *h, const char *path)
+{
+    struct pdesc_lookup *pl = xzmalloc (sizeof (*pl));
+    flux_future_t *f;
+
+    pl->path = xstrdup (path);
+    if (!(f = flux_future_create (pdesc_lookup_init, NULL))) {
+        pdesc_lookup_destroy (pl);
+        return NULL;
+    }
+    if (flux_future_aux_set (f, pdesc_auxkey, pl,
+                             (flux_free_f)pdesc_lookup_destroy) < 0) {
+        pdesc_lookup_destroy (pl);
+        flux_future_destroy (f);
+        return NULL;
+    }
+    flux_future_set_flux (f, h);
+    return f;
+}
+
+static int extract_raw_pdescs (flux_t *h, struct pdesc_lookup *pl, int64_t n,
+                               json_object *jcb)
+{
+    int rc = -1;
     zhash_t *eh = NULL; /* hash holding a set of unique exec_names */
     zhash_t *hh = NULL; /* hash holding a set of unique host_names */
-    json_object *o = NULL;
-    json_object *po = NULL;
     json_object *pa = Jnew_ar ();
     json_object *hns = Jnew_ar ();
     json_object *ens = Jnew_ar ();
 
     if (!(eh = zhash_new ()) || !(hh = zhash_new ()))
         oom ();
-    for (i=0; i < (int) n; i++) {
-        int64_t eix = 0, hix = 0;
-        int64_t pid = 0, nid = 0;
-
-        if (extract_raw_pdesc (h, j, i, &o) != 0)
-            goto done;
-        if (!fetch_rank_pdesc (o, &pid, &nid, &cmd))
-            goto done;
-
-        eix = build_name_array (eh, cmd, ens);
-        /* FIXME: we need a hostname service */
-        hnm = xasprintf ("%"PRId64, nid);
-        hix = build_name_array (hh, hnm, hns);
-        po = build_parray_elem (pid, eix, hix);
-        json_object_array_add (pa, po);
-        po = NULL;
-        Jput (o);
-        o = NULL;
-        free (hnm);
-    }
-    add_pdescs_to_jcb (&hns, &ens, &pa, jcb);
-    rc = 0;
+    if (!pl->tasks)
+        rc = extract_raw_node_pdescs (h, pl->procdesc, n, eh, hh, ens, hns,
+                                      pa);
+    else if (flux_kvs_lookup_get (pl->tasks, NULL) < 0)
+        flux_log_error (h, "extract procdesc");
+    else
+        rc = extract_raw_task_pdescs (h, pl->tasks, n, eh, hh, ens, hns, pa);
+    if (rc == 0)
+        add_pdescs_to_jcb (&hns, &ens, &pa, jcb);
 
-done:
-    if (o) Jput (o);
-    if (po) Jput (po);
     if (pa) Jput (pa);
     if (hns) Jput (hns);
     if (ens) Jput (ens);
@@ -547,20 +737,21 @@ done:
     return rc;
 }
 
-static int extract_raw_rdl_alloc (flux_t *h, int64_t j, json_object *jcb)
+/* A job without a rank directory has an empty allocation.
+ */
+static int extract_raw_rdl_alloc (flux_t *h, flux_future_t *f,
+                                  json_object *jcb)
 {
     int i;
     json_object *ra = Jnew_ar ();
-    bool processing = true;
+    bool processing = (flux_kvs_lookup_get (f, NULL) == 0);
 
     for (i=0; processing; ++i) {
-        char *key = lwj_key (h, j, ".rank.%d.cores", i);
-        flux_future_t *f = NULL;
+        char *key = xasprintf ("%d.cores", i);
         int64_t cores = 0;
-        if (!key || !(f = flux_kvs_lookup (h, 0, key))
-                 || flux_kvs_lookup_get_unpack (f, "I", &cores) < 0) {
-            if (errno != EINVAL)
-                flux_log_error (h, "extract %s", key);
+        if (tree_get_int64 (h, f, key, &cores) < 0) {
+            if (errno != ENOENT)
+                flux_log_error (h, "extract rank.%s", key);
             processing = false;
         } else {
             json_object *elem = Jnew ();
@@ -570,30 +761,27 @@ static int extract_raw_rdl_alloc (flux_t *h, int64_t j, json_object *jcb)
             json_object_array_add (ra, elem);
         }
         free (key);
-        flux_future_destroy (f);
     }
     json_object_object_add (jcb, JSC_RDL_ALLOC, ra);
     return 0;
 }
 
-static int query_jobid (flux_t *h, int64_t j, json_object **jcb)
+static int query_jobid (flux_t *h, flux_future_t *f, int64_t j,
+                        json_object **jcb)
 {
-    int rc = 0;
-    if ( ( rc = jobid_exist (h, j)) != 0)
-        *jcb = NULL;
-    else {
-        *jcb = Jnew ();
-        Jadd_int64 (*jcb, JSC_JOBID, j);
-    }
-    return rc;
+    if (flux_kvs_lookup_get (f, NULL) < 0)
+        return -1;
+    *jcb = Jnew ();
+    Jadd_int64 (*jcb, JSC_JOBID, j);
+    return 0;
 }
 
-static int query_state_pair (flux_t *h, int64_t j, json_object **jcb)
+static int query_state_pair (flux_t *h, flux_future_t *f, json_object **jcb)
 {
     json_object *o = NULL;
     int64_t st = (int64_t)J_FOR_RENT;;
 
-    if (extract_raw_state (h, j, &st) < 0) return -1;
+    if (extract_raw_state (h, f, &st) < 0) return -1;
 
     *jcb = Jnew ();
     o = Jnew ();
@@ -606,16 +794,18 @@ static int query_state_pair (flux_t *h, int64_t j, json_object **jcb)
     return 0;
 }
 
-static int query_rdesc (flux_t *h, int64_t j, json_object **jcb)
+static int query_rdesc (flux_t *h, flux_future_t *f, json_object **jcb)
 {
     json_object *o = NULL;
     int64_t nnodes = -1;
     int64_t ntasks = -1;
     int64_t walltime = -1;
 
-    if (extract_raw_nnodes (h, j, &nnodes) < 0) return -1;
-    if (extract_raw_ntasks (h, j, &ntasks) < 0) return -1;
-    if (extract_raw_walltime (h, j, &walltime) < 0) return -1;
+    if (flux_kvs_lookup_get (f, NULL) < 0
+            || extract_raw_nnodes (h, f, &nnodes) < 0
+            || extract_raw_ntasks (h, f, &ntasks) < 0
+            || extract_raw_walltime (h, f, &walltime) < 0)
+        return -1;
 
     *jcb = Jnew ();
     o = Jnew ();
@@ -626,11 +816,11 @@ static int query_rdesc (flux_t *h, int64_t j, json_object **jcb)
     return 0;
 }
 
-static int query_rdl (flux_t *h, int64_t j, json_object **jcb)
+static int query_rdl (flux_t *h, flux_future_t *f, json_object **jcb)
 {
     char *rdlstr = NULL;
 
-    if (extract_raw_rdl (h, j, &rdlstr) < 0) return -1;
+    if (extract_raw_rdl (h, f, &rdlstr) < 0) return -1;
 
     *jcb = Jnew ();
     Jadd_str (*jcb, JSC_RDL, (const char *)rdlstr);
@@ -641,19 +831,97 @@ static int query_rdl (flux_t *h, int64_t j, json_object **jcb)
     return 0;
 }
 
-static int query_rdl_alloc (flux_t *h, int64_t j, json_object **jcb)
+static int query_rdl_alloc (flux_t *h, flux_future_t *f, json_object **jcb)
 {
     *jcb = Jnew ();
-    return extract_raw_rdl_alloc (h, j, *jcb);
+    return extract_raw_rdl_alloc (h, f, *jcb);
 }
 
-static int query_pdesc (flux_t *h, int64_t j, json_object **jcb)
+static int query_pdesc (flux_t *h, flux_future_t *f, json_object **jcb)
 {
+    struct pdesc_lookup *pl = flux_future_aux_get (f, pdesc_auxkey);
     int64_t ntasks = 0;
-    if (extract_raw_ntasks (h, j, &ntasks) < 0) return -1;
+
+    if (!pl) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (flux_future_get (f, NULL) < 0)
+        return -1;
+    if (flux_kvs_lookup_get_unpack (pl->ntasks, "I", &ntasks) < 0) {
+        flux_log_error (h, "extract ntasks");
+        return -1;
+    }
     *jcb = Jnew ();
     Jadd_int64 (*jcb, JSC_PDESC_SIZE, ntasks);
-    return extract_raw_pdescs (h, j, ntasks, *jcb);
+    return extract_raw_pdescs (h, pl, ntasks, *jcb);
+}
+
+/* Start the KVS lookup needed to build JCB attribute 'key' for the job
+ * stored under 'path'.  Attributes made of several values fetch the job
+ * directory (down to the depth they need) in one request, so they are
+ * extracted from one KVS snapshot, except pdesc (see pdesc_lookup()).
+ */
+static flux_future_t *jcb_lookup (flux_t *h, const char *path,
+                                  const char *key)
+{
+    flux_future_t *f = NULL;
+    char *k = NULL;
+
+    if (is_jobid (key))
+        f = flux_kvs_lookup (h, FLUX_KVS_READDIR, path);
+    else if (is_state_pair (key)) {
+        k = xasprintf ("%s.state", path);
+        f = flux_kvs_lookup (h, 0, k);
+    } else if (is_rdesc (key))
+        f = flux_kvs_lookup_tree (h, path, NULL, 0, 0);
+    else if (is_rdl (key)) {
+        k = xasprintf ("%s.rdl", path);
+        f = flux_kvs_lookup (h, 0, k);
+    } else if (is_rdl_alloc (key)) {
+        k = xasprintf ("%s.rank", path);
+        f = flux_kvs_lookup_tree (h, k, NULL, 1, 0);
+    } else if (is_pdesc (key))
+        f = pdesc_lookup (h, path);
+    else {
+        flux_log (h, LOG_ERR, "key (%s) not understood", key);
+        errno = EINVAL;
+    }
+    free (k);
+    return f;
+}
+
+/* Build JCB attribute 'key' from the result of jcb_lookup().
+ * Blocks if the lookup has not yet been fulfilled.
+ */
+static int jcb_build (flux_t *h, flux_future_t *f, int64_t jobid,
+                      const char *key, json_object **jcb)
+{
+    int rc = -1;
+
+    if (is_jobid (key)) {
+        if ( (rc = query_jobid (h, f, jobid, jcb)) < 0)
+            flux_log (h, LOG_ERR, "query_jobid failed");
+    } else if (is_state_pair (key)) {
+        if ( (rc = query_state_pair (h, f, jcb)) < 0)
+            flux_log (h, LOG_ERR, "query_state_pair failed");
+    } else if (is_rdesc (key)) {
+        if ( (rc = query_rdesc (h, f, jcb)) < 0)
+            flux_log (h, LOG_ERR, "query_rdesc failed");
+    } else if (is_rdl (key)) {
+        if ( (rc = query_rdl (h, f, jcb)) < 0)
+            flux_log (h, LOG_ERR, "query_rdl failed");
+    } else if (is_rdl_alloc (key)) {
+        if ( (rc = query_rdl_alloc (h, f, jcb)) < 0)
+            flux_log (h, LOG_ERR, "query_rdl_alloc failed");
+    } else if (is_pdesc (key)) {
+        if ( (rc = query_pdesc (h, f, jcb)) < 0)
+            flux_log (h, LOG_ERR, "query_pdesc failed");
+    } else {
+        flux_log (h, LOG_ERR, "key (%s) not understood", key);
+        errno = EINVAL;
+    }
+    return rc;
 }
 
 static int send_state_event (flux_t *h, job_state_t st, int64_t j)
@@ -833,73 +1101,93 @@ done:
     return rc;
 }
 
-static int update_1pdesc (flux_t *h, int r, int64_t j, json_object *o,
-			  json_object *ha, json_object *ea)
+static int fetch_update_1pdesc (flux_t *h, json_object *o, json_object *ha,
+                                json_object *ea, int64_t *pid, int64_t *hrank,
+                                const char **en)
 {
-    int rc = -1;
-    json_object *d = NULL;
-    char *key;
-    char *json_str = NULL;
-    const char *hn = NULL, *en = NULL;
-    int64_t pid = 0, hindx = 0, eindx = 0, hrank = 0;
+    const char *hn = NULL;
+    int64_t hindx = 0, eindx = 0;
 
-    if (!Jget_int64 (o, JSC_PDESC_RANK_PDARRAY_PID, &pid)) return -1;
+    if (!Jget_int64 (o, JSC_PDESC_RANK_PDARRAY_PID, pid)) return -1;
     if (!Jget_int64 (o, JSC_PDESC_RANK_PDARRAY_HINDX, &hindx)) return -1;
     if (!Jget_int64 (o, JSC_PDESC_RANK_PDARRAY_EINDX, &eindx)) return -1;
     if (!Jget_ar_str (ha, (int)hindx, &hn)) return -1;
-    if (!Jget_ar_str (ea, (int)eindx, &en)) return -1;
-
-    key = lwj_key (h, j, ".%d.procdesc", r);
-    if (kvs_get (h, key, &json_str) < 0
-            || !(d = Jfromstr (json_str))) {
-        flux_log_error (h, "extract %s", key);
-        goto done;
-    }
-
-    Jadd_str (d, "command", en);
-    Jadd_int64 (d, "pid", pid);
+    if (!Jget_ar_str (ea, (int)eindx, en)) return -1;
     errno = 0;
-    if ( (hrank = strtoul (hn, NULL, 10)) && errno != 0) {
+    if ( (*hrank = strtoul (hn, NULL, 10)) && errno != 0) {
         flux_log (h, LOG_ERR, "invalid hostname %s", hn);
-        goto done;
+        return -1;
     }
-    Jadd_int64 (d, "nodeid", (int64_t)hrank);
+    return 0;
+}
+
+static int put_node_pdesc (flux_t *h, int64_t j, int k, json_object *d)
+{
+    char *key = lwj_key (h, j, ".procdesc.%d", k);
+    int rc = 0;
+
     if (kvs_put (h, key, Jtostr (d)) < 0) {
         flux_log_error (h, "put %s", key);
-        goto done;
+        rc = -1;
     }
-    rc = 0;
-
-done:
     free (key);
-    if (d)
-        Jput (d);
-    if (json_str)
-        free (json_str);
     return rc;
 }
 
+/* Rewrite lwj.<j>.procdesc as per-node records (see wrexecd), starting
+ * a new record whenever the host or command changes between tasks.
+ */
 static int update_pdesc (flux_t *h, int64_t j, json_object *o)
 {
     int i = 0;
+    int k = 0;
     int rc = -1;
     int64_t size = 0;
+    int64_t pid = 0, hrank = 0, last_hrank = -1;
+    const char *en = NULL, *last_en = NULL;
+    char *key = NULL;
     json_object *h_arr = NULL;
     json_object *e_arr = NULL;
     json_object *pd_arr = NULL;
     json_object *pde = NULL;
+    json_object *d = NULL;
+    json_object *pids = NULL;
 
     if (!Jget_int64 (o, JSC_PDESC_SIZE, &size)) return -1;
     if (!Jget_obj (o, JSC_PDESC_PDARRAY, &pd_arr)) return -1;
     if (!Jget_obj (o, JSC_PDESC_HOSTNAMES, &h_arr)) return -1;
     if (!Jget_obj (o, JSC_PDESC_EXECS, &e_arr)) return -1;
 
+    if (!(key = lwj_key (h, j, ".procdesc")))
+        return -1;
+    if (kvs_unlink (h, key) < 0) {
+        flux_log_error (h, "unlink %s", key);
+        goto done;
+    }
     for (i=0; i < (int) size; ++i) {
         if (!Jget_ar_obj (pd_arr, i, &pde))
             goto done;
-        if ( (rc = update_1pdesc (h, i, j, pde, h_arr, e_arr)) < 0)
+        if (fetch_update_1pdesc (h, pde, h_arr, e_arr, &pid, &hrank, &en) < 0)
             goto done;
+        if (!d || hrank != last_hrank || strcmp (en, last_en) != 0) {
+            if (d) {
+                if (put_node_pdesc (h, j, k++, d) < 0)
+                    goto done;
+                Jput (d);
+            }
+            d = Jnew ();
+            pids = Jnew_ar ();
+            Jadd_str (d, "command", en);
+            Jadd_int64 (d, "nodeid", hrank);
+            Jadd_int (d, "base", i);
+            json_object_object_add (d, "pids", pids);
+            last_hrank = hrank;
+            last_en = en;
+        }
+        Jadd_ar_int (pids, (int)pid);
     }
+    if (d && put_node_pdesc (h, j, k, d) < 0)
+        goto done;
     if (kvs_commit (h, 0) < 0) {
         flux_log (h, LOG_ERR, "update_pdesc commit failed");
         goto done;
@@ -907,6 +1195,9 @@ static int update_pdesc (flux_t *h, int64_t j, json_object *o)
     rc = 0;
 
 done:
+    free (key);
+    if (d)
+        Jput (d);
     return rc;
 }
 
@@ -1050,6 +1341,46 @@ static struct flux_msg_handler_spec htab[] = {
       FLUX_MSGHANDLER_TABLE_END
 };
 
+/* Seed the table of active jobs (used to report the old state in
+ * state-pair notifications) from the job-index module, if loaded.
+ * Jobs that started before we subscribed would otherwise be reported
+ * with an unavailable old state on their next transition.
+ */
+static void seed_active_jobs (flux_t *h, jscctx_t *ctx)
+{
+    flux_future_t *f = NULL;
+    const char *json_str;
+    json_object *o = NULL;
+    json_object *jobs;
+    json_object *job;
+    int64_t id;
+    int64_t state;
+    char key[21];
+    int i;
+
+    if (ctx->index_absent)
+        return;
+    if (!(f = flux_rpc (h, "job-index.list", NULL, FLUX_NODEID_ANY, 0))
+            || flux_rpc_get (f, &json_str) < 0) {
+        if (errno == ENOSYS)
+            ctx->index_absent = 1;
+        goto done;
+    }
+    if (!json_str || !(o = Jfromstr (json_str))
+            || !Jget_obj (o, "jobs", &jobs))
+        goto done;
+    for (i = 0; Jget_ar_obj (jobs, i, &job); i++) {
+        if (!Jget_int64 (job, "jobid", &id)
+                || !Jget_int64 (job, "state", &state))
+            continue;
+        snprintf (key, sizeof (key), "%"PRId64, id);
+        zhash_update (ctx->active_jobs, key, (void *)(intptr_t)state);
+    }
+done:
+    Jput (o);
+    flux_future_destroy (f);
+}
+
 static int notify_status_obj (flux_t *h, jsc_handler_obj_f func, void *d)
 {
     int rc = -1;
@@ -1075,6 +1406,10 @@ static int notify_status_obj (flux_t *h, jsc_handler_obj_f func, void *d)
     }
 
     ctx = getctx (h);
+    if (ctx->first_time) {
+        seed_active_jobs (h, ctx);
+        ctx->first_time = 0;
+    }
     c = (cb_pair_t *) xzmalloc (sizeof(*c));
     c->cb = func;
     c->arg = d;
@@ -1119,38 +1454,64 @@ int jsc_notify_status (flux_t *h, jsc_handler_f func, void *d)
     return rc;
 }
 
-static int query_jcb_obj (flux_t *h, int64_t jobid, const char *key,
-		       json_object **jcb)
+static int query_jcb_obj_kvs (flux_t *h, int64_t jobid, const char *key,
+                              json_object **jcb)
 {
-    int rc = -1;
+    const char *path;
+    flux_future_t *f;
+    int rc;
 
     if (!key) return -1;
     if (jobid_exist (h, jobid) != 0) return -1;
+    if (!(path = jscctx_jobid_path (getctx (h), jobid)))
+        return -1;
+    if (!(f = jcb_lookup (h, path, key)))
+        return -1;
+    rc = jcb_build (h, f, jobid, key, jcb);
+    flux_future_destroy (f);
+    return rc;
+}
 
-    if (is_jobid (key)) {
-        if ( (rc = query_jobid (h, jobid, jcb)) < 0)
-            flux_log (h, LOG_ERR, "query_jobid failed");
-    } else if (is_state_pair (key)) {
-        if ( (rc = query_state_pair (h, jobid, jcb)) < 0)
-            flux_log (h, LOG_ERR, "query_pdesc failed");
-    } else if (is_rdesc (key)) {
-        if ( (rc = query_rdesc (h, jobid, jcb)) < 0)
-            flux_log (h, LOG_ERR, "query_rdesc failed");
-    } else if (is_rdl (key)) {
-        if ( (rc = query_rdl (h, jobid, jcb)) < 0)
-            flux_log (h, LOG_ERR, "query_rdl failed");
-    } else if (is_rdl_alloc (key)) {
-        if ( (rc = query_rdl_alloc (h, jobid, jcb)) < 0)
-            flux_log (h, LOG_ERR, "query_rdl_alloc failed");
-    } else if (is_pdesc (key)) {
-        if ( (rc = query_pdesc (h, jobid, jcb)) < 0)
-            flux_log (h, LOG_ERR, "query_pdesc failed");
-    } else
-        flux_log (h, LOG_ERR, "key (%s) not understood", key);
+/* Ask the job-index module for the JCB.  Fails with ENOSYS if the
+ * module is not loaded.
+ */
+static int query_index (flux_t *h, int64_t jobid, const char *key,
+                        json_object **jcb)
+{
+    flux_future_t *f;
+    const char *json_str;
+    int rc = -1;
 
+    if (!(f = flux_rpc_pack (h, "job-index.query", FLUX_NODEID_ANY, 0,
+                             "{s:I s:s}", "jobid", jobid, "key", key))
+            || flux_rpc_get (f, &json_str) < 0)
+        goto done;
+    if (!json_str || !(*jcb = Jfromstr (json_str))) {
+        errno = EPROTO;
+        goto done;
+    }
+    rc = 0;
+done:
+    flux_future_destroy (f);
     return rc;
 }
 
+static int query_jcb_obj (flux_t *h, int64_t jobid, const char *key,
+		       json_object **jcb)
+{
+    jscctx_t *ctx = getctx (h);
+
+    if (!key) return -1;
+    if (!ctx->index_absent) {
+        if (query_index (h, jobid, key, jcb) == 0)
+            return 0;
+        if (errno != ENOSYS)
+            return -1;
+        ctx->index_absent = 1;
+    }
+    return query_jcb_obj_kvs (h, jobid, key, jcb);
+}
+
 /* deprecated */
 int jsc_query_jcb_obj (flux_t *h, int64_t jobid, const char *key,
 		       json_object **jcb)
@@ -1172,6 +1533,64 @@ done:
     return rc;
 }
 
+int jsc_query_jcb_kvs (flux_t *h, int64_t jobid, const char *key, char **jcb)
+{
+    int rc;
+    json_object *o = NULL;
+
+    rc = query_jcb_obj_kvs (h, jobid, key, &o);
+    if (rc < 0)
+        goto done;
+    *jcb = o ? xstrdup (Jtostr (o)) : NULL;
+done:
+    Jput (o);
+    return rc;
+}
+
+flux_future_t *jsc_query_jcb_kvs_lookup (flux_t *h, const char *path,
+                                         const char *key)
+{
+    if (!h || !path || !key) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return jcb_lookup (h, path, key);
+}
+
+int jsc_query_jcb_kvs_get (flux_future_t *f, int64_t jobid, const char *key,
+                           char **jcb)
+{
+    flux_t *h;
+    json_object *o = NULL;
+    int rc;
+
+    if (!f || !key || !jcb || !(h = flux_future_get_flux (f))) {
+        errno = EINVAL;
+        return -1;
+    }
+    rc = jcb_build (h, f, jobid, key, &o);
+    if (rc < 0)
+        goto done;
+    *jcb = o ? xstrdup (Jtostr (o)) : NULL;
+done:
+    Jput (o);
+    return rc;
+}
+
+/* Tell the job-index module to drop JCBs it has cached for 'jobid'.
+ */
+static void invalidate_index (flux_t *h, int64_t jobid)
+{
+    flux_future_t *f;
+
+    if (getctx (h)->index_absent)
+        return;
+    if (!(f = flux_rpc_pack (h, "job-index.invalidate", FLUX_NODEID_ANY,
+                             FLUX_RPC_NORESPONSE, "{s:I}", "jobid", jobid)))
+        flux_log_error (h, "job-index.invalidate");
+    flux_future_destroy (f);
+}
+
 static int update_jcb_obj (flux_t *h, int64_t jobid, const char *key,
 			json_object *jcb)
 {
@@ -1203,6 +1622,8 @@ static int update_jcb_obj (flux_t *h, int64_t jobid, const char *key,
     else
         flux_log (h, LOG_ERR, "key (%s) not understood", key);
 
+    if (rc == 0)
+        invalidate_index (h, jobid);
     return rc;
 }
 
@@ -105,6 +105,25 @@ int jsc_notify_status (flux_t *h, jsc_handler_f callback, void *d);
  */
 int jsc_query_jcb (flux_t *h, int64_t jobid, const char *key, char **jcb);
 
+/**
+ * Same as jsc_query_jcb(), but always read the JCB from the KVS, bypassing
+ * the job-index module.  jsc_query_jcb() falls back to this when the
+ * job-index module is not loaded.
+ */
+int jsc_query_jcb_kvs (flux_t *h, int64_t jobid, const char *key, char **jcb);
+
+/**
+ * Asynchronous form of jsc_query_jcb_kvs() for a job whose KVS directory
+ * "path" is already known.  Start the KVS lookup for the "key" attribute,
+ * then once the returned future is fulfilled, build the JCB with
+ * jsc_query_jcb_kvs_get() and destroy the future.  Both return NULL or -1
+ * on failure with errno set.
+ */
+flux_future_t *jsc_query_jcb_kvs_lookup (flux_t *h, const char *path,
+                                         const char *key);
+int jsc_query_jcb_kvs_get (flux_future_t *f, int64_t jobid, const char *key,
+                           char **jcb);
+
 
 /**
  * Update the "key" attribute of the JCB of "jobid". The top-level attribute
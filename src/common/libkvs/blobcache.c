@@ -0,0 +1,415 @@
+/*****************************************************************************\
+ *  Copyright (c) 2017 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/* blobcache.c - client side cache of content-addressed KVS blobs
+ *
+ * Blobs are immutable, so once a blob is cached it never needs to be
+ * invalidated; the LRU only bounds memory.  Lookups relative to a
+ * snapshot root (flux_kvs_lookupat) can then be resolved locally,
+ * falling back to a content.load for each blob not yet cached.
+ *
+ * The walk mirrors src/modules/kvs/lookup.c so that results (including
+ * errno values) match those returned by the kvs.get service.
+ *
+ * A walk that misses is restarted from the root once the missing blob
+ * has been inserted, so blobs fetched earlier in the walk must survive
+ * eviction by later ones or a path needing more than 'maxblobs' blobs
+ * would never complete.  The caller therefore passes a pin set that
+ * holds a reference on every blob the walk has touched, until the walk
+ * is finished and the pin set is destroyed.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <jansson.h>
+#include <czmq.h>
+#include <flux/core.h>
+
+#include "blobcache.h"
+#include "treeobj.h"
+#include "src/common/libutil/lru_cache.h"
+
+#define SYMLINK_CYCLE_LIMIT 10
+
+struct blobcache {
+    lru_cache_t *lru;
+};
+
+struct blobcache_pins {
+    zhash_t *blobs;
+};
+
+struct blob {
+    int refcount;
+    void *data;
+    int len;
+    json_t *obj;        // directory object, decoded on first use
+};
+
+static void blob_decref (struct blob *b)
+{
+    if (b && --b->refcount == 0) {
+        int saved_errno = errno;
+        free (b->data);
+        json_decref (b->obj);
+        free (b);
+        errno = saved_errno;
+    }
+}
+
+static struct blob *blob_incref (struct blob *b)
+{
+    if (b)
+        b->refcount++;
+    return b;
+}
+
+static struct blob *blob_create (const void *data, int len)
+{
+    struct blob *b;
+
+    if (!(b = calloc (1, sizeof (*b))))
+        goto nomem;
+    b->refcount = 1;
+    if (len > 0) {
+        if (!(b->data = malloc (len)))
+            goto nomem;
+        memcpy (b->data, data, len);
+    }
+    b->len = len;
+    return b;
+nomem:
+    blob_decref (b);
+    errno = ENOMEM;
+    return NULL;
+}
+
+/* Directory blobs are NUL-terminated JSON (see commit_unroll()).
+ */
+static json_t *blob_get_dir (struct blob *b)
+{
+    if (!b->obj) {
+        char *s = b->data;
+        if (b->len < 1 || s[b->len - 1] != '\0')
+            goto inval;
+        if (!(b->obj = json_loads (s, 0, NULL)))
+            goto inval;
+    }
+    if (!treeobj_is_dir (b->obj))
+        goto inval;
+    return b->obj;
+inval:
+    errno = EINVAL;
+    return NULL;
+}
+
+struct blobcache *blobcache_create (int maxblobs)
+{
+    struct blobcache *bc;
+
+    if (maxblobs <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(bc = calloc (1, sizeof (*bc)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!(bc->lru = lru_cache_create (maxblobs))) {
+        free (bc);
+        errno = ENOMEM;
+        return NULL;
+    }
+    lru_cache_set_free_f (bc->lru, (lru_cache_free_f)blob_decref);
+    return bc;
+}
+
+void blobcache_destroy (struct blobcache *bc)
+{
+    if (bc) {
+        int saved_errno = errno;
+        lru_cache_destroy (bc->lru);
+        free (bc);
+        errno = saved_errno;
+    }
+}
+
+int blobcache_count (struct blobcache *bc)
+{
+    return lru_cache_size (bc->lru);
+}
+
+int blobcache_insert (struct blobcache *bc, const char *blobref,
+                      const void *data, int len)
+{
+    struct blob *b;
+
+    if (!bc || !blobref || len < 0 || (len > 0 && !data)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (lru_cache_check (bc->lru, blobref))
+        return 0;
+    if (!(b = blob_create (data, len)))
+        return -1;
+    if (lru_cache_put (bc->lru, blobref, b) < 0) {
+        blob_decref (b);
+        return -1;
+    }
+    return 0;
+}
+
+struct blobcache_pins *blobcache_pins_create (void)
+{
+    struct blobcache_pins *pins;
+
+    if (!(pins = calloc (1, sizeof (*pins)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!(pins->blobs = zhash_new ())) {
+        free (pins);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return pins;
+}
+
+void blobcache_pins_destroy (struct blobcache_pins *pins)
+{
+    if (pins) {
+        int saved_errno = errno;
+        zhash_destroy (&pins->blobs);
+        free (pins);
+        errno = saved_errno;
+    }
+}
+
+int blobcache_pins_count (struct blobcache_pins *pins)
+{
+    return pins ? zhash_size (pins->blobs) : 0;
+}
+
+static int pin_blob (struct blobcache_pins *pins, const char *blobref,
+                     struct blob *b)
+{
+    if (zhash_insert (pins->blobs, blobref, blob_incref (b)) < 0) {
+        blob_decref (b);
+        errno = ENOMEM;
+        return -1;
+    }
+    zhash_freefn (pins->blobs, blobref, (zhash_free_fn *)blob_decref);
+    return 0;
+}
+
+/* Fetch the blob referenced by single-blobref 'ref' (dirref or valref),
+ * preferring blobs already pinned by this walk, and pinning any others.
+ * On cache miss, set *missing and fail with EAGAIN.
+ */
+static struct blob *get_ref (struct blobcache *bc, struct blobcache_pins *pins,
+                             json_t *ref, const char **missing)
+{
+    const char *blobref;
+    struct blob *b;
+
+    if (treeobj_get_count (ref) != 1) {
+        errno = EPERM;
+        return NULL;
+    }
+    if (!(blobref = treeobj_get_blobref (ref, 0)))
+        return NULL;
+    if (pins && (b = zhash_lookup (pins->blobs, blobref)))
+        return b;
+    if (!(b = lru_cache_get (bc->lru, blobref))) {
+        *missing = blobref;
+        errno = EAGAIN;
+        return NULL;
+    }
+    if (pins && pin_blob (pins, blobref, b) < 0)
+        return NULL;
+    return b;
+}
+
+/* Return directory object for 'dirent' (dir or dirref).
+ */
+static json_t *get_dir (struct blobcache *bc, struct blobcache_pins *pins,
+                        json_t *dirent, const char **missing)
+{
+    struct blob *b;
+    json_t *dir;
+
+    if (treeobj_is_dir (dirent))
+        return dirent;
+    if (!treeobj_is_dirref (dirent)) {
+        errno = treeobj_is_val (dirent) || treeobj_is_valref (dirent)
+              ? ENOENT : EPERM;
+        return NULL;
+    }
+    if (!(b = get_ref (bc, pins, dirent, missing)))
+        return NULL;
+    if (!(dir = blob_get_dir (b))) {
+        errno = EPERM;
+        return NULL;
+    }
+    return dir;
+}
+
+/* Walk 'path' from 'root', returning borrowed dirent of the last
+ * path component.  Symlinks are followed relative to 'root'.
+ */
+static json_t *walk (struct blobcache *bc, struct blobcache_pins *pins,
+                     json_t *root, const char *path,
+                     int depth, bool follow_last, const char **missing)
+{
+    char *cpy, *comp, *next, *saveptr = NULL;
+    json_t *dirent = root;
+    json_t *dir;
+
+    if (!(cpy = strdup (path))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    next = strtok_r (cpy, ".", &saveptr);
+    while ((comp = next)) {
+        next = strtok_r (NULL, ".", &saveptr);
+        if (!(dir = get_dir (bc, pins, dirent, missing)))
+            goto error;
+        if (!(dirent = treeobj_get_entry (dir, comp)))
+            goto error;
+        if (treeobj_is_symlink (dirent) && (next || follow_last)) {
+            const char *target = json_string_value (treeobj_get_data (dirent));
+            if (!target) {
+                errno = EPERM;
+                goto error;
+            }
+            if (depth == SYMLINK_CYCLE_LIMIT) {
+                errno = ELOOP;
+                goto error;
+            }
+            if (!(dirent = walk (bc, pins, root, target, depth + 1,
+                                 follow_last, missing)))
+                goto error;
+        }
+    }
+    free (cpy);
+    return dirent;
+error:
+    free (cpy);
+    return NULL;
+}
+
+int blobcache_lookup (struct blobcache *bc, struct blobcache_pins *pins,
+                      json_t *root, const char *key,
+                      int flags, json_t **val, const char **missing)
+{
+    json_t *dirent;
+    json_t *dir;
+    struct blob *b;
+
+    if (!bc || !root || !key || !val || !missing) {
+        errno = EINVAL;
+        return -1;
+    }
+    /* special case root */
+    if (!strcmp (key, ".")) {
+        if ((flags & FLUX_KVS_TREEOBJ)) {
+            *val = json_incref (root);
+            return 0;
+        }
+        if (!(flags & FLUX_KVS_READDIR)) {
+            errno = EISDIR;
+            return -1;
+        }
+        if (!(dir = get_dir (bc, pins, root, missing))) {
+            if (errno == EPERM)
+                errno = EINVAL;
+            return -1;
+        }
+        *val = json_incref (dir);
+        return 0;
+    }
+    if (!(dirent = walk (bc, pins, root, key, 0,
+                         !(flags & (FLUX_KVS_READLINK | FLUX_KVS_TREEOBJ)),
+                         missing)))
+        return -1;
+    if ((flags & FLUX_KVS_TREEOBJ)) {
+        *val = json_incref (dirent);
+        return 0;
+    }
+    if (treeobj_is_dirref (dirent) || treeobj_is_dir (dirent)) {
+        if ((flags & FLUX_KVS_READLINK)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (!(flags & FLUX_KVS_READDIR)) {
+            errno = EISDIR;
+            return -1;
+        }
+        if (!(dir = get_dir (bc, pins, dirent, missing)))
+            return -1;
+        *val = json_incref (dir);
+    }
+    else if (treeobj_is_valref (dirent) || treeobj_is_val (dirent)) {
+        if ((flags & FLUX_KVS_READLINK)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if ((flags & FLUX_KVS_READDIR)) {
+            errno = ENOTDIR;
+            return -1;
+        }
+        if (treeobj_is_valref (dirent)) {
+            if (!(b = get_ref (bc, pins, dirent, missing)))
+                return -1;
+            if (!(*val = treeobj_create_val (b->data, b->len)))
+                return -1;
+        }
+        else
+            *val = json_incref (dirent);
+    }
+    else if (treeobj_is_symlink (dirent)) {
+        if (!(flags & FLUX_KVS_READLINK)) {
+            errno = EPROTO;
+            return -1;
+        }
+        if ((flags & FLUX_KVS_READDIR)) {
+            errno = ENOTDIR;
+            return -1;
+        }
+        *val = json_incref (dirent);
+    }
+    else {
+        errno = EPERM;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,54 @@
+#ifndef _FLUX_KVS_BLOBCACHE_H
+#define _FLUX_KVS_BLOBCACHE_H
+
+#include <jansson.h>
+
+/* Client side cache of immutable KVS blobs (RFC 11 directory objects
+ * and raw value data) keyed by blobref, with a walker that resolves
+ * keys against a root tree object using only cached blobs.
+ */
+
+struct blobcache;
+struct blobcache_pins;
+
+/* Create a cache holding at most 'maxblobs' blobs (LRU eviction).
+ */
+struct blobcache *blobcache_create (int maxblobs);
+void blobcache_destroy (struct blobcache *bc);
+
+/* Add blob to cache.  Data is copied.  Adding a blobref that is already
+ * cached is a no-op.  Returns 0 on success, -1 on failure with errno set.
+ */
+int blobcache_insert (struct blobcache *bc, const char *blobref,
+                      const void *data, int len);
+
+/* Return the number of cached blobs.
+ */
+int blobcache_count (struct blobcache *bc);
+
+/* A pin set holds a reference on each blob a walk has used, so that
+ * blobs evicted from the LRU by later inserts remain available to the
+ * walk when it is restarted after a miss.  Create one per walk and
+ * destroy it when the walk completes.
+ */
+struct blobcache_pins *blobcache_pins_create (void);
+void blobcache_pins_destroy (struct blobcache_pins *pins);
+int blobcache_pins_count (struct blobcache_pins *pins);
+
+/* Resolve 'key' relative to 'root' (a dirref or dir tree object),
+ * with the same semantics as the kvs.get service for FLUX_KVS_* 'flags'.
+ * On success, return 0 with 'val' set to a new reference to the result
+ * tree object.  If a blob needed to continue is not cached, return -1
+ * with errno = EAGAIN and 'missing' set to its blobref (valid until the
+ * cache is next modified).  Otherwise return -1 with errno set.
+ * If 'pins' is non-NULL, blobs used by the walk are added to it.
+ */
+int blobcache_lookup (struct blobcache *bc, struct blobcache_pins *pins,
+                      json_t *root, const char *key,
+                      int flags, json_t **val, const char **missing);
+
+#endif /* !_FLUX_KVS_BLOBCACHE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
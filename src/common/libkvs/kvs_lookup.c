@@ -34,6 +34,7 @@
 
 #include "kvs_lookup.h"
 #include "treeobj.h"
+#include "blobcache.h"
 
 struct lookup_ctx {
     int flags;
@@ -43,9 +44,23 @@ struct lookup_ctx {
     int val_len;
     bool val_valid;
     json_t *val_obj;
+
+    /* lookupat resolved with client side blob cache */
+    struct blobcache *cache;
+    struct blobcache_pins *pins; // blobs used by this walk
+    json_t *root;
+    char *key;
+    char *missing;     // blobref being loaded
+    flux_future_t *load;
+    json_t *cache_val; // result of walk, becomes 'treeobj'
+    int cache_errnum;
+    bool done;
+
+    zhash_t *tree_vals; // decoded values from FLUX_KVS_RECURSIVE result
 };
 
 static const char *auxkey = "flux::lookup_ctx";
+static const char *cachekey = "flux::kvs_blobcache";
 
 static void free_ctx (struct lookup_ctx *ctx)
 {
@@ -53,6 +68,13 @@ static void free_ctx (struct lookup_ctx *ctx)
         free (ctx->treeobj_str);
         free (ctx->val_data);
         json_decref (ctx->val_obj);
+        flux_future_destroy (ctx->load);
+        blobcache_pins_destroy (ctx->pins);
+        json_decref (ctx->root);
+        json_decref (ctx->cache_val);
+        free (ctx->key);
+        free (ctx->missing);
+        zhash_destroy (&ctx->tree_vals);
         free (ctx);
     }
 }
@@ -75,6 +97,7 @@ static int validate_lookup_flags (int flags)
         case FLUX_KVS_TREEOBJ:
         case FLUX_KVS_READDIR:
         case FLUX_KVS_READDIR | FLUX_KVS_TREEOBJ:
+        case FLUX_KVS_READDIR | FLUX_KVS_RECURSIVE:
         case FLUX_KVS_READLINK:
             return 0;
         default:
@@ -108,12 +131,133 @@ flux_future_t *flux_kvs_lookup (flux_t *h, int flags, const char *key)
     return f;
 }
 
+int flux_kvs_lookup_cache_enable (flux_t *h, int maxblobs)
+{
+    struct blobcache *cache;
+
+    if (!h || maxblobs <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (flux_aux_get (h, cachekey))
+        return 0;
+    if (!(cache = blobcache_create (maxblobs)))
+        return -1;
+    flux_aux_set (h, cachekey, cache, (flux_free_f)blobcache_destroy);
+    return 0;
+}
+
+static void lookup_step (flux_future_t *f, struct lookup_ctx *ctx);
+
+/* Lookup errors are reported by the get functions rather than by
+ * fulfilling the future with an error, since a walk that completes
+ * within flux_future_then() would otherwise make it fail.
+ */
+static void lookup_finish (flux_future_t *f, struct lookup_ctx *ctx,
+                           int errnum)
+{
+    ctx->cache_errnum = errnum;
+    ctx->done = true;
+    blobcache_pins_destroy (ctx->pins);
+    ctx->pins = NULL;
+    flux_future_fulfill (f, NULL, NULL);
+}
+
+static void load_continuation (flux_future_t *load, void *arg)
+{
+    flux_future_t *f = arg;
+    struct lookup_ctx *ctx = flux_future_aux_get (f, auxkey);
+    const void *data;
+    int len;
+
+    if (flux_content_load_get (load, &data, &len) < 0
+                || blobcache_insert (ctx->cache, ctx->missing, data, len) < 0) {
+        lookup_finish (f, ctx, errno);
+        return;
+    }
+    flux_future_destroy (ctx->load);
+    ctx->load = NULL;
+    lookup_step (f, ctx);
+}
+
+/* Walk as far as cached blobs allow.  On a miss, load the missing blob
+ * from the content store and try again when it arrives.  Blobs used so
+ * far are pinned for the duration of the walk, so that the restarted
+ * walk makes progress even if later loads evict them from the cache.
+ */
+static void lookup_step (flux_future_t *f, struct lookup_ctx *ctx)
+{
+    const char *missing;
+
+    if (!ctx->pins && !(ctx->pins = blobcache_pins_create ()))
+        goto error;
+    if (blobcache_lookup (ctx->cache, ctx->pins, ctx->root, ctx->key,
+                          ctx->flags, &ctx->cache_val, &missing) == 0) {
+        lookup_finish (f, ctx, 0);
+        return;
+    }
+    if (errno != EAGAIN)
+        goto error;
+    free (ctx->missing);
+    if (!(ctx->missing = strdup (missing))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!(ctx->load = flux_content_load (flux_future_get_flux (f),
+                                         ctx->missing, 0)))
+        goto error;
+    if (flux_future_then (ctx->load, -1., load_continuation, f) < 0)
+        goto error;
+    return;
+error:
+    lookup_finish (f, ctx, errno);
+}
+
+/* May be called once in each of the "now" and "then" contexts.
+ * Restart the walk on the current context's handle; blobs loaded
+ * so far remain pinned.
+ */
+static void lookup_init (flux_future_t *f, void *arg)
+{
+    struct lookup_ctx *ctx = flux_future_aux_get (f, auxkey);
+
+    if (ctx->done)
+        return;
+    flux_future_destroy (ctx->load);
+    ctx->load = NULL;
+    lookup_step (f, ctx);
+}
+
+static flux_future_t *lookupat_cached (flux_t *h, struct blobcache *cache,
+                                       struct lookup_ctx *ctx,
+                                       const char *key, const char *treeobj)
+{
+    flux_future_t *f;
+
+    if (!(ctx->root = json_loads (treeobj, 0, NULL))
+            || treeobj_validate (ctx->root) < 0
+            || !(treeobj_is_dirref (ctx->root) || treeobj_is_dir (ctx->root))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(ctx->key = strdup (key))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    ctx->cache = cache;
+    if (!(f = flux_future_create (lookup_init, NULL)))
+        return NULL;
+    flux_future_set_flux (f, h);
+    return f;
+}
+
 flux_future_t *flux_kvs_lookupat (flux_t *h, int flags, const char *key,
                                   const char *treeobj)
 {
     flux_future_t *f;
     json_t *obj = NULL;
     struct lookup_ctx *ctx;
+    struct blobcache *cache;
 
     if (!h || !key || strlen (key) == 0 || validate_lookup_flags (flags) < 0) {
         errno = EINVAL;
@@ -128,8 +272,16 @@ flux_future_t *flux_kvs_lookupat (flux_t *h, int flags, const char *key,
             return NULL;
         }
     }
+    else if (!(flags & FLUX_KVS_RECURSIVE)
+                        && (cache = flux_aux_get (h, cachekey))) {
+        if (!(f = lookupat_cached (h, cache, ctx, key, treeobj))) {
+            free_ctx (ctx);
+            return NULL;
+        }
+    }
     else {
         if (!(obj = json_loads (treeobj, 0, NULL))) {
+            free_ctx (ctx);
             errno = EINVAL;
             return NULL;
         }
@@ -152,6 +304,74 @@ flux_future_t *flux_kvs_lookupat (flux_t *h, int flags, const char *key,
     return f;
 }
 
+flux_future_t *flux_kvs_lookup_tree (flux_t *h, const char *key,
+                                     const char *treeobj,
+                                     int maxdepth, int maxsize)
+{
+    int flags = FLUX_KVS_READDIR | FLUX_KVS_RECURSIVE;
+    flux_future_t *f;
+    json_t *obj = NULL;
+    struct lookup_ctx *ctx;
+
+    if (!h || !key || strlen (key) == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (treeobj && !(obj = json_loads (treeobj, 0, NULL))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(ctx = alloc_ctx ()))
+        goto error;
+    ctx->flags = flags;
+    if (obj)
+        f = flux_rpc_pack (h, "kvs.get", FLUX_NODEID_ANY, 0,
+                           "{s:s s:i s:i s:i s:O}", "key", key,
+                                                    "flags", flags,
+                                                    "maxdepth", maxdepth,
+                                                    "maxsize", maxsize,
+                                                    "rootdir", obj);
+    else
+        f = flux_rpc_pack (h, "kvs.get", FLUX_NODEID_ANY, 0,
+                           "{s:s s:i s:i s:i}", "key", key,
+                                                "flags", flags,
+                                                "maxdepth", maxdepth,
+                                                "maxsize", maxsize);
+    if (!f)
+        goto error;
+    if (flux_future_aux_set (f, auxkey, ctx, (flux_free_f)free_ctx) < 0) {
+        flux_future_destroy (f);
+        goto error;
+    }
+    json_decref (obj);
+    return f;
+error:
+    free_ctx (ctx);
+    json_decref (obj);
+    return NULL;
+}
+
+/* Set ctx->treeobj from the kvs.get response, or for cached lookups,
+ * from the result of the local walk.
+ */
+static int get_treeobj (flux_future_t *f, struct lookup_ctx *ctx)
+{
+    if (!ctx->treeobj) {
+        if (ctx->cache) {
+            if (flux_future_get (f, NULL) < 0)
+                return -1;
+            if (ctx->cache_errnum != 0) {
+                errno = ctx->cache_errnum;
+                return -1;
+            }
+            ctx->treeobj = ctx->cache_val;
+        }
+        else if (flux_rpc_get_unpack (f, "{s:o}", "val", &ctx->treeobj) < 0)
+            return -1;
+    }
+    return 0;
+}
+
 int flux_kvs_lookup_get (flux_future_t *f, const char **json_str)
 {
     struct lookup_ctx *ctx;
@@ -160,10 +380,8 @@ int flux_kvs_lookup_get (flux_future_t *f, const char **json_str)
         errno = EINVAL;
         return -1;
     }
-    if (!(ctx->treeobj)) {
-        if (flux_rpc_get_unpack (f, "{s:o}", "val", &ctx->treeobj) < 0)
-            return -1;
-    }
+    if (get_treeobj (f, ctx) < 0)
+        return -1;
     /* If TREEOBJ or READDIR flags, val is a tree object.
      * Re-encode as a string and return.
      */
@@ -252,11 +470,9 @@ int flux_kvs_lookup_get_raw (flux_future_t *f, const void **data, int *len)
         errno = EINVAL;
         return -1;
     }
-    if (!(ctx->treeobj)) {
-        if (flux_rpc_get_unpack (f, "{s:o}", "val", &ctx->treeobj) < 0) {
-            errno = EINVAL;
-            return -1;
-        }
+    if (get_treeobj (f, ctx) < 0) {
+        errno = EINVAL;
+        return -1;
     }
     if (!ctx->val_valid) {
         if (treeobj_decode_val (ctx->treeobj, &ctx->val_data,
@@ -271,6 +487,71 @@ int flux_kvs_lookup_get_raw (flux_future_t *f, const void **data, int *len)
     return 0;
 }
 
+int flux_kvs_lookup_tree_get (flux_future_t *f, const char *key,
+                              const char **json_str)
+{
+    struct lookup_ctx *ctx;
+    json_t *dirent;
+    char *cpy = NULL, *comp, *saveptr = NULL;
+    void *data = NULL;
+    int len;
+    char *s;
+
+    if (!(ctx = flux_future_aux_get (f, auxkey))
+            || !(ctx->flags & FLUX_KVS_RECURSIVE) || !key) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (get_treeobj (f, ctx) < 0)
+        return -1;
+    if (!ctx->tree_vals && !(ctx->tree_vals = zhash_new ())) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if ((s = zhash_lookup (ctx->tree_vals, key)))
+        goto done;
+    if (!(cpy = strdup (key))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    dirent = ctx->treeobj;
+    comp = strtok_r (cpy, ".", &saveptr);
+    while (comp) {
+        if (treeobj_is_dirref (dirent)) {
+            errno = ERANGE; // beyond maxdepth
+            goto error;
+        }
+        if (!treeobj_is_dir (dirent)
+                || !(dirent = treeobj_get_entry (dirent, comp))) {
+            errno = ENOENT;
+            goto error;
+        }
+        comp = strtok_r (NULL, ".", &saveptr);
+    }
+    if (treeobj_is_dir (dirent) || treeobj_is_dirref (dirent)) {
+        errno = EISDIR;
+        goto error;
+    }
+    if (treeobj_decode_val (dirent, &data, &len) < 0)
+        goto error;
+    s = data;
+    if (len < 1 || s[len - 1] != '\0') {
+        errno = EINVAL;
+        goto error;
+    }
+    zhash_update (ctx->tree_vals, key, s);
+    zhash_freefn (ctx->tree_vals, key, (zhash_free_fn *)free);
+    free (cpy);
+done:
+    if (json_str)
+        *json_str = s;
+    return 0;
+error:
+    free (cpy);
+    free (data);
+    return -1;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
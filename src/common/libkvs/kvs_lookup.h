@@ -5,16 +5,40 @@ enum kvs_lookup_flags {
     FLUX_KVS_READDIR = 1,
     FLUX_KVS_READLINK = 2,
     FLUX_KVS_TREEOBJ = 16,
+    FLUX_KVS_RECURSIVE = 32,
 };
 
 flux_future_t *flux_kvs_lookup (flux_t *h, int flags, const char *key);
 flux_future_t *flux_kvs_lookupat (flux_t *h, int flags, const char *key,
                                   const char *treeobj);
 
+/* Look up directory 'key' and its contents, recursively, in a single
+ * request against one root snapshot (current root if 'treeobj' is NULL).
+ * Subdirectories deeper than 'maxdepth' are returned as dirrefs
+ * (maxdepth < 0 is unlimited); if inlined values exceed 'maxsize' bytes
+ * the lookup fails with EFBIG (maxsize <= 0 is unlimited).
+ * Access the result with flux_kvs_lookup_get().
+ */
+flux_future_t *flux_kvs_lookup_tree (flux_t *h, const char *key,
+                                     const char *treeobj,
+                                     int maxdepth, int maxsize);
+
 int flux_kvs_lookup_get (flux_future_t *f, const char **json_str);
 int flux_kvs_lookup_get_unpack (flux_future_t *f, const char *fmt, ...);
 int flux_kvs_lookup_get_raw (flux_future_t *f, const void **data, int *len);
 
+/* Get the value of 'key', relative to the directory returned by
+ * flux_kvs_lookup_tree(), without further requests.  Fails with ERANGE
+ * if 'key' lies below the depth limit of the lookup.
+ */
+int flux_kvs_lookup_tree_get (flux_future_t *f, const char *key,
+                              const char **json_str);
+
+/* Resolve flux_kvs_lookupat() on handle 'h' in the client, using a
+ * cache of up to 'maxblobs' content blobs shared by all lookups.
+ */
+int flux_kvs_lookup_cache_enable (flux_t *h, int maxblobs);
+
 #endif /* !_FLUX_CORE_KVS_LOOKUP_H */
 
 /*
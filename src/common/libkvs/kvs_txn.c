@@ -131,6 +131,12 @@ static int flux_kvs_txn_put_treeobj (flux_kvs_txn_t *txn, int flags,
         op = json_pack ("{s:s s:n}", "key", key, "dirent");
     else
         op = json_pack ("{s:s s:O}", "key", key, "dirent", dirent);
+    if (op && (flags & FLUX_KVS_COMPARE)
+           && json_object_set_new (op, "flags",
+                                   json_integer (FLUX_KVS_COMPARE)) < 0) {
+        json_decref (op);
+        op = NULL;
+    }
     if (!op) {
         errno = ENOMEM;
         goto error;
@@ -343,6 +349,33 @@ error:
     return -1;
 }
 
+int flux_kvs_txn_compare (flux_kvs_txn_t *txn, int flags,
+                          const char *key, const char *treeobj)
+{
+    json_t *dirent = NULL;
+    int saved_errno;
+
+    if (!txn || !key) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (validate_flags (flags, 0) < 0)
+        goto error;
+    if (treeobj && !(dirent = json_loads (treeobj, 0, NULL))) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (flux_kvs_txn_put_treeobj (txn, FLUX_KVS_COMPARE, key, dirent) < 0)
+        goto error;
+    json_decref (dirent);
+    return 0;
+error:
+    saved_errno = errno;
+    json_decref (dirent);
+    errno = saved_errno;
+    return -1;
+}
+
 /* accessors for KVS internals and unit tests
  */
 int txn_get (flux_kvs_txn_t *txn, int request, void *arg)
@@ -3,6 +3,10 @@
 
 typedef struct flux_kvs_txn flux_kvs_txn_t;
 
+enum kvs_txn_flags {
+    FLUX_KVS_COMPARE = 64, /* op tests key instead of updating it */
+};
+
 flux_kvs_txn_t *flux_kvs_txn_create (void);
 void flux_kvs_txn_destroy (flux_kvs_txn_t *txn);
 
@@ -24,6 +28,15 @@ int flux_kvs_txn_unlink (flux_kvs_txn_t *txn, int flags,
 int flux_kvs_txn_symlink (flux_kvs_txn_t *txn, int flags,
                           const char *key, const char *target);
 
+/* Fail the commit with EAGAIN unless 'key' has the RFC 11 tree object
+ * 'treeobj', as returned by a FLUX_KVS_TREEOBJ lookup, or does not exist
+ * if 'treeobj' is NULL.  Compares are checked before any other operation
+ * in the transaction is applied.  Commit with FLUX_KVS_NO_MERGE so that a
+ * failed compare does not fail other commits.
+ */
+int flux_kvs_txn_compare (flux_kvs_txn_t *txn, int flags,
+                          const char *key, const char *treeobj);
+
 #endif /* !_FLUX_CORE_KVS_TXN_H */
 
 /*
@@ -0,0 +1,301 @@
+#include <string.h>
+#include <errno.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libkvs/treeobj.h"
+#include "src/common/libkvs/blobcache.h"
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/blobref.h"
+
+/* Encode 'obj' as the KVS module would store it (NUL terminated),
+ * compute its blobref, and optionally add it to the cache.
+ */
+static void store_obj (struct blobcache *bc, json_t *obj, char *ref, bool add)
+{
+    size_t flags = JSON_ENCODE_ANY | JSON_COMPACT | JSON_SORT_KEYS;
+    char *s = json_dumps (obj, flags);
+
+    if (!s)
+        BAIL_OUT ("json_dumps failed");
+    if (blobref_hash ("sha1", s, strlen (s) + 1, ref,
+                      BLOBREF_MAX_STRING_SIZE) < 0)
+        BAIL_OUT ("blobref_hash failed");
+    if (add && blobcache_insert (bc, ref, s, strlen (s) + 1) < 0)
+        BAIL_OUT ("blobcache_insert failed");
+    free (s);
+}
+
+static void store_raw (struct blobcache *bc, const char *data, char *ref)
+{
+    if (blobref_hash ("sha1", data, strlen (data) + 1, ref,
+                      BLOBREF_MAX_STRING_SIZE) < 0)
+        BAIL_OUT ("blobref_hash failed");
+    if (blobcache_insert (bc, ref, data, strlen (data) + 1) < 0)
+        BAIL_OUT ("blobcache_insert failed");
+}
+
+static void insert (json_t *dir, const char *name, json_t *ent)
+{
+    if (!ent || treeobj_insert_entry (dir, name, ent) < 0)
+        BAIL_OUT ("treeobj_insert_entry failed");
+    json_decref (ent);
+}
+
+/* Build:
+ *   a.b = 42 (val)
+ *   a.big = "valref" (valref)
+ *   a.link -> a.b (symlink)
+ *   loop -> loop (symlink)
+ *   c = "x" (val)
+ */
+static json_t *build_tree (struct blobcache *bc, char *bref, bool add_a)
+{
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    char aref[BLOBREF_MAX_STRING_SIZE];
+    json_t *a, *root, *rootref;
+
+    if (!(a = treeobj_create_dir ()) || !(root = treeobj_create_dir ()))
+        BAIL_OUT ("treeobj_create_dir failed");
+    insert (a, "b", treeobj_create_val ("42", 3));
+    store_raw (bc, "\"valref\"", ref);
+    insert (a, "big", treeobj_create_valref (ref));
+    insert (a, "link", treeobj_create_symlink ("a.b"));
+    store_obj (bc, a, aref, add_a);
+    strcpy (bref, aref);
+    insert (root, "a", treeobj_create_dirref (aref));
+    insert (root, "c", treeobj_create_val ("\"x\"", 4));
+    insert (root, "loop", treeobj_create_symlink ("loop"));
+    store_obj (bc, root, ref, true);
+    if (!(rootref = treeobj_create_dirref (ref)))
+        BAIL_OUT ("treeobj_create_dirref failed");
+    json_decref (a);
+    json_decref (root);
+    return rootref;
+}
+
+static bool val_is (json_t *val, const char *s)
+{
+    void *data;
+    int len;
+    bool match;
+
+    if (!val || treeobj_decode_val (val, &data, &len) < 0)
+        return false;
+    match = (len == strlen (s) + 1 && !memcmp (data, s, len));
+    free (data);
+    return match;
+}
+
+void test_miss (void)
+{
+    struct blobcache *bc;
+    char aref[BLOBREF_MAX_STRING_SIZE];
+    const char *missing = NULL;
+    json_t *root, *val = NULL;
+
+    if (!(bc = blobcache_create (16)))
+        BAIL_OUT ("blobcache_create failed");
+    root = build_tree (bc, aref, false);
+
+    ok (blobcache_lookup (bc, NULL, root, "c", 0, &val, &missing) == 0
+        && val_is (val, "\"x\""),
+        "lookup c succeeds without a.* in cache");
+    json_decref (val);
+    val = NULL;
+    errno = 0;
+    ok (blobcache_lookup (bc, NULL, root, "a.b", 0, &val, &missing) < 0
+        && errno == EAGAIN && missing && !strcmp (missing, aref),
+        "lookup a.b fails with EAGAIN and missing blobref of a");
+    ok (blobcache_count (bc) == 2,
+        "cache contains 2 blobs");
+
+    blobcache_destroy (bc);
+    json_decref (root);
+}
+
+void test_lookup (void)
+{
+    struct blobcache *bc;
+    char aref[BLOBREF_MAX_STRING_SIZE];
+    const char *missing;
+    json_t *root, *val;
+
+    if (!(bc = blobcache_create (16)))
+        BAIL_OUT ("blobcache_create failed");
+    root = build_tree (bc, aref, true);
+
+    val = NULL;
+    ok (blobcache_lookup (bc, NULL, root, "a.b", 0, &val, &missing) == 0
+        && val_is (val, "42"),
+        "lookup a.b works");
+    json_decref (val);
+
+    val = NULL;
+    ok (blobcache_lookup (bc, NULL, root, "a.big", 0, &val, &missing) == 0
+        && val_is (val, "\"valref\""),
+        "lookup a.big converts valref to val");
+    json_decref (val);
+
+    val = NULL;
+    ok (blobcache_lookup (bc, NULL, root, "a.link", 0, &val, &missing) == 0
+        && val_is (val, "42"),
+        "lookup a.link follows symlink");
+    json_decref (val);
+
+    val = NULL;
+    ok (blobcache_lookup (bc, NULL, root, "a.link", FLUX_KVS_READLINK,
+                          &val, &missing) == 0
+        && treeobj_is_symlink (val),
+        "lookup a.link with READLINK returns symlink");
+    json_decref (val);
+
+    val = NULL;
+    ok (blobcache_lookup (bc, NULL, root, "a", FLUX_KVS_READDIR,
+                          &val, &missing) == 0
+        && treeobj_is_dir (val) && treeobj_get_count (val) == 3,
+        "lookup a with READDIR returns dir");
+    json_decref (val);
+
+    val = NULL;
+    ok (blobcache_lookup (bc, NULL, root, "a", FLUX_KVS_TREEOBJ,
+                          &val, &missing) == 0
+        && treeobj_is_dirref (val),
+        "lookup a with TREEOBJ returns dirref");
+    json_decref (val);
+
+    val = NULL;
+    ok (blobcache_lookup (bc, NULL, root, ".", FLUX_KVS_READDIR,
+                          &val, &missing) == 0
+        && treeobj_is_dir (val),
+        "lookup . with READDIR returns root dir");
+    json_decref (val);
+
+    errno = 0;
+    ok (blobcache_lookup (bc, NULL, root, "a", 0, &val, &missing) < 0
+        && errno == EISDIR,
+        "lookup a fails with EISDIR");
+    errno = 0;
+    ok (blobcache_lookup (bc, NULL, root, "c", FLUX_KVS_READDIR,
+                          &val, &missing) < 0 && errno == ENOTDIR,
+        "lookup c with READDIR fails with ENOTDIR");
+    errno = 0;
+    ok (blobcache_lookup (bc, NULL, root, "a.nokey", 0, &val, &missing) < 0
+        && errno == ENOENT,
+        "lookup a.nokey fails with ENOENT");
+    errno = 0;
+    ok (blobcache_lookup (bc, NULL, root, "c.d", 0, &val, &missing) < 0
+        && errno == ENOENT,
+        "lookup c.d fails with ENOENT");
+    errno = 0;
+    ok (blobcache_lookup (bc, NULL, root, "loop", 0, &val, &missing) < 0
+        && errno == ELOOP,
+        "lookup loop fails with ELOOP");
+
+    blobcache_destroy (bc);
+    json_decref (root);
+}
+
+void test_insert (void)
+{
+    struct blobcache *bc;
+
+    ok (blobcache_create (0) == NULL && errno == EINVAL,
+        "blobcache_create maxblobs=0 fails with EINVAL");
+    if (!(bc = blobcache_create (2)))
+        BAIL_OUT ("blobcache_create failed");
+    ok (blobcache_insert (bc, "sha1-1", "a", 1) == 0
+        && blobcache_insert (bc, "sha1-1", "a", 1) == 0
+        && blobcache_count (bc) == 1,
+        "duplicate insert is a no-op");
+    ok (blobcache_insert (bc, "sha1-2", "b", 1) == 0
+        && blobcache_insert (bc, "sha1-3", "c", 1) == 0
+        && blobcache_count (bc) == 2,
+        "cache size is bounded by maxblobs");
+    errno = 0;
+    ok (blobcache_insert (bc, NULL, "a", 1) < 0 && errno == EINVAL,
+        "blobcache_insert blobref=NULL fails with EINVAL");
+    blobcache_destroy (bc);
+}
+
+/* Walk a path 'depth' directories deep through a cache holding fewer
+ * blobs than the path, inserting each missing blob and restarting the
+ * walk, as flux_kvs_lookupat() does.
+ */
+#define DEEP 8
+void test_deep (void)
+{
+    struct blobcache *bc;
+    struct blobcache_pins *pins;
+    char refs[DEEP + 1][BLOBREF_MAX_STRING_SIZE];
+    char *blobs[DEEP + 1];
+    char key[2 * DEEP + 2] = "";
+    const char *missing;
+    json_t *dir, *val, *root;
+    int i, loads, rc;
+
+    if (!(bc = blobcache_create (2)))
+        BAIL_OUT ("blobcache_create failed");
+    for (i = 0; i <= DEEP; i++) {
+        if (!(dir = treeobj_create_dir ()))
+            BAIL_OUT ("treeobj_create_dir failed");
+        if (i == 0)
+            insert (dir, "v", treeobj_create_val ("42", 3));
+        else
+            insert (dir, "d", treeobj_create_dirref (refs[i - 1]));
+        if (!(blobs[i] = json_dumps (dir, JSON_COMPACT | JSON_SORT_KEYS)))
+            BAIL_OUT ("json_dumps failed");
+        store_obj (bc, dir, refs[i], false);
+        json_decref (dir);
+        strcat (key, i < DEEP ? "d." : "v");
+    }
+    if (!(root = treeobj_create_dirref (refs[DEEP])))
+        BAIL_OUT ("treeobj_create_dirref failed");
+    if (!(pins = blobcache_pins_create ()))
+        BAIL_OUT ("blobcache_pins_create failed");
+
+    loads = 0;
+    val = NULL;
+    while ((rc = blobcache_lookup (bc, pins, root, key, 0,
+                                   &val, &missing)) < 0 && errno == EAGAIN) {
+        for (i = 0; i <= DEEP; i++)
+            if (!strcmp (missing, refs[i]))
+                break;
+        if (i > DEEP || ++loads > DEEP + 1)
+            break;
+        if (blobcache_insert (bc, refs[i], blobs[i], strlen (blobs[i]) + 1) < 0)
+            BAIL_OUT ("blobcache_insert failed");
+    }
+    ok (rc == 0 && val_is (val, "42"),
+        "lookup of key %d levels deep works with maxblobs=2", DEEP);
+    ok (loads == DEEP + 1,
+        "each blob on the path was loaded exactly once");
+    ok (blobcache_count (bc) == 2 && blobcache_pins_count (pins) == DEEP + 1,
+        "cache stays bounded while the walk pins %d blobs", DEEP + 1);
+    json_decref (val);
+    blobcache_pins_destroy (pins);
+    ok (blobcache_count (bc) == 2,
+        "destroying pins leaves cache intact");
+
+    for (i = 0; i <= DEEP; i++)
+        free (blobs[i]);
+    blobcache_destroy (bc);
+    json_decref (root);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_insert ();
+    test_miss ();
+    test_lookup ();
+    test_deep ();
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
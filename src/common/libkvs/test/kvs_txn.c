@@ -287,6 +287,53 @@ void test_raw_values (void)
     flux_kvs_txn_destroy (txn);
 }
 
+void test_compare (void)
+{
+    flux_kvs_txn_t *txn;
+    json_t *entry, *dirent;
+    const char *key;
+    int flags;
+
+    txn = flux_kvs_txn_create ();
+    ok (txn != NULL,
+        "flux_kvs_txn_create works");
+    ok (flux_kvs_txn_compare (txn, 0, "a.b",
+                              "{\"data\":\"b.c\",\"type\":\"symlink\","
+                              "\"ver\":1}") == 0,
+        "flux_kvs_txn_compare works");
+    ok (flux_kvs_txn_compare (txn, 0, "a.c", NULL) == 0,
+        "flux_kvs_txn_compare treeobj=NULL works");
+    errno = 0;
+    ok (flux_kvs_txn_compare (txn, 0, "a.d", "{\"type\":\"foo\"}") < 0
+        && errno == EINVAL,
+        "error: flux_kvs_txn_compare(bad treeobj) fails with EINVAL");
+    errno = 0;
+    ok (flux_kvs_txn_compare (txn, 0xFFFF, "a.d", NULL) < 0 && errno == EINVAL,
+        "error: flux_kvs_txn_compare(bad flags) fails with EINVAL");
+
+    ok (txn_get (txn, TXN_GET_FIRST, &entry) == 0 && entry != NULL,
+        "1: retrieved");
+    jdiag (entry);
+    ok (json_unpack (entry, "{s:s s:i s:o}", "key", &key,
+                                             "flags", &flags,
+                                             "dirent", &dirent) == 0
+        && !strcmp (key, "a.b") && flags == FLUX_KVS_COMPARE
+        && treeobj_is_symlink (dirent),
+        "1: compare a.b symlink");
+    ok (txn_get (txn, TXN_GET_NEXT, &entry) == 0 && entry != NULL,
+        "2: retrieved");
+    jdiag (entry);
+    ok (json_unpack (entry, "{s:s s:i s:n}", "key", &key,
+                                             "flags", &flags,
+                                             "dirent") == 0
+        && !strcmp (key, "a.c") && flags == FLUX_KVS_COMPARE,
+        "2: compare a.c null");
+    ok (txn_get (txn, TXN_GET_NEXT, &entry) == 0 && entry == NULL,
+        "3: NULL - end of transaction");
+
+    flux_kvs_txn_destroy (txn);
+}
+
 int main (int argc, char *argv[])
 {
 
@@ -294,6 +341,7 @@ int main (int argc, char *argv[])
 
     basic ();
     test_raw_values ();
+    test_compare ();
 
     done_testing();
     return (0);
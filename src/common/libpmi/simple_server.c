@@ -366,8 +366,16 @@ put_respond:
             }
             goto proto;
         }
-        if (pmi->ops.kvs_get (pmi->arg, name, key, val, sizeof (val)) < 0)
-            result = PMI_ERR_INVALID_KEY;
+        switch (pmi->ops.kvs_get (pmi->arg, client, name, key,
+                                  val, sizeof (val))) {
+            case 0:
+                break;
+            case 1: /* deferred */
+                goto done;
+            default:
+                result = PMI_ERR_INVALID_KEY;
+                break;
+        }
 get_respond:
         if (result == 0)
             snprintf (resp, sizeof (resp), "cmd=get_result rc=0 value=%s\n",
@@ -431,6 +439,20 @@ int pmi_simple_server_barrier_complete (struct pmi_simple_server *pmi, int rc)
     return barrier_exit (pmi, rc);
 }
 
+int pmi_simple_server_kvs_get_complete (struct pmi_simple_server *pmi,
+                                        void *client, const char *val)
+{
+    char resp[SIMPLE_MAX_PROTO_LINE+1];
+
+    if (val && strlen (val) < SIMPLE_KVS_VAL_MAX)
+        snprintf (resp, sizeof (resp), "cmd=get_result rc=0 value=%s\n", val);
+    else
+        snprintf (resp, sizeof (resp), "cmd=get_result rc=%d\n",
+                  PMI_ERR_INVALID_KEY);
+    trace (pmi, client, "S: %s", resp);
+    return pmi->ops.response_send (client, resp);
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
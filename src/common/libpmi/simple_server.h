@@ -17,11 +17,14 @@ struct pmi_simple_server;
 
 /* User-provided service implementation.
  * Integer return: 0 on success, -1 on failure.
+ * kvs_get may also return 1 to defer its response, then call
+ * pmi_simple_server_kvs_get_complete() with 'client' once the value
+ * is available.
  */
 struct pmi_simple_ops {
     int (*kvs_put)(void *arg, const char *kvsname,
                    const char *key, const char *val);
-    int (*kvs_get)(void *arg, const char *kvsname,
+    int (*kvs_get)(void *arg, void *client, const char *kvsname,
                    const char *key, char *val, int len);
     int (*barrier_enter)(void *arg);
     int (*response_send)(void *client, const char *buf);
@@ -54,6 +57,11 @@ int pmi_simple_server_request (struct pmi_simple_server *pmi,
  */
 int pmi_simple_server_barrier_complete (struct pmi_simple_server *pmi, int rc);
 
+/* Finalize a deferred kvs_get.  Set val to NULL if the key was not found.
+ */
+int pmi_simple_server_kvs_get_complete (struct pmi_simple_server *pmi,
+                                        void *client, const char *val);
+
 #endif /* ! _FLUX_CORE_PMI_SIMPLE_SERVER_H */
 
 /*
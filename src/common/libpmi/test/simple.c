@@ -21,8 +21,12 @@ struct context {
     struct pmi_simple_server *pmi;
     int size;
     char buf[SIMPLE_MAX_PROTO_LINE];
+    void *deferred_client;
+    char deferred_key[SIMPLE_KVS_KEY_MAX];
 };
 
+static int rig_kvs_get_defer = 0;
+
 static int s_kvs_put (void *arg, const char *kvsname, const char *key,
                  const char *val)
 {
@@ -35,14 +39,19 @@ static int s_kvs_put (void *arg, const char *kvsname, const char *key,
     return rc;
 }
 
-static int s_kvs_get (void *arg, const char *kvsname, const char *key,
-                 char *val, int len)
+static int s_kvs_get (void *arg, void *client, const char *kvsname,
+                      const char *key, char *val, int len)
 {
     diag ("%s: %s::%s", __FUNCTION__, kvsname, key);
     struct context *ctx = arg;
     char *v = zhash_lookup (ctx->kvs, key);
     int rc = -1;
 
+    if (rig_kvs_get_defer) {
+        ctx->deferred_client = client;
+        snprintf (ctx->deferred_key, sizeof (ctx->deferred_key), "%s", key);
+        return 1;
+    }
     if (v && strlen (v) < len) {
         strcpy (val, v);
         rc = 0;
@@ -78,6 +87,17 @@ static void s_io_cb (flux_reactor_t *r, flux_watcher_t *w,
         close (fd);
         flux_watcher_stop (w);
     }
+    /* complete a deferred get after returning to the reactor
+     */
+    if (ctx->deferred_client) {
+        const char *v = zhash_lookup (ctx->kvs, ctx->deferred_key);
+        if (pmi_simple_server_kvs_get_complete (ctx->pmi,
+                                                ctx->deferred_client, v) < 0) {
+            diag ("pmi_simple_server_kvs_get_complete: %s", strerror (errno));
+            flux_reactor_stop_error (r);
+        }
+        ctx->deferred_client = NULL;
+    }
 }
 
 static int rig_barrier_entry_failure = 0;
@@ -244,6 +264,17 @@ int main (int argc, char *argv[])
     ok (rc == PMI_ERR_INVALID_KEY,
         "pmi_simple_client_kvs_get unknown key fails");
 
+    /* get: deferred response
+     */
+    rig_kvs_get_defer = 1;
+    ok (pmi_simple_client_kvs_get (cli, name, "foo", val, val_len) == PMI_SUCCESS
+        && !strcmp (val, "bar"),
+        "pmi_simple_client_kvs_get foo with deferred response OK, val=%s", val);
+    rc = pmi_simple_client_kvs_get (cli, name, "noexist", val, val_len);
+    ok (rc == PMI_ERR_INVALID_KEY,
+        "pmi_simple_client_kvs_get unknown key with deferred response fails");
+    rig_kvs_get_defer = 0;
+
     /* barrier: entry failure
      */
     rig_barrier_entry_failure = 1;
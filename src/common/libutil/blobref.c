@@ -26,6 +26,7 @@
 #include "config.h"
 #endif
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <errno.h>
@@ -34,6 +35,7 @@
 #include "blobref.h"
 #include "sha1.h"
 #include "sha256.h"
+#include "sha_ni.h"
 
 #define SHA1_PREFIX_STRING  "sha1-"
 #define SHA1_PREFIX_LENGTH  5
@@ -58,25 +60,60 @@
 
 static void sha1_hash (const void *data, int data_len, void *hash, int hash_len);
 static void sha256_hash (const void *data, int data_len, void *hash, int hash_len);
+static void sha1_hash_ni (const void *data, int data_len,
+                          void *hash, int hash_len);
+static void sha256_hash_ni (const void *data, int data_len,
+                            void *hash, int hash_len);
+
+typedef void (*hashfun_f)(const void *data, int data_len,
+                          void *hash, int hash_len);
 
 struct blobhash {
     char *name;
     int hashlen;
-    void (*hashfun)(const void *data, int data_len, void *hash, int hash_len);
+    hashfun_f hashfun;          // selected implementation
+    hashfun_f hashfun_generic;
+    hashfun_f hashfun_accel;    // used if CPU supports it
 };
 
 static struct blobhash blobtab[] = {
     { .name = "sha1",
       .hashlen = SHA1_DIGEST_SIZE,
       .hashfun = sha1_hash,
+      .hashfun_generic = sha1_hash,
+      .hashfun_accel = sha1_hash_ni,
     },
     { .name = "sha256",
       .hashlen = SHA256_BLOCK_SIZE,
       .hashfun = sha256_hash,
+      .hashfun_generic = sha256_hash,
+      .hashfun_accel = sha256_hash_ni,
     },
-    { NULL, 0, 0 },
+    { NULL, 0, 0, 0, 0 },
 };
 
+/* Select accelerated hash functions on first use, unless disabled
+ * via blobref_set_accel() or FLUX_BLOBREF_NOACCEL in the environment.
+ * Concurrent first calls may both run this; they store the same values.
+ */
+static bool blobtab_initialized = false;
+
+static void blobtab_select (bool accel)
+{
+    struct blobhash *bh;
+
+    for (bh = &blobtab[0]; bh->name != NULL; bh++)
+        bh->hashfun = accel ? bh->hashfun_accel : bh->hashfun_generic;
+}
+
+static void blobtab_init (void)
+{
+    if (!blobtab_initialized) {
+        blobtab_select (sha_ni_available () && !getenv ("FLUX_BLOBREF_NOACCEL"));
+        blobtab_initialized = true;
+    }
+}
+
 static void sha1_hash (const void *data, int data_len, void *hash, int hash_len)
 {
     SHA1_CTX ctx;
@@ -97,6 +134,20 @@ static void sha256_hash (const void *data, int data_len, void *hash, int hash_le
     sha256_final (&ctx, hash);
 }
 
+static void sha1_hash_ni (const void *data, int data_len,
+                          void *hash, int hash_len)
+{
+    assert (hash_len == SHA1_DIGEST_SIZE);
+    sha1_ni (data, data_len, hash);
+}
+
+static void sha256_hash_ni (const void *data, int data_len,
+                            void *hash, int hash_len)
+{
+    assert (hash_len == SHA256_BLOCK_SIZE);
+    sha256_ni (data, data_len, hash);
+}
+
 /* true if s1 contains "s2-" prefix
  */
 static int prefixmatch (const char *s1, const char *s2)
@@ -111,6 +162,7 @@ static struct blobhash *lookup_blobhash (const char *name)
 {
     struct blobhash *bh;
 
+    blobtab_init ();
     for (bh = &blobtab[0]; bh->name != NULL; bh++)
         if (!strcmp (name, bh->name) || prefixmatch (name, bh->name))
             return bh;
@@ -215,6 +267,44 @@ int blobref_hash (const char *hashtype,
     return hashtostr (bh, hash, bh->hashlen, s, size);
 }
 
+int blobref_hash_vec (const char *hashtype, struct blobref_vec *vec,
+                      int count)
+{
+    struct blobhash *bh;
+    uint8_t hash[BLOBREF_MAX_DIGEST_SIZE];
+    int i;
+
+    if (!(bh = lookup_blobhash (hashtype)) || count < 0
+                                           || (count > 0 && !vec)) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        bh->hashfun (vec[i].data, vec[i].len, hash, bh->hashlen);
+        if (hashtostr (bh, hash, bh->hashlen, vec[i].blobref,
+                       sizeof (vec[i].blobref)) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int blobref_set_accel (bool enable)
+{
+    blobtab_init ();
+    if (enable && !sha_ni_available ()) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    blobtab_select (enable);
+    return 0;
+}
+
+bool blobref_get_accel (void)
+{
+    blobtab_init ();
+    return blobtab[0].hashfun == blobtab[0].hashfun_accel;
+}
+
 int blobref_validate (const char *blobref)
 {
     struct blobhash *bh;
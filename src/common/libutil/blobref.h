@@ -5,6 +5,7 @@
 #define BLOBREF_MAX_DIGEST_SIZE     32
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /* Convert a blobref string to hash digest.
  * The hash algorithm is selected by the blobref prefix.
@@ -28,6 +29,26 @@ int blobref_hash (const char *hashtype,
                   const void *data, int len,
                   char *s, int size);
 
+/* Hash many blobs in one call, storing each result in vec[i].blobref.
+ * This saves a hash type lookup per blob when hashing many small blobs,
+ * as on KVS commit.  Returns 0 on success, -1 on error with errno set.
+ */
+struct blobref_vec {
+    const void *data;
+    int len;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+};
+
+int blobref_hash_vec (const char *hashtype, struct blobref_vec *vec,
+                      int count);
+
+/* Hash functions use CPU SHA extensions when available (unless
+ * FLUX_BLOBREF_NOACCEL is set in the environment).  Enable/disable this,
+ * e.g. for benchmarking.  Enabling fails with ENOTSUP if unsupported.
+ */
+int blobref_set_accel (bool enable);
+bool blobref_get_accel (void);
+
 /* Check validity of blobref string.
  */
 int blobref_validate (const char *blobref);
@@ -0,0 +1,275 @@
+/*****************************************************************************\
+ *  Copyright (c) 2017 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/* sha_ni.c - SHA-1 and SHA-256 block functions using x86 SHA extensions
+ *
+ * The block functions follow the instruction sequences in Intel's
+ * "Intel SHA Extensions" white paper (Gulley et al, 2013), written as
+ * loops over groups of four rounds.  Functions are compiled with a
+ * target attribute so no special CFLAGS are needed; callers must check
+ * sha_ni_available() at runtime.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <string.h>
+
+#include "sha_ni.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define HAVE_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if HAVE_SHA_NI
+
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+static const uint32_t sha256_k[64] __attribute__((aligned(16))) = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+SHA_NI_TARGET
+static void sha256_ni_blocks (uint32_t state[8], const uint8_t *data,
+                              size_t nblocks)
+{
+    const __m128i mask = _mm_set_epi64x (0x0c0d0e0f08090a0bULL,
+                                         0x0405060700010203ULL);
+    __m128i state0, state1, tmp, abef_save, cdgh_save;
+    __m128i w[4];
+    int g;
+
+    tmp = _mm_loadu_si128 ((const __m128i *)&state[0]);
+    state1 = _mm_loadu_si128 ((const __m128i *)&state[4]);
+    tmp = _mm_shuffle_epi32 (tmp, 0xB1);            // CDAB
+    state1 = _mm_shuffle_epi32 (state1, 0x1B);      // EFGH
+    state0 = _mm_alignr_epi8 (tmp, state1, 8);      // ABEF
+    state1 = _mm_blend_epi16 (state1, tmp, 0xF0);   // CDGH
+
+    while (nblocks-- > 0) {
+        abef_save = state0;
+        cdgh_save = state1;
+        for (g = 0; g < 16; g++) {
+            __m128i *wg = &w[g % 4];
+            if (g < 4) {
+                tmp = _mm_loadu_si128 ((const __m128i *)(data + g * 16));
+                *wg = _mm_shuffle_epi8 (tmp, mask);
+            }
+            else {
+                tmp = _mm_sha256msg1_epu32 (*wg, w[(g + 1) % 4]);
+                tmp = _mm_add_epi32 (tmp, _mm_alignr_epi8 (w[(g + 3) % 4],
+                                                           w[(g + 2) % 4], 4));
+                *wg = _mm_sha256msg2_epu32 (tmp, w[(g + 3) % 4]);
+            }
+            tmp = _mm_add_epi32 (*wg,
+                          _mm_load_si128 ((const __m128i *)&sha256_k[g * 4]));
+            state1 = _mm_sha256rnds2_epu32 (state1, state0, tmp);
+            tmp = _mm_shuffle_epi32 (tmp, 0x0E);
+            state0 = _mm_sha256rnds2_epu32 (state0, state1, tmp);
+        }
+        state0 = _mm_add_epi32 (state0, abef_save);
+        state1 = _mm_add_epi32 (state1, cdgh_save);
+        data += 64;
+    }
+
+    tmp = _mm_shuffle_epi32 (state0, 0x1B);         // FEBA
+    state1 = _mm_shuffle_epi32 (state1, 0xB1);      // DCHG
+    state0 = _mm_blend_epi16 (tmp, state1, 0xF0);   // DCBA
+    state1 = _mm_alignr_epi8 (state1, tmp, 8);      // HGFE
+    _mm_storeu_si128 ((__m128i *)&state[0], state0);
+    _mm_storeu_si128 ((__m128i *)&state[4], state1);
+}
+
+/* sha1rnds4 takes its round function as an immediate, hence one loop
+ * per group of 20 rounds.
+ */
+#define SHA1_GROUP(func) do { \
+    if (g >= 4) { \
+        w[g % 4] = _mm_sha1msg2_epu32 ( \
+                        _mm_xor_si128 (_mm_sha1msg1_epu32 (w[g % 4], \
+                                                           w[(g + 1) % 4]), \
+                                       w[(g + 2) % 4]), \
+                        w[(g + 3) % 4]); \
+    } \
+    e = _mm_sha1nexte_epu32 (prev, w[g % 4]); \
+    prev = abcd; \
+    abcd = _mm_sha1rnds4_epu32 (abcd, e, (func)); \
+} while (0)
+
+SHA_NI_TARGET
+static void sha1_ni_blocks (uint32_t state[5], const uint8_t *data,
+                            size_t nblocks)
+{
+    const __m128i mask = _mm_set_epi64x (0x0001020304050607ULL,
+                                         0x08090a0b0c0d0e0fULL);
+    __m128i abcd, e0, e, prev, abcd_save, e0_save;
+    __m128i w[4];
+    int g;
+
+    abcd = _mm_loadu_si128 ((const __m128i *)state);
+    abcd = _mm_shuffle_epi32 (abcd, 0x1B);
+    e0 = _mm_set_epi32 (state[4], 0, 0, 0);
+
+    while (nblocks-- > 0) {
+        abcd_save = abcd;
+        e0_save = e0;
+        for (g = 0; g < 4; g++)
+            w[g] = _mm_shuffle_epi8 (_mm_loadu_si128 (
+                                    (const __m128i *)(data + g * 16)), mask);
+        /* rounds 0-3 */
+        e = _mm_add_epi32 (e0, w[0]);
+        prev = abcd;
+        abcd = _mm_sha1rnds4_epu32 (abcd, e, 0);
+        /* rounds 4-79 */
+        for (g = 1; g < 5; g++)
+            SHA1_GROUP (0);
+        for (; g < 10; g++)
+            SHA1_GROUP (1);
+        for (; g < 15; g++)
+            SHA1_GROUP (2);
+        for (; g < 20; g++)
+            SHA1_GROUP (3);
+        e0 = _mm_sha1nexte_epu32 (prev, e0_save);
+        abcd = _mm_add_epi32 (abcd, abcd_save);
+        data += 64;
+    }
+
+    abcd = _mm_shuffle_epi32 (abcd, 0x1B);
+    _mm_storeu_si128 ((__m128i *)state, abcd);
+    state[4] = _mm_extract_epi32 (e0, 3);
+}
+
+/* Merkle-Damgard padding shared by SHA-1 and SHA-256: hash whole blocks
+ * in place, then the tail with 0x80, zeros, and 64-bit big-endian bit count.
+ */
+static void md_hash (void (*blocks)(uint32_t *, const uint8_t *, size_t),
+                     uint32_t *state, const uint8_t *data, size_t len)
+{
+    uint8_t buf[128];
+    size_t nblocks = len / 64;
+    size_t rem = len % 64;
+    size_t tail = rem < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    int i;
+
+    if (nblocks > 0)
+        blocks (state, data, nblocks);
+    memset (buf, 0, sizeof (buf));
+    memcpy (buf, data + nblocks * 64, rem);
+    buf[rem] = 0x80;
+    for (i = 0; i < 8; i++)
+        buf[tail - 1 - i] = bits >> (i * 8);
+    blocks (state, buf, tail / 64);
+}
+
+static void store_be32 (uint8_t *digest, const uint32_t *state, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        digest[i * 4] = state[i] >> 24;
+        digest[i * 4 + 1] = state[i] >> 16;
+        digest[i * 4 + 2] = state[i] >> 8;
+        digest[i * 4 + 3] = state[i];
+    }
+}
+
+void sha1_ni (const void *data, size_t len, uint8_t *digest)
+{
+    uint32_t state[5] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+    };
+    md_hash (sha1_ni_blocks, state, data, len);
+    store_be32 (digest, state, 5);
+}
+
+void sha256_ni (const void *data, size_t len, uint8_t *digest)
+{
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    md_hash (sha256_ni_blocks, state, data, len);
+    store_be32 (digest, state, 8);
+}
+
+/* CPUID leaf 7 EBX bit 29 = SHA, leaf 1 ECX bit 19 = SSE4.1,
+ * bit 9 = SSSE3.
+ */
+bool sha_ni_available (void)
+{
+    static int available = -1;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (available < 0) {
+        available = 0;
+        if (__get_cpuid (1, &eax, &ebx, &ecx, &edx)
+                && (ecx & (1 << 19)) && (ecx & (1 << 9))
+                && __get_cpuid_max (0, NULL) >= 7) {
+            __cpuid_count (7, 0, eax, ebx, ecx, edx);
+            if ((ebx & (1 << 29)))
+                available = 1;
+        }
+    }
+    return available;
+}
+
+#else /* !HAVE_SHA_NI */
+
+bool sha_ni_available (void)
+{
+    return false;
+}
+
+void sha1_ni (const void *data, size_t len, uint8_t *digest)
+{
+}
+
+void sha256_ni (const void *data, size_t len, uint8_t *digest)
+{
+}
+
+#endif /* !HAVE_SHA_NI */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,22 @@
+#ifndef _UTIL_SHA_NI_H
+#define _UTIL_SHA_NI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* SHA-1 and SHA-256 using the x86 SHA extensions (SHA-NI).
+ * sha_ni_available() returns true if the build supports them and the
+ * CPU has them; the hash functions must not be called otherwise.
+ * Digests are 20 and 32 bytes respectively.
+ */
+bool sha_ni_available (void);
+
+void sha1_ni (const void *data, size_t len, uint8_t *digest);
+void sha256_ni (const void *data, size_t len, uint8_t *digest);
+
+#endif /* !_UTIL_SHA_NI_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
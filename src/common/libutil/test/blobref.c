@@ -19,6 +19,57 @@ const char *goodref[] = {
     NULL,
 };
 
+/* Compare accelerated hash against generic over sizes that cover
+ * the padding boundary cases (55, 56, 63, 64 mod 64).
+ */
+void check_accel (const char *hashtype)
+{
+    uint8_t data[300];
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    char ref2[BLOBREF_MAX_STRING_SIZE];
+    int len;
+    int errors = 0;
+
+    for (len = 0; len < sizeof (data); len++)
+        data[len] = len * 31 + 7;
+    for (len = 0; len <= sizeof (data); len++) {
+        if (blobref_set_accel (false) < 0
+            || blobref_hash (hashtype, data, len, ref, sizeof (ref)) < 0
+            || blobref_set_accel (true) < 0
+            || blobref_hash (hashtype, data, len, ref2, sizeof (ref2)) < 0
+            || strcmp (ref, ref2) != 0) {
+            diag ("%s len=%d: %s != %s", hashtype, len, ref, ref2);
+            errors++;
+        }
+    }
+    ok (errors == 0,
+        "%s accelerated hash matches generic for sizes 0-%d",
+        hashtype, (int)sizeof (data));
+}
+
+void check_vec (const char *hashtype)
+{
+    struct blobref_vec vec[4];
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    const char *s[] = { "", "a", "foo", "hello world" };
+    int i;
+    int errors = 0;
+
+    for (i = 0; i < 4; i++) {
+        vec[i].data = s[i];
+        vec[i].len = strlen (s[i]);
+    }
+    ok (blobref_hash_vec (hashtype, vec, 4) == 0,
+        "blobref_hash_vec %s works", hashtype);
+    for (i = 0; i < 4; i++) {
+        if (blobref_hash (hashtype, s[i], strlen (s[i]), ref, sizeof (ref)) < 0
+            || strcmp (ref, vec[i].blobref) != 0)
+            errors++;
+    }
+    ok (errors == 0,
+        "blobref_hash_vec %s results match blobref_hash", hashtype);
+}
+
 int main(int argc, char** argv)
 {
     char ref[BLOBREF_MAX_STRING_SIZE];
@@ -133,6 +184,34 @@ int main(int argc, char** argv)
     ok (blobref_validate_hashtype (NULL) == -1,
         "blobref_validate_hashtype NULL is invalid");
 
+    /* blobref_hash_vec */
+    check_vec ("sha1");
+    check_vec ("sha256");
+    ok (blobref_hash_vec ("sha1", NULL, 0) == 0,
+        "blobref_hash_vec count=0 works");
+    errno = 0;
+    ok (blobref_hash_vec ("nerf", NULL, 0) < 0 && errno == EINVAL,
+        "blobref_hash_vec fails EINVAL with unknown hash name");
+    errno = 0;
+    ok (blobref_hash_vec ("sha1", NULL, 1) < 0 && errno == EINVAL,
+        "blobref_hash_vec fails EINVAL with NULL vec");
+
+    /* accelerated hashing */
+    ok (blobref_set_accel (false) == 0 && !blobref_get_accel (),
+        "blobref_set_accel false works");
+    if (blobref_set_accel (true) < 0) {
+        ok (errno == ENOTSUP,
+            "blobref_set_accel true fails ENOTSUP without SHA extensions");
+    }
+    else {
+        ok (blobref_get_accel (),
+            "blobref_set_accel true works");
+        check_accel ("sha1");
+        check_accel ("sha256");
+        check_vec ("sha1");
+        check_vec ("sha256");
+    }
+
     done_testing();
 }
 
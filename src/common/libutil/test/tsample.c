@@ -0,0 +1,41 @@
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/tsample.h"
+
+int main (int argc, char** argv)
+{
+    tsample_t ts = { 0 };
+    int i;
+
+    plan (NO_PLAN);
+
+    ok (tsample_count (&ts) == 0 && tsample_percentile (&ts, 50) == 0,
+        "empty sample set has count 0 and percentile 0");
+    for (i = 100; i >= 1; i--)
+        tsample_push (&ts, i);
+    ok (tsample_count (&ts) == 100,
+        "pushed 100 samples");
+    ok (tsample_sum (&ts) == 5050,
+        "sum is correct");
+    tsample_sort (&ts);
+    ok (ts.v[0] == 1 && ts.v[99] == 100,
+        "samples are sorted");
+    ok (tsample_percentile (&ts, 50) == 50,
+        "p50 is 50");
+    ok (tsample_percentile (&ts, 99) == 99,
+        "p99 is 99");
+    ok (tsample_percentile (&ts, 0) == 1 && tsample_percentile (&ts, 100) == 100,
+        "p0 is min and p100 is max");
+    for (i = 0; i < 2000; i++)
+        tsample_push (&ts, 0);
+    ok (tsample_count (&ts) == 2100,
+        "sample array grows");
+    tsample_clear (&ts);
+    ok (tsample_count (&ts) == 0 && ts.v == NULL,
+        "tsample_clear empties sample set");
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
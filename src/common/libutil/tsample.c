@@ -0,0 +1,96 @@
+/*****************************************************************************\
+ *  Copyright (c) 2017 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/* tsample.c - keep every sample, for percentiles (cf. tstat.c)
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+
+#include "tsample.h"
+#include "xzmalloc.h"
+
+void tsample_push (tsample_t *ts, double x)
+{
+    if (ts->n == ts->size) {
+        ts->size = ts->size ? ts->size * 2 : 1024;
+        ts->v = xrealloc (ts->v, ts->size * sizeof (ts->v[0]));
+    }
+    ts->v[ts->n++] = x;
+}
+
+static int double_cmp (const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+void tsample_sort (tsample_t *ts)
+{
+    qsort (ts->v, ts->n, sizeof (ts->v[0]), double_cmp);
+}
+
+double tsample_sum (tsample_t *ts)
+{
+    double sum = 0;
+    int i;
+
+    for (i = 0; i < ts->n; i++)
+        sum += ts->v[i];
+    return sum;
+}
+
+/* Nearest-rank percentile.
+ */
+double tsample_percentile (tsample_t *ts, double p)
+{
+    int i = (int)(p / 100. * ts->n + 0.5) - 1;
+
+    if (ts->n == 0)
+        return 0;
+    if (i < 0)
+        i = 0;
+    if (i >= ts->n)
+        i = ts->n - 1;
+    return ts->v[i];
+}
+
+int tsample_count (tsample_t *ts)
+{
+    return ts->n;
+}
+
+void tsample_clear (tsample_t *ts)
+{
+    free (ts->v);
+    ts->v = NULL;
+    ts->n = ts->size = 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,26 @@
+#ifndef _UTIL_TSAMPLE_H
+#define _UTIL_TSAMPLE_H
+
+/* Samples are kept in v[0..n-1], in order pushed until tsample_sort().
+ * Initialize with tsample_t ts = { 0 }; release with tsample_clear().
+ */
+typedef struct {
+    double *v;
+    int n;
+    int size;
+} tsample_t;
+
+void tsample_push (tsample_t *ts, double x);
+void tsample_sort (tsample_t *ts);
+double tsample_sum (tsample_t *ts);
+int tsample_count (tsample_t *ts);
+void tsample_clear (tsample_t *ts);
+
+/* Nearest-rank percentile 'p' (0-100) of sorted samples.
+ */
+double tsample_percentile (tsample_t *ts, double p);
+
+#endif /* !_UTIL_TSAMPLE_H */
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -33,6 +33,7 @@
 #include <stdbool.h>
 #include <flux/core.h>
 #include <czmq.h>
+#include <jansson.h>
 
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/oom.h"
@@ -57,9 +58,12 @@ typedef struct _barrier_struct {
     barrier_ctx_t *ctx;
     int errnum;
     flux_watcher_t *debug_timer;
+    json_t *dict;           /* merged key-value sets not yet sent upstream */
+    bool storing;           /* dict store in progress on rank 0 */
 } barrier_t;
 
-static int exit_event_send (flux_t *h, const char *name, int errnum);
+static int exit_event_send (flux_t *h, const char *name, int errnum,
+                            const char *blobref);
 static void timeout_cb (flux_reactor_t *r, flux_watcher_t *w,
                         int revents, void *arg);
 
@@ -119,6 +123,7 @@ static void barrier_destroy (void *arg)
         flux_watcher_destroy (b->debug_timer);
     }
     zhash_destroy (&b->clients);
+    json_decref (b->dict);
     free (b->name);
     free (b);
     return;
@@ -157,9 +162,11 @@ done:
 
 static int barrier_add_client (barrier_t *b, char *sender, const flux_msg_t *msg)
 {
-    flux_msg_t *cpy = flux_msg_copy (msg, true);
-    if (!cpy || zhash_insert (b->clients, sender, cpy) < 0)
+    flux_msg_t *cpy = flux_msg_copy (msg, false);
+    if (!cpy || zhash_insert (b->clients, sender, cpy) < 0) {
+        flux_msg_destroy (cpy);
         return -1;
+    }
     zhash_freefn (b->clients, sender, (zhash_free_fn *)flux_msg_destroy);
     return 0;
 }
@@ -168,12 +175,22 @@ static void send_enter_request (barrier_ctx_t *ctx, barrier_t *b)
 {
     flux_future_t *f;
 
-    if (!(f = flux_rpc_pack (ctx->h, "barrier.enter", FLUX_NODEID_UPSTREAM,
-                             FLUX_RPC_NORESPONSE, "{s:s s:i s:i s:b}",
-                             "name", b->name,
-                             "count", b->count,
-                             "nprocs", b->nprocs,
-                             "internal", true))) {
+    if (b->dict)
+        f = flux_rpc_pack (ctx->h, "barrier.enter", FLUX_NODEID_UPSTREAM,
+                           FLUX_RPC_NORESPONSE, "{s:s s:i s:i s:b s:O}",
+                           "name", b->name,
+                           "count", b->count,
+                           "nprocs", b->nprocs,
+                           "internal", true,
+                           "dict", b->dict);
+    else
+        f = flux_rpc_pack (ctx->h, "barrier.enter", FLUX_NODEID_UPSTREAM,
+                           FLUX_RPC_NORESPONSE, "{s:s s:i s:i s:b}",
+                           "name", b->name,
+                           "count", b->count,
+                           "nprocs", b->nprocs,
+                           "internal", true);
+    if (!f) {
         flux_log_error (ctx->h, "sending barrier.enter request");
         goto done;
     }
@@ -181,11 +198,66 @@ done:
     flux_future_destroy (f);
 }
 
+static void store_continuation (flux_future_t *f, void *arg)
+{
+    barrier_ctx_t *ctx = arg;
+    const char *name = flux_future_aux_get (f, "name");
+    const char *blobref;
+    int errnum = 0;
+
+    if (flux_content_store_get (f, &blobref) < 0) {
+        errnum = errno;
+        blobref = NULL;
+        flux_log_error (ctx->h, "%s: storing dict", name);
+    }
+    if (exit_event_send (ctx->h, name, errnum, blobref) < 0)
+        flux_log_error (ctx->h, "exit_event_send");
+    flux_future_destroy (f);
+}
+
+/* All participants have entered.  If they contributed key-value sets,
+ * store the merged set as a single blob and announce its blobref with
+ * the exit event, so that participants can fetch everyone's set
+ * without a KVS entry per key.
+ */
+static void barrier_complete (barrier_ctx_t *ctx, barrier_t *b)
+{
+    flux_future_t *f = NULL;
+    char *s = NULL;
+
+    if (!b->dict) {
+        if (exit_event_send (ctx->h, b->name, 0, NULL) < 0)
+            flux_log_error (ctx->h, "exit_event_send");
+        return;
+    }
+    if (b->storing)
+        return;
+    b->storing = true;
+    if (!(s = json_dumps (b->dict, JSON_COMPACT))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    /* include the NUL so consumers may decode the blob in place */
+    if (!(f = flux_content_store (ctx->h, s, strlen (s) + 1, 0))
+            || flux_future_aux_set (f, "name", xstrdup (b->name), free) < 0
+            || flux_future_then (f, -1., store_continuation, ctx) < 0)
+        goto error;
+    free (s);
+    return;
+error:
+    flux_log_error (ctx->h, "%s: storing dict", b->name);
+    if (exit_event_send (ctx->h, b->name, errno, NULL) < 0)
+        flux_log_error (ctx->h, "exit_event_send");
+    flux_future_destroy (f);
+    free (s);
+}
+
 /* Barrier entry happens in two ways:
  * - client calling flux_barrier ()
  * - downstream barrier plugin sending count upstream.
  * In the first case only, we track client uuid to handle disconnect and
- * notification upon barrier termination.
+ * notification upon barrier termination.  Either may carry a key-value
+ * set "dict", merged on the way upstream (see barrier_complete).
  */
 
 static void enter_request_cb (flux_t *h, flux_msg_handler_t *w,
@@ -196,12 +268,15 @@ static void enter_request_cb (flux_t *h, flux_msg_handler_t *w,
     char *sender = NULL;
     const char *name;
     int count, nprocs, internal;
+    json_t *dict = NULL;
 
-    if (flux_request_unpack (msg, NULL, "{s:s s:i s:i s:b !}",
+    if (flux_request_unpack (msg, NULL, "{s:s s:i s:i s:b s?o !}",
                              "name", &name,
                              "count", &count,
                              "nprocs", &nprocs,
-                             "internal", &internal) < 0
+                             "internal", &internal,
+                             "dict", &dict) < 0
+                || (dict && !json_is_object (dict))
                 || flux_msg_get_route_first (msg, &sender) < 0) {
         flux_log_error (ctx->h, "%s: decoding request", __FUNCTION__);
         goto done;
@@ -219,20 +294,28 @@ static void enter_request_cb (flux_t *h, flux_msg_handler_t *w,
             flux_log (ctx->h, LOG_ERR,
                         "abort %s due to double entry by client %s",
                         name, sender);
-            if (exit_event_send (ctx->h, b->name, ECONNABORTED) < 0)
+            if (exit_event_send (ctx->h, b->name, ECONNABORTED, NULL) < 0)
+                flux_log_error (ctx->h, "exit_event_send");
+            goto done;
+        }
+    }
+    if (dict) {
+        if ((!b->dict && !(b->dict = json_object ()))
+                || json_object_update (b->dict, dict) < 0) {
+            flux_log (ctx->h, LOG_ERR, "%s: merging dict", name);
+            if (exit_event_send (ctx->h, b->name, ENOMEM, NULL) < 0)
                 flux_log_error (ctx->h, "exit_event_send");
             goto done;
         }
     }
 
     /* If the count has been reached, terminate the barrier;
-     * o/w set timer to pass count upstream and zero it here.
+     * o/w set timer to pass count (and dict) upstream and zero it here.
      */
     b->count += count;
-    if (b->count == b->nprocs) {
-        if (exit_event_send (ctx->h, b->name, 0) < 0)
-            flux_log_error (ctx->h, "exit_event_send");
-    } else if (ctx->rank > 0 && !ctx->timer_armed) {
+    if (b->count == b->nprocs)
+        barrier_complete (ctx, b);
+    else if (ctx->rank > 0 && !ctx->timer_armed) {
         flux_timer_watcher_reset (ctx->timer, barrier_reduction_timeout_sec, 0.);
         flux_watcher_start (ctx->timer);
         ctx->timer_armed = true;
@@ -258,21 +341,29 @@ static void disconnect_request_cb (flux_t *h, flux_msg_handler_t *w,
         return;
     FOREACH_ZHASH (ctx->barriers, key, b) {
         if (zhash_lookup (b->clients, sender)) {
-            if (exit_event_send (h, b->name, ECONNABORTED) < 0)
+            if (exit_event_send (h, b->name, ECONNABORTED, NULL) < 0)
                 flux_log_error (h, "exit_event_send");
         }
     }
     free (sender);
 }
 
-static int exit_event_send (flux_t *h, const char *name, int errnum)
+static int exit_event_send (flux_t *h, const char *name, int errnum,
+                            const char *blobref)
 {
     flux_msg_t *msg = NULL;
     int rc = -1;
 
-    if (!(msg = flux_event_pack ("barrier.exit", "{s:s s:i}",
-                                 "name", name,
-                                 "errnum", errnum)))
+    if (blobref)
+        msg = flux_event_pack ("barrier.exit", "{s:s s:i s:s}",
+                               "name", name,
+                               "errnum", errnum,
+                               "blobref", blobref);
+    else
+        msg = flux_event_pack ("barrier.exit", "{s:s s:i}",
+                               "name", name,
+                               "errnum", errnum);
+    if (!msg)
         goto done;
     if (flux_send (h, msg, 0) < 0)
         goto done;
@@ -288,20 +379,27 @@ static void exit_event_cb (flux_t *h, flux_msg_handler_t *w,
     barrier_ctx_t *ctx = arg;
     barrier_t *b;
     const char *name;
+    const char *blobref = NULL;
     int errnum;
     const char *key;
     flux_msg_t *req;
+    int rc;
 
-    if (flux_event_unpack (msg, NULL, "{s:s s:i !}",
+    if (flux_event_unpack (msg, NULL, "{s:s s:i s?s !}",
                            "name", &name,
-                           "errnum", &errnum) < 0) {
+                           "errnum", &errnum,
+                           "blobref", &blobref) < 0) {
         flux_log_error (h, "%s: decoding event", __FUNCTION__);
         return;
     }
     if ((b = zhash_lookup (ctx->barriers, name))) {
         b->errnum = errnum;
         FOREACH_ZHASH (b->clients, key, req) {
-            if (flux_respond (h, req, b->errnum, NULL) < 0)
+            if (!b->errnum && blobref)
+                rc = flux_respond_pack (h, req, "{s:s}", "blobref", blobref);
+            else
+                rc = flux_respond (h, req, b->errnum, NULL);
+            if (rc < 0)
                 flux_log_error (h, "%s: sending enter response", __FUNCTION__);
         }
         zhash_delete (ctx->barriers, name);
@@ -322,6 +420,8 @@ static void timeout_cb (flux_reactor_t *r, flux_watcher_t *w,
         if (b->count > 0) {
             send_enter_request (ctx, b);
             b->count = 0;
+            if (b->dict)
+                json_object_clear (b->dict);
         }
     }
 }
@@ -28,13 +28,18 @@
 #include "config.h"
 #endif
 #include <sqlite3.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <czmq.h>
+#include <jansson.h>
 #include <flux/core.h>
 
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/cleanup.h"
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/oom.h"
 #include "src/common/libminilzo/minilzo.h"
 
 const size_t lzo_buf_chunksize = 1024*1024;
@@ -50,8 +55,51 @@ const char *sql_load = "SELECT object,size FROM objects"
 const char *sql_store = "INSERT INTO objects (hash,size,object) "
                         "  values (?1, ?2, ?3)";
 const char *sql_dump = "SELECT object,size FROM objects";
+const char *sql_gc_scan = "SELECT hash,length(object) FROM objects"
+                          "  WHERE hash > ?1 ORDER BY hash LIMIT ?2";
+const char *sql_gc_delete = "DELETE FROM objects WHERE hash = ?1";
 
-typedef struct {
+const int default_wal_readers = 2;
+const int default_wal_batch = 256;
+const int wal_busy_timeout_ms = 10000;
+const int default_gc_batch = 1000;
+
+/* A load or store handed to a worker thread in WAL mode.
+ */
+struct sqlite_job {
+    flux_msg_t *msg;
+    bool store;
+    uint8_t hash[BLOBREF_MAX_DIGEST_SIZE];
+    int hash_len;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    const void *in;             /* store: payload of 'msg' */
+    int in_size;
+    void *out;                  /* load: blob data */
+    int out_size;
+    int errnum;
+    char *errstr;               /* logged by the reactor thread, if set */
+};
+
+struct workq {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    zlist_t *jobs;
+    bool stop;
+};
+
+/* A worker thread and its private database connection.
+ */
+struct dbconn {
+    struct sqlite_ctx *ctx;
+    pthread_t t;
+    bool started;
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    size_t lzo_bufsize;
+    void *lzo_buf;
+};
+
+typedef struct sqlite_ctx {
     char *dbdir;
     char *dbfile;
     sqlite3 *db;
@@ -64,8 +112,28 @@ typedef struct {
     uint32_t blob_size_limit;
     size_t lzo_bufsize;
     void *lzo_buf;
+
+    bool wal;                   /* WAL journal, threaded loads and stores */
+    int wal_readers;
+    int wal_batch;
+    bool threads_running;
+    struct dbconn *readers;
+    struct dbconn writer;
+    struct workq readq;
+    struct workq writeq;
+    pthread_mutex_t done_lock;
+    zlist_t *done;
+    int done_fd;
+    flux_watcher_t *done_w;
+
+    struct gc *gc;              /* garbage collection in progress */
 } sqlite_ctx_t;
 
+static void threads_stop (sqlite_ctx_t *ctx);
+static void gc_stored (sqlite_ctx_t *ctx, const char *blobref);
+static void gc_destroy (struct gc *gc);
+static void gc_finish (sqlite_ctx_t *ctx, int errnum);
+
 #define HEAP_ALLOC(var,size) \
         lzo_align_t __LZO_MMODEL var [ ((size) + (sizeof(lzo_align_t) - 1)) / sizeof(lzo_align_t) ]
 
@@ -85,36 +153,37 @@ static void log_sqlite_error (sqlite_ctx_t *ctx, const char *fmt, ...)
     free (s);
 }
 
-static void set_errno_from_sqlite_error (sqlite_ctx_t *ctx)
+static int errno_from_sqlite_error (sqlite3 *db)
 {
-    switch (sqlite3_errcode (ctx->db)) {
+    switch (sqlite3_errcode (db)) {
         case SQLITE_IOERR:      /* os io error */
-            errno = EIO;
-            break;
+            return EIO;
         case SQLITE_NOMEM:      /* cannot allocate memory */
-            errno = ENOMEM;
-            break;
+            return ENOMEM;
         case SQLITE_ABORT:      /* statment is not authorized */
         case SQLITE_PERM:       /* access mode for new db cannot be provided */
         case SQLITE_READONLY:   /* attempt to alter data with no permission */
-            errno = EPERM;
-            break;
+            return EPERM;
         case SQLITE_TOOBIG:     /* blob too large */
-            errno = EFBIG;
-            break;
+            return EFBIG;
         case SQLITE_FULL:       /* file system full */
-            errno = ENOSPC;
-            break;
+            return ENOSPC;
         default:
-            errno = EINVAL;
-            break;
+            return EINVAL;
     }
 }
 
+static void set_errno_from_sqlite_error (sqlite_ctx_t *ctx)
+{
+    errno = errno_from_sqlite_error (ctx->db);
+}
+
 static void freectx (void *arg)
 {
     sqlite_ctx_t *ctx = arg;
     if (ctx) {
+        gc_destroy (ctx->gc);
+        threads_stop (ctx);
         if (ctx->store_stmt)
             sqlite3_finalize (ctx->store_stmt);
         if (ctx->load_stmt)
@@ -123,19 +192,46 @@ static void freectx (void *arg)
             sqlite3_finalize (ctx->dump_stmt);
         if (ctx->dbdir)
             free (ctx->dbdir);
+        if (ctx->db)
+            sqlite3_close (ctx->db);
         if (ctx->dbfile) {
+            char *s;
             unlink (ctx->dbfile);
+            s = xasprintf ("%s-wal", ctx->dbfile);
+            unlink (s);
+            free (s);
+            s = xasprintf ("%s-shm", ctx->dbfile);
+            unlink (s);
+            free (s);
             free (ctx->dbfile);
         }
-        if (ctx->db)
-            sqlite3_close (ctx->db);
         if (ctx->lzo_buf)
             free (ctx->lzo_buf);
         free (ctx);
     }
 }
 
-static sqlite_ctx_t *getctx (flux_t *h)
+static void process_args (sqlite_ctx_t *ctx, int ac, char **av)
+{
+    int i;
+
+    for (i = 0; i < ac; i++) {
+        if (strcmp (av[i], "wal") == 0)
+            ctx->wal = true;
+        else if (strncmp (av[i], "readers=", 8) == 0)
+            ctx->wal_readers = strtoul (av[i]+8, NULL, 10);
+        else if (strncmp (av[i], "batch=", 6) == 0)
+            ctx->wal_batch = strtoul (av[i]+6, NULL, 10);
+        else
+            flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
+    }
+    if (ctx->wal_readers < 1)
+        ctx->wal_readers = 1;
+    if (ctx->wal_batch < 1)
+        ctx->wal_batch = 1;
+}
+
+static sqlite_ctx_t *getctx (flux_t *h, int argc, char **argv)
 {
     sqlite_ctx_t *ctx = (sqlite_ctx_t *)flux_aux_get (h, "flux::content-sqlite");
     const char *dir;
@@ -149,6 +245,10 @@ static sqlite_ctx_t *getctx (flux_t *h)
         ctx->lzo_buf = xzmalloc (lzo_buf_chunksize);
         ctx->lzo_bufsize = lzo_buf_chunksize;
         ctx->h = h;
+        ctx->done_fd = -1;
+        ctx->wal_readers = default_wal_readers;
+        ctx->wal_batch = default_wal_batch;
+        process_args (ctx, argc, argv);
         if (!(ctx->hashfun = flux_attr_get (h, "content.hash", &flags))) {
             saved_errno = errno;
             flux_log_error (h, "content.hash");
@@ -184,7 +284,23 @@ static sqlite_ctx_t *getctx (flux_t *h)
             flux_log_error (h, "sqlite3_open %s", ctx->dbfile);
             goto error;
         }
-        if (sqlite3_exec (ctx->db, "PRAGMA journal_mode=OFF",
+        if (ctx->wal) {
+            /* Worker threads open their own connections, so no
+             * exclusive lock.  With WAL, synchronous=NORMAL keeps the
+             * database consistent if the broker crashes.
+             */
+            if (sqlite3_exec (ctx->db, "PRAGMA journal_mode=WAL",
+                                            NULL, NULL, NULL) != SQLITE_OK
+                || sqlite3_exec (ctx->db, "PRAGMA synchronous=NORMAL",
+                                            NULL, NULL, NULL) != SQLITE_OK
+                || sqlite3_busy_timeout (ctx->db,
+                                         wal_busy_timeout_ms) != SQLITE_OK) {
+                saved_errno = EINVAL;
+                log_sqlite_error (ctx, "setting sqlite pragmas");
+                goto error;
+            }
+        }
+        else if (sqlite3_exec (ctx->db, "PRAGMA journal_mode=OFF",
                                             NULL, NULL, NULL) != SQLITE_OK
                 || sqlite3_exec (ctx->db, "PRAGMA synchronous=OFF",
                                             NULL, NULL, NULL) != SQLITE_OK
@@ -242,6 +358,545 @@ int grow_lzo_buf (sqlite_ctx_t *ctx, size_t size)
     return 0;
 }
 
+/* WAL mode
+ * Loads are handed to a pool of reader threads, each with a read-only
+ * connection, so they proceed while stores are being written.  Stores
+ * are handed to a single writer thread that commits up to 'batch' of
+ * them per transaction, and checkpoints the WAL when it goes idle.
+ * Worker threads never use the flux handle:  finished jobs are queued
+ * and an eventfd wakes the reactor, which sends the responses.
+ */
+
+static void job_destroy (struct sqlite_job *job)
+{
+    if (job) {
+        flux_msg_destroy (job->msg);
+        free (job->out);
+        free (job->errstr);
+        free (job);
+    }
+}
+
+static struct sqlite_job *job_create (const flux_msg_t *msg, bool store)
+{
+    struct sqlite_job *job = xzmalloc (sizeof (*job));
+
+    if (!(job->msg = flux_msg_copy (msg, true))) {
+        free (job);
+        return NULL;
+    }
+    job->store = store;
+    strcpy (job->blobref, "-");
+    return job;
+}
+
+static void job_set_error (struct sqlite_job *job, int errnum,
+                           const char *errstr)
+{
+    job->errnum = errnum;
+    if (errstr && !job->errstr)
+        job->errstr = xstrdup (errstr);
+}
+
+static void job_set_sqlite_error (struct sqlite_job *job, sqlite3 *db,
+                                  const char *what)
+{
+    const char *error = sqlite3_errmsg (db);
+
+    job->errnum = errno_from_sqlite_error (db);
+    if (!job->errstr)
+        job->errstr = xasprintf ("%s: %s(%d)", what,
+                                 error ? error : "failure",
+                                 sqlite3_extended_errcode (db));
+}
+
+static int workq_init (struct workq *q)
+{
+    memset (q, 0, sizeof (*q));
+    if (!(q->jobs = zlist_new ())) {
+        errno = ENOMEM;
+        return -1;
+    }
+    pthread_mutex_init (&q->lock, NULL);
+    pthread_cond_init (&q->cond, NULL);
+    return 0;
+}
+
+static void workq_fini (struct workq *q)
+{
+    struct sqlite_job *job;
+
+    if (q->jobs) {
+        while ((job = zlist_pop (q->jobs)))
+            job_destroy (job);
+        zlist_destroy (&q->jobs);
+        pthread_mutex_destroy (&q->lock);
+        pthread_cond_destroy (&q->cond);
+    }
+}
+
+static int workq_push (struct workq *q, struct sqlite_job *job)
+{
+    int rc;
+
+    pthread_mutex_lock (&q->lock);
+    rc = zlist_append (q->jobs, job);
+    pthread_cond_signal (&q->cond);
+    pthread_mutex_unlock (&q->lock);
+    if (rc < 0)
+        errno = ENOMEM;
+    return rc;
+}
+
+/* Pop a job, optionally waiting for one.
+ * Returns NULL if there is none, or if the queue is stopped and empty.
+ */
+static struct sqlite_job *workq_pop (struct workq *q, bool wait)
+{
+    struct sqlite_job *job;
+
+    pthread_mutex_lock (&q->lock);
+    while (wait && zlist_size (q->jobs) == 0 && !q->stop)
+        pthread_cond_wait (&q->cond, &q->lock);
+    job = zlist_pop (q->jobs);
+    pthread_mutex_unlock (&q->lock);
+    return job;
+}
+
+static void workq_stop (struct workq *q)
+{
+    pthread_mutex_lock (&q->lock);
+    q->stop = true;
+    pthread_cond_broadcast (&q->cond);
+    pthread_mutex_unlock (&q->lock);
+}
+
+static void done_push (sqlite_ctx_t *ctx, struct sqlite_job *job)
+{
+    uint64_t one = 1;
+
+    pthread_mutex_lock (&ctx->done_lock);
+    if (zlist_append (ctx->done, job) < 0)
+        job_destroy (job); /* requestor will not get a response */
+    pthread_mutex_unlock (&ctx->done_lock);
+    if (write (ctx->done_fd, &one, sizeof (one)) < 0)
+        return; /* counter overflow:  a wakeup is already pending */
+}
+
+static void job_respond (sqlite_ctx_t *ctx, struct sqlite_job *job)
+{
+    const char *name = job->store ? "store" : "load";
+
+    if (job->errstr)
+        flux_log (ctx->h, LOG_ERR, "%s: %s", name, job->errstr);
+    if (job->store) {
+        if (flux_respond_raw (ctx->h, job->msg, job->errnum,
+                              job->blobref, strlen (job->blobref) + 1) < 0)
+            flux_log_error (ctx->h, "store: flux_respond");
+    }
+    else {
+        if (flux_respond_raw (ctx->h, job->msg, job->errnum,
+                              job->errnum ? NULL : job->out,
+                              job->errnum ? 0 : job->out_size) < 0)
+            flux_log_error (ctx->h, "load: flux_respond");
+    }
+}
+
+static void done_drain (sqlite_ctx_t *ctx)
+{
+    struct sqlite_job *job;
+
+    for (;;) {
+        pthread_mutex_lock (&ctx->done_lock);
+        job = zlist_pop (ctx->done);
+        pthread_mutex_unlock (&ctx->done_lock);
+        if (!job)
+            break;
+        job_respond (ctx, job);
+        job_destroy (job);
+    }
+}
+
+static void done_cb (flux_reactor_t *r, flux_watcher_t *w,
+                     int revents, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    uint64_t count;
+
+    if (read (ctx->done_fd, &count, sizeof (count)) < 0 && errno != EAGAIN)
+        flux_log_error (ctx->h, "done: read");
+    done_drain (ctx);
+}
+
+static int conn_grow_lzo_buf (struct dbconn *c, size_t size)
+{
+    size_t newsize = c->lzo_bufsize;
+    void *newbuf;
+    while (newsize < size)
+        newsize += lzo_buf_chunksize;
+    if (!(newbuf = realloc (c->lzo_buf, newsize))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    c->lzo_bufsize = newsize;
+    c->lzo_buf = newbuf;
+    return 0;
+}
+
+static void conn_load (struct dbconn *c, struct sqlite_job *job)
+{
+    const void *data;
+    int size;
+    int uncompressed_size;
+    int rc;
+
+    if (sqlite3_bind_text (c->stmt, 1, (char *)job->hash, job->hash_len,
+                                              SQLITE_STATIC) != SQLITE_OK) {
+        job_set_sqlite_error (job, c->db, "binding key");
+        goto done;
+    }
+    if ((rc = sqlite3_step (c->stmt)) != SQLITE_ROW) {
+        if (rc == SQLITE_DONE)
+            job_set_error (job, ENOENT, NULL);
+        else
+            job_set_sqlite_error (job, c->db, "executing stmt");
+        goto done;
+    }
+    size = sqlite3_column_bytes (c->stmt, 0);
+    if (sqlite3_column_type (c->stmt, 0) != SQLITE_BLOB && size > 0) {
+        job_set_error (job, EINVAL, "selected value is not a blob");
+        goto done;
+    }
+    data = sqlite3_column_blob (c->stmt, 0);
+    if (sqlite3_column_type (c->stmt, 1) != SQLITE_INTEGER) {
+        job_set_error (job, EINVAL, "selected value is not an integer");
+        goto done;
+    }
+    uncompressed_size = sqlite3_column_int (c->stmt, 1);
+    if (uncompressed_size == -1) {
+        if (size > 0) {
+            if (!(job->out = malloc (size))) {
+                job_set_error (job, ENOMEM, NULL);
+                goto done;
+            }
+            memcpy (job->out, data, size);
+        }
+        job->out_size = size;
+    }
+    else {
+        lzo_uint out_len = uncompressed_size;
+        if (!(job->out = malloc (uncompressed_size + 1))) {
+            job_set_error (job, ENOMEM, NULL);
+            goto done;
+        }
+        if (lzo1x_decompress_safe (data, size, job->out, &out_len, NULL)
+                        != LZO_E_OK || out_len != uncompressed_size) {
+            job_set_error (job, EINVAL, "blob size mismatch");
+            goto done;
+        }
+        job->out_size = uncompressed_size;
+    }
+done:
+    (void)sqlite3_reset (c->stmt);
+}
+
+/* Only the writer thread compresses, so the static lzo_wrkmem is safe.
+ * The blobref was computed by the reactor thread, see store_request_queue().
+ */
+static void conn_store (struct dbconn *c, struct sqlite_job *job)
+{
+    const void *data = job->in;
+    int size = job->in_size;
+    int uncompressed_size = -1;
+
+    if (size >= compression_threshold) {
+        lzo_uint out_len = size + size / 16 + 64 + 3;
+        if (c->lzo_bufsize < out_len && conn_grow_lzo_buf (c, out_len) < 0) {
+            job_set_error (job, errno, NULL);
+            goto done;
+        }
+        if (lzo1x_1_compress (data, size, c->lzo_buf, &out_len,
+                              lzo_wrkmem) != LZO_E_OK) {
+            job_set_error (job, EINVAL, NULL);
+            goto done;
+        }
+        uncompressed_size = size;
+        size = out_len;
+        data = c->lzo_buf;
+    }
+    if (sqlite3_bind_text (c->stmt, 1, (char *)job->hash, job->hash_len,
+                           SQLITE_STATIC) != SQLITE_OK) {
+        job_set_sqlite_error (job, c->db, "binding key");
+        goto done;
+    }
+    if (sqlite3_bind_int (c->stmt, 2, uncompressed_size) != SQLITE_OK) {
+        job_set_sqlite_error (job, c->db, "binding size");
+        goto done;
+    }
+    if (sqlite3_bind_blob (c->stmt, 3, data, size,
+                           SQLITE_STATIC) != SQLITE_OK) {
+        job_set_sqlite_error (job, c->db, "binding data");
+        goto done;
+    }
+    if (sqlite3_step (c->stmt) != SQLITE_DONE
+                    && sqlite3_errcode (c->db) != SQLITE_CONSTRAINT) {
+        job_set_sqlite_error (job, c->db, "executing stmt");
+        goto done;
+    }
+done:
+    (void)sqlite3_reset (c->stmt);
+}
+
+static void *reader_thread (void *arg)
+{
+    struct dbconn *c = arg;
+    struct sqlite_job *job;
+
+    while ((job = workq_pop (&c->ctx->readq, true))) {
+        conn_load (c, job);
+        done_push (c->ctx, job);
+    }
+    return NULL;
+}
+
+static void *writer_thread (void *arg)
+{
+    struct dbconn *c = arg;
+    sqlite_ctx_t *ctx = c->ctx;
+    struct sqlite_job **batch;
+    struct sqlite_job *job;
+    bool txn;
+    int i, n;
+
+    batch = xzmalloc (sizeof (batch[0]) * ctx->wal_batch);
+    while ((job = workq_pop (&ctx->writeq, true))) {
+        txn = (sqlite3_exec (c->db, "BEGIN", NULL, NULL, NULL) == SQLITE_OK);
+        n = 0;
+        do {
+            conn_store (c, job);
+            batch[n++] = job;
+        } while (n < ctx->wal_batch && (job = workq_pop (&ctx->writeq, false)));
+        if (txn && sqlite3_exec (c->db, "COMMIT",
+                                 NULL, NULL, NULL) != SQLITE_OK) {
+            for (i = 0; i < n; i++) {
+                if (batch[i]->errnum == 0)
+                    job_set_sqlite_error (batch[i], c->db, "commit");
+            }
+            (void)sqlite3_exec (c->db, "ROLLBACK", NULL, NULL, NULL);
+        }
+        for (i = 0; i < n; i++)
+            done_push (ctx, batch[i]);
+        pthread_mutex_lock (&ctx->writeq.lock);
+        n = zlist_size (ctx->writeq.jobs);
+        pthread_mutex_unlock (&ctx->writeq.lock);
+        if (n == 0)
+            (void)sqlite3_wal_checkpoint_v2 (c->db, NULL,
+                                             SQLITE_CHECKPOINT_PASSIVE,
+                                             NULL, NULL);
+    }
+    free (batch);
+    return NULL;
+}
+
+static int conn_open (sqlite_ctx_t *ctx, struct dbconn *c, bool readonly)
+{
+    int flags = SQLITE_OPEN_NOMUTEX;
+
+    c->ctx = ctx;
+    flags |= readonly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE;
+    if (sqlite3_open_v2 (ctx->dbfile, &c->db, flags, NULL) != SQLITE_OK) {
+        flux_log (ctx->h, LOG_ERR, "sqlite3_open_v2 %s: %s", ctx->dbfile,
+                  c->db ? sqlite3_errmsg (c->db) : "failure");
+        goto error;
+    }
+    if (sqlite3_busy_timeout (c->db, wal_busy_timeout_ms) != SQLITE_OK
+            || (!readonly && sqlite3_exec (c->db, "PRAGMA synchronous=NORMAL",
+                                           NULL, NULL, NULL) != SQLITE_OK)) {
+        flux_log (ctx->h, LOG_ERR, "setting sqlite pragmas: %s",
+                  sqlite3_errmsg (c->db));
+        goto error;
+    }
+    if (sqlite3_prepare_v2 (c->db, readonly ? sql_load : sql_store, -1,
+                            &c->stmt, NULL) != SQLITE_OK) {
+        flux_log (ctx->h, LOG_ERR, "preparing %s stmt: %s",
+                  readonly ? "load" : "store", sqlite3_errmsg (c->db));
+        goto error;
+    }
+    return 0;
+error:
+    errno = EINVAL;
+    return -1;
+}
+
+static void conn_close (struct dbconn *c)
+{
+    if (c->stmt)
+        sqlite3_finalize (c->stmt);
+    if (c->db)
+        sqlite3_close (c->db);
+    free (c->lzo_buf);
+    memset (c, 0, sizeof (*c));
+}
+
+static int conn_start (struct dbconn *c, void *(*fun)(void *))
+{
+    int e;
+
+    if ((e = pthread_create (&c->t, NULL, fun, c)) != 0) {
+        errno = e;
+        return -1;
+    }
+    c->started = true;
+    return 0;
+}
+
+/* Stop worker threads, answering any requests they have completed.
+ * Afterwards, requests are handled on the reactor thread again.
+ */
+static void threads_stop (sqlite_ctx_t *ctx)
+{
+    int i;
+
+    if (!ctx->threads_running)
+        return;
+    workq_stop (&ctx->readq);
+    workq_stop (&ctx->writeq);
+    for (i = 0; i < ctx->wal_readers; i++) {
+        if (ctx->readers[i].started)
+            pthread_join (ctx->readers[i].t, NULL);
+        conn_close (&ctx->readers[i]);
+    }
+    free (ctx->readers);
+    ctx->readers = NULL;
+    if (ctx->writer.started)
+        pthread_join (ctx->writer.t, NULL);
+    conn_close (&ctx->writer);
+    done_drain (ctx);
+    workq_fini (&ctx->readq);
+    workq_fini (&ctx->writeq);
+    zlist_destroy (&ctx->done);
+    pthread_mutex_destroy (&ctx->done_lock);
+    flux_watcher_destroy (ctx->done_w);
+    ctx->done_w = NULL;
+    close (ctx->done_fd);
+    ctx->done_fd = -1;
+    ctx->threads_running = false;
+}
+
+static int threads_start (sqlite_ctx_t *ctx)
+{
+    int i;
+
+    if (workq_init (&ctx->readq) < 0 || workq_init (&ctx->writeq) < 0
+                                     || !(ctx->done = zlist_new ())) {
+        errno = ENOMEM;
+        goto error_early;
+    }
+    pthread_mutex_init (&ctx->done_lock, NULL);
+    ctx->readers = xzmalloc (sizeof (ctx->readers[0]) * ctx->wal_readers);
+    ctx->threads_running = true; /* threads_stop() cleans up from here */
+    if ((ctx->done_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        flux_log_error (ctx->h, "eventfd");
+        goto error;
+    }
+    if (!(ctx->done_w = flux_fd_watcher_create (flux_get_reactor (ctx->h),
+                                                ctx->done_fd, FLUX_POLLIN,
+                                                done_cb, ctx))) {
+        flux_log_error (ctx->h, "flux_fd_watcher_create");
+        goto error;
+    }
+    flux_watcher_start (ctx->done_w);
+    if (conn_open (ctx, &ctx->writer, false) < 0
+                        || conn_start (&ctx->writer, writer_thread) < 0) {
+        flux_log_error (ctx->h, "starting writer thread");
+        goto error;
+    }
+    for (i = 0; i < ctx->wal_readers; i++) {
+        if (conn_open (ctx, &ctx->readers[i], true) < 0
+                    || conn_start (&ctx->readers[i], reader_thread) < 0) {
+            flux_log_error (ctx->h, "starting reader thread");
+            goto error;
+        }
+    }
+    flux_log (ctx->h, LOG_DEBUG, "wal: %d readers, batch %d",
+              ctx->wal_readers, ctx->wal_batch);
+    return 0;
+error:
+    threads_stop (ctx);
+    return -1;
+error_early:
+    workq_fini (&ctx->readq);
+    workq_fini (&ctx->writeq);
+    zlist_destroy (&ctx->done);
+    return -1;
+}
+
+static void load_request_queue (sqlite_ctx_t *ctx, const flux_msg_t *msg)
+{
+    struct sqlite_job *job = NULL;
+    const char *blobref;
+    int blobref_size;
+
+    if (flux_request_decode_raw (msg, NULL, (const void **)&blobref,
+                                 &blobref_size) < 0) {
+        flux_log_error (ctx->h, "load: request decode failed");
+        goto error;
+    }
+    if (!blobref || blobref[blobref_size - 1] != '\0') {
+        errno = EPROTO;
+        flux_log_error (ctx->h, "load: malformed blobref");
+        goto error;
+    }
+    if (!(job = job_create (msg, false)))
+        goto error;
+    if ((job->hash_len = blobref_strtohash (blobref, job->hash,
+                                            sizeof (job->hash))) < 0) {
+        errno = ENOENT;
+        flux_log_error (ctx->h, "load: unexpected foreign blobref");
+        goto error;
+    }
+    if (workq_push (&ctx->readq, job) < 0)
+        goto error;
+    return;
+error:
+    if (flux_respond (ctx->h, msg, errno, NULL) < 0)
+        flux_log_error (ctx->h, "load: flux_respond");
+    job_destroy (job);
+}
+
+static void store_request_queue (sqlite_ctx_t *ctx, const flux_msg_t *msg)
+{
+    struct sqlite_job *job = NULL;
+
+    if (!(job = job_create (msg, true)))
+        goto error;
+    if (flux_request_decode_raw (job->msg, NULL, &job->in,
+                                 &job->in_size) < 0) {
+        flux_log_error (ctx->h, "store: request decode failed");
+        goto error;
+    }
+    if (job->in_size > ctx->blob_size_limit) {
+        errno = EFBIG;
+        goto error;
+    }
+    /* Hash here rather than in the writer, so a garbage collection
+     * running on this thread learns of the store before it is written.
+     */
+    if (blobref_hash (ctx->hashfun, (uint8_t *)job->in, job->in_size,
+                      job->blobref, sizeof (job->blobref)) < 0
+        || (job->hash_len = blobref_strtohash (job->blobref, job->hash,
+                                               sizeof (job->hash))) < 0)
+        goto error;
+    gc_stored (ctx, job->blobref);
+    if (workq_push (&ctx->writeq, job) < 0)
+        goto error;
+    return;
+error:
+    if (flux_respond_raw (ctx->h, msg, errno, "-", 2) < 0)
+        flux_log_error (ctx->h, "store: flux_respond");
+    job_destroy (job);
+}
+
 void load_cb (flux_t *h, flux_msg_handler_t *w,
               const flux_msg_t *msg, void *arg)
 {
@@ -255,6 +910,11 @@ void load_cb (flux_t *h, flux_msg_handler_t *w,
     int uncompressed_size;
     int rc = -1;
     int old_state;
+
+    if (ctx->threads_running) {
+        load_request_queue (ctx, msg);
+        return;
+    }
     //delay cancellation to ensure lock-correctness in sqlite
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
 
@@ -334,6 +994,11 @@ void store_cb (flux_t *h, flux_msg_handler_t *w,
     int uncompressed_size = -1;
     int rc = -1;
     int old_state;
+
+    if (ctx->threads_running) {
+        store_request_queue (ctx, msg);
+        return;
+    }
     //delay cancellation to ensure lock-correctness in sqlite
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
 
@@ -350,6 +1015,7 @@ void store_cb (flux_t *h, flux_msg_handler_t *w,
         goto done;
     if ((hash_len = blobref_strtohash (blobref, hash, sizeof (hash))) < 0)
         goto done;
+    gc_stored (ctx, blobref);
     if (size >= compression_threshold) {
         int r;
         lzo_uint out_len = size + size / 16 + 64 + 3;
@@ -396,6 +1062,695 @@ done:
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_state);
 }
 
+/* Garbage collection
+ * A content-backing.gc request starts a mark-and-sweep collection.
+ * Marking and sweeping are done a batch at a time from an idle watcher,
+ * so loads and stores continue to be served while it runs.
+ *
+ * 1) The rank 0 cache is told a collection is active, after which it
+ *    passes through stores of blobs it holds clean.  From then on, every
+ *    blobref stored is recorded and exempt from the sweep.
+ * 2) Unless disabled, the KVS is told a collection is active, after which
+ *    commits store every object they write, even if the KVS holds it in
+ *    cache.  It responds with its root once any commit in progress, which
+ *    may have skipped such stores, has finished.  The cache is flushed so
+ *    every blob reachable from that root is in the database.
+ * 3) Mark:  the RFC 11 directories reachable from the KVS root and any
+ *    roots named in the request are walked, marking their blobs.  Then
+ *    the current KVS root is fetched, the cache flushed, and the new root
+ *    walked in turn, covering commits that stored before step 2.
+ * 4) Sweep:  the table is scanned in chunks of 'batch' blobs, and blobs
+ *    that are neither marked nor recorded are deleted.  Before the next
+ *    chunk is read, the content cache and KVS drop their clean entries for
+ *    the deleted blobs, so a later store of one reaches the database.
+ *    Optionally the database is vacuumed.
+ */
+
+enum gc_state { GC_START, GC_MARK, GC_SCAN, GC_SWEEP };
+
+struct gc_victim {
+    int size;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+};
+
+struct gc {
+    flux_msg_t *request;
+    enum gc_state state;
+    int batch;
+    bool kvs;
+    bool kvs_active;            /* KVS has been told gc is active */
+    bool rerooted;              /* final KVS root has been marked */
+    bool scanned;               /* last chunk of objects has been read */
+    uint8_t scan_hash[BLOBREF_MAX_DIGEST_SIZE]; /* last hash read */
+    int scan_hash_len;
+    bool compact;
+    zhash_t *stored;            /* blobrefs stored since gc began */
+    zhash_t *marked;            /* blobrefs reachable from roots */
+    zlist_t *todo;              /* marked directories to be walked */
+    zlist_t *victims;           /* struct gc_victim to be deleted */
+    json_t *dropped;            /* blobrefs deleted, not yet dropped */
+    sqlite3_stmt *scan_stmt;
+    sqlite3_stmt *delete_stmt;
+    flux_watcher_t *w;
+    int deleted;
+    int64_t bytes;
+};
+
+static void gc_destroy (struct gc *gc)
+{
+    if (gc) {
+        char *s;
+        flux_msg_destroy (gc->request);
+        zhash_destroy (&gc->stored);
+        zhash_destroy (&gc->marked);
+        if (gc->todo) {
+            while ((s = zlist_pop (gc->todo)))
+                free (s);
+            zlist_destroy (&gc->todo);
+        }
+        if (gc->victims) {
+            while ((s = zlist_pop (gc->victims)))
+                free (s);
+            zlist_destroy (&gc->victims);
+        }
+        json_decref (gc->dropped);
+        if (gc->scan_stmt)
+            sqlite3_finalize (gc->scan_stmt);
+        if (gc->delete_stmt)
+            sqlite3_finalize (gc->delete_stmt);
+        flux_watcher_destroy (gc->w);
+        free (gc);
+    }
+}
+
+static struct gc *gc_create (sqlite_ctx_t *ctx, const flux_msg_t *msg)
+{
+    struct gc *gc = xzmalloc (sizeof (*gc));
+
+    if (!(gc->request = flux_msg_copy (msg, false))
+                    || !(gc->stored = zhash_new ())
+                    || !(gc->marked = zhash_new ())
+                    || !(gc->todo = zlist_new ())
+                    || !(gc->victims = zlist_new ())
+                    || !(gc->dropped = json_array ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (sqlite3_prepare_v2 (ctx->db, sql_gc_scan, -1, &gc->scan_stmt,
+                                            NULL) != SQLITE_OK
+            || sqlite3_prepare_v2 (ctx->db, sql_gc_delete, -1,
+                                   &gc->delete_stmt, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "gc: preparing stmts");
+        errno = EINVAL;
+        goto error;
+    }
+    gc->batch = default_gc_batch;
+    gc->kvs = true;
+    return gc;
+error:
+    gc_destroy (gc);
+    return NULL;
+}
+
+/* Record a blobref that was stored while a collection is in progress.
+ */
+static void gc_stored (sqlite_ctx_t *ctx, const char *blobref)
+{
+    if (ctx->gc)
+        (void)zhash_insert (ctx->gc->stored, blobref, ctx->gc);
+}
+
+static void backing_gc_continuation (flux_future_t *f, void *arg)
+{
+    flux_future_destroy (f);
+}
+
+/* Ask the content cache and the KVS to drop clean cache entries for
+ * deleted blobs, else a later store of one would be satisfied from cache
+ * and never reach the database.  They must do so before being told the
+ * collection has ended, while stores still pass through.
+ */
+static flux_future_t *gc_drop_rpc (sqlite_ctx_t *ctx, const char *topic)
+{
+    return flux_rpc_pack (ctx->h, topic, FLUX_NODEID_ANY, 0, "{ s:O }",
+                          "blobrefs", ctx->gc->dropped);
+}
+
+static void gc_finish (sqlite_ctx_t *ctx, int errnum)
+{
+    struct gc *gc = ctx->gc;
+    flux_future_t *f;
+
+    /* Requests to a service are handled in the order sent, so these
+     * drops precede the end of the collection below.
+     */
+    if (json_array_size (gc->dropped) > 0) {
+        if (!(f = gc_drop_rpc (ctx, "content.drop"))
+                || flux_future_then (f, -1., backing_gc_continuation,
+                                     NULL) < 0) {
+            flux_log_error (ctx->h, "gc: content.drop");
+            flux_future_destroy (f);
+        }
+        if (!(f = gc_drop_rpc (ctx, "kvs.drop"))
+                || flux_future_then (f, -1., backing_gc_continuation,
+                                     NULL) < 0) {
+            flux_log_error (ctx->h, "gc: kvs.drop");
+            flux_future_destroy (f);
+        }
+    }
+    ctx->gc = NULL;
+    if (gc->kvs_active) {
+        if (!(f = flux_rpc_pack (ctx->h, "kvs.gc", FLUX_NODEID_ANY, 0,
+                                 "{ s:b }", "active", 0))
+                || flux_future_then (f, -1., backing_gc_continuation,
+                                     NULL) < 0) {
+            flux_log_error (ctx->h, "gc: kvs.gc");
+            flux_future_destroy (f);
+        }
+    }
+    if (!(f = flux_rpc_pack (ctx->h, "content.backing-gc", FLUX_NODEID_ANY, 0,
+                             "{ s:b }", "active", 0))
+            || flux_future_then (f, -1., backing_gc_continuation, NULL) < 0) {
+        flux_log_error (ctx->h, "gc: content.backing-gc");
+        flux_future_destroy (f);
+    }
+    if (errnum == 0) {
+        flux_log (ctx->h, LOG_INFO, "gc: marked %d, deleted %d (%lld bytes)",
+                  (int)zhash_size (gc->marked), gc->deleted,
+                  (long long)gc->bytes);
+        if (flux_respond_pack (ctx->h, gc->request, "{ s:i s:i s:I }",
+                               "marked", (int)zhash_size (gc->marked),
+                               "deleted", gc->deleted,
+                               "bytes", gc->bytes) < 0)
+            flux_log_error (ctx->h, "gc: flux_respond_pack");
+    }
+    else {
+        flux_log (ctx->h, LOG_ERR, "gc: %s", flux_strerror (errnum));
+        if (flux_respond (ctx->h, gc->request, errnum, NULL) < 0)
+            flux_log_error (ctx->h, "gc: flux_respond");
+    }
+    gc_destroy (gc);
+}
+
+/* Mark 'blobref' reachable, queueing it to be walked if 'walk' is true.
+ */
+static void gc_mark (struct gc *gc, const char *blobref, bool walk)
+{
+    if (zhash_lookup (gc->marked, blobref))
+        return;
+    if (zhash_insert (gc->marked, blobref, gc) < 0)
+        return;
+    if (walk && zlist_append (gc->todo, xstrdup (blobref)) < 0)
+        oom ();
+}
+
+static void gc_mark_treeobj (struct gc *gc, json_t *obj)
+{
+    const char *type;
+    json_t *data;
+    json_t *o;
+    const char *name;
+    size_t index;
+
+    if (json_unpack (obj, "{s:s s:o}", "type", &type, "data", &data) < 0)
+        return;
+    if (!strcmp (type, "dirref") || !strcmp (type, "valref")) {
+        bool walk = !strcmp (type, "dirref");
+        if (!json_is_array (data))
+            return;
+        json_array_foreach (data, index, o) {
+            if (json_is_string (o))
+                gc_mark (gc, json_string_value (o), walk);
+        }
+    }
+    else if (!strcmp (type, "dir") && json_is_object (data)) {
+        json_object_foreach (data, name, o)
+            gc_mark_treeobj (gc, o);
+    }
+}
+
+/* Load a blob directly from the database into ctx->lzo_buf.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int gc_load (sqlite_ctx_t *ctx, const char *blobref,
+                    const void **datap, int *sizep)
+{
+    uint8_t hash[BLOBREF_MAX_DIGEST_SIZE];
+    int hash_len;
+    const void *data;
+    int size;
+    int uncompressed_size;
+    lzo_uint out_len;
+    int step;
+    int rc = -1;
+
+    if ((hash_len = blobref_strtohash (blobref, hash, sizeof (hash))) < 0)
+        return -1;
+    if (sqlite3_bind_text (ctx->load_stmt, 1, (char *)hash, hash_len,
+                                              SQLITE_STATIC) != SQLITE_OK) {
+        set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
+    if ((step = sqlite3_step (ctx->load_stmt)) != SQLITE_ROW) {
+        if (step == SQLITE_DONE)
+            errno = ENOENT;
+        else
+            set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
+    size = sqlite3_column_bytes (ctx->load_stmt, 0);
+    data = sqlite3_column_blob (ctx->load_stmt, 0);
+    uncompressed_size = sqlite3_column_int (ctx->load_stmt, 1);
+    if (uncompressed_size == -1) {
+        if (ctx->lzo_bufsize < size && grow_lzo_buf (ctx, size) < 0)
+            goto done;
+        memcpy (ctx->lzo_buf, data, size);
+    }
+    else {
+        if (ctx->lzo_bufsize < uncompressed_size
+                                && grow_lzo_buf (ctx, uncompressed_size) < 0)
+            goto done;
+        out_len = ctx->lzo_bufsize;
+        if (lzo1x_decompress_safe (data, size, ctx->lzo_buf, &out_len, NULL)
+                    != LZO_E_OK || out_len != uncompressed_size) {
+            errno = EINVAL;
+            goto done;
+        }
+        size = uncompressed_size;
+    }
+    *datap = ctx->lzo_buf;
+    *sizep = size;
+    rc = 0;
+done:
+    (void)sqlite3_reset (ctx->load_stmt);
+    return rc;
+}
+
+static void gc_reroot (sqlite_ctx_t *ctx);
+
+static int gc_mark_batch (sqlite_ctx_t *ctx)
+{
+    struct gc *gc = ctx->gc;
+    const void *data;
+    int size;
+    json_t *o;
+    char *blobref;
+    int n = 0;
+
+    /* If walking can't be completed, sweeping would be unsafe.
+     */
+    while (n++ < gc->batch && (blobref = zlist_pop (gc->todo))) {
+        if (gc_load (ctx, blobref, &data, &size) < 0) {
+            flux_log_error (ctx->h, "gc: load %s", blobref);
+            free (blobref);
+            return -1;
+        }
+        if (!(o = json_loadb (data, size, JSON_DISABLE_EOF_CHECK, NULL))) {
+            flux_log (ctx->h, LOG_ERR, "gc: %s: malformed directory",
+                      blobref);
+            free (blobref);
+            errno = EPROTO;
+            return -1;
+        }
+        gc_mark_treeobj (gc, o);
+        json_decref (o);
+        free (blobref);
+    }
+    if (zlist_size (gc->todo) == 0) {
+        if (gc->kvs && !gc->rerooted)
+            gc_reroot (ctx);
+        else
+            gc->state = GC_SCAN;
+    }
+    return 0;
+}
+
+/* Read the next chunk of up to 'batch' objects, in hash order after the
+ * last one read, and queue unmarked ones for deletion.  The statement is
+ * reset after each chunk so no read transaction stays open between
+ * reactor loop iterations, which would block WAL checkpoints.
+ */
+static int gc_scan_batch (sqlite_ctx_t *ctx)
+{
+    struct gc *gc = ctx->gc;
+    struct gc_victim *v;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    const void *hash;
+    int hash_len;
+    int n = 0;
+    int rc = -1;
+
+    if (sqlite3_bind_text (gc->scan_stmt, 1, (char *)gc->scan_hash,
+                           gc->scan_hash_len, SQLITE_STATIC) != SQLITE_OK
+            || sqlite3_bind_int (gc->scan_stmt, 2, gc->batch) != SQLITE_OK) {
+        log_sqlite_error (ctx, "gc: binding scan");
+        set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
+    while ((rc = sqlite3_step (gc->scan_stmt)) == SQLITE_ROW) {
+        n++;
+        hash = sqlite3_column_blob (gc->scan_stmt, 0);
+        hash_len = sqlite3_column_bytes (gc->scan_stmt, 0);
+        if (hash_len > sizeof (gc->scan_hash)) {
+            flux_log (ctx->h, LOG_ERR, "gc: scanned hash is too long");
+            errno = EPROTO;
+            rc = -1;
+            goto done;
+        }
+        memcpy (gc->scan_hash, hash, hash_len);
+        gc->scan_hash_len = hash_len;
+        if (blobref_hashtostr (ctx->hashfun, hash, hash_len,
+                               blobref, sizeof (blobref)) < 0)
+            continue;
+        if (zhash_lookup (gc->marked, blobref))
+            continue;
+        v = xzmalloc (sizeof (*v));
+        strcpy (v->blobref, blobref);
+        v->size = sqlite3_column_int (gc->scan_stmt, 1);
+        if (zlist_append (gc->victims, v) < 0)
+            oom ();
+    }
+    if (rc != SQLITE_DONE) {
+        log_sqlite_error (ctx, "gc: scanning objects");
+        set_errno_from_sqlite_error (ctx);
+        rc = -1;
+        goto done;
+    }
+    if (n < gc->batch)
+        gc->scanned = true;
+    gc->state = GC_SWEEP;
+    rc = 0;
+done:
+    (void)sqlite3_reset (gc->scan_stmt);
+    return rc;
+}
+
+static int gc_sweep_batch (sqlite_ctx_t *ctx)
+{
+    struct gc *gc = ctx->gc;
+    struct gc_victim *v;
+    uint8_t hash[BLOBREF_MAX_DIGEST_SIZE];
+    int hash_len;
+    int n = 0;
+
+    if (sqlite3_exec (ctx->db, "BEGIN IMMEDIATE",
+                                    NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "gc: begin");
+        set_errno_from_sqlite_error (ctx);
+        return -1;
+    }
+    while (n++ < gc->batch && (v = zlist_pop (gc->victims))) {
+        if (zhash_lookup (gc->stored, v->blobref)
+            || (hash_len = blobref_strtohash (v->blobref, hash,
+                                              sizeof (hash))) < 0) {
+            free (v);
+            continue;
+        }
+        if (sqlite3_bind_text (gc->delete_stmt, 1, (char *)hash, hash_len,
+                                              SQLITE_STATIC) != SQLITE_OK
+                || sqlite3_step (gc->delete_stmt) != SQLITE_DONE) {
+            log_sqlite_error (ctx, "gc: deleting %s", v->blobref);
+            set_errno_from_sqlite_error (ctx);
+            (void)sqlite3_reset (gc->delete_stmt);
+            (void)sqlite3_exec (ctx->db, "ROLLBACK", NULL, NULL, NULL);
+            free (v);
+            return -1;
+        }
+        if (sqlite3_changes (ctx->db) > 0) {
+            if (json_array_append_new (gc->dropped,
+                                       json_string (v->blobref)) < 0)
+                oom ();
+            gc->deleted++;
+            gc->bytes += v->size;
+        }
+        (void)sqlite3_reset (gc->delete_stmt);
+        free (v);
+    }
+    if (sqlite3_exec (ctx->db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "gc: commit");
+        set_errno_from_sqlite_error (ctx);
+        (void)sqlite3_exec (ctx->db, "ROLLBACK", NULL, NULL, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+static void gc_kvs_drop_continuation (flux_future_t *f, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    if (flux_future_get (f, NULL) < 0 && errno != ENOSYS) {
+        flux_log_error (ctx->h, "gc: kvs.drop");
+        gc_finish (ctx, errno);
+        goto done;
+    }
+    json_array_clear (ctx->gc->dropped);
+    flux_watcher_start (ctx->gc->w);
+done:
+    flux_future_destroy (f);
+}
+
+static void gc_drop_continuation (flux_future_t *f, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    flux_future_t *f2;
+
+    if (flux_future_get (f, NULL) < 0) {
+        flux_log_error (ctx->h, "gc: content.drop");
+        gc_finish (ctx, errno);
+        goto done;
+    }
+    if (!(f2 = gc_drop_rpc (ctx, "kvs.drop"))
+            || flux_future_then (f2, -1., gc_kvs_drop_continuation,
+                                 ctx) < 0) {
+        flux_log_error (ctx->h, "gc: kvs.drop");
+        flux_future_destroy (f2);
+        gc_finish (ctx, errno);
+    }
+done:
+    flux_future_destroy (f);
+}
+
+/* Idle until the blobs just deleted have been dropped from the caches.
+ * The KVS may not be loaded (ENOSYS).
+ */
+static void gc_drop (sqlite_ctx_t *ctx)
+{
+    flux_future_t *f;
+
+    flux_watcher_stop (ctx->gc->w);
+    if (!(f = gc_drop_rpc (ctx, "content.drop"))
+            || flux_future_then (f, -1., gc_drop_continuation, ctx) < 0) {
+        flux_log_error (ctx->h, "gc: content.drop");
+        flux_future_destroy (f);
+        gc_finish (ctx, errno);
+    }
+}
+
+static void gc_idle_cb (flux_reactor_t *r, flux_watcher_t *w,
+                        int revents, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    struct gc *gc = ctx->gc;
+    int rc = 0;
+
+    switch (gc->state) {
+        case GC_START:
+            break;
+        case GC_MARK:
+            rc = gc_mark_batch (ctx);
+            break;
+        case GC_SCAN:
+            rc = gc_scan_batch (ctx);
+            break;
+        case GC_SWEEP:
+            rc = gc_sweep_batch (ctx);
+            if (rc == 0 && json_array_size (gc->dropped) > 0) {
+                gc_drop (ctx);
+                return;
+            }
+            if (rc == 0 && zlist_size (gc->victims) == 0) {
+                if (!gc->scanned) {
+                    gc->state = GC_SCAN;
+                    break;
+                }
+                if (gc->compact && sqlite3_exec (ctx->db, "VACUUM",
+                                            NULL, NULL, NULL) != SQLITE_OK)
+                    log_sqlite_error (ctx, "gc: vacuum");
+                gc_finish (ctx, 0);
+                return;
+            }
+            break;
+    }
+    if (rc < 0)
+        gc_finish (ctx, errno);
+}
+
+static void gc_flush_continuation (flux_future_t *f, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    if (flux_future_get (f, NULL) < 0) {
+        flux_log_error (ctx->h, "gc: content.flush");
+        gc_finish (ctx, errno);
+        goto done;
+    }
+    if (!ctx->gc->w && !(ctx->gc->w = flux_idle_watcher_create (
+                                                    flux_get_reactor (ctx->h),
+                                                    gc_idle_cb, ctx))) {
+        gc_finish (ctx, errno);
+        goto done;
+    }
+    ctx->gc->state = GC_MARK;
+    flux_watcher_start (ctx->gc->w);
+done:
+    flux_future_destroy (f);
+}
+
+static void gc_flush (sqlite_ctx_t *ctx)
+{
+    flux_future_t *f;
+
+    if (!(f = flux_rpc (ctx->h, "content.flush", NULL, FLUX_NODEID_ANY, 0))
+            || flux_future_then (f, -1., gc_flush_continuation, ctx) < 0) {
+        flux_log_error (ctx->h, "gc: content.flush");
+        flux_future_destroy (f);
+        gc_finish (ctx, errno);
+    }
+}
+
+static void gc_getroot_continuation (flux_future_t *f, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    const char *topic = flux_future_aux_get (f, "topic");
+    const char *rootdir;
+
+    if (!ctx->gc)   /* kvs.gc canceled by gc_finish() */
+        goto done;
+    if (flux_rpc_get_unpack (f, "{ s:s }", "rootdir", &rootdir) < 0) {
+        flux_log_error (ctx->h, "gc: %s", topic);
+        gc_finish (ctx, errno);
+        goto done;
+    }
+    gc_mark (ctx->gc, rootdir, true);
+    gc_flush (ctx);
+done:
+    flux_future_destroy (f);
+}
+
+static int gc_getroot (sqlite_ctx_t *ctx, flux_future_t *f, const char *topic)
+{
+    if (!f || flux_future_aux_set (f, "topic", (void *)topic, NULL) < 0
+           || flux_future_then (f, -1., gc_getroot_continuation, ctx) < 0) {
+        flux_log_error (ctx->h, "gc: %s", topic);
+        flux_future_destroy (f);
+        return -1;
+    }
+    return 0;
+}
+
+/* Marking from the first KVS root is complete:  fetch the current root,
+ * which may refer to blobs stored before the KVS began storing everything,
+ * and walk it before sweeping.  Idle until it has been flushed.
+ */
+static void gc_reroot (sqlite_ctx_t *ctx)
+{
+    flux_future_t *f;
+
+    ctx->gc->rerooted = true;
+    ctx->gc->state = GC_START;
+    flux_watcher_stop (ctx->gc->w);
+    f = flux_rpc (ctx->h, "kvs.getroot", NULL, FLUX_NODEID_ANY, 0);
+    if (gc_getroot (ctx, f, "kvs.getroot") < 0)
+        gc_finish (ctx, errno);
+}
+
+static void gc_begin_continuation (flux_future_t *f, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    flux_future_t *f2;
+
+    if (flux_future_get (f, NULL) < 0) {
+        flux_log_error (ctx->h, "gc: content.backing-gc");
+        gc_finish (ctx, errno);
+        goto done;
+    }
+    if (!ctx->gc->kvs) {
+        gc_flush (ctx);
+        goto done;
+    }
+    f2 = flux_rpc_pack (ctx->h, "kvs.gc", FLUX_NODEID_ANY, 0,
+                        "{ s:b }", "active", 1);
+    if (gc_getroot (ctx, f2, "kvs.gc") < 0) {
+        gc_finish (ctx, errno);
+        goto done;
+    }
+    ctx->gc->kvs_active = true;
+done:
+    flux_future_destroy (f);
+}
+
+void gc_cb (flux_t *h, flux_msg_handler_t *w,
+            const flux_msg_t *msg, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    json_t *roots = NULL;
+    json_t *o;
+    size_t index;
+    int batch = default_gc_batch;
+    int kvs = 1;
+    int compact = 0;
+    flux_future_t *f;
+
+    if (flux_request_unpack (msg, NULL, "{ s?:o s?:i s?:b s?:b }",
+                             "roots", &roots,
+                             "batch", &batch,
+                             "kvs", &kvs,
+                             "compact", &compact) < 0)
+        goto error;
+    if ((roots && !json_is_array (roots)) || batch < 1) {
+        errno = EPROTO;
+        goto error;
+    }
+    if (ctx->gc) {
+        errno = EBUSY;
+        goto error;
+    }
+    if (!kvs && (!roots || json_array_size (roots) == 0)) {
+        errno = EINVAL; /* no roots: everything would be deleted */
+        goto error;
+    }
+    if (!(ctx->gc = gc_create (ctx, msg)))
+        goto error;
+    ctx->gc->batch = batch;
+    ctx->gc->kvs = kvs;
+    ctx->gc->compact = compact;
+    json_array_foreach (roots, index, o) {
+        if (!json_is_string (o)
+                    || blobref_validate (json_string_value (o)) < 0) {
+            gc_destroy (ctx->gc);
+            ctx->gc = NULL;
+            errno = EINVAL;
+            goto error;
+        }
+        gc_mark (ctx->gc, json_string_value (o), true);
+    }
+    flux_log (h, LOG_DEBUG, "gc: begin");
+    if (!(f = flux_rpc_pack (h, "content.backing-gc", FLUX_NODEID_ANY, 0,
+                             "{ s:b }", "active", 1))
+            || flux_future_then (f, -1., gc_begin_continuation, ctx) < 0) {
+        flux_log_error (h, "gc: content.backing-gc");
+        flux_future_destroy (f);
+        gc_destroy (ctx->gc);
+        ctx->gc = NULL;
+        goto error;
+    }
+    return;
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "gc: flux_respond");
+}
+
 int register_backing_store (flux_t *h, bool value, const char *name)
 {
     flux_future_t *f;
@@ -445,6 +1800,9 @@ void shutdown_cb (flux_t *h, flux_msg_handler_t *w,
         flux_log_error (h, "shutdown: unregistering backing store");
         goto done;
     }
+    if (ctx->gc)
+        gc_finish (ctx, ENOSYS);
+    threads_stop (ctx);
     if (ctx->broker_shutdown) {
         flux_log (h, LOG_DEBUG, "shutdown: instance is terminating, don't reload to cache");
         goto done;
@@ -515,6 +1873,7 @@ done:
 static struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST,     "content-backing.load",         load_cb, 0, NULL },
     { FLUX_MSGTYPE_REQUEST,     "content-backing.store",        store_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST,     "content-backing.gc",           gc_cb, 0, NULL },
     { FLUX_MSGTYPE_REQUEST,     "content-sqlite.shutdown", shutdown_cb, 0, NULL },
     { FLUX_MSGTYPE_EVENT,       "shutdown",             broker_shutdown_cb, 0, NULL },
     FLUX_MSGHANDLER_TABLE_END,
@@ -523,13 +1882,15 @@ static struct flux_msg_handler_spec htab[] = {
 int mod_main (flux_t *h, int argc, char **argv)
 {
     int lzo_rc = lzo_init ();
-    sqlite_ctx_t *ctx = getctx (h);
+    sqlite_ctx_t *ctx = getctx (h, argc, argv);
     if (!ctx)
         return -1;
     if (lzo_rc != LZO_E_OK) {
         flux_log (h, LOG_ERR, "lzo_init failed (rc=%d)", lzo_rc);
         return -1;
     }
+    if (ctx->wal && threads_start (ctx) < 0)
+        return -1;
     if (flux_event_subscribe (h, "shutdown") < 0) {
         flux_log_error (h, "flux_event_subscribe");
         return -1;
@@ -547,6 +1908,9 @@ int mod_main (flux_t *h, int argc, char **argv)
         goto done;
     }
 done:
+    if (ctx->gc)
+        gc_finish (ctx, ENOSYS);
+    threads_stop (ctx);
     flux_msg_handler_delvec (htab);
     return 0;
 }
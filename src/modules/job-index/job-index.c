@@ -0,0 +1,488 @@
+/*****************************************************************************\
+ *  Copyright (c) 2017 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/* job-index: in-memory index of active jobs for libjsc
+ *
+ * The state of each active job is tracked from wreck.state.* and
+ * jsc.state.* events.  JCB attributes read from the KVS are cached per job
+ * until its next state change (or an explicit invalidate from
+ * jsc_update_jcb()), so repeated jsc_query_jcb() calls on active jobs are
+ * answered from memory.  Jobs are dropped from the index when they reach
+ * complete or failed; queries on such jobs are passed through to the KVS.
+ * KVS reads (and the job.kvspath lookup that precedes them) are issued
+ * asynchronously, so a miss does not stall other requests and events.
+ *
+ * Services:
+ *   job-index.query       {"jobid":I, "key":s} => JCB object
+ *   job-index.invalidate  {"jobid":I} (no response)
+ *   job-index.list        => {"jobs":[{"jobid":I, "state":i}, ...]}
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+
+struct job {
+    int64_t id;
+    int state;
+    char *path;             /* KVS directory, once known */
+    zhash_t *jcbs;          /* JCB key => JCB json string */
+    unsigned int gen;       /* changes whenever jcbs is cleared */
+};
+
+static unsigned int jcbs_generation = 0;
+
+struct index_ctx {
+    flux_t *h;
+    zhash_t *jobs;          /* jobid => struct job */
+    int hits;
+    int misses;
+};
+
+static int state2num (const char *s)
+{
+    int i;
+    for (i = J_NULL; i <= J_FOR_RENT; i++) {
+        if (!strcmp (jsc_job_num2state (i), s))
+            return i;
+    }
+    return -1;
+}
+
+static void job_destroy (void *arg)
+{
+    struct job *job = arg;
+    if (job) {
+        zhash_destroy (&job->jcbs);
+        free (job->path);
+        free (job);
+    }
+}
+
+static void job_clear_jcbs (struct job *job)
+{
+    zhash_destroy (&job->jcbs);
+    if (!(job->jcbs = zhash_new ()))
+        oom ();
+    job->gen = ++jcbs_generation;
+}
+
+static struct job *job_create (int64_t id, int state)
+{
+    struct job *job = xzmalloc (sizeof (*job));
+    job->id = id;
+    job->state = state;
+    job_clear_jcbs (job);
+    return job;
+}
+
+static struct job *job_lookup (struct index_ctx *ctx, int64_t id)
+{
+    char key[32];
+    snprintf (key, sizeof (key), "%"PRId64, id);
+    return zhash_lookup (ctx->jobs, key);
+}
+
+static void job_insert (struct index_ctx *ctx, struct job *job)
+{
+    char key[32];
+    snprintf (key, sizeof (key), "%"PRId64, job->id);
+    zhash_update (ctx->jobs, key, job);
+    zhash_freefn (ctx->jobs, key, job_destroy);
+}
+
+static void job_remove (struct index_ctx *ctx, int64_t id)
+{
+    char key[32];
+    snprintf (key, sizeof (key), "%"PRId64, id);
+    zhash_delete (ctx->jobs, key);
+}
+
+static void index_ctx_destroy (struct index_ctx *ctx)
+{
+    if (ctx) {
+        zhash_destroy (&ctx->jobs);
+        free (ctx);
+    }
+}
+
+static struct index_ctx *index_ctx_create (flux_t *h)
+{
+    struct index_ctx *ctx = xzmalloc (sizeof (*ctx));
+    ctx->h = h;
+    if (!(ctx->jobs = zhash_new ()))
+        oom ();
+    return ctx;
+}
+
+/* Topics are wreck.state.<state> or jsc.state.<state>.
+ */
+static void state_cb (flux_t *h, flux_msg_handler_t *w,
+                      const flux_msg_t *msg, void *arg)
+{
+    struct index_ctx *ctx = arg;
+    const char *topic;
+    const char *state;
+    int64_t id;
+    int nstate;
+    struct job *job;
+
+    if (flux_event_unpack (msg, &topic, "{s:I}", "lwj", &id) < 0) {
+        flux_log_error (h, "%s: flux_event_unpack", __FUNCTION__);
+        return;
+    }
+    state = strrchr (topic, '.') + 1;
+    /* wrexecd reports "sync" when tasks are stopped in exec for a
+     * debugger.  It is not a JSC state, but the job's KVS directory
+     * has changed, so drop cached JCBs.
+     */
+    if (!strcmp (state, "sync")) {
+        if ((job = job_lookup (ctx, id)))
+            job_clear_jcbs (job);
+        return;
+    }
+    if ((nstate = state2num (state)) < 0) {
+        flux_log (h, LOG_ERR, "%s: unknown state %s", __FUNCTION__, state);
+        return;
+    }
+    if (nstate == J_COMPLETE || nstate == J_FAILED) {
+        job_remove (ctx, id);
+        return;
+    }
+    if ((job = job_lookup (ctx, id))) {
+        job->state = nstate;
+        job_clear_jcbs (job);
+    }
+    else
+        job_insert (ctx, job_create (id, nstate));
+}
+
+static json_t *jcb_from_state (struct job *job, const char *key)
+{
+    if (!strcmp (key, JSC_JOBID))
+        return json_pack ("{s:I}", JSC_JOBID, job->id);
+    if (!strcmp (key, JSC_STATE_PAIR))
+        return json_pack ("{s:{s:I s:I}}",
+                          JSC_STATE_PAIR,
+                            JSC_STATE_PAIR_OSTATE, (int64_t)job->state,
+                            JSC_STATE_PAIR_NSTATE, (int64_t)job->state);
+    return NULL;
+}
+
+/* In-flight KVS read for a job-index.query miss.
+ */
+struct query {
+    struct index_ctx *ctx;
+    flux_msg_t *msg;
+    int64_t id;
+    char *key;
+    bool cacheable;         /* job was indexed at generation 'gen' */
+    unsigned int gen;
+};
+
+static void query_destroy (struct query *q)
+{
+    if (q) {
+        int saved_errno = errno;
+        flux_msg_destroy (q->msg);
+        free (q->key);
+        free (q);
+        errno = saved_errno;
+    }
+}
+
+static struct query *query_create (struct index_ctx *ctx,
+                                   const flux_msg_t *msg, int64_t id,
+                                   const char *key, struct job *job)
+{
+    struct query *q = xzmalloc (sizeof (*q));
+
+    q->ctx = ctx;
+    q->id = id;
+    if (job) {
+        q->cacheable = true;
+        q->gen = job->gen;
+    }
+    q->key = xstrdup (key);
+    if (!(q->msg = flux_msg_copy (msg, true))) {
+        query_destroy (q);
+        return NULL;
+    }
+    return q;
+}
+
+static void query_respond_error (flux_t *h, struct query *q, int errnum)
+{
+    if (errnum == 0 || errnum == ENOSYS)
+        errnum = ENOENT;
+    if (flux_respond (h, q->msg, errnum, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
+static void query_jcb_continuation (flux_future_t *f, void *arg)
+{
+    struct query *q = arg;
+    flux_t *h = q->ctx->h;
+    struct job *job;
+    char *jcb = NULL;
+
+    errno = 0;
+    if (jsc_query_jcb_kvs_get (f, q->id, q->key, &jcb) < 0 || !jcb) {
+        query_respond_error (h, q, errno);
+        goto done;
+    }
+    if (flux_respond (h, q->msg, 0, jcb) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    /* Don't cache if the job changed state or left the index meanwhile,
+     * since this JCB may then be stale.
+     */
+    if (q->cacheable && (job = job_lookup (q->ctx, q->id))
+                     && job->gen == q->gen) {
+        zhash_update (job->jcbs, q->key, jcb);
+        zhash_freefn (job->jcbs, q->key, free);
+        jcb = NULL;
+    }
+done:
+    free (jcb);
+    flux_future_destroy (f);
+    query_destroy (q);
+}
+
+static int query_jcb (struct query *q, const char *path)
+{
+    flux_future_t *f;
+
+    if (!(f = jsc_query_jcb_kvs_lookup (q->ctx->h, path, q->key)))
+        return -1;
+    if (flux_future_then (f, -1., query_jcb_continuation, q) < 0) {
+        flux_future_destroy (f);
+        return -1;
+    }
+    return 0;
+}
+
+static void query_path_continuation (flux_future_t *f, void *arg)
+{
+    struct query *q = arg;
+    flux_t *h = q->ctx->h;
+    struct job *job;
+    const char *path;
+
+    if (flux_rpc_get_unpack (f, "{s:[s]}", "paths", &path) < 0) {
+        query_respond_error (h, q, errno);
+        goto error;
+    }
+    if ((job = job_lookup (q->ctx, q->id)) && !job->path)
+        job->path = xstrdup (path);
+    if (query_jcb (q, path) < 0) {
+        query_respond_error (h, q, errno);
+        goto error;
+    }
+    flux_future_destroy (f);
+    return;
+error:
+    flux_future_destroy (f);
+    query_destroy (q);
+}
+
+/* Resolve the job's KVS directory with job.kvspath unless already known,
+ * then read the JCB attribute from the KVS.
+ */
+static int query_start (struct query *q, struct job *job)
+{
+    flux_future_t *f;
+
+    if (job && job->path)
+        return query_jcb (q, job->path);
+    if (!(f = flux_rpc_pack (q->ctx->h, "job.kvspath", FLUX_NODEID_ANY, 0,
+                             "{s:[I]}", "ids", q->id)))
+        return -1;
+    if (flux_future_then (f, -1., query_path_continuation, q) < 0) {
+        flux_future_destroy (f);
+        return -1;
+    }
+    return 0;
+}
+
+static void query_cb (flux_t *h, flux_msg_handler_t *w,
+                      const flux_msg_t *msg, void *arg)
+{
+    struct index_ctx *ctx = arg;
+    int64_t id;
+    const char *key;
+    struct job *job;
+    const char *cached;
+    struct query *q = NULL;
+    json_t *o;
+
+    if (flux_request_unpack (msg, NULL, "{s:I s:s}",
+                             "jobid", &id, "key", &key) < 0)
+        goto error;
+    if ((job = job_lookup (ctx, id))) {
+        if ((o = jcb_from_state (job, key))) {
+            ctx->hits++;
+            if (flux_respond_pack (h, msg, "O", o) < 0)
+                flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+            json_decref (o);
+            return;
+        }
+        if ((cached = zhash_lookup (job->jcbs, key))) {
+            ctx->hits++;
+            if (flux_respond (h, msg, 0, cached) < 0)
+                flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+            return;
+        }
+    }
+    ctx->misses++;
+    if (!(q = query_create (ctx, msg, id, key, job))
+                                            || query_start (q, job) < 0)
+        goto error;
+    return;
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    query_destroy (q);
+}
+
+static void invalidate_cb (flux_t *h, flux_msg_handler_t *w,
+                           const flux_msg_t *msg, void *arg)
+{
+    struct index_ctx *ctx = arg;
+    struct job *job;
+    int64_t id;
+
+    if (flux_request_unpack (msg, NULL, "{s:I}", "jobid", &id) < 0) {
+        flux_log_error (h, "%s: flux_request_unpack", __FUNCTION__);
+        return;
+    }
+    if ((job = job_lookup (ctx, id)))
+        job_clear_jcbs (job);
+}
+
+static void list_cb (flux_t *h, flux_msg_handler_t *w,
+                     const flux_msg_t *msg, void *arg)
+{
+    struct index_ctx *ctx = arg;
+    struct job *job;
+    json_t *jobs = NULL;
+    json_t *o;
+
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+    if (!(jobs = json_array ()))
+        goto nomem;
+    job = zhash_first (ctx->jobs);
+    while (job) {
+        if (!(o = json_pack ("{s:I s:i}", "jobid", job->id,
+                                          "state", job->state))
+                || json_array_append_new (jobs, o) < 0) {
+            json_decref (o);
+            goto nomem;
+        }
+        job = zhash_next (ctx->jobs);
+    }
+    if (flux_respond_pack (h, msg, "{s:O}", "jobs", jobs) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    json_decref (jobs);
+    return;
+nomem:
+    errno = ENOMEM;
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    json_decref (jobs);
+}
+
+static void stats_get_cb (flux_t *h, flux_msg_handler_t *w,
+                          const flux_msg_t *msg, void *arg)
+{
+    struct index_ctx *ctx = arg;
+
+    if (flux_respond_pack (h, msg, "{s:i s:i s:i}",
+                           "jobs", (int)zhash_size (ctx->jobs),
+                           "hits", ctx->hits,
+                           "misses", ctx->misses) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+}
+
+static void stats_clear_request_cb (flux_t *h, flux_msg_handler_t *w,
+                                    const flux_msg_t *msg, void *arg)
+{
+    struct index_ctx *ctx = arg;
+
+    ctx->hits = ctx->misses = 0;
+    if (flux_respond (h, msg, 0, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
+static struct flux_msg_handler_spec htab[] = {
+    { FLUX_MSGTYPE_EVENT,   "wreck.state.*",          state_cb, 0, NULL },
+    { FLUX_MSGTYPE_EVENT,   "jsc.state.*",            state_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "job-index.query",        query_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "job-index.invalidate",   invalidate_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "job-index.list",         list_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "job-index.stats.get",    stats_get_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "job-index.stats.clear",
+                                            stats_clear_request_cb, 0, NULL },
+    FLUX_MSGHANDLER_TABLE_END,
+};
+
+int mod_main (flux_t *h, int argc, char **argv)
+{
+    int rc = -1;
+    struct index_ctx *ctx = index_ctx_create (h);
+
+    if (flux_event_subscribe (h, "wreck.state.") < 0
+            || flux_event_subscribe (h, "jsc.state.") < 0) {
+        flux_log_error (h, "flux_event_subscribe");
+        goto done;
+    }
+    if (flux_msg_handler_addvec (h, htab, ctx) < 0) {
+        flux_log_error (h, "flux_msg_handler_addvec");
+        goto done;
+    }
+    if ((rc = flux_reactor_run (flux_get_reactor (h), 0)) < 0)
+        flux_log_error (h, "flux_reactor_run");
+    flux_msg_handler_delvec (htab);
+done:
+    index_ctx_destroy (ctx);
+    return rc;
+}
+
+MOD_NAME ("job-index");
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
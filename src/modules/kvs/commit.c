@@ -46,6 +46,7 @@ struct commit_mgr {
     struct cache *cache;
     const char *hash_name;
     int noop_stores;            /* for kvs.stats.get, etc.*/
+    bool store_all;             /* store objects even if already cached */
     zhash_t *fences;
     zlist_t *ready;
     flux_t *h;
@@ -57,6 +58,7 @@ struct commit {
     int aux_errnum;
     fence_t *f;
     int blocked:1;
+    int compared:1;    /* compare ops have all matched */
     json_t *rootcpy;   /* working copy of root dir */
     href_t newroot;
     zlist_t *item_callback_list;
@@ -229,10 +231,20 @@ static int store_cache (commit_t *c, int current_epoch, json_t *o,
         cache_insert (c->cm->cache, ref, hp);
     }
     if (cache_entry_get_valid (hp)) {
-        c->cm->noop_stores++;
         if (is_raw)
             free (data);
-        rc = 0;
+        if (c->cm->store_all && !cache_entry_get_dirty (hp)) {
+            /* cache entry already holds the same data */
+            if (cache_entry_set_dirty (hp, true) < 0) {
+                saved_errno = errno;
+                goto done;
+            }
+            rc = 1;
+        }
+        else {
+            c->cm->noop_stores++;
+            rc = 0;
+        }
     } else {
         if (is_raw) {
             if (cache_entry_set_raw (hp, data, len) < 0) {
@@ -356,10 +368,13 @@ static int commit_unroll (commit_t *c, int current_epoch, json_t *dir)
 }
 
 /* link (key, dirent) into directory 'dir'.
+ * With FLUX_KVS_COMPARE, fail with EAGAIN unless key already has dirent
+ * (or does not exist if dirent is null) and leave the directory unchanged.
  */
 static int commit_link_dirent (commit_t *c, int current_epoch,
                                json_t *rootdir, const char *key,
-                               json_t *dirent, const char **missing_ref)
+                               json_t *dirent, int flags,
+                               const char **missing_ref)
 {
     char *cpy = NULL;
     char *next, *name;
@@ -395,6 +410,10 @@ static int commit_link_dirent (commit_t *c, int current_epoch,
         if (!(dir_entry = treeobj_get_entry (dir, name))) {
             if (json_is_null (dirent)) /* key deletion - it doesn't exist so return */
                 goto success;
+            if ((flags & FLUX_KVS_COMPARE)) {
+                saved_errno = EAGAIN;
+                goto done;
+            }
             if (!(subdir = treeobj_create_dir ())) {
                 saved_errno = errno;
                 goto done;
@@ -469,6 +488,7 @@ static int commit_link_dirent (commit_t *c, int current_epoch,
                                     rootdir,
                                     nkey,
                                     dirent,
+                                    flags,
                                     missing_ref) < 0) {
                 saved_errno = errno;
                 free (nkey);
@@ -479,6 +499,10 @@ static int commit_link_dirent (commit_t *c, int current_epoch,
         } else {
             if (json_is_null (dirent)) /* key deletion - it doesn't exist so return */
                 goto success;
+            if ((flags & FLUX_KVS_COMPARE)) {
+                saved_errno = EAGAIN;
+                goto done;
+            }
             if (!(subdir = treeobj_create_dir ())) {
                 saved_errno = errno;
                 goto done;
@@ -495,7 +519,19 @@ static int commit_link_dirent (commit_t *c, int current_epoch,
     }
     /* This is the final path component of the key.  Add it to the directory.
      */
-    if (!json_is_null (dirent)) {
+    if ((flags & FLUX_KVS_COMPARE)) {
+        if (!(dir_entry = treeobj_get_entry (dir, name))) {
+            if (!json_is_null (dirent)) {
+                saved_errno = EAGAIN;
+                goto done;
+            }
+        }
+        else if (!json_equal (dir_entry, dirent)) {
+            saved_errno = EAGAIN;
+            goto done;
+        }
+    }
+    else if (!json_is_null (dirent)) {
         if (treeobj_insert_entry (dir, name, dirent) < 0) {
             saved_errno = errno;
             goto done;
@@ -567,39 +603,55 @@ commit_process_t commit_process (commit_t *c,
              * dirref objects to dir objects in the copy.  This allows
              * the commit to be self-contained in the rootcpy until it
              * is unrolled later on.
+             *
+             * Compare ops are all checked first, in a pass of their own,
+             * since updates may be applied again after a stalled load and
+             * must not be seen by a compare.
              */
             if (fence_get_json_ops (c->f)) {
                 json_t *op, *key, *dirent;
                 const char *missing_ref = NULL;
                 json_t *ops = fence_get_json_ops (c->f);
                 int i, len = json_array_size (ops);
+                int pass;
 
                 /* Caller didn't call commit_iter_missing_refs() */
                 if (zlist_first (c->item_callback_list))
                     goto stall_load;
 
-                for (i = 0; i < len; i++) {
-                    missing_ref = NULL;
-                    if (!(op = json_array_get (ops, i))
-                        || !(key = json_object_get (op, "key"))
-                        || !(dirent = json_object_get (op, "dirent")))
-                        continue;
-                    if (commit_link_dirent (c,
-                                            current_epoch,
-                                            c->rootcpy,
-                                            json_string_value (key),
-                                            dirent,
-                                            &missing_ref) < 0) {
-                        c->errnum = errno;
-                        break;
-                    }
-                    if (missing_ref) {
-                        if (zlist_push (c->item_callback_list,
-                                        (void *)missing_ref) < 0) {
-                            c->errnum = ENOMEM;
+                for (pass = c->compared ? 1 : 0; pass < 2; pass++) {
+                    for (i = 0; i < len; i++) {
+                        int flags;
+                        missing_ref = NULL;
+                        if (!(op = json_array_get (ops, i))
+                            || !(key = json_object_get (op, "key"))
+                            || !(dirent = json_object_get (op, "dirent")))
+                            continue;
+                        flags = json_integer_value (json_object_get (op,
+                                                                     "flags"));
+                        if ((pass == 0) != ((flags & FLUX_KVS_COMPARE) != 0))
+                            continue;
+                        if (commit_link_dirent (c,
+                                                current_epoch,
+                                                c->rootcpy,
+                                                json_string_value (key),
+                                                dirent,
+                                                flags,
+                                                &missing_ref) < 0) {
+                            c->errnum = errno;
                             break;
                         }
+                        if (missing_ref) {
+                            if (zlist_push (c->item_callback_list,
+                                            (void *)missing_ref) < 0) {
+                                c->errnum = ENOMEM;
+                                break;
+                            }
+                        }
                     }
+                    if (c->errnum != 0 || zlist_first (c->item_callback_list))
+                        break;
+                    c->compared = 1;
                 }
 
                 if (c->errnum != 0) {
@@ -862,6 +914,11 @@ void commit_mgr_clear_noop_stores (commit_mgr_t *cm)
     cm->noop_stores = 0;
 }
 
+void commit_mgr_set_store_all (commit_mgr_t *cm, bool store_all)
+{
+    cm->store_all = store_all;
+}
+
 /* Merge ready commits that are mergeable, where merging consists of
  * popping the "donor" commit off the ready list, and appending its
  * ops to the top commit.  The top commit can be appended to if it
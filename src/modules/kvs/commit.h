@@ -139,6 +139,13 @@ void commit_mgr_remove_fence (commit_mgr_t *cm, const char *name);
 int commit_mgr_get_noop_stores (commit_mgr_t *cm);
 void commit_mgr_clear_noop_stores (commit_mgr_t *cm);
 
+/* While 'store_all' is true, every object a commit writes is sent to the
+ * content store, even if an identical object is already valid in cache.
+ * A garbage collection of the content backing store sets this so that it
+ * learns of every blob that is put back into use.
+ */
+void commit_mgr_set_store_all (commit_mgr_t *cm, bool store_all);
+
 /* In internally stored ready commits (moved to ready status via
  * commit_mgr_process_fence_request()), merge them if they are capable
  * of being merged.
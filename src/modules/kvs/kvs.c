@@ -80,9 +80,12 @@ typedef struct {
     flux_watcher_t *check_w;
     int commit_merge;
     const char *hash_name;
+    flux_msg_t *gc_request;     /* kvs.gc waiting for gc_commit to finish */
+    commit_t *gc_commit;
 } kvs_ctx_t;
 
 static int setroot_event_send (kvs_ctx_t *ctx, json_t *names);
+static void gc_respond (kvs_ctx_t *ctx, const flux_msg_t *msg);
 static int error_event_send (kvs_ctx_t *ctx, json_t *names, int errnum);
 static void commit_prep_cb (flux_reactor_t *r, flux_watcher_t *w,
                             int revents, void *arg);
@@ -100,6 +103,7 @@ static void freectx (void *arg)
         flux_watcher_destroy (ctx->prep_w);
         flux_watcher_destroy (ctx->check_w);
         flux_watcher_destroy (ctx->idle_w);
+        flux_msg_destroy (ctx->gc_request);
         free (ctx);
     }
 }
@@ -611,6 +615,12 @@ done:
      * N.B. fence_t remains in the fences hash until event is received.
      */
     commit_mgr_remove_commit (ctx->cm, c);
+    if (ctx->gc_request && ctx->gc_commit == c) {
+        gc_respond (ctx, ctx->gc_request);
+        flux_msg_destroy (ctx->gc_request);
+        ctx->gc_request = NULL;
+        ctx->gc_commit = NULL;
+    }
     return;
 
 stall:
@@ -712,11 +722,33 @@ static void heartbeat_cb (flux_t *h, flux_msg_handler_t *w,
         flux_log_error (ctx->h, "%s: cache_expire_entries", __FUNCTION__);
 }
 
+struct lookup_cb_data {
+    kvs_ctx_t *ctx;
+    wait_t *wait;
+};
+
+static int lookup_load_cb (lookup_t *lh, const char *ref, bool raw,
+                           void *data)
+{
+    struct lookup_cb_data *cbd = data;
+    bool stall;
+
+    if (load (cbd->ctx, ref, raw, cbd->wait, &stall) < 0) {
+        flux_log_error (cbd->ctx->h, "%s: load", __FUNCTION__);
+        return -1;
+    }
+    /* if not stalling, logic issue within code */
+    assert (stall);
+    return 0;
+}
+
 static void get_request_cb (flux_t *h, flux_msg_handler_t *w,
                             const flux_msg_t *msg, void *arg)
 {
     kvs_ctx_t *ctx = NULL;
     int flags;
+    int maxdepth = -1;
+    int maxsize = 0;
     const char *key;
     json_t *val = NULL;
     json_t *root_dirent = NULL;
@@ -742,6 +774,12 @@ static void get_request_cb (flux_t *h, flux_msg_handler_t *w,
         (void)flux_request_unpack (msg, NULL, "{ s:o }",
                                    "rootdir", &root_dirent);
 
+        /* maxdepth, maxsize are optional (FLUX_KVS_RECURSIVE only) */
+        (void)flux_request_unpack (msg, NULL, "{ s:i }",
+                                   "maxdepth", &maxdepth);
+        (void)flux_request_unpack (msg, NULL, "{ s:i }",
+                                   "maxsize", &maxsize);
+
         /* If root dirent was specified, lookup corresponding 'root' directory.
          * Otherwise, use the current root.
          */
@@ -765,6 +803,9 @@ static void get_request_cb (flux_t *h, flux_msg_handler_t *w,
 
         ret = lookup_set_aux_data (lh, ctx);
         assert (ret == 0);
+
+        ret = lookup_set_limits (lh, maxdepth, maxsize);
+        assert (ret == 0);
     }
     else {
         lh = arg;
@@ -777,20 +818,18 @@ static void get_request_cb (flux_t *h, flux_msg_handler_t *w,
     }
 
     if (!lookup (lh)) {
-        const char *missing_ref;
-        bool ref_raw, stall;
-
-        missing_ref = lookup_get_missing_ref (lh, &ref_raw);
-        assert (missing_ref);
+        struct lookup_cb_data cbd;
 
         if (!(wait = wait_create_msg_handler (h, w, msg, get_request_cb, lh)))
             goto done;
-        if (load (ctx, missing_ref, ref_raw, wait, &stall) < 0) {
-            flux_log_error (h, "%s: load", __FUNCTION__);
+        cbd.ctx = ctx;
+        cbd.wait = wait;
+        if (lookup_iter_missing_refs (lh, lookup_load_cb, &cbd) < 0) {
+            /* loads already in flight, retry lookup when they complete */
+            if (wait_get_usecount (wait) > 0)
+                goto stall;
             goto done;
         }
-        /* if not stalling, logic issue within code */
-        assert (stall);
         goto stall;
     }
     if (lookup_get_errnum (lh) != 0) {
@@ -1277,6 +1316,93 @@ error:
         flux_log_error (h, "%s: flux_respond", __FUNCTION__);
 }
 
+static void gc_respond (kvs_ctx_t *ctx, const flux_msg_t *msg)
+{
+    if (flux_respond_pack (ctx->h, msg, "{ s:i s:s }",
+                           "rootseq", ctx->rootseq,
+                           "rootdir", ctx->rootdir) < 0)
+        flux_log_error (ctx->h, "%s: flux_respond_pack", __FUNCTION__);
+}
+
+/* The content backing store brackets a garbage collection with these
+ * requests (rank 0 only).  While active, commits store every object they
+ * write, so the collector learns of blobs put back into use.  A commit
+ * already in progress may have skipped such stores, so the response,
+ * carrying the root to be marked, is held until that commit has set it.
+ */
+static void gc_request_cb (flux_t *h, flux_msg_handler_t *w,
+                           const flux_msg_t *msg, void *arg)
+{
+    kvs_ctx_t *ctx = arg;
+    commit_t *c;
+    int active;
+
+    if (flux_request_unpack (msg, NULL, "{ s:b }", "active", &active) < 0)
+        goto error;
+    if (ctx->rank != 0) {
+        errno = EPROTO;
+        goto error;
+    }
+    if (ctx->gc_request) {
+        if (active) {
+            errno = EBUSY;
+            goto error;
+        }
+        /* collection ended before the held request was answered */
+        if (flux_respond (h, ctx->gc_request, ECANCELED, NULL) < 0)
+            flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+        flux_msg_destroy (ctx->gc_request);
+        ctx->gc_request = NULL;
+        ctx->gc_commit = NULL;
+    }
+    commit_mgr_set_store_all (ctx->cm, active ? true : false);
+    if (active && (c = commit_mgr_get_ready_commit (ctx->cm))) {
+        if (!(ctx->gc_request = flux_msg_copy (msg, false)))
+            goto error;
+        ctx->gc_commit = c;
+        return;
+    }
+    gc_respond (ctx, msg);
+    return;
+
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
+/* The content backing store has deleted these blobs.  Drop them from
+ * cache so that a commit reusing one stores it again (rank 0 only).
+ */
+static void drop_request_cb (flux_t *h, flux_msg_handler_t *w,
+                             const flux_msg_t *msg, void *arg)
+{
+    kvs_ctx_t *ctx = arg;
+    json_t *blobrefs;
+    json_t *o;
+    size_t index;
+    int count = 0;
+
+    if (flux_request_unpack (msg, NULL, "{ s:o }", "blobrefs", &blobrefs) < 0)
+        goto error;
+    if (ctx->rank != 0 || !json_is_array (blobrefs)) {
+        errno = EPROTO;
+        goto error;
+    }
+    json_array_foreach (blobrefs, index, o) {
+        if (json_is_string (o))
+            count += cache_remove_entry (ctx->cache, json_string_value (o));
+    }
+    flux_log (h, LOG_DEBUG, "dropped %d of %d deleted objects", count,
+              (int)json_array_size (blobrefs));
+    if (flux_respond (h, msg, 0, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    return;
+
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
 static int getroot_rpc (kvs_ctx_t *ctx, int *rootseq, href_t rootdir)
 {
     flux_future_t *f;
@@ -1585,6 +1711,8 @@ static struct flux_msg_handler_spec handlers[] = {
     { FLUX_MSGTYPE_EVENT,   "kvs.setroot",    setroot_event_cb, 0, NULL },
     { FLUX_MSGTYPE_EVENT,   "kvs.error",      error_event_cb, 0, NULL },
     { FLUX_MSGTYPE_REQUEST, "kvs.getroot",    getroot_request_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "kvs.gc",         gc_request_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "kvs.drop",       drop_request_cb, 0, NULL },
     { FLUX_MSGTYPE_REQUEST, "kvs.dropcache",  dropcache_request_cb, 0, NULL },
     { FLUX_MSGTYPE_EVENT,   "kvs.dropcache",  dropcache_event_cb, 0, NULL },
     { FLUX_MSGTYPE_EVENT,   "hb",             heartbeat_cb, 0, NULL },
@@ -76,6 +76,10 @@ struct lookup {
 
     void *aux;
 
+    /* limits for FLUX_KVS_RECURSIVE */
+    int maxdepth;               /* < 0 means unlimited */
+    int maxsize;                /* <= 0 means unlimited */
+
     /* potential return values from lookup */
     json_t *val;           /* value of lookup */
     const char *missing_ref;    /* on stall, missing ref to load */
@@ -86,15 +90,23 @@ struct lookup {
     json_t *root_dirent;
     zlist_t *levels;
     json_t *wdirent;       /* result after walk() */
+    zlist_t *missing_refs; /* on expand stall, all missing refs */
+    int size;              /* bytes of value data inlined by expand() */
     enum {
         LOOKUP_STATE_INIT,
         LOOKUP_STATE_CHECK_ROOT,
         LOOKUP_STATE_WALK,
         LOOKUP_STATE_VALUE,
+        LOOKUP_STATE_EXPAND,
         LOOKUP_STATE_FINISHED,
     } state;
 };
 
+struct missing_ref {
+    char *ref;
+    bool raw;
+};
+
 static bool last_pathcomp (zlist_t *pathcomps, const void *data)
 {
     return (zlist_tail (pathcomps) == data);
@@ -374,6 +386,176 @@ stall:
     return false;
 }
 
+static void missing_ref_destroy (void *data)
+{
+    struct missing_ref *mr = data;
+    if (mr) {
+        free (mr->ref);
+        free (mr);
+    }
+}
+
+static int missing_ref_add (lookup_t *lh, const char *ref, bool raw)
+{
+    struct missing_ref *mr;
+
+    if (!(mr = calloc (1, sizeof (*mr))) || !(mr->ref = strdup (ref))) {
+        missing_ref_destroy (mr);
+        errno = ENOMEM;
+        return -1;
+    }
+    mr->raw = raw;
+    if (zlist_append (lh->missing_refs, mr) < 0) {
+        missing_ref_destroy (mr);
+        errno = ENOMEM;
+        return -1;
+    }
+    zlist_freefn (lh->missing_refs, mr, missing_ref_destroy, true);
+    return 0;
+}
+
+/* Get cache entry for single-blobref 'ref'.  If not (yet) valid, add it
+ * to missing_refs and return NULL with errno = 0.
+ */
+static struct cache_entry *expand_get_entry (lookup_t *lh, json_t *ref,
+                                             bool raw)
+{
+    struct cache_entry *hp;
+    const char *blobref;
+    int refcount;
+
+    if ((refcount = treeobj_get_count (ref)) < 0)
+        return NULL;
+    if (refcount != 1) {
+        flux_log (lh->h, LOG_ERR, "invalid %s count: %d",
+                  raw ? "valref" : "dirref", refcount);
+        errno = EPERM;
+        return NULL;
+    }
+    if (!(blobref = treeobj_get_blobref (ref, 0)))
+        return NULL;
+    if (!(hp = cache_lookup (lh->cache, blobref, lh->current_epoch))
+        || !cache_entry_get_valid (hp)) {
+        if (missing_ref_add (lh, blobref, raw) < 0)
+            return NULL;
+        errno = 0;
+        return NULL;
+    }
+    return hp;
+}
+
+/* Copy directory 'dir', replacing dirrefs with the directories they
+ * reference (down to lh->maxdepth) and valrefs with vals.  Rather than
+ * stopping at the first missing reference, collect them all so they
+ * may be loaded in parallel.  The returned copy is only complete if
+ * lh->missing_refs is empty.
+ */
+static json_t *expand_dir (lookup_t *lh, json_t *dir, int depth)
+{
+    json_t *cpy;
+    json_t *data;
+    json_t *dirent;
+    const char *name;
+    int saved_errno;
+
+    if (!(cpy = treeobj_create_dir ()))
+        return NULL;
+    if (!(data = treeobj_get_data (dir)))
+        goto error;
+    json_object_foreach (data, name, dirent) {
+        json_t *ndirent = NULL;
+        struct cache_entry *hp;
+
+        if ((treeobj_is_dirref (dirent) || treeobj_is_dir (dirent))
+                && (lh->maxdepth < 0 || depth < lh->maxdepth)) {
+            json_t *subdir = dirent;
+            if (treeobj_is_dirref (dirent)) {
+                if (!(hp = expand_get_entry (lh, dirent, false))) {
+                    if (errno != 0)
+                        goto error;
+                    continue;
+                }
+                if (!(subdir = cache_entry_get_json (hp))
+                    || !treeobj_is_dir (subdir)) {
+                    flux_log (lh->h, LOG_ERR, "dirref points to non-dir");
+                    errno = EPERM;
+                    goto error;
+                }
+            }
+            if (!(ndirent = expand_dir (lh, subdir, depth + 1)))
+                goto error;
+        }
+        else if (treeobj_is_valref (dirent)) {
+            void *valdata;
+            int len;
+
+            if (!(hp = expand_get_entry (lh, dirent, true))) {
+                if (errno != 0)
+                    goto error;
+                continue;
+            }
+            if (!(valdata = cache_entry_get_raw (hp, &len))) {
+                flux_log (lh->h, LOG_ERR, "valref points to non-raw data");
+                errno = EPERM;
+                goto error;
+            }
+            if (!(ndirent = treeobj_create_val (valdata, len)))
+                goto error;
+            lh->size += len;
+        }
+        else {
+            /* base64 encoded val is roughly 4/3 the decoded size */
+            if (treeobj_is_val (dirent))
+                lh->size += json_string_length (treeobj_get_data (dirent))
+                            / 4 * 3;
+            ndirent = json_incref (dirent);
+        }
+        if (treeobj_insert_entry (cpy, name, ndirent) < 0) {
+            json_decref (ndirent);
+            goto error;
+        }
+        json_decref (ndirent);
+        if (lh->maxsize > 0 && lh->size > lh->maxsize) {
+            errno = EFBIG;
+            goto error;
+        }
+    }
+    return cpy;
+error:
+    saved_errno = errno;
+    json_decref (cpy);
+    errno = saved_errno;
+    return NULL;
+}
+
+/* Expand lh->val (a directory) in place for FLUX_KVS_RECURSIVE.
+ *
+ * Return true on success or error, error code is returned in
+ * lh->errnum.  Return false on stall, with all missing references
+ * available via lookup_iter_missing_refs().
+ */
+static bool expand (lookup_t *lh)
+{
+    json_t *cpy;
+    struct missing_ref *mr;
+
+    zlist_purge (lh->missing_refs);
+    lh->size = 0;
+    if (!(cpy = expand_dir (lh, lh->val, 0))) {
+        lh->errnum = errno;
+        return true;
+    }
+    if ((mr = zlist_first (lh->missing_refs))) {
+        json_decref (cpy);
+        lh->missing_ref = mr->ref;
+        lh->missing_ref_raw = mr->raw;
+        return false;
+    }
+    json_decref (lh->val);
+    lh->val = cpy;
+    return true;
+}
+
 lookup_t *lookup_create (struct cache *cache,
                          int current_epoch,
                          const char *root_dir,
@@ -421,6 +603,8 @@ lookup_t *lookup_create (struct cache *cache,
     }
     lh->h = h;
     lh->flags = flags;
+    lh->maxdepth = -1;
+    lh->maxsize = 0;
 
     lh->aux = NULL;
 
@@ -439,6 +623,11 @@ lookup_t *lookup_create (struct cache *cache,
         goto cleanup;
     }
 
+    if (!(lh->missing_refs = zlist_new ())) {
+        saved_errno = ENOMEM;
+        goto cleanup;
+    }
+
     /* first depth is level 0 */
     if (!walk_levels_push (lh, lh->path, 0)) {
         saved_errno = errno;
@@ -465,6 +654,7 @@ void lookup_destroy (lookup_t *lh)
         json_decref (lh->val);
         json_decref (lh->root_dirent);
         zlist_destroy (&lh->levels);
+        zlist_destroy (&lh->missing_refs);
         lh->magic = ~LOOKUP_MAGIC;
         free (lh);
     }
@@ -484,7 +674,8 @@ int lookup_get_errnum (lookup_t *lh)
             return lh->errnum;
         if (lh->state == LOOKUP_STATE_CHECK_ROOT
             || lh->state == LOOKUP_STATE_WALK
-            || lh->state == LOOKUP_STATE_VALUE)
+            || lh->state == LOOKUP_STATE_VALUE
+            || lh->state == LOOKUP_STATE_EXPAND)
             return EAGAIN;
     }
     return EINVAL;
@@ -506,7 +697,8 @@ const char *lookup_get_missing_ref (lookup_t *lh, bool *ref_raw)
         && lh->magic == LOOKUP_MAGIC
         && (lh->state == LOOKUP_STATE_CHECK_ROOT
             || lh->state == LOOKUP_STATE_WALK
-            || lh->state == LOOKUP_STATE_VALUE)) {
+            || lh->state == LOOKUP_STATE_VALUE
+            || lh->state == LOOKUP_STATE_EXPAND)) {
         if (ref_raw)
             (*ref_raw) = lh->missing_ref_raw;
         return lh->missing_ref;
@@ -514,6 +706,31 @@ const char *lookup_get_missing_ref (lookup_t *lh, bool *ref_raw)
     return NULL;
 }
 
+int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data)
+{
+    struct missing_ref *mr;
+
+    if (!lh || lh->magic != LOOKUP_MAGIC || !cb) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (lh->state == LOOKUP_STATE_EXPAND) {
+        mr = zlist_first (lh->missing_refs);
+        while (mr) {
+            if (cb (lh, mr->ref, mr->raw, data) < 0)
+                return -1;
+            mr = zlist_next (lh->missing_refs);
+        }
+        return 0;
+    }
+    if (lh->state == LOOKUP_STATE_CHECK_ROOT
+        || lh->state == LOOKUP_STATE_WALK
+        || lh->state == LOOKUP_STATE_VALUE)
+        return cb (lh, lh->missing_ref, lh->missing_ref_raw, data);
+    errno = EINVAL;
+    return -1;
+}
+
 struct cache *lookup_get_cache (lookup_t *lh)
 {
     if (lh && lh->magic == LOOKUP_MAGIC)
@@ -572,6 +789,16 @@ int lookup_set_current_epoch (lookup_t *lh, int epoch)
     return -1;
 }
 
+int lookup_set_limits (lookup_t *lh, int maxdepth, int maxsize)
+{
+    if (lh && lh->magic == LOOKUP_MAGIC) {
+        lh->maxdepth = maxdepth;
+        lh->maxsize = maxsize;
+        return 0;
+    }
+    return -1;
+}
+
 int lookup_set_aux_data (lookup_t *lh, void *data)
 {
     if (lh && lh->magic == LOOKUP_MAGIC) {
@@ -628,6 +855,11 @@ bool lookup (lookup_t *lh)
                         goto done;
                     }
                     lh->val = json_incref (valtmp);
+                    if ((lh->flags & FLUX_KVS_RECURSIVE)) {
+                        lh->state = LOOKUP_STATE_EXPAND;
+                        if (!expand (lh))
+                            goto stall;
+                    }
                 }
                 goto done;
             }
@@ -773,6 +1005,14 @@ bool lookup (lookup_t *lh)
                 goto done;
             }
             /* val now contains the requested object (copied) */
+            if (!(lh->flags & FLUX_KVS_RECURSIVE)
+                || !treeobj_is_dir (lh->val))
+                break;
+            lh->state = LOOKUP_STATE_EXPAND;
+            /* fallthrough */
+        case LOOKUP_STATE_EXPAND:
+            if (!expand (lh))
+                goto stall;
             break;
         case LOOKUP_STATE_FINISHED:
             break;
@@ -6,6 +6,9 @@
 
 typedef struct lookup lookup_t;
 
+typedef int (*lookup_ref_f)(lookup_t *lh, const char *ref, bool raw,
+                            void *data);
+
 /* Initialize a lookup handle
  * - If root_ref is same as root_dir, can be set to NULL.
  * - flux_t is optional, if NULL logging will go to stderr
@@ -41,6 +44,14 @@ json_t *lookup_get_value (lookup_t *lh);
  */
 const char *lookup_get_missing_ref (lookup_t *lh, bool *ref_raw);
 
+/* On lookup stall, iterate through all missing refs that the caller
+ * should load before retrying.  Usually there is only one, but
+ * FLUX_KVS_RECURSIVE lookups return all refs missing from the subtree.
+ *
+ * return -1 in callback to break iteration
+ */
+int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data);
+
 /* Convenience function to get cache from earlier instantiation.
  * Convenient if replaying RPC and don't have it presently.
  */
@@ -79,6 +90,14 @@ void *lookup_get_aux_data (lookup_t *lh);
  * be new */
 int lookup_set_current_epoch (lookup_t *lh, int epoch);
 
+/* Bound the subtree returned by a FLUX_KVS_RECURSIVE lookup.
+ * Directories more than 'maxdepth' levels below the requested one are
+ * returned as dirrefs (maxdepth < 0 is unlimited).  If inlined values
+ * exceed 'maxsize' bytes, the lookup fails with EFBIG (maxsize <= 0 is
+ * unlimited).
+ */
+int lookup_set_limits (lookup_t *lh, int maxdepth, int maxsize);
+
 /* Set auxiliarry data for convenience.  User is responsible for
  * freeing data.
  */
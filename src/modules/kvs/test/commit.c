@@ -1132,6 +1132,152 @@ void commit_process_follow_link (void) {
     cache_destroy (cache);
 }
 
+/* Append { "key" : key, "flags" : FLUX_KVS_COMPARE, "dirent" : dirent }
+ * to a json array, where dirent may be NULL.
+ */
+void ops_append_compare (json_t *array, const char *key, json_t *dirent)
+{
+    json_t *op;
+
+    op = json_pack ("{s:s s:i s:O}", "key", key,
+                                     "flags", FLUX_KVS_COMPARE,
+                                     "dirent", dirent ? dirent : json_null ());
+    json_array_append_new (array, op);
+}
+
+void create_ready_compare_commit (commit_mgr_t *cm,
+                                  const char *name,
+                                  const char *compare_key,
+                                  json_t *compare_dirent,
+                                  const char *key,
+                                  const char *val)
+{
+    fence_t *f;
+    json_t *ops;
+
+    ok ((f = fence_create (name, 1, FLUX_KVS_NO_MERGE)) != NULL,
+        "fence_create works");
+
+    ops = json_array ();
+    ops_append (ops, key, val);
+    ops_append_compare (ops, compare_key, compare_dirent);
+
+    ok (fence_add_request_data (f, ops) == 0,
+        "fence_add_request_data add works");
+
+    json_decref (ops);
+
+    ok (commit_mgr_add_fence (cm, f) == 0,
+        "commit_mgr_add_fence works");
+
+    ok (commit_mgr_process_fence_request (cm, f) == 0,
+        "commit_mgr_process_fence_request works");
+}
+
+void commit_process_compare (void) {
+    struct cache *cache;
+    commit_mgr_t *cm;
+    commit_t *c;
+    json_t *root;
+    json_t *dir;
+    json_t *dirref;
+    href_t root_ref;
+    href_t dir_ref;
+    href_t newroot;
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+
+    /* This root is
+     *
+     * root_ref
+     * "dir" : dirref to dir_ref
+     *
+     * dir_ref
+     * "val" : val w/ "42"
+     *
+     */
+
+    dir = treeobj_create_dir ();
+    treeobj_insert_entry (dir, "val", treeobj_create_val ("42", 2));
+
+    ok (kvs_util_json_hash ("sha1", dir, dir_ref) == 0,
+        "kvs_util_json_hash worked");
+
+    cache_insert (cache, dir_ref, cache_entry_create_json (dir));
+
+    dirref = treeobj_create_dirref (dir_ref);
+    root = treeobj_create_dir ();
+    treeobj_insert_entry (root, "dir", json_incref (dirref));
+
+    ok (kvs_util_json_hash ("sha1", root, root_ref) == 0,
+        "kvs_util_json_hash worked");
+
+    cache_insert (cache, root_ref, cache_entry_create_json (root));
+
+    ok ((cm = commit_mgr_create (cache, "sha1", NULL, &test_global)) != NULL,
+        "commit_mgr_create works");
+
+    /* compare is checked before the update listed ahead of it */
+    create_ready_compare_commit (cm, "fence1", "dir", dirref, "dir.val", "52");
+
+    ok ((c = commit_mgr_get_ready_commit (cm)) != NULL,
+        "commit_mgr_get_ready_commit returns ready commit");
+
+    ok (commit_process (c, 1, root_ref) == COMMIT_PROCESS_DIRTY_CACHE_ENTRIES,
+        "commit_process returns COMMIT_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (commit_iter_dirty_cache_entries (c, cache_noop_cb, NULL) == 0,
+        "commit_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (commit_process (c, 1, root_ref) == COMMIT_PROCESS_FINISHED,
+        "commit_process returns COMMIT_PROCESS_FINISHED");
+
+    ok (commit_get_newroot_ref (c) != NULL,
+        "commit_get_newroot_ref returns != NULL when processing complete");
+    strcpy (newroot, commit_get_newroot_ref (c));
+
+    verify_value (cache, newroot, "dir.val", "52");
+
+    commit_mgr_remove_commit (cm, c);
+
+    /* "dir" has changed, so comparing with the old dirref fails */
+    create_ready_compare_commit (cm, "fence2", "dir", dirref, "dir.val", "53");
+
+    ok ((c = commit_mgr_get_ready_commit (cm)) != NULL,
+        "commit_mgr_get_ready_commit returns ready commit");
+
+    ok (commit_process (c, 1, newroot) == COMMIT_PROCESS_ERROR,
+        "commit_process returns COMMIT_PROCESS_ERROR on stale compare");
+
+    ok (commit_get_errnum (c) == EAGAIN,
+        "commit_get_errnum return EAGAIN");
+
+    commit_mgr_remove_commit (cm, c);
+
+    /* a missing key matches a null compare */
+    create_ready_compare_commit (cm, "fence3", "dir.noent", NULL,
+                                 "dir.val", "54");
+
+    ok ((c = commit_mgr_get_ready_commit (cm)) != NULL,
+        "commit_mgr_get_ready_commit returns ready commit");
+
+    ok (commit_process (c, 1, newroot) == COMMIT_PROCESS_DIRTY_CACHE_ENTRIES,
+        "commit_process returns COMMIT_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (commit_iter_dirty_cache_entries (c, cache_noop_cb, NULL) == 0,
+        "commit_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (commit_process (c, 1, newroot) == COMMIT_PROCESS_FINISHED,
+        "commit_process returns COMMIT_PROCESS_FINISHED");
+
+    verify_value (cache, commit_get_newroot_ref (c), "dir.val", "54");
+
+    json_decref (dirref);
+    commit_mgr_destroy (cm);
+    cache_destroy (cache);
+}
+
 void commit_process_dirval_test (void) {
     struct cache *cache;
     commit_mgr_t *cm;
@@ -1642,6 +1788,70 @@ void commit_process_giant_dir (void) {
     cache_destroy (cache);
 }
 
+/* Commit a value equal to the one already in the cached tree, so that
+ * every object the commit writes is already valid in cache.
+ */
+void commit_process_store_all (bool store_all)
+{
+    struct cache *cache;
+    commit_mgr_t *cm;
+    commit_t *c;
+    json_t *root;
+    json_t *dir;
+    href_t root_ref;
+    href_t dir_ref;
+    int count = 0;
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+
+    dir = treeobj_create_dir ();
+    treeobj_insert_entry (dir, "val", treeobj_create_val ("42", 2));
+    ok (kvs_util_json_hash ("sha1", dir, dir_ref) == 0,
+        "kvs_util_json_hash worked");
+    cache_insert (cache, dir_ref, cache_entry_create_json (dir));
+
+    root = treeobj_create_dir ();
+    treeobj_insert_entry (root, "dir", treeobj_create_dirref (dir_ref));
+    ok (kvs_util_json_hash ("sha1", root, root_ref) == 0,
+        "kvs_util_json_hash worked");
+    cache_insert (cache, root_ref, cache_entry_create_json (root));
+
+    ok ((cm = commit_mgr_create (cache, "sha1", NULL, &test_global)) != NULL,
+        "commit_mgr_create works");
+    commit_mgr_set_store_all (cm, store_all);
+
+    create_ready_commit (cm, "fence1", "dir.val", "42", 0);
+
+    ok ((c = commit_mgr_get_ready_commit (cm)) != NULL,
+        "commit_mgr_get_ready_commit returns ready commit");
+
+    if (store_all) {
+        ok (commit_process (c, 1, root_ref)
+                                    == COMMIT_PROCESS_DIRTY_CACHE_ENTRIES,
+            "with store_all, commit_process stores objects already cached");
+        ok (commit_iter_dirty_cache_entries (c, cache_count_dirty_cb,
+                                             &count) == 0
+            && count == 2,
+            "both the directory and root are to be stored");
+        ok (commit_mgr_get_noop_stores (cm) == 0,
+            "no stores were skipped");
+        ok (commit_process (c, 1, root_ref) == COMMIT_PROCESS_FINISHED,
+            "commit_process returns COMMIT_PROCESS_FINISHED");
+    }
+    else {
+        ok (commit_process (c, 1, root_ref) == COMMIT_PROCESS_FINISHED,
+            "commit_process skips storing objects already cached");
+        ok (commit_mgr_get_noop_stores (cm) == 2,
+            "both the directory and root stores were skipped");
+    }
+    ok (strcmp (commit_get_newroot_ref (c), root_ref) == 0,
+        "commit_get_newroot_ref returns the unchanged root");
+
+    commit_mgr_destroy (cm);
+    cache_destroy (cache);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -1663,6 +1873,7 @@ int main (int argc, char *argv[])
     commit_process_invalid_operation ();
     commit_process_invalid_hash ();
     commit_process_follow_link ();
+    commit_process_compare ();
     commit_process_dirval_test ();
     commit_process_delete_test ();
     commit_process_delete_nosubdir_test ();
@@ -1670,6 +1881,8 @@ int main (int argc, char *argv[])
     commit_process_bad_dirrefs ();
     commit_process_big_fileval ();
     commit_process_giant_dir ();
+    commit_process_store_all (false);
+    commit_process_store_all (true);
 
     done_testing ();
     return (0);
@@ -1354,6 +1354,145 @@ void lookup_stall (void) {
     cache_destroy (cache);
 }
 
+static int count_ref_cb (lookup_t *lh, const char *ref, bool raw, void *data)
+{
+    int *count = data;
+    (*count)++;
+    return 0;
+}
+
+/* lookup tests with FLUX_KVS_RECURSIVE */
+void lookup_recursive (void) {
+    json_t *root;
+    json_t *dirref1;
+    json_t *dirref2;
+    json_t *test;
+    json_t *subdir;
+    struct cache *cache;
+    lookup_t *lh;
+    href_t valref_ref;
+    href_t dirref1_ref;
+    href_t dirref2_ref;
+    href_t root_ref;
+    int count;
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+
+    /* This cache is
+     *
+     * valref_ref
+     * "abcd"
+     *
+     * dirref1_ref
+     * "val" : val to "foo"
+     * "valref" : valref to valref_ref
+     *
+     * dirref2_ref
+     * "val" : val to "bar"
+     *
+     * root_ref
+     * "symlink" : symlink to "dirref2"
+     * "dirref1" : dirref to dirref1_ref
+     * "dirref2" : dirref to dirref2_ref
+     * "val" : val to "baz"
+     */
+
+    blobref_hash ("sha1", "abcd", 4, valref_ref, sizeof (href_t));
+
+    dirref1 = treeobj_create_dir ();
+    treeobj_insert_entry (dirref1, "val", treeobj_create_val ("foo", 3));
+    treeobj_insert_entry (dirref1, "valref", treeobj_create_valref (valref_ref));
+    kvs_util_json_hash ("sha1", dirref1, dirref1_ref);
+
+    dirref2 = treeobj_create_dir ();
+    treeobj_insert_entry (dirref2, "val", treeobj_create_val ("bar", 3));
+    kvs_util_json_hash ("sha1", dirref2, dirref2_ref);
+
+    root = treeobj_create_dir ();
+    treeobj_insert_entry (root, "dirref1", treeobj_create_dirref (dirref1_ref));
+    treeobj_insert_entry (root, "dirref2", treeobj_create_dirref (dirref2_ref));
+    treeobj_insert_entry (root, "symlink", treeobj_create_symlink ("dirref2"));
+    treeobj_insert_entry (root, "val", treeobj_create_val ("baz", 3));
+    kvs_util_json_hash ("sha1", root, root_ref);
+
+    cache_insert (cache, root_ref, cache_entry_create_json (json_incref (root)));
+
+    /* lookup ".", should stall on both subdirs at once */
+    ok ((lh = lookup_create (cache,
+                             1,
+                             root_ref,
+                             root_ref,
+                             ".",
+                             NULL,
+                             FLUX_KVS_READDIR | FLUX_KVS_RECURSIVE)) != NULL,
+        "lookup_create recursive .");
+    check_stall (lh, EAGAIN, dirref1_ref, false, ". recursive stall #1");
+    count = 0;
+    ok (lookup_iter_missing_refs (lh, count_ref_cb, &count) == 0 && count == 2,
+        "lookup_iter_missing_refs returns both missing dirrefs");
+
+    cache_insert (cache, dirref1_ref, cache_entry_create_json (dirref1));
+    cache_insert (cache, dirref2_ref, cache_entry_create_json (dirref2));
+
+    check_stall (lh, EAGAIN, valref_ref, true, ". recursive stall #2");
+
+    cache_insert (cache, valref_ref, cache_entry_create_raw (strdup ("abcd"), 4));
+
+    test = treeobj_create_dir ();
+    subdir = treeobj_create_dir ();
+    treeobj_insert_entry (subdir, "val", treeobj_create_val ("foo", 3));
+    treeobj_insert_entry (subdir, "valref", treeobj_create_val ("abcd", 4));
+    treeobj_insert_entry (test, "dirref1", subdir);
+    subdir = treeobj_create_dir ();
+    treeobj_insert_entry (subdir, "val", treeobj_create_val ("bar", 3));
+    treeobj_insert_entry (test, "dirref2", subdir);
+    treeobj_insert_entry (test, "symlink", treeobj_create_symlink ("dirref2"));
+    treeobj_insert_entry (test, "val", treeobj_create_val ("baz", 3));
+    check (lh, 0, test, ". recursive");
+
+    /* lookup "dirref1", now fully cached, should succeed */
+    ok ((lh = lookup_create (cache,
+                             1,
+                             root_ref,
+                             root_ref,
+                             "dirref1",
+                             NULL,
+                             FLUX_KVS_READDIR | FLUX_KVS_RECURSIVE)) != NULL,
+        "lookup_create recursive dirref1");
+    check (lh, 0, treeobj_get_entry (test, "dirref1"), "dirref1 recursive");
+    json_decref (test);
+
+    /* maxdepth = 0 leaves subdirectories as dirrefs */
+    ok ((lh = lookup_create (cache,
+                             1,
+                             root_ref,
+                             root_ref,
+                             ".",
+                             NULL,
+                             FLUX_KVS_READDIR | FLUX_KVS_RECURSIVE)) != NULL,
+        "lookup_create recursive . maxdepth=0");
+    ok (lookup_set_limits (lh, 0, 0) == 0,
+        "lookup_set_limits works");
+    check (lh, 0, root, ". recursive maxdepth=0");
+
+    /* maxsize too small fails with EFBIG */
+    ok ((lh = lookup_create (cache,
+                             1,
+                             root_ref,
+                             root_ref,
+                             ".",
+                             NULL,
+                             FLUX_KVS_READDIR | FLUX_KVS_RECURSIVE)) != NULL,
+        "lookup_create recursive . maxsize=4");
+    ok (lookup_set_limits (lh, -1, 4) == 0,
+        "lookup_set_limits works");
+    check (lh, EFBIG, NULL, ". recursive maxsize=4");
+
+    json_decref (root);
+    cache_destroy (cache);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -1368,6 +1507,7 @@ int main (int argc, char *argv[])
     lookup_alt_root ();
     lookup_stall_root ();
     lookup_stall ();
+    lookup_recursive ();
 
     done_testing ();
     return (0);
@@ -27,25 +27,61 @@
 #endif
 
 #include <flux/core.h>
+#include <czmq.h>
+#include <jansson.h>
 
-#include <stdarg.h>
 #include <hwloc.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <inttypes.h>
 
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/kary.h"
+#include "src/common/libutil/blobref.h"
+#include "src/common/libkvs/treeobj.h"
+
+/* Topology is published once per broker at module load time.
+ * Each rank's contribution (a single KVS directory object plus the
+ * blobref of its XML, which is stored in the content store and thereby
+ * deduplicated across identical nodes) is reduced up the TBON through
+ * the resource-hwloc.publish service, and rank 0 commits everything in
+ * a single transaction.  If a subtree is incomplete after
+ * 'publish_timeout' seconds, whatever has been collected is passed on,
+ * and stragglers are forwarded as they arrive.
+ */
+static const double default_publish_timeout = 2.;
+static const double publish_retry_delay = 0.1;
+static const int publish_retry_limit = 50;
 
 typedef struct
 {
+    flux_t *h;
     uint32_t rank;
+    uint32_t size;
+    char rankstr[16];
+    int arity;
     hwloc_topology_t topology;
     bool loaded;
     bool walk_topology;
+    double publish_timeout;
+    json_t *pending;        /* rank records awaiting forward/commit */
+    int expected;           /* records expected from this subtree */
+    bool flushed;           /* subtree complete or timed out */
+    flux_watcher_t *timer;
+    zlist_t *forwards;      /* in-flight upstream publish requests */
 } resource_ctx_t;
 
+struct forward {
+    resource_ctx_t *ctx;
+    json_t *ranks;
+    int attempts;
+    flux_future_t *f;
+    flux_watcher_t *retry;
+};
+
 static int ctx_hwloc_init (flux_t *h, resource_ctx_t *ctx)
 {
     int ret = -1;
@@ -131,11 +167,29 @@ done:
     return ret;
 }
 
+static void forward_destroy (struct forward *fwd)
+{
+    if (fwd) {
+        flux_future_destroy (fwd->f);
+        flux_watcher_destroy (fwd->retry);
+        json_decref (fwd->ranks);
+        free (fwd);
+    }
+}
+
 static void resource_hwloc_ctx_destroy (resource_ctx_t *ctx)
 {
     if (ctx) {
         if (ctx->topology)
             hwloc_topology_destroy (ctx->topology);
+        if (ctx->forwards) {
+            struct forward *fwd;
+            while ((fwd = zlist_pop (ctx->forwards)))
+                forward_destroy (fwd);
+            zlist_destroy (&ctx->forwards);
+        }
+        flux_watcher_destroy (ctx->timer);
+        json_decref (ctx->pending);
         free (ctx);
     }
 }
@@ -143,10 +197,28 @@ static void resource_hwloc_ctx_destroy (resource_ctx_t *ctx)
 static resource_ctx_t *resource_hwloc_ctx_create (flux_t *h)
 {
     resource_ctx_t *ctx = xzmalloc (sizeof(resource_ctx_t));
+    const char *s;
+
+    ctx->h = h;
+    ctx->publish_timeout = default_publish_timeout;
     if (flux_get_rank (h, &ctx->rank) < 0) {
         flux_log_error (h, "flux_get_rank");
         goto error;
     }
+    if (flux_get_size (h, &ctx->size) < 0) {
+        flux_log_error (h, "flux_get_size");
+        goto error;
+    }
+    if (!(s = flux_attr_get (h, "tbon.arity", NULL))) {
+        flux_log_error (h, "flux_attr_get tbon.arity");
+        goto error;
+    }
+    ctx->arity = strtoul (s, NULL, 10);
+    snprintf (ctx->rankstr, sizeof (ctx->rankstr), "%" PRIu32, ctx->rank);
+    if (!(ctx->pending = json_object ()) || !(ctx->forwards = zlist_new ())) {
+        flux_log (h, LOG_ERR, "out of memory");
+        goto error;
+    }
     if (ctx_hwloc_init (h, ctx)) {
         flux_log_error (h, "hwloc context could not be created");
         goto error;
@@ -157,30 +229,6 @@ error:
     return NULL;
 }
 
-static int load_xml_to_kvs (flux_t *h, resource_ctx_t *ctx)
-{
-    char *xml_path = NULL;
-    char *buffer = NULL;
-    int buflen = 0, ret = -1;
-
-    xml_path = xasprintf ("resource.hwloc.xml.%" PRIu32, ctx->rank);
-    (void)kvs_unlink (h, xml_path);
-    if (hwloc_topology_export_xmlbuffer (ctx->topology, &buffer, &buflen) < 0) {
-        flux_log (h, LOG_ERR, "hwloc_topology_export_xmlbuffer");
-        goto done;
-    }
-    if (kvs_put_string (h, xml_path, buffer) < 0) {
-        flux_log (h, LOG_ERR, "kvs_put_string");
-        goto done;
-    }
-    ret = 0;
-done:
-    if (xml_path)
-        free (xml_path);
-    hwloc_free_xmlbuffer (ctx->topology, buffer);
-    return ret;
-}
-
 static char *escape_kvs_key (const char *key)
 {
     char *ret_str = key ? xstrdup (key) : NULL;
@@ -191,53 +239,56 @@ static char *escape_kvs_key (const char *key)
     return ret_str;
 }
 
-static char *escape_and_join_kvs_path (const char *base,
-                                       int64_t num_suffixes,
-                                       ...)
+/* Insert JSON value 'val' into treeobj directory 'dir' under 'name',
+ * encoded the same way flux_kvs_txn_pack() would.  Steals 'val'.
+ */
+static int dir_put_value (json_t *dir, const char *name, json_t *val)
 {
-    int64_t i;
-    va_list varargs;
-    char *ret_str = base ? xstrdup (base) : NULL;
-    va_start (varargs, num_suffixes);
-    for (i = 0; i < num_suffixes; i++) {
-        char *tmp = ret_str;
-        char *suffix = va_arg (varargs, char *);
-        if (!suffix || !strlen (suffix))
-            continue;
-
-        suffix = escape_kvs_key (suffix);
+    char *s = NULL;
+    json_t *dirent = NULL;
+    int rc = -1;
 
-        if (!ret_str || !strlen (ret_str))
-            ret_str = xstrdup (suffix);
-        else
-            ret_str = xasprintf ("%s.%s", ret_str, suffix);
-        free (suffix);
-        free (tmp);
+    if (!val || !(s = json_dumps (val, JSON_ENCODE_ANY))) {
+        errno = ENOMEM;
+        goto done;
     }
-    va_end (varargs);
-    return ret_str;
+    if (!(dirent = treeobj_create_val (s, strlen (s) + 1)))
+        goto done;
+    if (treeobj_insert_entry (dir, name, dirent) < 0)
+        goto done;
+    rc = 0;
+done:
+    json_decref (dirent);
+    json_decref (val);
+    free (s);
+    return rc;
 }
 
-static int walk_topology (flux_t *h,
-                          hwloc_topology_t topology,
+/* Build a treeobj directory for 'obj' and its children, inserting it
+ * into 'parent' as <type>_<logical_index>.
+ */
+static int walk_topology (hwloc_topology_t topology,
                           hwloc_obj_t obj,
-                          const char *path)
+                          json_t *parent)
 {
     int ret = -1;
     int size_buf = hwloc_obj_attr_snprintf (NULL, 0, obj, ":-!:", 1) + 1;
     int size_type = hwloc_obj_type_snprintf (NULL, 0, obj, 1) + 1;
-    char *os_index_path, *new_path = NULL, *token = NULL, *end = NULL;
+    char *name = NULL, *token = NULL, *end = NULL;
     char *buf = xzmalloc (size_buf);
     char *type = xzmalloc (size_type);
     hwloc_obj_t prev = NULL;
+    json_t *dir;
 
     hwloc_obj_attr_snprintf (buf, size_buf, obj, ":-!:", 1);
     hwloc_obj_type_snprintf (type, size_type, obj, 1);
 
-    new_path = xasprintf ("%s.%s_%u", path, type, obj->logical_index);
+    if (!(dir = treeobj_create_dir ()))
+        goto done;
+    name = xasprintf ("%s_%u", type, obj->logical_index);
 
-    os_index_path = xasprintf ("%s.os_index", new_path);
-    kvs_put_int (h, os_index_path, obj->os_index);
+    if (dir_put_value (dir, "os_index", json_integer ((int)obj->os_index)) < 0)
+        goto done;
 
     // Tokenize the string, break out key/value pairs and store appropriately
     for (token = buf, end = strstr (token, ":-!:"); end && token;
@@ -246,16 +297,11 @@ static int walk_topology (flux_t *h,
         char *value = strstr (token, "=");
         if (value) {
             value[0] = '\0';
-            {
-                char *value_path =
-                    escape_and_join_kvs_path (new_path, 1, token);
-                int kvs_ret = -1;
-                value++;
-
-                kvs_ret = kvs_put_string (h, value_path, value);
-
-                free (value_path);
-                if (kvs_ret < 0)
+            if (strlen (token) > 0) {
+                char *key = escape_kvs_key (token);
+                int rc = dir_put_value (dir, key, json_string (value + 1));
+                free (key);
+                if (rc < 0)
                     goto done;
             }
         }
@@ -263,112 +309,407 @@ static int walk_topology (flux_t *h,
 
     // Recurse into the children of this object
     while ((prev = hwloc_get_next_child (topology, obj, prev))) {
-        if (walk_topology (h, topology, prev, new_path) < 0)
+        if (walk_topology (topology, prev, dir) < 0)
             goto done;
     }
+    if (treeobj_insert_entry (parent, name, dir) < 0)
+        goto done;
 
     ret = 0;
 done:
-    free (os_index_path);
-    free (new_path);
+    json_decref (dir);
+    free (name);
     free (buf);
     free (type);
     return ret;
 }
 
-static int put_hostname (flux_t *h, const char *base, const char *hostname)
+/* Store this rank's XML in the content store and return its blobref
+ * in 'blobref'.  The blob is the JSON-encoded string, so it can be
+ * referenced directly as a KVS valref.  Identical topologies hash to
+ * the same blobref and are stored only once.
+ */
+static int store_xml (resource_ctx_t *ctx, char *blobref, int size)
 {
-    int rc;
-    char *key;
-    if (asprintf (&key, "%s.HostName", base) < 0)
-        return (-1);
-    rc = kvs_put_string (h, key, hostname);
-    free (key);
-    return (rc);
+    char *buffer = NULL;
+    int buflen = 0;
+    json_t *o = NULL;
+    char *s = NULL;
+    flux_future_t *f = NULL;
+    const char *ref;
+    int rc = -1;
+
+    if (hwloc_topology_export_xmlbuffer (ctx->topology, &buffer, &buflen) < 0) {
+        flux_log (ctx->h, LOG_ERR, "hwloc_topology_export_xmlbuffer");
+        goto done;
+    }
+    if (!(o = json_string (buffer)) || !(s = json_dumps (o, JSON_ENCODE_ANY))) {
+        errno = ENOMEM;
+        goto done;
+    }
+    if (!(f = flux_content_store (ctx->h, s, strlen (s) + 1, 0))
+            || flux_content_store_get (f, &ref) < 0) {
+        flux_log_error (ctx->h, "%s: flux_content_store", __FUNCTION__);
+        goto done;
+    }
+    if (snprintf (blobref, size, "%s", ref) >= size) {
+        errno = EOVERFLOW;
+        goto done;
+    }
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    json_decref (o);
+    free (s);
+    if (buffer)
+        hwloc_free_xmlbuffer (ctx->topology, buffer);
+    return rc;
 }
 
-static int load_info_to_kvs (flux_t *h, resource_ctx_t *ctx)
+/* Build this rank's contribution: { "<rank>": record } where record is
+ *   { "by_rank": dir, "xml": blobref, "host": name?, "by_host": dir? }
+ */
+static json_t *topology_record (resource_ctx_t *ctx)
 {
-    char *base_path = NULL;
-    int ret = -1, i;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    json_t *by_rank = NULL, *by_host = NULL;
+    json_t *rec = NULL, *ranks = NULL;
+    hwloc_obj_t machine;
+    const char *hostname = NULL;
+    char *kvs_hostname = NULL;
+    int i;
     int depth = hwloc_topology_get_depth (ctx->topology);
 
-    base_path = xasprintf ("resource.hwloc.by_rank.%" PRIu32, ctx->rank);
-    (void)kvs_unlink (h, base_path);
+    if (store_xml (ctx, blobref, sizeof (blobref)) < 0)
+        goto error;
+    if (!(by_rank = treeobj_create_dir ()))
+        goto error;
     for (i = 0; i < depth; ++i) {
         int nobj = hwloc_get_nbobjs_by_depth (ctx->topology, i);
         hwloc_obj_type_t t = hwloc_get_depth_type (ctx->topology, i);
-        char *obj_path =
-            xasprintf ("%s.%s", base_path, hwloc_obj_type_string (t));
-        kvs_put_int (h, obj_path, nobj);
-        free (obj_path);
-    }
-    if (ctx->walk_topology &&
-        walk_topology (h,
-                       ctx->topology,
-                       hwloc_get_root_obj (ctx->topology),
-                       base_path) < 0) {
-        flux_log (h, LOG_ERR, "walk_topology");
-        goto done;
+        if (dir_put_value (by_rank, hwloc_obj_type_string (t),
+                           json_integer (nobj)) < 0)
+            goto error;
+    }
+    if (ctx->walk_topology
+            && walk_topology (ctx->topology,
+                              hwloc_get_root_obj (ctx->topology),
+                              by_rank) < 0) {
+        flux_log (ctx->h, LOG_ERR, "walk_topology");
+        goto error;
     }
-    hwloc_obj_t machine =
-        hwloc_get_obj_by_type (ctx->topology, HWLOC_OBJ_MACHINE, 0);
-    if (machine) {
-        const char *hostname = hwloc_obj_get_info_by_name (machine, "HostName");
-        char *kvs_hostname = escape_kvs_key (hostname);
-        char *host_path = xasprintf ("resource.hwloc.by_host.%s", kvs_hostname);
-
-        if (put_hostname (h, base_path, hostname) < 0)
-            flux_log_error (h, "failed to record hostname for this rank");
-
-        free (kvs_hostname);
-        (void) kvs_unlink (h, host_path);
-        if (ctx->walk_topology &&
-            walk_topology (h,
-                           ctx->topology,
-                           hwloc_get_root_obj (ctx->topology),
-                           host_path) < 0) {
-            flux_log (h, LOG_ERR, "walk_topology");
-            goto done;
+    machine = hwloc_get_obj_by_type (ctx->topology, HWLOC_OBJ_MACHINE, 0);
+    if (machine)
+        hostname = hwloc_obj_get_info_by_name (machine, "HostName");
+    if (hostname) {
+        if (dir_put_value (by_rank, "HostName", json_string (hostname)) < 0)
+            flux_log_error (ctx->h, "failed to record hostname for this rank");
+        if (ctx->walk_topology) {
+            if (!(by_host = treeobj_create_dir ())
+                    || walk_topology (ctx->topology,
+                                      hwloc_get_root_obj (ctx->topology),
+                                      by_host) < 0) {
+                flux_log (ctx->h, LOG_ERR, "walk_topology");
+                goto error;
+            }
         }
-        free (host_path);
     }
-    ret = 0;
-done:
-    if (base_path)
-        free (base_path);
-    return ret;
+    if (!(rec = json_pack ("{s:O s:s}", "by_rank", by_rank,
+                                        "xml", blobref)))
+        goto nomem;
+    if (hostname) {
+        kvs_hostname = escape_kvs_key (hostname);
+        if (json_object_set_new (rec, "host", json_string (kvs_hostname)) < 0)
+            goto nomem;
+        if (by_host && json_object_set (rec, "by_host", by_host) < 0)
+            goto nomem;
+    }
+    if (!(ranks = json_object ())
+            || json_object_set (ranks, ctx->rankstr, rec) < 0)
+        goto nomem;
+    json_decref (rec);
+    json_decref (by_rank);
+    json_decref (by_host);
+    free (kvs_hostname);
+    return ranks;
+nomem:
+    errno = ENOMEM;
+error:
+    json_decref (ranks);
+    json_decref (rec);
+    json_decref (by_rank);
+    json_decref (by_host);
+    free (kvs_hostname);
+    return NULL;
 }
 
-static int load_hwloc (flux_t *h, resource_ctx_t *ctx)
+static int txn_put_record (flux_kvs_txn_t *txn, const char *rank,
+                           json_t *rec)
 {
-    uint32_t size;
-    char *completion_path = NULL;
+    json_t *by_rank, *by_host = NULL, *valref = NULL;
+    const char *xml, *host = NULL;
+    char *key = NULL;
+    char *endptr;
     int rc = -1;
 
-    if (load_xml_to_kvs (h, ctx) < 0 || load_info_to_kvs (h, ctx) < 0) {
-        flux_log_error (h, "%s: failed to load xml/info to kvs", __FUNCTION__);
+    errno = 0;
+    (void)strtoul (rank, &endptr, 10);
+    if (errno != 0 || *endptr != '\0' || endptr == rank) {
+        errno = EPROTO;
         goto done;
     }
-    if (flux_get_size (h, &size) < 0) {
-        flux_log_error (h, "%s: flux_get_size", __FUNCTION__);
+    if (json_unpack (rec, "{s:o s:s s?s s?o}", "by_rank", &by_rank,
+                                               "xml", &xml,
+                                               "host", &host,
+                                               "by_host", &by_host) < 0
+            || !(valref = treeobj_create_valref (xml))) {
+        errno = EPROTO;
         goto done;
     }
-    completion_path = xasprintf ("resource.hwloc.loaded.%" PRIu32, ctx->rank);
-    if (kvs_put_int (h, completion_path, 1) < 0) {
-        flux_log_error (h, "%s: kvs_put_int", __FUNCTION__);
+    key = xasprintf ("resource.hwloc.by_rank.%s", rank);
+    if (flux_kvs_txn_pack (txn, FLUX_KVS_TREEOBJ, key, "O", by_rank) < 0)
+        goto done;
+    free (key);
+    key = xasprintf ("resource.hwloc.xml.%s", rank);
+    if (flux_kvs_txn_pack (txn, FLUX_KVS_TREEOBJ, key, "O", valref) < 0)
+        goto done;
+    if (host && strlen (host) > 0) {
+        free (key);
+        key = xasprintf ("resource.hwloc.by_host.%s", host);
+        if (by_host) {
+            if (flux_kvs_txn_pack (txn, FLUX_KVS_TREEOBJ, key, "O", by_host) < 0)
+                goto done;
+        }
+        else if (flux_kvs_txn_unlink (txn, 0, key) < 0)
+            goto done;
+    }
+    free (key);
+    key = xasprintf ("resource.hwloc.loaded.%s", rank);
+    if (flux_kvs_txn_pack (txn, 0, key, "i", 1) < 0)
         goto done;
+    rc = 0;
+done:
+    json_decref (valref);
+    free (key);
+    return rc;
+}
+
+/* Commit a set of rank records to the KVS in one transaction.
+ */
+static int publish_commit (resource_ctx_t *ctx, json_t *ranks)
+{
+    flux_kvs_txn_t *txn;
+    flux_future_t *f = NULL;
+    const char *rank;
+    json_t *rec;
+    int rc = -1;
+
+    if (!(txn = flux_kvs_txn_create ())) {
+        flux_log_error (ctx->h, "%s: flux_kvs_txn_create", __FUNCTION__);
+        goto done;
+    }
+    json_object_foreach (ranks, rank, rec) {
+        if (txn_put_record (txn, rank, rec) < 0) {
+            flux_log_error (ctx->h, "%s: rank %s", __FUNCTION__, rank);
+            goto done;
+        }
     }
-    if (kvs_commit (h, 0) < 0) {
-        flux_log_error (h, "%s: kvs_commit", __FUNCTION__);
+    if (!(f = flux_kvs_commit (ctx->h, 0, txn))
+            || flux_future_get (f, NULL) < 0) {
+        flux_log_error (ctx->h, "%s: flux_kvs_commit", __FUNCTION__);
         goto done;
     }
-    flux_log (h, LOG_DEBUG, "loaded");
-    ctx->loaded = true;
+    flux_log (ctx->h, LOG_DEBUG, "published %d rank(s)",
+              (int)json_object_size (ranks));
+    if (json_object_get (ranks, ctx->rankstr))
+        ctx->loaded = true;
     rc = 0;
 done:
-    if (completion_path)
-        free (completion_path);
+    flux_future_destroy (f);
+    flux_kvs_txn_destroy (txn);
+    return rc;
+}
+
+static void forward_remove (struct forward *fwd)
+{
+    zlist_remove (fwd->ctx->forwards, fwd);
+    forward_destroy (fwd);
+}
+
+static int forward_send (struct forward *fwd);
+
+static void forward_retry_cb (flux_reactor_t *r, flux_watcher_t *w,
+                              int revents, void *arg)
+{
+    struct forward *fwd = arg;
+
+    if (forward_send (fwd) < 0) {
+        flux_log_error (fwd->ctx->h, "%s: forward_send", __FUNCTION__);
+        if (publish_commit (fwd->ctx, fwd->ranks) < 0)
+            flux_log (fwd->ctx->h, LOG_ERR, "failed to publish topology");
+        forward_remove (fwd);
+    }
+}
+
+/* Upstream acknowledged (it now owns the records), or failed.
+ * ENOSYS means the parent's module is not loaded (yet), so retry for
+ * a while, then give up and commit the records directly.
+ */
+static void forward_continuation (flux_future_t *f, void *arg)
+{
+    struct forward *fwd = arg;
+    resource_ctx_t *ctx = fwd->ctx;
+
+    if (flux_future_get (f, NULL) < 0) {
+        if (errno == ENOSYS && fwd->attempts < publish_retry_limit) {
+            flux_future_destroy (fwd->f);
+            fwd->f = NULL;
+            flux_timer_watcher_reset (fwd->retry, publish_retry_delay, 0.);
+            flux_watcher_start (fwd->retry);
+            return;
+        }
+        flux_log_error (ctx->h, "%s: upstream publish failed", __FUNCTION__);
+        if (publish_commit (ctx, fwd->ranks) < 0)
+            flux_log (ctx->h, LOG_ERR, "failed to publish topology");
+    }
+    else if (json_object_get (fwd->ranks, ctx->rankstr))
+        ctx->loaded = true;
+    forward_remove (fwd);
+}
+
+static int forward_send (struct forward *fwd)
+{
+    resource_ctx_t *ctx = fwd->ctx;
+
+    if (!(fwd->f = flux_rpc_pack (ctx->h, "resource-hwloc.publish",
+                                  FLUX_NODEID_UPSTREAM, 0, "{s:O}",
+                                  "ranks", fwd->ranks)))
+        return -1;
+    if (flux_future_then (fwd->f, -1., forward_continuation, fwd) < 0) {
+        flux_future_destroy (fwd->f);
+        fwd->f = NULL;
+        return -1;
+    }
+    fwd->attempts++;
+    return 0;
+}
+
+static int publish_forward (resource_ctx_t *ctx, json_t *ranks)
+{
+    flux_reactor_t *r = flux_get_reactor (ctx->h);
+    struct forward *fwd = xzmalloc (sizeof (*fwd));
+
+    fwd->ctx = ctx;
+    fwd->ranks = json_incref (ranks);
+    if (!(fwd->retry = flux_timer_watcher_create (r, publish_retry_delay, 0.,
+                                                  forward_retry_cb, fwd)))
+        goto error;
+    if (forward_send (fwd) < 0)
+        goto error;
+    if (zlist_append (ctx->forwards, fwd) < 0) {
+        errno = ENOMEM;
+        goto error;
+    }
+    return 0;
+error:
+    forward_destroy (fwd);
+    return -1;
+}
+
+/* Pass everything collected so far to the parent, or commit it on rank 0.
+ */
+static int publish_flush (resource_ctx_t *ctx)
+{
+    json_t *ranks = ctx->pending;
+    int rc = -1;
+
+    if (json_object_size (ranks) == 0)
+        return 0;
+    if (!(ctx->pending = json_object ())) {
+        ctx->pending = ranks;
+        errno = ENOMEM;
+        return -1;
+    }
+    flux_watcher_stop (ctx->timer);
+    if (ctx->rank == 0)
+        rc = publish_commit (ctx, ranks);
+    else if ((rc = publish_forward (ctx, ranks)) < 0) {
+        flux_log_error (ctx->h, "%s: forwarding upstream", __FUNCTION__);
+        rc = publish_commit (ctx, ranks);
+    }
+    json_decref (ranks);
+    return rc;
+}
+
+static int publish_append (resource_ctx_t *ctx, json_t *ranks)
+{
+    if (json_object_update (ctx->pending, ranks) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (json_object_size (ctx->pending) >= ctx->expected)
+        ctx->flushed = true;
+    if (ctx->flushed)
+        return publish_flush (ctx);
+    return 0;
+}
+
+static void publish_timeout_cb (flux_reactor_t *r, flux_watcher_t *w,
+                                int revents, void *arg)
+{
+    resource_ctx_t *ctx = arg;
+
+    flux_log (ctx->h, LOG_DEBUG, "publish timeout: have %d of %d ranks",
+              (int)json_object_size (ctx->pending), ctx->expected);
+    ctx->flushed = true;
+    if (publish_flush (ctx) < 0)
+        flux_log (ctx->h, LOG_ERR, "failed to publish topology");
+}
+
+static void publish_request_cb (flux_t *h,
+                                flux_msg_handler_t *watcher,
+                                const flux_msg_t *msg,
+                                void *arg)
+{
+    resource_ctx_t *ctx = arg;
+    json_t *ranks;
+    int errnum = 0;
+
+    if (flux_request_unpack (msg, NULL, "{s:o}", "ranks", &ranks) < 0
+            || publish_append (ctx, ranks) < 0)
+        errnum = errno;
+    if (flux_respond (h, msg, errnum, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
+/* Contribute this rank's topology to the reduction.  Ranks with no
+ * children (and a size=1 instance) flush immediately.
+ */
+static int publish_start (resource_ctx_t *ctx)
+{
+    json_t *ranks;
+    int rc;
+
+    ctx->expected = 1 + kary_sum_descendants (ctx->arity, ctx->size,
+                                              ctx->rank);
+    if (!(ranks = topology_record (ctx))) {
+        flux_log_error (ctx->h, "%s: failed to load xml/info", __FUNCTION__);
+        return -1;
+    }
+    if (ctx->expected > 1) {
+        flux_reactor_t *r = flux_get_reactor (ctx->h);
+        if (!(ctx->timer = flux_timer_watcher_create (r,
+                                                      ctx->publish_timeout, 0.,
+                                                      publish_timeout_cb,
+                                                      ctx))) {
+            flux_log_error (ctx->h, "flux_timer_watcher_create");
+            json_decref (ranks);
+            return -1;
+        }
+        flux_watcher_start (ctx->timer);
+    }
+    rc = publish_append (ctx, ranks);
+    json_decref (ranks);
     return rc;
 }
 
@@ -392,6 +733,23 @@ static int decode_reload_request (flux_t *h, resource_ctx_t *ctx,
     return (0);
 }
 
+/* A reload bypasses the TBON reduction:  the caller expects the new
+ * topology to be visible when the response arrives, so commit it here.
+ */
+static int reload_hwloc (resource_ctx_t *ctx)
+{
+    json_t *ranks;
+    int rc;
+
+    if (!(ranks = topology_record (ctx))) {
+        flux_log_error (ctx->h, "%s: failed to load xml/info", __FUNCTION__);
+        return -1;
+    }
+    rc = publish_commit (ctx, ranks);
+    json_decref (ranks);
+    return rc;
+}
+
 static void reload_request_cb (flux_t *h,
                                flux_msg_handler_t *watcher,
                                const flux_msg_t *msg,
@@ -402,7 +760,7 @@ static void reload_request_cb (flux_t *h,
 
     if ((decode_reload_request (h, ctx, msg) < 0)
         || (ctx_hwloc_init (h, ctx) < 0)
-        || (load_hwloc (h, ctx) < 0))
+        || (reload_hwloc (ctx) < 0))
         errnum = errno;
     if (flux_respond (h, msg, errnum, NULL) < 0)
         flux_log_error (h, "flux_respond");
@@ -542,6 +900,8 @@ static void process_args (flux_t *h, resource_ctx_t *ctx, int argc, char **argv)
     for (i = 0; i < argc; i++) {
         if (strcmp (argv[i], "walk_topology") == 0)
             ctx->walk_topology = true;
+        else if (strncmp (argv[i], "publish_timeout=", 16) == 0)
+            ctx->publish_timeout = strtod (argv[i] + 16, NULL);
         else
             flux_log (h, LOG_ERR, "Unknown option: %s\n", argv[i]);
     }
@@ -554,6 +914,9 @@ static struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "resource-hwloc.topo", topo_request_cb,
        FLUX_ROLE_USER, NULL
     },
+    { FLUX_MSGTYPE_REQUEST, "resource-hwloc.publish", publish_request_cb,
+       0, NULL
+    },
     FLUX_MSGHANDLER_TABLE_END
 };
 
@@ -567,10 +930,6 @@ int mod_main (flux_t *h, int argc, char **argv)
 
     process_args (h, ctx, argc, argv);
 
-    // Load hardware information immediately
-    if (load_hwloc (h, ctx) < 0)
-        goto done;
-
     if (flux_event_subscribe (h, "resource-hwloc.load") < 0) {
         flux_log_error (h, "flux_event_subscribe");
         goto done;
@@ -581,6 +940,10 @@ int mod_main (flux_t *h, int argc, char **argv)
         goto done;
     }
 
+    // Publish hardware information immediately
+    if (publish_start (ctx) < 0)
+        goto done_delvec;
+
     if (flux_reactor_run (flux_get_reactor (h), 0) < 0) {
         flux_log_error (h, "flux_reactor_run");
         goto done_delvec;
@@ -27,6 +27,8 @@
 #endif
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
 #include <zmq.h>
 #include <czmq.h>
@@ -69,9 +71,55 @@
 static int kvs_dir_levels = 2;
 static int kvs_bits_per_dir = 7;
 
+/*
+ *  Archival compaction (job.archive request, see archive_cb()):
+ *
+ *  Once every id that maps to a leaf directory lwj.x.y has been
+ *   allocated and all of those jobs have completed or failed, the
+ *   leaf is moved as a single dirref to lwj-archive.x.y and replaced
+ *   in lwj by a symlink to it.  A parent directory whose leaves have all
+ *   been archived is likewise replaced by a symlink, so the live lwj tree
+ *   shrinks as jobs finish while the archive keeps the same bounded
+ *   fanout, and old lwj paths still resolve.
+ *
+ *  Leaves are archived in id order, stopping at the first leaf with
+ *   active jobs, so every id below archive_next is in the archive and
+ *   job.kvspath can return its lwj-archive path.  archive_next is
+ *   committed to the KVS with each leaf and read back at module load.
+ */
+#define ARCHIVE_NEXT_KEY    "lwj-archive-next"
+#define ARCHIVE_MAX_DEFAULT 16
+static uint64_t archive_next = 0;
+static bool archive_busy = false;
+
 uint32_t broker_rank;
 const char *local_uri = NULL;
 
+/*
+ *  Resident wrexecd ("wrexecd-server" module option): a single wrexecd
+ *   started at module load preloads the wreck Lua plugins, then forks a
+ *   per-job wrexecd for each job request written to server_fd.  This only
+ *   saves the exec and plugin compilation per job:  each forked wrexecd
+ *   still opens its own broker connection and reads its job from the KVS.
+ */
+static int server_fd = -1;
+static pid_t server_pid = -1;
+
+/*
+ *  Requests not yet fully written to server_fd, sent from server_w as the
+ *   socket becomes writable so the module reactor never blocks on a slow
+ *   server.  If the server goes away, queued jobs fall back to fork+exec.
+ */
+struct server_req {
+    int64_t id;
+    char *kvspath;
+    char *line;
+    size_t len;
+    size_t off;
+};
+static zlist_t *server_queue = NULL;
+static flux_watcher_t *server_w = NULL;
+
 /*
  *  Return as 64bit integer the portion of integer `n`
  *   masked from bit position `a` to position `b`,
@@ -89,14 +137,19 @@ static inline uint64_t prefix64 (uint64_t n, int a, int b)
  *   prefix hiearchy of max levels `levels`, using `bits_per_dir` bits
  *   for each directory. Returns a kvs key path or NULL on failure.
  */
-static char * lwj_to_path (uint64_t id, int levels, int bits_per_dir)
+static char * lwj_to_path (const char *base, uint64_t id, int levels,
+                           int bits_per_dir)
 {
-    char buf [1024] = "lwj";
-    int len = 3;
-    int nleft = sizeof (buf) - len;
+    char buf [1024];
+    int len;
+    int nleft;
     int i, n;
 
-    /* Build up kvs directory from lwj. down */
+    if ((len = snprintf (buf, sizeof (buf), "%s", base)) >= sizeof (buf))
+        return NULL;
+    nleft = sizeof (buf) - len;
+
+    /* Build up kvs directory from base down */
     for (i = levels; i > 0; i--) {
         int b = bits_per_dir * i;
         uint64_t d = prefix64 (id, b, b + bits_per_dir);
@@ -113,7 +166,19 @@ static char * lwj_to_path (uint64_t id, int levels, int bits_per_dir)
 
 static char * id_to_path (uint64_t id)
 {
-    return (lwj_to_path (id, kvs_dir_levels, kvs_bits_per_dir));
+    return (lwj_to_path ("lwj", id, kvs_dir_levels, kvs_bits_per_dir));
+}
+
+/*
+ *  Return kvs path of job `id`, which is under lwj-archive once the
+ *   job's leaf directory has been archived.
+ */
+static char * id_to_kvspath (uint64_t id)
+{
+    if (id < archive_next)
+        return (lwj_to_path ("lwj-archive", id, kvs_dir_levels,
+                             kvs_bits_per_dir));
+    return (id_to_path (id));
 }
 
 static int kvs_job_set_state (flux_t *h, unsigned long jobid, const char *state)
@@ -395,7 +460,7 @@ static void job_kvspath_cb (flux_t *h, flux_msg_handler_t *w,
         json_object *v = json_object_array_get_idx (id_list, i);
         int64_t id = json_object_get_int64 (v);
         char * path;
-        if (!(path = id_to_path (id))) {
+        if (!(path = id_to_kvspath (id))) {
             flux_log (h, LOG_ERR, "kvspath_cb: lwj_to_path failed");
             goto out;
         }
@@ -418,6 +483,451 @@ out:
     Jput (out);
 }
 
+/*
+ *  Return kvs path under `base` of the directory `level` levels above
+ *   job `id` (level 1 is the leaf directory holding the job).
+ */
+static char * id_to_dir_path (const char *base, uint64_t id, int level)
+{
+    char *path = lwj_to_path (base, id, kvs_dir_levels, kvs_bits_per_dir);
+    char *p;
+    while (path && level-- > 0 && (p = strrchr (path, '.')))
+        *p = '\0';
+    return (path);
+}
+
+/*
+ *  State of one job.archive request.  The request is driven entirely
+ *   from continuations so the job module keeps serving job requests and
+ *   events while leaves are checked and moved.
+ */
+struct archive {
+    flux_t *h;
+    flux_msg_t *msg;
+    int max;            /* max leaves to archive in this request */
+    int count;          /* leaves archived so far */
+    uint64_t lastid;    /* last allocated job id */
+    uint64_t base;      /* first id of leaf being examined */
+    char *leaf;         /* kvs path of leaf being examined */
+    char *treeobj;      /* snapshot of leaf, NULL if leaf does not exist */
+    int pending;        /* outstanding job state lookups */
+    int active;         /* jobs in leaf not yet complete or failed */
+    int errnum;
+};
+
+static void archive_destroy (struct archive *a)
+{
+    if (a) {
+        flux_msg_destroy (a->msg);
+        free (a->leaf);
+        free (a->treeobj);
+        free (a);
+    }
+    archive_busy = false;
+}
+
+/*
+ *  Tell the job module on every rank to advance its archive cursor,
+ *   so job.kvspath answered locally returns archive paths.
+ */
+static void archive_publish (flux_t *h)
+{
+    flux_msg_t *msg;
+
+    if (!(msg = flux_event_pack ("wreck.archive", "{s:I}",
+                                 "next", (int64_t) archive_next))
+        || flux_send (h, msg, 0) < 0)
+        flux_log_error (h, "archive: publish wreck.archive");
+    flux_msg_destroy (msg);
+}
+
+static void archive_event_cb (flux_t *h, flux_msg_handler_t *w,
+                              const flux_msg_t *msg, void *arg)
+{
+    int64_t next;
+
+    if (flux_event_unpack (msg, NULL, "{s:I}", "next", &next) < 0) {
+        flux_log_error (h, "wreck.archive: flux_event_unpack");
+        return;
+    }
+    if (next > archive_next)
+        archive_next = next;
+}
+
+static void archive_finish (struct archive *a, int errnum)
+{
+    if (a->count > 0)
+        archive_publish (a->h);
+    if (errnum) {
+        if (flux_respond (a->h, a->msg, errnum, NULL) < 0)
+            flux_log_error (a->h, "archive: flux_respond");
+    }
+    else if (flux_respond_pack (a->h, a->msg, "{s:i s:I}",
+                                "count", a->count,
+                                "next", (int64_t) archive_next) < 0)
+        flux_log_error (a->h, "archive: flux_respond_pack");
+    archive_destroy (a);
+}
+
+static void archive_next_leaf (struct archive *a);
+
+static void archive_commit_continuation (flux_future_t *f, void *arg)
+{
+    struct archive *a = arg;
+    uint64_t fanout = 1ULL << kvs_bits_per_dir;
+    int errnum;
+
+    if (flux_future_get (f, NULL) < 0) {
+        errnum = errno;
+        flux_future_destroy (f);
+        if (errnum == EAGAIN) {
+            /*  Leaf was written after its snapshot was taken.  Leave it
+             *   for the next job.archive request.
+             */
+            flux_log (a->h, LOG_DEBUG, "archive: %s changed", a->leaf);
+            archive_finish (a, 0);
+            return;
+        }
+        flux_log (a->h, LOG_ERR, "archive: %s: flux_kvs_commit: %s",
+                  a->leaf, strerror (errnum));
+        archive_finish (a, errnum);
+        return;
+    }
+    flux_future_destroy (f);
+    flux_log (a->h, LOG_DEBUG, "archived %s", a->leaf);
+    archive_next = a->base + fanout;
+    a->count++;
+    a->base += fanout;
+    archive_next_leaf (a);
+}
+
+/*
+ *  Copy the leaf snapshot to lwj-archive and replace the leaf with a
+ *   symlink to the copy, in one commit with the updated archive cursor.
+ *   Any parent of the leaf whose id range ends with it is replaced with
+ *   a symlink to its lwj-archive counterpart, so lwj keeps one entry per
+ *   archived parent.  Job paths under lwj, e.g. lwj-complete links and
+ *   late writers, then resolve to the archive.
+ *
+ *  The commit fails with EAGAIN unless the leaf still matches the
+ *   snapshot the job states were read from, so no write is lost.
+ */
+static void archive_commit (struct archive *a)
+{
+    uint64_t end = a->base + (1ULL << kvs_bits_per_dir);
+    flux_kvs_txn_t *txn = NULL;
+    flux_future_t *f = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+    int level;
+
+    if (!(dst = id_to_dir_path ("lwj-archive", a->base, 1))
+        || !(txn = flux_kvs_txn_create ())
+        || (flux_kvs_txn_compare (txn, 0, a->leaf, a->treeobj) < 0)
+        || (a->treeobj && flux_kvs_txn_put (txn, FLUX_KVS_TREEOBJ,
+                                            dst, a->treeobj) < 0)
+        || (flux_kvs_txn_symlink (txn, 0, a->leaf, dst) < 0)
+        || (flux_kvs_txn_pack (txn, 0, ARCHIVE_NEXT_KEY, "I",
+                               (int64_t) end) < 0)) {
+        flux_log_error (a->h, "archive: %s: flux_kvs_txn", a->leaf);
+        goto error;
+    }
+    for (level = 2; level <= kvs_dir_levels; level++) {
+        int shift = kvs_bits_per_dir * level;
+        if (shift >= 64 || (end & ((1ULL << shift) - 1)) != 0)
+            break;
+        free (src);
+        free (dst);
+        src = dst = NULL;
+        if (!(src = id_to_dir_path ("lwj", a->base, level))
+            || !(dst = id_to_dir_path ("lwj-archive", a->base, level))
+            || flux_kvs_txn_symlink (txn, 0, src, dst) < 0) {
+            flux_log_error (a->h, "archive: link parent of %s", a->leaf);
+            goto error;
+        }
+    }
+    if (!(f = flux_kvs_commit (a->h, FLUX_KVS_NO_MERGE, txn))
+        || flux_future_then (f, -1., archive_commit_continuation, a) < 0) {
+        flux_log_error (a->h, "archive: %s: flux_kvs_commit", a->leaf);
+        flux_future_destroy (f);
+        goto error;
+    }
+    flux_kvs_txn_destroy (txn);
+    free (src);
+    free (dst);
+    return;
+error:
+    archive_finish (a, errno);
+    flux_kvs_txn_destroy (txn);
+    free (src);
+    free (dst);
+}
+
+/*
+ *  All job states in the leaf are known.  Archive the leaf if every job
+ *   has finished, otherwise stop here so that archived ids stay contiguous.
+ *   Jobs without a state key (e.g. still being created) do not hold up
+ *   archival:  their state is written through the leaf symlink later.
+ */
+static void archive_states_done (struct archive *a)
+{
+    if (a->errnum) {
+        archive_finish (a, a->errnum);
+        return;
+    }
+    if (a->active > 0) {
+        archive_finish (a, 0);
+        return;
+    }
+    archive_commit (a);
+}
+
+static void archive_state_continuation (flux_future_t *f, void *arg)
+{
+    struct archive *a = arg;
+    const char *state;
+
+    if (flux_kvs_lookup_get_unpack (f, "s", &state) < 0) {
+        if (errno != ENOENT) {
+            flux_log_error (a->h, "archive: %s: lookup state", a->leaf);
+            a->errnum = errno;
+        }
+    }
+    else if (strcmp (state, "complete") && strcmp (state, "failed"))
+        a->active++;
+    flux_future_destroy (f);
+    if (--a->pending == 0)
+        archive_states_done (a);
+}
+
+/*
+ *  Look up the state of each job in the leaf snapshot.
+ */
+static void archive_readdir_continuation (flux_future_t *f, void *arg)
+{
+    struct archive *a = arg;
+    struct json_object_iter iter;
+    json_object *o = NULL;
+    json_object *data;
+    const char *json_str;
+
+    if (flux_kvs_lookup_get (f, &json_str) < 0) {
+        flux_log_error (a->h, "archive: readdir %s", a->leaf);
+        flux_future_destroy (f);
+        archive_finish (a, errno);
+        return;
+    }
+    if (!(o = Jfromstr (json_str)) || !Jget_obj (o, "data", &data)) {
+        flux_log (a->h, LOG_ERR, "archive: %s: bad dir object", a->leaf);
+        a->errnum = EPROTO;
+        goto done;
+    }
+    a->pending = 1; /* hold off completion until all lookups are issued */
+    json_object_object_foreachC (data, iter) {
+        flux_future_t *sf = NULL;
+        char *key;
+        if (asprintf (&key, "%s.state", iter.key) < 0) {
+            a->errnum = ENOMEM;
+            break;
+        }
+        if (!(sf = flux_kvs_lookupat (a->h, 0, key, a->treeobj))
+            || flux_future_then (sf, -1., archive_state_continuation, a) < 0) {
+            flux_log_error (a->h, "archive: lookup %s.%s", a->leaf, key);
+            a->errnum = errno;
+            flux_future_destroy (sf);
+            free (key);
+            break;
+        }
+        free (key);
+        a->pending++;
+    }
+    a->pending--;
+done:
+    Jput (o);
+    flux_future_destroy (f);
+    if (a->pending == 0)
+        archive_states_done (a);
+}
+
+/*
+ *  Take a snapshot of the leaf.  Its jobs are read from the snapshot and
+ *   the commit only succeeds if the leaf has not changed since.
+ */
+static void archive_treeobj_continuation (flux_future_t *f, void *arg)
+{
+    struct archive *a = arg;
+    flux_future_t *df = NULL;
+    json_object *o = NULL;
+    const char *json_str;
+    const char *type;
+
+    if (flux_kvs_lookup_get (f, &json_str) < 0) {
+        if (errno != ENOENT) {
+            flux_log_error (a->h, "archive: lookup %s", a->leaf);
+            archive_finish (a, errno);
+            goto done;
+        }
+        /*  Leaf was never created.  Link it to the archive anyway so a
+         *   job created in it later is found there.
+         */
+        archive_commit (a);
+        goto done;
+    }
+    if (!(o = Jfromstr (json_str)) || !Jget_str (o, "type", &type)) {
+        flux_log (a->h, LOG_ERR, "archive: %s: bad tree object", a->leaf);
+        archive_finish (a, EPROTO);
+        goto done;
+    }
+    if (strcmp (type, "symlink") == 0) {
+        /*  Already archived
+         */
+        archive_next = a->base + (1ULL << kvs_bits_per_dir);
+        a->base = archive_next;
+        archive_next_leaf (a);
+        goto done;
+    }
+    if (!(a->treeobj = strdup (json_str))) {
+        archive_finish (a, ENOMEM);
+        goto done;
+    }
+    if (!(df = flux_kvs_lookupat (a->h, FLUX_KVS_READDIR, ".", a->treeobj))
+        || flux_future_then (df, -1., archive_readdir_continuation, a) < 0) {
+        flux_log_error (a->h, "archive: readdir %s", a->leaf);
+        flux_future_destroy (df);
+        archive_finish (a, errno);
+    }
+done:
+    Jput (o);
+    flux_future_destroy (f);
+}
+
+/*
+ *  Only leaves whose id range has been fully allocated may be moved,
+ *   and ids beyond 2^shift wrap around into existing leaves.
+ */
+static void archive_next_leaf (struct archive *a)
+{
+    uint64_t fanout = 1ULL << kvs_bits_per_dir;
+    int shift = kvs_bits_per_dir * (kvs_dir_levels + 1);
+    flux_future_t *f;
+
+    free (a->leaf);
+    a->leaf = NULL;
+    free (a->treeobj);
+    a->treeobj = NULL;
+    a->active = 0;
+    if (a->count >= a->max
+        || a->base + fanout - 1 > a->lastid
+        || (shift < 64 && a->base + fanout > (1ULL << shift))) {
+        archive_finish (a, 0);
+        return;
+    }
+    if (!(a->leaf = id_to_dir_path ("lwj", a->base, 1))) {
+        flux_log_error (a->h, "archive: path");
+        archive_finish (a, errno ? errno : ENOMEM);
+        return;
+    }
+    if (!(f = flux_kvs_lookup (a->h, FLUX_KVS_TREEOBJ, a->leaf))
+        || flux_future_then (f, -1., archive_treeobj_continuation, a) < 0) {
+        flux_log_error (a->h, "archive: lookup %s", a->leaf);
+        flux_future_destroy (f);
+        archive_finish (a, errno);
+    }
+}
+
+static void archive_lastid_continuation (flux_future_t *f, void *arg)
+{
+    struct archive *a = arg;
+    int64_t id;
+
+    if (flux_rpc_get_unpack (f, "{s:I}", "value", &id) < 0) {
+        if (errno != ENOENT) {
+            flux_log_error (a->h, "archive: seq.fetch");
+            flux_future_destroy (f);
+            archive_finish (a, errno);
+            return;
+        }
+        id = -1;
+    }
+    flux_future_destroy (f);
+    if (id < 0 || (uint64_t) id < archive_next) {
+        archive_finish (a, 0);
+        return;
+    }
+    a->lastid = id;
+    a->base = archive_next;
+    archive_next_leaf (a);
+}
+
+/*
+ *  job.archive: archive up to "max" (default ARCHIVE_MAX_DEFAULT) leaf
+ *   directories of completed jobs.  Responds with the number of leaves
+ *   archived and the first id not yet covered by the archive.
+ */
+static void archive_cb (flux_t *h, flux_msg_handler_t *w,
+                        const flux_msg_t *msg, void *arg)
+{
+    struct archive *a = NULL;
+    flux_future_t *f = NULL;
+    int max = ARCHIVE_MAX_DEFAULT;
+
+    if (flux_request_unpack (msg, NULL, "{s?:i}", "max", &max) < 0)
+        goto error;
+    if (kvs_dir_levels == 0) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (archive_busy) {
+        errno = EBUSY;
+        goto error;
+    }
+    if (!(a = calloc (1, sizeof (*a)))
+        || !(a->msg = flux_msg_copy (msg, true)))
+        goto error;
+    a->h = h;
+    a->max = max > 0 ? max : ARCHIVE_MAX_DEFAULT;
+    if (!(f = flux_rpc_pack (h, "seq.fetch", 0, 0, "{s:s,s:i,s:i,s:b}",
+                             "name", "lwj",
+                             "preincrement", 0,
+                             "postincrement", 0,
+                             "create", false))
+        || flux_future_then (f, -1., archive_lastid_continuation, a) < 0)
+        goto error;
+    archive_busy = true;
+    return;
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "archive_cb: flux_respond");
+    flux_future_destroy (f);
+    if (a) {
+        flux_msg_destroy (a->msg);
+        free (a);
+    }
+}
+
+/*
+ *  Restore the archive cursor committed by a previous job module.
+ */
+static int archive_cursor_load (flux_t *h)
+{
+    flux_future_t *f;
+    int64_t next;
+    int rc = -1;
+
+    if (!(f = flux_kvs_lookup (h, 0, ARCHIVE_NEXT_KEY)))
+        return (-1);
+    if (flux_kvs_lookup_get_unpack (f, "I", &next) < 0) {
+        if (errno == ENOENT)
+            rc = 0;
+        goto done;
+    }
+    archive_next = next;
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    return (rc);
+}
+
 static int flux_attr_set_int (flux_t *h, const char *attr, int val)
 {
     char buf [16];
@@ -448,24 +958,14 @@ static int flux_attr_get_int (flux_t *h, const char *attr, int *valp)
 
 static void exec_close_fd (void *arg, int fd)
 {
-    if (fd >= 3)
+    int *keepfd = arg;
+    if (fd >= 3 && (!keepfd || fd != *keepfd))
         (void) close (fd);
 }
 
-static void exec_handler (const char *exe, int64_t id, const char *kvspath)
+static void exec_wrexecd (char **av, int keepfd)
 {
     pid_t sid;
-    int argc = 2;
-    char **av = malloc ((sizeof (char *)) * (argc + 2));
-
-    if ((av == NULL)
-     || ((av [0] = strdup (exe)) == NULL)
-     || (asprintf (&av[1], "--lwj-id=%"PRId64, id) < 0)
-     || (asprintf (&av[2], "--kvs-path=%s", kvspath) < 0)) {
-        fprintf (stderr, "Out of Memory trying to exec wrexecd!\n");
-        exit (1);
-    }
-    av[argc+1] = NULL;
 
     if ((sid = setsid ()) < 0)
         fprintf (stderr, "setsid: %s\n", strerror (errno));
@@ -477,7 +977,7 @@ static void exec_handler (const char *exe, int64_t id, const char *kvspath)
      *   process should be reparented to init.
      */
 
-    fdwalk (exec_close_fd, NULL);
+    fdwalk (exec_close_fd, keepfd >= 0 ? &keepfd : NULL);
     if (setenv ("FLUX_URI", local_uri, 1) < 0)
         fprintf (stderr, "setenv: %s\n", strerror (errno));
     else if (execvp (av[0], av) < 0)
@@ -485,6 +985,37 @@ static void exec_handler (const char *exe, int64_t id, const char *kvspath)
     exit (255);
 }
 
+static void exec_handler (const char *exe, int64_t id, const char *kvspath)
+{
+    int argc = 2;
+    char **av = malloc ((sizeof (char *)) * (argc + 2));
+
+    if ((av == NULL)
+     || ((av [0] = strdup (exe)) == NULL)
+     || (asprintf (&av[1], "--lwj-id=%"PRId64, id) < 0)
+     || (asprintf (&av[2], "--kvs-path=%s", kvspath) < 0)) {
+        fprintf (stderr, "Out of Memory trying to exec wrexecd!\n");
+        exit (1);
+    }
+    av[argc+1] = NULL;
+    exec_wrexecd (av, -1);
+}
+
+static void exec_server_handler (const char *exe, int fd)
+{
+    int argc = 2;
+    char **av = malloc ((sizeof (char *)) * (argc + 1));
+
+    if ((av == NULL)
+     || ((av [0] = strdup (exe)) == NULL)
+     || (asprintf (&av[1], "--server-fd=%d", fd) < 0)) {
+        fprintf (stderr, "Out of Memory trying to exec wrexecd!\n");
+        exit (1);
+    }
+    av[argc] = NULL;
+    exec_wrexecd (av, fd);
+}
+
 static int spawn_exec_handler (flux_t *h, int64_t id, const char *kvspath)
 {
     pid_t pid;
@@ -516,6 +1047,170 @@ static int spawn_exec_handler (flux_t *h, int64_t id, const char *kvspath)
     return (0);
 }
 
+static void server_req_destroy (struct server_req *req)
+{
+    if (req) {
+        free (req->kvspath);
+        free (req->line);
+        free (req);
+    }
+}
+
+static void server_stop (flux_t *h)
+{
+    struct server_req *req;
+
+    flux_watcher_destroy (server_w);
+    server_w = NULL;
+    if (server_fd >= 0) {
+        close (server_fd);
+        server_fd = -1;
+    }
+    /*  Jobs not yet handed to the server are started with fork+exec
+     */
+    if (server_queue) {
+        while ((req = zlist_pop (server_queue))) {
+            spawn_exec_handler (h, req->id, req->kvspath);
+            server_req_destroy (req);
+        }
+        zlist_destroy (&server_queue);
+    }
+    /*  wrexecd exits on EOF, leaving running jobs to finish on their own.
+     *   Don't wait for it from the reactor.  Child watchers only work on
+     *   the broker's main reactor, not a module's, but the broker reaps
+     *   any child that exits, as it does per-job wrexecds.  So only reap
+     *   the server here if it has already exited.
+     */
+    if (server_pid > 0 && waitpid (server_pid, NULL, WNOHANG) < 0
+                       && errno != ECHILD)
+        flux_log_error (h, "waitpid wrexecd server");
+    server_pid = -1;
+}
+
+/*
+ *  Write queued requests to server_fd without blocking.
+ *   Returns 0 if the queue was drained or the socket is full, -1 on error.
+ */
+static int server_flush (void)
+{
+    struct server_req *req;
+
+    while ((req = zlist_first (server_queue))) {
+        while (req->off < req->len) {
+            ssize_t w = send (server_fd, req->line + req->off,
+                              req->len - req->off,
+                              MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (w < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return (0);
+                return (-1);
+            }
+            req->off += w;
+        }
+        zlist_remove (server_queue, req);
+        server_req_destroy (req);
+    }
+    return (0);
+}
+
+static void server_update (flux_t *h)
+{
+    if (server_flush () < 0) {
+        flux_log_error (h, "wrexecd server: falling back to fork");
+        server_stop (h);
+        return;
+    }
+    if (zlist_size (server_queue) > 0)
+        flux_watcher_start (server_w);
+    else
+        flux_watcher_stop (server_w);
+}
+
+static void server_out_cb (flux_reactor_t *r, flux_watcher_t *w,
+                           int revents, void *arg)
+{
+    server_update (arg);
+}
+
+static int server_start (flux_t *h)
+{
+    int fds[2];
+    const char *wrexecd_path;
+
+    if (!(wrexecd_path = flux_attr_get (h, "wrexec.wrexecd_path", NULL))) {
+        flux_log_error (h, "server_start: flux_attr_get");
+        return (-1);
+    }
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        flux_log_error (h, "server_start: socketpair");
+        return (-1);
+    }
+    if ((server_pid = fork ()) < 0) {
+        flux_log_error (h, "server_start: fork");
+        close (fds[0]);
+        close (fds[1]);
+        return (-1);
+    }
+    if (server_pid == 0) {
+#if WITH_TCMALLOC
+        if (IsHeapProfilerRunning ())
+            HeapProfilerStop ();
+#endif
+        exec_server_handler (wrexecd_path, fds[1]);
+    }
+    close (fds[1]);
+    server_fd = fds[0];
+    if (!(server_queue = zlist_new ())
+        || !(server_w = flux_fd_watcher_create (flux_get_reactor (h),
+                                                server_fd, FLUX_POLLOUT,
+                                                server_out_cb, h))) {
+        flux_log_error (h, "server_start: flux_fd_watcher_create");
+        server_stop (h);
+        return (-1);
+    }
+    flux_log (h, LOG_DEBUG, "started wrexecd server pid %d", server_pid);
+    return (0);
+}
+
+/*
+ *  Queue one job request line for the resident wrexecd:
+ *   {"id":I, "kvspath":s, "lua_pattern":s}
+ *  The Lua pattern is sent with each job since it may have changed
+ *   since the server preloaded its plugins.
+ */
+static int server_send (flux_t *h, int64_t id, const char *kvspath)
+{
+    json_object *o = Jnew ();
+    const char *pattern = flux_attr_get (h, "wrexec.lua_pattern", NULL);
+    struct server_req *req;
+    int rc = -1;
+
+    Jadd_int64 (o, "id", id);
+    Jadd_str (o, "kvspath", kvspath);
+    if (pattern)
+        Jadd_str (o, "lua_pattern", pattern);
+    if (!(req = calloc (1, sizeof (*req)))
+        || !(req->kvspath = strdup (kvspath)))
+        goto done;
+    if (asprintf (&req->line, "%s\n", Jtostr (o)) < 0) {
+        req->line = NULL;
+        goto done;
+    }
+    req->id = id;
+    req->len = strlen (req->line);
+    if (zlist_append (server_queue, req) < 0)
+        goto done;
+    req = NULL;
+    server_update (h);
+    rc = 0;
+done:
+    server_req_destroy (req);
+    Jput (o);
+    return (rc);
+}
+
 static bool lwj_targets_this_node (flux_t *h, const char *kvspath)
 {
     kvsdir_t *tmp;
@@ -568,8 +1263,10 @@ static void runevent_cb (flux_t *h, flux_msg_handler_t *w,
         return;
     }
     kvspath = id_to_path (id);
-    if (lwj_targets_this_node (h, kvspath))
-        spawn_exec_handler (h, id, kvspath);
+    if (lwj_targets_this_node (h, kvspath)) {
+        if (server_fd < 0 || server_send (h, id, kvspath) < 0)
+            spawn_exec_handler (h, id, kvspath);
+    }
     free (kvspath);
     Jput (in);
 }
@@ -579,12 +1276,23 @@ struct flux_msg_handler_spec mtab[] = {
     { FLUX_MSGTYPE_REQUEST, "job.submit", job_request_cb, 0, NULL },
     { FLUX_MSGTYPE_REQUEST, "job.shutdown", job_request_cb, 0, NULL },
     { FLUX_MSGTYPE_REQUEST, "job.kvspath",  job_kvspath_cb, 0, NULL },
+    { FLUX_MSGTYPE_REQUEST, "job.archive",  archive_cb, 0, NULL },
     { FLUX_MSGTYPE_EVENT,   "wrexec.run.*", runevent_cb, 0, NULL },
+    { FLUX_MSGTYPE_EVENT,   "wreck.archive", archive_event_cb, 0, NULL },
     FLUX_MSGHANDLER_TABLE_END
 };
 
 int mod_main (flux_t *h, int argc, char **argv)
 {
+    bool use_server = false;
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        if (strcmp (argv[i], "wrexecd-server") == 0)
+            use_server = true;
+        else
+            flux_log (h, LOG_ERR, "Unknown option: %s", argv[i]);
+    }
     if (flux_msg_handler_addvec (h, mtab, NULL) < 0) {
         flux_log_error (h, "flux_msg_handler_addvec");
         return (-1);
@@ -597,7 +1305,8 @@ int mod_main (flux_t *h, int argc, char **argv)
      */
     if ((flux_event_subscribe (h, "wreck.state.reserved") < 0)
        || (flux_event_subscribe (h, "wreck.state.submitted") < 0)
-       || (flux_event_subscribe (h, "wrexec.run.") < 0)) {
+       || (flux_event_subscribe (h, "wrexec.run.") < 0)
+       || (flux_event_subscribe (h, "wreck.archive") < 0)) {
         flux_log_error (h, "flux_event_subscribe");
         return -1;
     }
@@ -625,10 +1334,18 @@ int mod_main (flux_t *h, int argc, char **argv)
         return -1;
     }
 
+    if (archive_cursor_load (h) < 0)
+        flux_log_error (h, "failed to read %s", ARCHIVE_NEXT_KEY);
+
+    if (use_server && server_start (h) < 0)
+        flux_log (h, LOG_ERR, "wrexecd server failed, using fork+exec");
+
     if (flux_reactor_run (flux_get_reactor (h), 0) < 0) {
         flux_log_error (h, "flux_reactor_run");
+        server_stop (h);
         return -1;
     }
+    server_stop (h);
     flux_msg_handler_delvec (mtab);
     return 0;
 }
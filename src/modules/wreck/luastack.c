@@ -54,11 +54,13 @@ struct lua_script {
     lua_stack_t   st; /*  Pointer back to lua_stack in which we're loaded   */
     lua_State *    L; /*  This script's local Lua state                     */
     int      lua_ref; /*  Reference back into global registry               */
+    int      pending; /*  Compiled chunk not yet run (deferred)             */
 };
 
 struct lua_script_stack {
     lua_State *L;           /*  Global lua state                            */
     l_err_f    errf;
+    int        defer;       /*  Defer running newly compiled scripts        */
     List       script_list; /*  List of scripts in this stack               */
 };
 
@@ -172,6 +174,16 @@ static inline void print_lua_script_error (lua_stack_t st, lua_script_t s)
     (*st->errf) ("%s: %s\n", s->label, lua_tostring (s->L, -1));
 }
 
+static int lua_script_run (lua_stack_t st, lua_script_t s)
+{
+    s->pending = 0;
+    if (lua_pcall (s->L, 0, 0, 0)) {
+        print_lua_script_error (st, s);
+        return (-1);
+    }
+    return (0);
+}
+
 static int lua_script_compile (lua_stack_t st, lua_script_t s)
 {
     /*
@@ -188,14 +200,14 @@ static int lua_script_compile (lua_stack_t st, lua_script_t s)
     }
 
     /*
-     *  Now compile the loaded script:
+     *  Leave the compiled chunk on the script's stack if running is
+     *   deferred, otherwise run it now:
      */
-    if (lua_pcall (s->L, 0, 0, 0)) {
-        print_lua_script_error (st, s);
-        return (-1);
+    if (st->defer) {
+        s->pending = 1;
+        return (0);
     }
-
-    return (0);
+    return (lua_script_run (st, s));
 }
 
 static int ef (const char *p, int eerrno)
@@ -284,6 +296,7 @@ lua_stack_t lua_stack_create (void)
 
     s->L = luaL_newstate ();
     s->errf = &verr;
+    s->defer = 0;
 
     luaL_openlibs(s->L);
 
@@ -321,6 +334,35 @@ int lua_stack_append_script (lua_stack_t st, const char *script,
     return (0);
 }
 
+int lua_stack_set_defer (lua_stack_t st, int defer)
+{
+    if (st == NULL)
+        return (-1);
+    st->defer = defer;
+    return (0);
+}
+
+int lua_stack_run_deferred (lua_stack_t st)
+{
+    lua_script_t s;
+    ListIterator i;
+
+    if (st == NULL || st->script_list == NULL)
+        return (-1);
+
+    i = list_iterator_create (st->script_list);
+    while ((s = list_next (i))) {
+        if (s->pending && lua_script_run (st, s) < 0) {
+            (*st->errf) ("%s: Failed. Skipping.\n", s->label);
+            list_delete (i);
+        }
+    }
+    list_iterator_destroy (i);
+    st->defer = 0;
+
+    return (0);
+}
+
 int lua_stack_foreach (lua_stack_t st, l_foreach_f f, void *arg)
 {
     int rc = 0;
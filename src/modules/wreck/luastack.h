@@ -46,6 +46,19 @@ int lua_stack_set_errfunc (lua_stack_t s, l_err_f f);
  */
 int lua_stack_append_file (lua_stack_t s, const char *pattern);
 
+/*
+ *  If [defer] is nonzero, scripts subsequently appended to [s] are only
+ *   loaded and compiled, and their top-level code is not run until
+ *   lua_stack_run_deferred() is called.
+ */
+int lua_stack_set_defer (lua_stack_t s, int defer);
+
+/*
+ *  Run the top-level code of scripts whose run was deferred, dropping
+ *   any that fail, and stop deferring.  Returns 0 for success.
+ */
+int lua_stack_run_deferred (lua_stack_t s);
+
 /*
  *  Load a script in buffer [s] into the Lua stack [st] and give it a
  *   label of [name]
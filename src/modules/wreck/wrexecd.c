@@ -32,11 +32,16 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 #include <sys/signalfd.h>
 #include <czmq.h>
 #include <sys/syslog.h>
 #include <envz.h>
 #include <sys/ptrace.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <sched.h>
 #include <inttypes.h>
 
 #include <lua.h>
@@ -49,6 +54,8 @@
 #include "src/common/libutil/sds.h"
 #include "src/common/libutil/fdwalk.h"
 #include "src/common/libutil/shortjson.h"
+#include "src/common/libutil/nodeset.h"
+#include "src/common/libutil/monotime.h"
 #include "src/common/libsubprocess/zio.h"
 #include "src/common/libpmi/simple_server.h"
 #include "src/common/libkz/kz.h"
@@ -72,6 +79,7 @@ struct task_info {
     kvsdir_t *kvs;            /* kvs handle to this task's dir in kvs */
     int      status;
     int      exited;          /* non-zero if this task exited */
+    int      exit_sent;       /* non-zero if exit status was reported */
 
     /*  IO */
     zio_t *zio[3];
@@ -99,6 +107,14 @@ struct prog_ctx {
     unsigned int barrier_sequence;
     char barrier_name[64];
     flux_kvs_txn_t *barrier_txn;
+    char *pmi_kvsname;
+    flux_future_t *pmi_tree;  /* kvsname dir fetched after each barrier */
+    int pmi_tree_ready;
+    zlist_t *pmi_pending;     /* gets waiting for pmi_tree */
+    zlist_t *pmi_lookups;     /* gets waiting for a per-key lookup */
+    int pmi_use_exchange;     /* exchange puts via barrier module */
+    json_object *pmi_puts;    /* local puts since last barrier */
+    zhash_t *pmi_exchanged;   /* values from completed exchanges */
 
     uint32_t noderank;
 
@@ -138,6 +154,7 @@ struct prog_ctx {
      */
     struct task_info **task;
     int in_task;            /* Non-zero if currently in task ctx  */
+    int in_spawner;         /* Non-zero if task ctx is in wrexecd itself */
     int taskid;             /* Current taskid executing lua_stack */
 
     const char *lua_pattern;/* Glob for lua plugins */
@@ -177,7 +194,7 @@ static flux_t *prog_ctx_flux_handle (struct prog_ctx *ctx)
 {
     struct task_info *t;
 
-    if (!ctx->in_task)
+    if (!ctx->in_task || ctx->in_spawner)
         return (ctx->flux);
 
     t = prog_ctx_current_task (ctx);
@@ -622,6 +639,24 @@ static int get_executable_path (char *buf, size_t len)
     return (0);
 }
 
+/* A PMI kvs_get awaiting its response.
+ */
+struct pmi_get {
+    struct prog_ctx *ctx;
+    void *client;
+    char *key;
+    flux_future_t *f;       /* per-key lookup, if any */
+};
+
+static void pmi_get_destroy (struct pmi_get *g)
+{
+    if (g) {
+        flux_future_destroy (g->f);
+        free (g->key);
+        free (g);
+    }
+}
+
 void prog_ctx_destroy (struct prog_ctx *ctx)
 {
     int i;
@@ -646,6 +681,22 @@ void prog_ctx_destroy (struct prog_ctx *ctx)
     if (ctx->mw)
         flux_msg_handler_destroy (ctx->mw);
 
+    /* Futures refer to ctx->flux:  destroy them before closing it.
+     */
+    flux_future_destroy (ctx->pmi_tree);
+    if (ctx->pmi_pending) {
+        struct pmi_get *g;
+        while ((g = zlist_pop (ctx->pmi_pending)))
+            pmi_get_destroy (g);
+        zlist_destroy (&ctx->pmi_pending);
+    }
+    if (ctx->pmi_lookups) {
+        struct pmi_get *g;
+        while ((g = zlist_pop (ctx->pmi_lookups)))
+            pmi_get_destroy (g);
+        zlist_destroy (&ctx->pmi_lookups);
+    }
+
     free (ctx->envz);
     if (ctx->signalfd >= 0)
         close (ctx->signalfd);
@@ -664,6 +715,11 @@ void prog_ctx_destroy (struct prog_ctx *ctx)
         zhash_destroy (&ctx->completion_refs);
 
     flux_kvs_txn_destroy (ctx->barrier_txn);
+    free (ctx->pmi_kvsname);
+    if (ctx->pmi_puts)
+        Jput (ctx->pmi_puts);
+    if (ctx->pmi_exchanged)
+        zhash_destroy (&ctx->pmi_exchanged);
 
     free (ctx);
 }
@@ -749,7 +805,7 @@ struct prog_ctx * prog_ctx_create (void)
     if (get_executable_path (ctx->exedir, sizeof (ctx->exedir)) < 0)
         wlog_fatal (ctx, 1, "get_executable_path: %s", flux_strerror (errno));
 
-    ctx->lua_stack = lua_stack_create ();
+    ctx->lua_stack = NULL;  /* created or taken over in wreck_lua_init() */
     ctx->lua_pattern = NULL;
     return (ctx);
 }
@@ -1227,38 +1283,35 @@ int rexec_state_change (struct prog_ctx *ctx, const char *state)
 }
 
 
-json_object * json_task_info_object_create (struct prog_ctx *ctx,
-    const char *cmd, pid_t pid)
-{
-    json_object *o = json_object_new_object ();
-    json_object *ocmd = json_object_new_string (cmd);
-    json_object *opid = json_object_new_int (pid);
-    json_object *onodeid = json_object_new_int (ctx->noderank);
-    json_object_object_add (o, "command", ocmd);
-    json_object_object_add (o, "pid", opid);
-    json_object_object_add (o, "nodeid", onodeid);
-    return (o);
-}
-
-int rexec_taskinfo_put (struct prog_ctx *ctx, int localid)
+/*  Publish one procdesc record for all tasks on this node,
+ *   <kvspath>.procdesc.<nodeid> = {
+ *      "command":s, "nodeid":i, "base":i, "pids":[i, ...]
+ *   }
+ *  where task with globalid (base + n) has pid pids[n].  This replaces
+ *  the <taskid>.procdesc key per task.
+ */
+int rexec_procdesc_put (struct prog_ctx *ctx)
 {
-    json_object *o;
+    json_object *o = Jnew ();
+    json_object *pids = Jnew_ar ();
     char *key;
-    int rc;
-    struct task_info *t = ctx->task [localid];
+    int i, rc;
 
-    o = json_task_info_object_create (ctx, ctx->argv [0], t->pid);
+    for (i = 0; i < ctx->nprocs; i++)
+        Jadd_ar_int (pids, ctx->task [i]->pid);
+    Jadd_str (o, "command", ctx->argv [0]);
+    Jadd_int (o, "nodeid", ctx->noderank);
+    Jadd_int (o, "base", ctx->globalbasis);
+    json_object_object_add (o, "pids", pids);
 
-    if (asprintf (&key, "%d.procdesc", t->globalid) < 0) {
+    if (asprintf (&key, "procdesc.%d", ctx->nodeid) < 0) {
         errno = ENOMEM;
-        wlog_fatal (ctx, 1, "rexec_taskinfo_put: asprintf: %s",
+        wlog_fatal (ctx, 1, "rexec_procdesc_put: asprintf: %s",
                     flux_strerror (errno));
     }
-
-    rc = kvsdir_put (ctx->kvs, key, json_object_to_json_string (o));
+    rc = kvsdir_put (ctx->kvs, key, Jtostr (o));
     free (key);
-    json_object_put (o);
-    //kvs_commit (ctx->flux, 0);
+    Jput (o);
 
     if (rc < 0)
         return wlog_err (ctx, "kvs_put failure");
@@ -1267,13 +1320,10 @@ int rexec_taskinfo_put (struct prog_ctx *ctx, int localid)
 
 int send_startup_message (struct prog_ctx *ctx)
 {
-    int i;
     const char * state = "running";
 
-    for (i = 0; i < ctx->nprocs; i++) {
-        if (rexec_taskinfo_put (ctx, i) < 0)
-            return (-1);
-    }
+    if (rexec_procdesc_put (ctx) < 0)
+        return (-1);
 
     if (prog_ctx_getopt (ctx, "stop-children-in-exec"))
         state = "sync";
@@ -1314,32 +1364,40 @@ exitstatus_watcher (const char *key, const char *str, void *arg, int err)
     return (0);
 }
 
-static json_object *task_exit_tojson (struct task_info *t)
+/*  Return exit status entries for tasks that have exited but not yet
+ *   been reported, grouped by status: { "<idset>": status, ... }
+ */
+static json_object *task_exits_tojson (struct prog_ctx *ctx)
 {
-    char *key = NULL;
-    char *taskid = NULL;
-    struct prog_ctx *ctx = t->ctx;
-    json_object *o;
-    json_object *e;
+    zhash_t *sets = zhash_new ();
+    json_object *e = Jnew ();
+    nodeset_t *ns;
+    char status [16];
+    int i;
 
-    if (asprintf (&key, "%s.exit_status", ctx->kvspath) < 0)
-        return (NULL);
-    if (asprintf (&taskid, "%d", t->globalid) < 0) {
-        free (key);
-        return (NULL);
+    if (!sets)
+        oom ();
+    for (i = 0; i < ctx->nprocs; i++) {
+        struct task_info *t = ctx->task [i];
+        if (!t->exited || t->exit_sent)
+            continue;
+        snprintf (status, sizeof (status), "%d", t->status);
+        if (!(ns = zhash_lookup (sets, status))) {
+            if (!(ns = nodeset_create ()))
+                oom ();
+            zhash_update (sets, status, ns);
+            zhash_freefn (sets, status, (zhash_free_fn *) nodeset_destroy);
+        }
+        nodeset_add_rank (ns, t->globalid);
     }
-
-    e = Jnew ();
-    Jadd_int64 (e, taskid, t->status);
-
-    o = Jnew ();
-    Jadd_str (o, "key", key);
-    Jadd_int (o, "total", ctx->total_ntasks);
-    json_object_object_add (o, "entries", e);
-
-    free (key);
-    free (taskid);
-    return (o);
+    ns = zhash_first (sets);
+    while (ns) {
+        Jadd_int64 (e, nodeset_string (ns), strtol (zhash_cursor (sets),
+                                                    NULL, 10));
+        ns = zhash_next (sets);
+    }
+    zhash_destroy (&sets);
+    return (e);
 }
 
 static int wait_for_task_exit_aggregate (struct prog_ctx *ctx)
@@ -1366,17 +1424,26 @@ static int wait_for_task_exit_aggregate (struct prog_ctx *ctx)
     return (rc);
 }
 
-static int aggregator_push_task_exit (struct task_info *t)
+/*  Push exit status of all newly exited local tasks in one message.
+ */
+static int aggregator_push_task_exits (struct prog_ctx *ctx)
 {
     int rc = 0;
-    flux_t *h = t->ctx->flux;
+    flux_t *h = ctx->flux;
     flux_future_t *f;
-    json_object *o = task_exit_tojson (t);
+    struct task_info *t0 = ctx->task [0];
+    json_object *o = Jnew ();
+    char *key = NULL;
 
-    if (o == NULL) {
-        flux_log_error (h, "task_exit_tojson");
+    if (asprintf (&key, "%s.exit_status", ctx->kvspath) < 0) {
+        flux_log_error (h, "aggregator_push_task_exits: asprintf");
+        Jput (o);
         return (-1);
     }
+    Jadd_str (o, "key", key);
+    Jadd_int (o, "total", ctx->total_ntasks);
+    json_object_object_add (o, "entries", task_exits_tojson (ctx));
+    free (key);
 
     if (!(f = flux_rpc (h, "aggregator.push", Jtostr (o),
                                 FLUX_NODEID_ANY, 0))) {
@@ -1391,38 +1458,45 @@ static int aggregator_push_task_exit (struct task_info *t)
     flux_future_destroy (f);
     Jput (o);
 
-    if (t->ctx->noderank == 0 && t->id == 0)
-        rc = wait_for_task_exit_aggregate (t->ctx);
+    if (ctx->noderank == 0 && t0->exited && !t0->exit_sent)
+        rc = wait_for_task_exit_aggregate (ctx);
     return (rc);
 }
 
-int send_exit_message (struct task_info *t)
+static int put_int (struct prog_ctx *ctx, int taskid, const char *name,
+                    int val)
 {
     char *key;
-    struct prog_ctx *ctx = t->ctx;
-
-    if (!prog_ctx_getopt (ctx, "no-aggregate-task-exit"))
-        return aggregator_push_task_exit (t);
+    int rc;
 
-    if (asprintf (&key, "%s.%d.exit_status", ctx->kvspath, t->globalid) < 0)
-        return (-1);
-    if (kvs_put_int (ctx->flux, key, t->status) < 0)
+    if (asprintf (&key, "%s.%d.%s", ctx->kvspath, taskid, name) < 0)
         return (-1);
+    rc = kvs_put_int (ctx->flux, key, val);
     free (key);
+    return (rc);
+}
 
-    if (WIFSIGNALED (t->status)) {
-        if (asprintf (&key, "%s.%d.exit_sig", ctx->kvspath, t->globalid) < 0)
-            return (-1);
-        if (kvs_put_int (ctx->flux, key, WTERMSIG (t->status)) < 0)
-            return (-1);
-        free (key);
-    }
-    else {
-        if (asprintf (&key, "%s.%d.exit_code", ctx->kvspath, t->globalid) < 0)
+/*  Write exit_status and exit_code or exit_sig for each newly exited task,
+ *   with at most one commit for all of them.
+ */
+static int kvs_put_task_exits (struct prog_ctx *ctx)
+{
+    int i;
+
+    for (i = 0; i < ctx->nprocs; i++) {
+        struct task_info *t = ctx->task [i];
+        if (!t->exited || t->exit_sent)
+            continue;
+        if (put_int (ctx, t->globalid, "exit_status", t->status) < 0)
             return (-1);
-        if (kvs_put_int (ctx->flux, key, WEXITSTATUS (t->status)) < 0)
+        if (WIFSIGNALED (t->status)) {
+            if (put_int (ctx, t->globalid, "exit_sig",
+                         WTERMSIG (t->status)) < 0)
+                return (-1);
+        }
+        else if (put_int (ctx, t->globalid, "exit_code",
+                          WEXITSTATUS (t->status)) < 0)
             return (-1);
-        free (key);
     }
 
     if (prog_ctx_getopt (ctx, "commit-on-task-exit")) {
@@ -1434,6 +1508,38 @@ int send_exit_message (struct task_info *t)
     return (0);
 }
 
+/*  Report all tasks that exited since the last call, e.g. all tasks
+ *   reaped on one SIGCHLD, in a single aggregator push or commit.
+ */
+int send_exit_messages (struct prog_ctx *ctx)
+{
+    int i, rc;
+    int pending = 0;
+
+    for (i = 0; i < ctx->nprocs; i++) {
+        if (ctx->task [i]->exited && !ctx->task [i]->exit_sent)
+            pending++;
+    }
+    if (pending == 0)
+        return (0);
+
+    if (!prog_ctx_getopt (ctx, "no-aggregate-task-exit"))
+        rc = aggregator_push_task_exits (ctx);
+    else
+        rc = kvs_put_task_exits (ctx);
+    if (rc < 0)
+        wlog_err (ctx, "Sending exit message failed!");
+
+    for (i = 0; i < ctx->nprocs; i++) {
+        struct task_info *t = ctx->task [i];
+        if (t->exited && !t->exit_sent) {
+            t->exit_sent = 1;
+            prog_ctx_remove_completion_ref (ctx, "task.%d.exit", t->id);
+        }
+    }
+    return (rc);
+}
+
 void prog_ctx_unsetenv (struct prog_ctx *ctx, const char *name)
 {
     envz_remove (&ctx->envz, &ctx->envz_len, name);
@@ -1482,6 +1588,27 @@ char ** prog_ctx_env_create (struct prog_ctx *ctx)
     return (env);
 }
 
+/*
+ *  Set current taskid, invoke rexecd_task_init, and add per-task
+ *   variables to the environment for task [t].
+ */
+static void task_init (struct prog_ctx *ctx, struct task_info *t)
+{
+    ctx->taskid = t->id;
+    ctx->in_task = 1;
+    lua_stack_call (ctx->lua_stack, "rexecd_task_init");
+
+    prog_ctx_setenv  (ctx, "FLUX_URI", getenv ("FLUX_URI"));
+    prog_ctx_setenvf (ctx, "FLUX_TASK_RANK", 1, "%d", t->globalid);
+    prog_ctx_setenvf (ctx, "FLUX_TASK_LOCAL_ID", 1, "%d", t->id);
+
+    if (ctx->pmi) {
+        prog_ctx_setenvf (ctx, "PMI_FD", 1, "%d", t->pmi_fds[1]);
+        prog_ctx_setenvf (ctx, "PMI_RANK", 1, "%d", t->globalid);
+        prog_ctx_setenvf (ctx, "PMI_SIZE", 1, "%d", t->ctx->total_ntasks);
+    }
+}
+
 int exec_command (struct prog_ctx *ctx, int i)
 {
     struct task_info *t = ctx->task [i];
@@ -1498,22 +1625,7 @@ int exec_command (struct prog_ctx *ctx, int i)
         if (sigmask_unblock_all () < 0)
             fprintf (stderr, "sigprocmask: %s\n", flux_strerror (errno));
 
-        /*
-         *  Set current taskid and invoke rexecd_task_init
-         */
-        ctx->taskid = i;
-        ctx->in_task = 1;
-        lua_stack_call (ctx->lua_stack, "rexecd_task_init");
-
-        prog_ctx_setenv  (ctx, "FLUX_URI", getenv ("FLUX_URI"));
-        prog_ctx_setenvf (ctx, "FLUX_TASK_RANK", 1, "%d", t->globalid);
-        prog_ctx_setenvf (ctx, "FLUX_TASK_LOCAL_ID", 1, "%d", i);
-
-        if (ctx->pmi) {
-            prog_ctx_setenvf (ctx, "PMI_FD", 1, "%d", t->pmi_fds[1]);
-            prog_ctx_setenvf (ctx, "PMI_RANK", 1, "%d", t->globalid);
-            prog_ctx_setenvf (ctx, "PMI_SIZE", 1, "%d", t->ctx->total_ntasks);
-        }
+        task_init (ctx, t);
 
         if (prog_ctx_getopt (ctx, "stop-children-in-exec")) {
             /* Stop process on exec with parent attached */
@@ -1542,6 +1654,268 @@ int exec_command (struct prog_ctx *ctx, int i)
     return (0);
 }
 
+/*
+ *  Fast launch ("fast-launch" option):
+ *
+ *  Tasks are started with posix_spawn(3), which avoids copying the page
+ *   tables of this process (Lua state, flux handle, zio buffers) for
+ *   every task.  Since nothing can run in the child between spawn and
+ *   exec, rexecd_task_init is run here in the parent just before each
+ *   task is spawned.  The task inherits any environment, working
+ *   directory, cpu affinity, umask and resource limit changes made by
+ *   the plugins, which are then reverted before the next task.
+ */
+struct cloexec_fd {
+    int fd;
+    dev_t dev;
+    ino_t ino;
+};
+
+struct fast_launch {
+    char *envz;             /* environment common to all tasks */
+    size_t envz_len;
+    int cwd_fd;             /* working directory common to all tasks */
+    cpu_set_t cpus;         /* cpu affinity common to all tasks */
+    mode_t umask;           /* umask common to all tasks */
+    struct rlimit rlimits [RLIM_NLIMITS];
+    struct cloexec_fd *cloexec; /* fds set close-on-exec for the launch */
+    int cloexec_count;
+    int cloexec_size;
+    double hooks_ms;        /* time spent in per-task plugins */
+};
+
+static void set_cloexec (void *arg, int fd)
+{
+    struct fast_launch *fl = arg;
+    struct stat st;
+    int flags;
+
+    if (fd < 3 || (flags = fcntl (fd, F_GETFD)) < 0 || (flags & FD_CLOEXEC)
+               || fstat (fd, &st) < 0
+               || fcntl (fd, F_SETFD, flags | FD_CLOEXEC) < 0)
+        return;
+    if (fl->cloexec_count == fl->cloexec_size) {
+        fl->cloexec_size = fl->cloexec_size ? fl->cloexec_size * 2 : 16;
+        fl->cloexec = xrealloc (fl->cloexec,
+                                fl->cloexec_size * sizeof (*fl->cloexec));
+    }
+    fl->cloexec [fl->cloexec_count].fd = fd;
+    fl->cloexec [fl->cloexec_count].dev = st.st_dev;
+    fl->cloexec [fl->cloexec_count].ino = st.st_ino;
+    fl->cloexec_count++;
+}
+
+/*
+ *  Clear close-on-exec on fds set by set_cloexec() that are still open
+ *   on the same file, so that later execs of wrexecd are unaffected.
+ */
+static void clear_cloexec (struct fast_launch *fl)
+{
+    struct stat st;
+    int flags;
+    int i;
+
+    for (i = 0; i < fl->cloexec_count; i++) {
+        int fd = fl->cloexec [i].fd;
+        if (fstat (fd, &st) < 0 || st.st_dev != fl->cloexec [i].dev
+                                || st.st_ino != fl->cloexec [i].ino)
+            continue;
+        if ((flags = fcntl (fd, F_GETFD)) >= 0)
+            (void) fcntl (fd, F_SETFD, flags & ~FD_CLOEXEC);
+    }
+    free (fl->cloexec);
+    fl->cloexec = NULL;
+    fl->cloexec_count = fl->cloexec_size = 0;
+}
+
+static void fast_launch_fini (struct fast_launch *fl)
+{
+    if (fl->cwd_fd >= 0)
+        close (fl->cwd_fd);
+    fl->cwd_fd = -1;
+    clear_cloexec (fl);
+    free (fl->envz);
+    fl->envz = NULL;
+}
+
+static int fast_launch_init (struct prog_ctx *ctx, struct fast_launch *fl)
+{
+    int r;
+
+    memset (fl, 0, sizeof (*fl));
+    fl->cwd_fd = -1;
+
+    /*  Spawned tasks inherit only the fds dup'd onto stdio and their
+     *   own PMI_FD, the equivalent of fdwalk() in child_io_setup().
+     */
+    if (fdwalk (set_cloexec, fl) < 0) {
+        wlog_err (ctx, "fast-launch: fdwalk: %s", flux_strerror (errno));
+        goto error;
+    }
+    if ((fl->cwd_fd = open (".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+        wlog_err (ctx, "fast-launch: open cwd: %s", flux_strerror (errno));
+        goto error;
+    }
+    if (sched_getaffinity (0, sizeof (fl->cpus), &fl->cpus) < 0) {
+        wlog_err (ctx, "fast-launch: sched_getaffinity: %s",
+                  flux_strerror (errno));
+        goto error;
+    }
+    for (r = 0; r < RLIM_NLIMITS; r++) {
+        if (getrlimit (r, &fl->rlimits [r]) < 0) {
+            wlog_err (ctx, "fast-launch: getrlimit: %s",
+                      flux_strerror (errno));
+            goto error;
+        }
+    }
+    fl->umask = umask (0);
+    (void) umask (fl->umask);
+    fl->envz = xzmalloc (ctx->envz_len);
+    memcpy (fl->envz, ctx->envz, ctx->envz_len);
+    fl->envz_len = ctx->envz_len;
+    return (0);
+error:
+    fast_launch_fini (fl);
+    return (-1);
+}
+
+/*
+ *  Undo per-task plugin changes to the environment, cwd, affinity,
+ *   umask and resource limits, and release the task's kvsdir.
+ */
+static void fast_launch_restore (struct prog_ctx *ctx, struct fast_launch *fl,
+                                 struct task_info *t)
+{
+    struct rlimit rl;
+    int r;
+
+    free (ctx->envz);
+    ctx->envz = xzmalloc (fl->envz_len);
+    memcpy (ctx->envz, fl->envz, fl->envz_len);
+    ctx->envz_len = fl->envz_len;
+    ctx->in_task = 0;
+    ctx->in_spawner = 0;
+    if (t->kvs) {
+        kvsdir_destroy (t->kvs);
+        t->kvs = NULL;
+    }
+
+    if (fchdir (fl->cwd_fd) < 0)
+        wlog_fatal (ctx, 1, "fast-launch: fchdir: %s", flux_strerror (errno));
+    if (sched_setaffinity (0, sizeof (fl->cpus), &fl->cpus) < 0)
+        wlog_fatal (ctx, 1, "fast-launch: sched_setaffinity: %s",
+                    flux_strerror (errno));
+    (void) umask (fl->umask);
+    for (r = 0; r < RLIM_NLIMITS; r++) {
+        if (getrlimit (r, &rl) == 0
+            && rl.rlim_cur == fl->rlimits [r].rlim_cur
+            && rl.rlim_max == fl->rlimits [r].rlim_max)
+            continue;
+        if (setrlimit (r, &fl->rlimits [r]) < 0)
+            wlog_fatal (ctx, 1, "fast-launch: setrlimit: %s",
+                        flux_strerror (errno));
+    }
+}
+
+/*
+ *  Start task [i] with posix_spawn.  On failure, return -1 with the
+ *   task's fds still open so the caller can fall back to exec_command(),
+ *   which reports exec errors on the task's stderr as usual.
+ */
+static int spawn_command (struct prog_ctx *ctx, int i, struct fast_launch *fl)
+{
+    struct task_info *t = ctx->task [i];
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    short flags = POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK;
+    struct timespec t0;
+    sigset_t mask;
+    char **env;
+    pid_t pid;
+    int e;
+
+    monotime (&t0);
+    ctx->in_spawner = 1;
+    task_init (ctx, t);
+    env = prog_ctx_env_create (ctx);
+    fl->hooks_ms += monotime_since (t0);
+
+#ifdef POSIX_SPAWN_USEVFORK
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    sigemptyset (&mask);
+    posix_spawn_file_actions_init (&fa);
+    posix_spawnattr_init (&attr);
+    if ((e = posix_spawn_file_actions_adddup2 (&fa,
+                                   zio_src_fd (t->zio [IN]), STDIN_FILENO))
+        || (e = posix_spawn_file_actions_adddup2 (&fa,
+                                   zio_dst_fd (t->zio [OUT]), STDOUT_FILENO))
+        || (e = posix_spawn_file_actions_adddup2 (&fa,
+                                   zio_dst_fd (t->zio [ERR]), STDERR_FILENO))
+        || (e = posix_spawnattr_setflags (&attr, flags))
+        || (e = posix_spawnattr_setpgroup (&attr, 0))
+        || (e = posix_spawnattr_setsigmask (&attr, &mask)))
+        goto done;
+
+    /*  Let this task, and only this task, inherit its PMI_FD
+     */
+    if (fcntl (t->pmi_fds[1], F_SETFD, 0) < 0) {
+        e = errno;
+        goto done;
+    }
+    e = posix_spawnp (&pid, ctx->argv [0], &fa, &attr, ctx->argv, env);
+    (void) fcntl (t->pmi_fds[1], F_SETFD, FD_CLOEXEC);
+done:
+    posix_spawn_file_actions_destroy (&fa);
+    posix_spawnattr_destroy (&attr);
+    free (env);
+    fast_launch_restore (ctx, fl, t);
+    if (e != 0) {
+        wlog_debug (ctx, "task%d: posix_spawnp: %s", i, flux_strerror (e));
+        errno = e;
+        return (-1);
+    }
+    close_child_fds (t);
+    wlog_debug (ctx, "task%d: pid %d (%s): started", i, pid, ctx->argv [0]);
+    t->pid = pid;
+    return (0);
+}
+
+/*
+ *  Record time spent in each launch phase on this node, in milliseconds:
+ *   <kvspath>.launch-timing.<nodeid> = {
+ *      "method":s, "ntasks":i, "init":f, "hooks":f, "spawn":f
+ *   }
+ *  "hooks" is only measured by fast launch; otherwise per-task plugins
+ *   run in the forked children and are included in "spawn".
+ */
+static int launch_timing_put (struct prog_ctx *ctx, const char *method,
+                              double init_ms, double hooks_ms, double spawn_ms)
+{
+    json_object *o = Jnew ();
+    char *key;
+    int rc;
+
+    Jadd_str (o, "method", method);
+    Jadd_int (o, "ntasks", ctx->nprocs);
+    Jadd_double (o, "init", init_ms);
+    Jadd_double (o, "hooks", hooks_ms);
+    Jadd_double (o, "spawn", spawn_ms);
+
+    if (asprintf (&key, "launch-timing.%d", ctx->nodeid) < 0) {
+        errno = ENOMEM;
+        wlog_fatal (ctx, 1, "launch_timing_put: asprintf: %s",
+                    flux_strerror (errno));
+    }
+    rc = kvsdir_put (ctx->kvs, key, Jtostr (o));
+    free (key);
+    Jput (o);
+
+    if (rc < 0)
+        return wlog_err (ctx, "kvs_put failure");
+    return (0);
+}
+
 char *gtid_list_create (struct prog_ctx *ctx, char *buf, size_t len)
 {
     int i, n = 0;
@@ -1659,7 +2033,16 @@ static kvsdir_t *prog_ctx_kvsdir (struct prog_ctx *ctx)
         return (ctx->kvs);
 
     t = prog_ctx_current_task (ctx);
-    if (!t->kvs) {
+    if (!t->kvs && ctx->in_spawner) {
+        /*  Look up the task dir relative to the job dir over the wrexecd
+         *   handle.  It is released once this task has been spawned.
+         */
+        if ( (kvsdir_get_dir (ctx->kvs, &t->kvs, "%d", t->globalid) < 0)
+          && (errno != ENOENT))
+            wlog_err (ctx, "kvsdir_get_dir (%s.%d): %s",
+                      ctx->kvspath, t->globalid, flux_strerror (errno));
+    }
+    else if (!t->kvs) {
         if ( (kvs_get_dir (prog_ctx_flux_handle (ctx), &t->kvs,
                            "%s.%d", ctx->kvspath, t->globalid) < 0)
           && (errno != ENOENT))
@@ -1861,9 +2244,35 @@ static const struct luaL_Reg environ_methods [] = {
     { NULL,         NULL           },
 };
 
-static int wreck_lua_init (struct prog_ctx *ctx)
+/*
+ *  Lua plugins loaded and compiled by the resident server (see
+ *   wrexecd_server()), taken over by the next job if its lua_pattern is
+ *   the same.  Running the plugins' top-level code is deferred until the
+ *   job sets the "wreck" global, so plugins see the same per-job
+ *   environment as when loaded by a newly exec'd wrexecd.
+ */
+static lua_stack_t preloaded_stack = NULL;
+static char *preloaded_pattern = NULL;
+
+static bool pattern_eq (const char *a, const char *b)
+{
+    return (a == b || (a && b && !strcmp (a, b)));
+}
+
+/*
+ *  Create a Lua stack with the wreck metatables and load plugins matching
+ *   [pattern].  The global "wreck" object is set before plugins are run
+ *   if [ctx] is non-NULL, otherwise plugins are compiled but not run.
+ */
+static lua_stack_t wreck_lua_stack_create (struct prog_ctx *ctx,
+                                           const char *pattern)
 {
-    lua_State *L = lua_stack_state (ctx->lua_stack);
+    lua_stack_t st;
+    lua_State *L;
+
+    if (!(st = lua_stack_create ()))
+        return (NULL);
+    L = lua_stack_state (st);
 
     luaopen_flux (L); /* Also loads kvs metatable */
 
@@ -1871,10 +2280,33 @@ static int wreck_lua_init (struct prog_ctx *ctx)
     luaL_setfuncs (L, wreck_methods, 0);
     luaL_newmetatable (L, "WRECK.environ");
     luaL_setfuncs (L, environ_methods, 0);
-    l_push_prog_ctx (L, ctx);
-    lua_setglobal (L, "wreck");
+    if (ctx) {
+        l_push_prog_ctx (L, ctx);
+        lua_setglobal (L, "wreck");
+    }
+    else
+        lua_stack_set_defer (st, 1);
+    lua_stack_append_file (st, pattern);
+    return (st);
+}
+
+static int wreck_lua_init (struct prog_ctx *ctx)
+{
+    lua_State *L;
+
+    if (preloaded_stack && pattern_eq (ctx->lua_pattern, preloaded_pattern)) {
+        wlog_debug (ctx, "using preloaded lua files from %s", ctx->lua_pattern);
+        ctx->lua_stack = preloaded_stack;
+        preloaded_stack = NULL;
+        L = lua_stack_state (ctx->lua_stack);
+        l_push_prog_ctx (L, ctx);
+        lua_setglobal (L, "wreck");
+        lua_stack_run_deferred (ctx->lua_stack);
+        return (0);
+    }
     wlog_debug (ctx, "reading lua files from %s", ctx->lua_pattern);
-    lua_stack_append_file (ctx->lua_stack, ctx->lua_pattern);
+    if (!(ctx->lua_stack = wreck_lua_stack_create (ctx, ctx->lua_pattern)))
+        wlog_fatal (ctx, 1, "lua_stack_create: %s", flux_strerror (errno));
     return (0);
 }
 
@@ -1890,12 +2322,7 @@ int task_exit (struct task_info *t, int status)
     ctx->taskid = t->id;
     lua_stack_call (ctx->lua_stack, "rexecd_task_exit");
 
-
-    if (send_exit_message (t) < 0)
-        wlog_err (ctx, "Sending exit message failed!");
-
-    prog_ctx_remove_completion_ref (t->ctx, "task.%d.exit", t->id);
-
+    /* Exit is reported by caller via send_exit_messages() */
     return (0);
 }
 
@@ -1931,6 +2358,7 @@ int start_trace_task (struct task_info *t)
     if (WIFEXITED (status)) {
         wlog_err (ctx, "start_trace: task unexpectedly exited");
         task_exit (t, status);
+        send_exit_messages (ctx);
     }
     else
         wlog_err (ctx, "start_trace: Unexpected status 0x%04x", status);
@@ -1986,10 +2414,16 @@ int exec_commands (struct prog_ctx *ctx)
     char buf [4096];
     int i;
     int stop_children = 0;
+    int fast = 0;
+    struct fast_launch fl = { .hooks_ms = 0. };
+    struct timespec t0;
+    double init_ms, spawn_ms;
 
+    monotime (&t0);
     wreck_lua_init (ctx);
     if (rexecd_init (ctx) < 0)
         return (-1);
+    init_ms = monotime_since (t0);
 
     prog_ctx_setenvf (ctx, "FLUX_JOB_ID",    1, "%d", ctx->id);
     prog_ctx_setenvf (ctx, "FLUX_JOB_NNODES",1, "%d", ctx->nnodes);
@@ -1998,16 +2432,27 @@ int exec_commands (struct prog_ctx *ctx)
     gtid_list_create (ctx, buf, sizeof (buf));
     prog_ctx_setenvf (ctx, "FLUX_LOCAL_RANKS",  1, "%s", buf);
 
-    for (i = 0; i < ctx->nprocs; i++)
-        exec_command (ctx, i);
-
     if (prog_ctx_getopt (ctx, "stop-children-in-exec"))
         stop_children = 1;
+    else if (prog_ctx_getopt (ctx, "fast-launch"))
+        fast = (fast_launch_init (ctx, &fl) == 0);
+
+    monotime (&t0);
+    for (i = 0; i < ctx->nprocs; i++) {
+        if (!fast || spawn_command (ctx, i, &fl) < 0)
+            exec_command (ctx, i);
+    }
+    spawn_ms = monotime_since (t0);
+    if (fast)
+        fast_launch_fini (&fl);
+
     for (i = 0; i < ctx->nprocs; i++) {
         if (stop_children)
             start_trace_task (ctx->task [i]);
     }
 
+    launch_timing_put (ctx, fast ? "posix_spawn" : "fork",
+                       init_ms, fl.hooks_ms, spawn_ms);
     return send_startup_message (ctx);
 }
 
@@ -2096,6 +2541,7 @@ void signal_cb (flux_reactor_t *r, flux_watcher_t *fdw, int revents, void *arg)
     /* SIGCHLD assumed */
     while (reap_child (ctx))
         ++ctx->exited;
+    send_exit_messages (ctx);
 
     return;
 }
@@ -2190,6 +2636,25 @@ int prog_ctx_reactor_init (struct prog_ctx *ctx)
     return (0);
 }
 
+static int wreck_pmi_txn_put (struct prog_ctx *ctx, const char *kvskey,
+        const char *val)
+{
+    if (!ctx->barrier_txn && !(ctx->barrier_txn = flux_kvs_txn_create ())) {
+        wlog_err (ctx, "pmi_kvs_put: flux_kvs_txn_create: %s",
+                  strerror (errno));
+        return (-1);
+    }
+    if (flux_kvs_txn_pack (ctx->barrier_txn, 0, kvskey, "s", val) < 0) {
+        wlog_err (ctx, "pmi_kvs_put: flux_kvs_txn_pack: %s", strerror (errno));
+        return (-1);
+    }
+    return (0);
+}
+
+/* With the exchange, puts are collected locally under their full
+ *  kvs key and sent with the next barrier, o/w they are added to the
+ *  transaction committed by the barrier's fence.
+ */
 static int wreck_pmi_kvs_put (void *arg, const char *kvsname,
         const char *key, const char *val)
 {
@@ -2201,15 +2666,13 @@ static int wreck_pmi_kvs_put (void *arg, const char *kvsname,
         wlog_err (ctx, "pmi_kvs_put: asprintf: %s", strerror (errno));
         goto done;
     }
-    if (!ctx->barrier_txn && !(ctx->barrier_txn = flux_kvs_txn_create ())) {
-        wlog_err (ctx, "pmi_kvs_put: flux_kvs_txn_create: %s",
-                  strerror (errno));
-        goto done;
+    if (ctx->pmi_use_exchange) {
+        if (!ctx->pmi_puts)
+            ctx->pmi_puts = Jnew ();
+        Jadd_str (ctx->pmi_puts, kvskey, val);
     }
-    if (flux_kvs_txn_pack (ctx->barrier_txn, 0, kvskey, "s", val) < 0) {
-        wlog_err (ctx, "pmi_kvs_put: flux_kvs_txn_pack: %s", strerror (errno));
+    else if (wreck_pmi_txn_put (ctx, kvskey, val) < 0)
         goto done;
-    }
     rc = 0;
 done:
     free (kvskey);
@@ -2217,47 +2680,220 @@ done:
 }
 
 
-static int wreck_pmi_kvs_get (void *arg, const char *kvsname, const char *key,
-        char *val, int len)
+/* PMI values are stored as JSON strings.
+ */
+static int pmi_value_copy (const char *json_str, char *val, int len)
 {
-    struct prog_ctx *ctx = arg;
-    char *kvskey = NULL;
-    const char *s = NULL;
-    int rc = 0;
-    flux_future_t *f;
+    json_object *o;
+    const char *s;
+    int rc = -1;
 
-    if (asprintf (&kvskey, "%s.%s", kvsname, key) < 0) {
-        wlog_err (ctx, "pmi_kvs_get: asprintf: %s", strerror (errno));
-        return (-1);
+    if (!(o = Jfromstr (json_str))
+            || json_object_get_type (o) != json_type_string) {
+        errno = EPROTO;
+        goto done;
     }
-
-    if (!(f = flux_kvs_lookup (ctx->flux, 0, kvskey))) {
-        wlog_err (ctx, "pmi_kvs_get: flux_kvs_lookup: %s", strerror (errno));
-        free (kvskey);
-        return (-1);
+    s = json_object_get_string (o);
+    if (strlen (s) >= len) {
+        errno = ENOSPC;
+        goto done;
     }
-    if (flux_kvs_lookup_get_unpack (f, "s", &s) < 0) {
+    strcpy (val, s);
+    rc = 0;
+done:
+    Jput (o);
+    return (rc);
+}
+
+static int wreck_pmi_tree_get (struct prog_ctx *ctx, const char *key,
+        char *val, int len)
+{
+    const char *json_str;
+
+    if (flux_kvs_lookup_tree_get (ctx->pmi_tree, key, &json_str) < 0) {
         if (errno != ENOENT)
-            wlog_err (ctx, "pmi_kvs_get: flux_kvs_lookup_get_unpack (s,%s): %s",
-                      kvskey, strerror (errno));
-        free (kvskey);
-        flux_future_destroy (f);
+            wlog_err (ctx, "pmi_kvs_get: flux_kvs_lookup_tree_get (%s): %s",
+                      key, strerror (errno));
         return (-1);
     }
+    return (pmi_value_copy (json_str, val, len));
+}
 
-    if (strlen (s) >= len) {
-        rc = -1;
-        errno = ENOSPC;
+static void wreck_pmi_get_respond (struct pmi_get *g, const char *val)
+{
+    if (g->f)
+        zlist_remove (g->ctx->pmi_lookups, g);
+    if (pmi_simple_server_kvs_get_complete (g->ctx->pmi, g->client, val) < 0)
+        wlog_err (g->ctx, "pmi_simple_server_kvs_get_complete: %s",
+                  strerror (errno));
+    pmi_get_destroy (g);
+}
+
+static void wreck_pmi_lookup_cb (flux_future_t *f, void *arg)
+{
+    struct pmi_get *g = arg;
+    char val[SIMPLE_KVS_VAL_MAX];
+    const char *json_str;
+    int rc = -1;
+
+    if (flux_kvs_lookup_get (f, &json_str) < 0) {
+        if (errno != ENOENT)
+            wlog_err (g->ctx, "pmi_kvs_get: flux_kvs_lookup_get (%s): %s",
+                      g->key, strerror (errno));
     }
     else
-        strcpy (val, s);
+        rc = pmi_value_copy (json_str, val, sizeof (val));
+    wreck_pmi_get_respond (g, rc < 0 ? NULL : val);
+}
 
+/* Look up a single key without blocking the reactor.
+ */
+static void wreck_pmi_lookup (struct pmi_get *g, const char *kvsname)
+{
+    struct prog_ctx *ctx = g->ctx;
+    flux_future_t *f = NULL;
+    char *kvskey = NULL;
+
+    if (asprintf (&kvskey, "%s.%s", kvsname, g->key) < 0) {
+        wlog_err (ctx, "pmi_kvs_get: asprintf: %s", strerror (errno));
+        goto error;
+    }
+    if (!(f = flux_kvs_lookup (ctx->flux, 0, kvskey))
+            || flux_future_then (f, -1., wreck_pmi_lookup_cb, g) < 0) {
+        wlog_err (ctx, "pmi_kvs_get: flux_kvs_lookup: %s", strerror (errno));
+        goto error;
+    }
+    if (zlist_append (ctx->pmi_lookups, g) < 0) {
+        wlog_err (ctx, "pmi_kvs_get: zlist_append: out of memory");
+        goto error;
+    }
+    g->f = f;
     free (kvskey);
+    return;
+error:
     flux_future_destroy (f);
+    free (kvskey);
+    wreck_pmi_get_respond (g, NULL);
+}
+
+/* If the directory could not be fetched, mark it unavailable so that
+ *  wreck_pmi_kvs_get() falls back to per-key lookups until the next barrier.
+ */
+static void wreck_pmi_tree_ready (flux_future_t *f, void *arg)
+{
+    struct prog_ctx *ctx = arg;
+    char val[SIMPLE_KVS_VAL_MAX];
+    const char *json_str;
+    struct pmi_get *g;
+
+    if (flux_kvs_lookup_get (f, &json_str) < 0) {
+        wlog_err (ctx, "pmi: flux_kvs_lookup_tree (%s): %s",
+                  ctx->pmi_kvsname, strerror (errno));
+        flux_future_destroy (ctx->pmi_tree);
+        ctx->pmi_tree = NULL;
+        while ((g = zlist_pop (ctx->pmi_pending)))
+            wreck_pmi_lookup (g, ctx->pmi_kvsname);
+        return;
+    }
+    ctx->pmi_tree_ready = 1;
+    while ((g = zlist_pop (ctx->pmi_pending))) {
+        if (wreck_pmi_tree_get (ctx, g->key, val, sizeof (val)) < 0)
+            wreck_pmi_get_respond (g, NULL);
+        else
+            wreck_pmi_get_respond (g, val);
+    }
+}
+
+/* Fetch the whole PMI kvsname directory in one request, so that gets
+ *  from all local tasks until the next barrier are served from memory.
+ *  On failure, fall back to per-key lookups.
+ */
+static void wreck_pmi_tree_fetch (struct prog_ctx *ctx)
+{
+    flux_future_t *f;
+    struct pmi_get *g;
+
+    flux_future_destroy (ctx->pmi_tree);
+    ctx->pmi_tree = NULL;
+    ctx->pmi_tree_ready = 0;
+
+    if (!(f = flux_kvs_lookup_tree (ctx->flux, ctx->pmi_kvsname, NULL, -1, 0))
+            || flux_future_then (f, -1., wreck_pmi_tree_ready, ctx) < 0) {
+        wlog_err (ctx, "pmi: flux_kvs_lookup_tree: %s", strerror (errno));
+        flux_future_destroy (f);
+        while ((g = zlist_pop (ctx->pmi_pending)))
+            wreck_pmi_lookup (g, ctx->pmi_kvsname);
+        return;
+    }
+    ctx->pmi_tree = f;
+}
+
+/* Serve a get from the values gathered by the last exchange.
+ */
+static int wreck_pmi_exchanged_get (struct prog_ctx *ctx, const char *kvsname,
+        const char *key, char *val, int len)
+{
+    char *kvskey = NULL;
+    const char *s;
+    int rc = -1;
 
+    if (asprintf (&kvskey, "%s.%s", kvsname, key) < 0) {
+        wlog_err (ctx, "pmi_kvs_get: asprintf: %s", strerror (errno));
+        goto done;
+    }
+    if (!(s = zhash_lookup (ctx->pmi_exchanged, kvskey))) {
+        errno = ENOENT;
+        goto done;
+    }
+    if (strlen (s) >= len) {
+        errno = ENOSPC;
+        goto done;
+    }
+    strcpy (val, s);
+    rc = 0;
+done:
+    free (kvskey);
     return (rc);
 }
 
+/* Gets are answered from the values gathered by the exchange, or from
+ *  the kvsname directory fetched after the last barrier, or deferred
+ *  until it arrives.  Otherwise (before the first barrier, a foreign
+ *  kvsname, or keys written directly to the kvs such as
+ *  PMI_process_mapping), the key is looked up individually.
+ */
+static int wreck_pmi_kvs_get (void *arg, void *client, const char *kvsname,
+        const char *key, char *val, int len)
+{
+    struct prog_ctx *ctx = arg;
+    bool mine = !strcmp (kvsname, ctx->pmi_kvsname);
+    struct pmi_get *g;
+
+    if (ctx->pmi_use_exchange) {
+        if (wreck_pmi_exchanged_get (ctx, kvsname, key, val, len) == 0)
+            return (0);
+        if (errno != ENOENT)
+            return (-1);
+    }
+    if (mine && ctx->pmi_tree && ctx->pmi_tree_ready)
+        return (wreck_pmi_tree_get (ctx, key, val, len));
+
+    g = xzmalloc (sizeof (*g));
+    g->ctx = ctx;
+    g->client = client;
+    g->key = xstrdup (key);
+    if (mine && ctx->pmi_tree) {
+        if (zlist_append (ctx->pmi_pending, g) < 0) {
+            pmi_get_destroy (g);
+            errno = ENOMEM;
+            return (-1);
+        }
+    }
+    else
+        wreck_pmi_lookup (g, kvsname);
+    return (1);
+}
+
 static void wreck_barrier_next (struct prog_ctx *ctx)
 {
     snprintf (ctx->barrier_name, sizeof (ctx->barrier_name), "lwj.%"PRId64".%u",
@@ -2268,14 +2904,15 @@ static void wreck_barrier_complete (flux_future_t *f, void *arg)
 {
     struct prog_ctx *ctx = arg;
     int rc = flux_future_get (f, NULL);
+    if (rc == 0)
+        wreck_pmi_tree_fetch (ctx);
     pmi_simple_server_barrier_complete (ctx->pmi, rc);
     flux_future_destroy (f);
     wreck_barrier_next (ctx);
 }
 
-static int wreck_pmi_barrier_enter (void *arg)
+static int wreck_pmi_fence (struct prog_ctx *ctx)
 {
-    struct prog_ctx *ctx = arg;
     flux_future_t *f;
 
     if ((f = flux_kvs_fence (ctx->flux, 0, ctx->barrier_name,
@@ -2295,6 +2932,148 @@ out:
     return (f== NULL ? -1 : 0);
 }
 
+static void wreck_pmi_exchange_complete (struct prog_ctx *ctx, int rc)
+{
+    if (ctx->pmi_puts) {
+        Jput (ctx->pmi_puts);
+        ctx->pmi_puts = NULL;
+    }
+    pmi_simple_server_barrier_complete (ctx->pmi, rc);
+    wreck_barrier_next (ctx);
+}
+
+/* The barrier module is not loaded: commit this barrier's puts
+ *  to the kvs with a fence as usual, and stay on that path.
+ */
+static void wreck_pmi_exchange_fallback (struct prog_ctx *ctx)
+{
+    struct json_object_iter i;
+
+    flux_log (ctx->flux, LOG_DEBUG, "barrier module unavailable, using kvs");
+    ctx->pmi_use_exchange = 0;
+    if (ctx->pmi_puts) {
+        json_object_object_foreachC (ctx->pmi_puts, i) {
+            if (wreck_pmi_txn_put (ctx, i.key,
+                                   json_object_get_string (i.val)) < 0)
+                goto error;
+        }
+        Jput (ctx->pmi_puts);
+        ctx->pmi_puts = NULL;
+    }
+    if (wreck_pmi_fence (ctx) < 0)
+        goto error;
+    return;
+error:
+    wreck_pmi_exchange_complete (ctx, -1);
+}
+
+static void wreck_pmi_exchange_loaded (flux_future_t *f, void *arg)
+{
+    struct prog_ctx *ctx = arg;
+    struct json_object_iter i;
+    json_object *o = NULL;
+    const char *buf;
+    int len;
+    int rc = -1;
+
+    if (flux_content_load_get (f, (const void **) &buf, &len) < 0) {
+        wlog_err (ctx, "pmi: flux_content_load: %s", strerror (errno));
+        goto done;
+    }
+    if (len == 0 || buf[len - 1] != '\0' || !(o = Jfromstr (buf))) {
+        wlog_err (ctx, "pmi: malformed exchange blob");
+        goto done;
+    }
+    json_object_object_foreachC (o, i)
+        zhash_update (ctx->pmi_exchanged, i.key,
+                      (void *) json_object_get_string (i.val));
+    rc = 0;
+done:
+    if (o)
+        Jput (o);
+    flux_future_destroy (f);
+    wreck_pmi_exchange_complete (ctx, rc);
+}
+
+/* All nodes have entered: fetch the merged puts of the whole job,
+ *  stored as a single blob, by its blobref.
+ */
+static void wreck_pmi_exchange_entered (flux_future_t *f, void *arg)
+{
+    struct prog_ctx *ctx = arg;
+    flux_future_t *lf = NULL;
+    json_object *o = NULL;
+    const char *json_str;
+    const char *blobref;
+
+    if (flux_rpc_get (f, &json_str) < 0) {
+        if (errno == ENOSYS) {
+            wreck_pmi_exchange_fallback (ctx);
+            goto done;
+        }
+        wlog_err (ctx, "pmi: barrier.enter: %s", strerror (errno));
+        goto error;
+    }
+    if (!json_str || !(o = Jfromstr (json_str))
+                  || !Jget_str (o, "blobref", &blobref)) {
+        wlog_err (ctx, "pmi: barrier.enter: malformed response");
+        goto error;
+    }
+    if (!(lf = flux_content_load (ctx->flux, blobref, 0))
+            || flux_future_then (lf, -1., wreck_pmi_exchange_loaded, ctx) < 0) {
+        wlog_err (ctx, "pmi: flux_content_load: %s", strerror (errno));
+        flux_future_destroy (lf);
+        goto error;
+    }
+    goto done;
+error:
+    wreck_pmi_exchange_complete (ctx, -1);
+done:
+    if (o)
+        Jput (o);
+    flux_future_destroy (f);
+}
+
+/* Send this node's puts since the last barrier to the barrier module,
+ *  which merges them with all other nodes' puts up the TBON.
+ */
+static int wreck_pmi_exchange_enter (struct prog_ctx *ctx)
+{
+    json_object *o = Jnew ();
+    flux_future_t *f;
+    int rc = -1;
+
+    if (!ctx->pmi_puts)
+        ctx->pmi_puts = Jnew ();
+    Jadd_str (o, "name", ctx->barrier_name);
+    Jadd_int (o, "count", 1);
+    Jadd_int (o, "nprocs", ctx->nnodes);
+    json_object_object_add (o, "internal", json_object_new_boolean (0));
+    Jadd_obj (o, "dict", ctx->pmi_puts);
+
+    if (!(f = flux_rpc (ctx->flux, "barrier.enter", Jtostr (o),
+                        FLUX_NODEID_ANY, 0))
+            || flux_future_then (f, -1., wreck_pmi_exchange_entered, ctx) < 0) {
+        wlog_err (ctx, "pmi_barrier_enter: barrier.enter: %s",
+                  strerror (errno));
+        flux_future_destroy (f);
+        goto done;
+    }
+    rc = 0;
+done:
+    Jput (o);
+    return (rc);
+}
+
+static int wreck_pmi_barrier_enter (void *arg)
+{
+    struct prog_ctx *ctx = arg;
+
+    if (ctx->pmi_use_exchange)
+        return (wreck_pmi_exchange_enter (ctx));
+    return (wreck_pmi_fence (ctx));
+}
+
 static void wreck_pmi_debug_trace (void *client, const char *buf)
 {
     struct task_info *t = client;
@@ -2318,6 +3097,22 @@ static int prog_ctx_initialize_pmi (struct prog_ctx *ctx)
     }
     if (prog_ctx_getopt (ctx, "trace-pmi-server"))
         flags |= PMI_SIMPLE_SERVER_TRACE;
+    if (!(ctx->pmi_pending = zlist_new ())
+            || !(ctx->pmi_lookups = zlist_new ())) {
+        flux_log_error (ctx->flux, "initialize_pmi: zlist_new");
+        free (kvsname);
+        return (-1);
+    }
+    if (!prog_ctx_getopt (ctx, "no-pmi-exchange")) {
+        if (!(ctx->pmi_exchanged = zhash_new ())) {
+            flux_log_error (ctx->flux, "initialize_pmi: zhash_new");
+            free (kvsname);
+            return (-1);
+        }
+        zhash_autofree (ctx->pmi_exchanged);
+        ctx->pmi_use_exchange = 1;
+    }
+    ctx->pmi_kvsname = kvsname;
     ctx->barrier_sequence = 0;
     wreck_barrier_next (ctx);
     ctx->pmi = pmi_simple_server_create (ops, (int) ctx->id,
@@ -2328,7 +3123,6 @@ static int prog_ctx_initialize_pmi (struct prog_ctx *ctx)
                                          ctx);
     if (!ctx->pmi)
         flux_log_error (ctx->flux, "pmi_simple_server_create");
-    free (kvsname);
     return (ctx->pmi == NULL ? -1 : 0);
 }
 
@@ -2378,11 +3172,148 @@ int prog_ctx_get_id (struct prog_ctx *ctx, optparse_t *p)
     return (0);
 }
 
-int main (int ac, char **av)
+/*
+ *  Run job described by [ctx] (id and kvspath set) to completion.
+ *   Returns exit code for this process.
+ */
+static int run_job (struct prog_ctx *ctx, int parent_fd)
 {
-    int code = 0;
-    int parent_fd = -1;
+    int code;
     int exec_rc = -1;
+
+    if (prog_ctx_init_from_cmb (ctx) < 0) /* Nothing to do here */
+        exit (0);
+
+    if (rexec_state_change (ctx, "starting") < 0)
+        wlog_fatal (ctx, 1, "rexec_state_change");
+
+    if (parent_fd >= 0)
+        prog_ctx_signal_parent (parent_fd);
+    prog_ctx_reactor_init (ctx);
+
+    if (!prog_ctx_getopt (ctx, "no-pmi-server") && prog_ctx_initialize_pmi (ctx) < 0)
+        wlog_fatal (ctx, 1, "failed to initialize pmi-server");
+
+    exec_rc = exec_commands (ctx);
+
+    if (exec_rc == 0 && flux_reactor_run (flux_get_reactor (ctx->flux), 0) < 0)
+        wlog_err (ctx, "flux_reactor_run: %s", flux_strerror (errno));
+
+    if (ctx->nodeid == 0) {
+        /* At final job state, archive the completed lwj back to the
+         * its final resting place in lwj.<id>
+         */
+        if (archive_lwj (ctx) < 0)
+            wlog_err (ctx, "archive_lwj failed");
+    }
+
+    if (exec_rc == 0) {
+        rexec_state_change (ctx, "complete");
+        wlog_msg (ctx, "job complete. exiting...");
+
+        lua_stack_call (ctx->lua_stack, "rexecd_exit");
+    }
+
+    code = ctx->errnum;
+    prog_ctx_destroy (ctx);
+    return (code);
+}
+
+/*
+ *  Resident server mode (--server-fd=FD), started by the job module
+ *   "wrexecd-server" option.  For each request line read from FD,
+ *    {"id":I, "kvspath":s, "lua_pattern":s}
+ *   fork a daemonized child that runs the job as a newly exec'd wrexecd
+ *   would, but without process startup and, after the first job, without
+ *   reading and compiling Lua plugins.  Plugin top-level code still runs
+ *   once per job, in the child.  Plugins are reloaded if lua_pattern
+ *   changes.  Exit on EOF.
+ *
+ *  Each job still runs in its own process with its own broker connection
+ *   and reads the job from the KVS, as with fork+exec.  Running jobs in
+ *   the server itself, over one connection, would need prog_ctx, the
+ *   signalfd and the Lua plugin state to become per-job.  That is not
+ *   done here.
+ */
+static void server_preload (const char *pattern)
+{
+    if (preloaded_stack && pattern_eq (pattern, preloaded_pattern))
+        return;
+    lua_stack_destroy (preloaded_stack);
+    free (preloaded_pattern);
+    preloaded_pattern = pattern ? xstrdup (pattern) : NULL;
+    preloaded_stack = pattern ? wreck_lua_stack_create (NULL, pattern) : NULL;
+}
+
+static void server_fork_job (FILE *fp, int64_t id, const char *kvspath)
+{
+    struct prog_ctx *ctx;
+    pid_t pid;
+
+    if ((pid = fork ()) < 0) {
+        fprintf (stderr, "wrexecd server: fork: %s\n", strerror (errno));
+        return;
+    }
+    if (pid > 0) {
+        /* Reap intermediate child, job process is reparented */
+        if (waitpid (pid, NULL, 0) < 0)
+            fprintf (stderr, "wrexecd server: waitpid: %s\n",
+                     strerror (errno));
+        return;
+    }
+    switch (fork ()) {
+        case  0 : break;        /* child */
+        case -1 : _exit (2);
+        default : _exit (0);    /* exit intermediate child */
+    }
+    fclose (fp);
+    if (setsid () < 0)
+        exit (3);
+
+    ctx = prog_ctx_create ();
+    signalfd_setup (ctx);
+    ctx->kvspath = xstrdup (kvspath);
+    ctx->id = id;
+    exit (run_job (ctx, -1));
+}
+
+static int wrexecd_server (int fd)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t size = 0;
+
+    if (!(fp = fdopen (fd, "r"))) {
+        fprintf (stderr, "wrexecd server: fdopen: %s\n", strerror (errno));
+        return (1);
+    }
+    while (getline (&line, &size, fp) > 0) {
+        json_object *o = Jfromstr (line);
+        const char *kvspath;
+        const char *pattern = NULL;
+        int64_t id;
+
+        if (!o || !Jget_int64 (o, "id", &id)
+               || !Jget_str (o, "kvspath", &kvspath))
+            fprintf (stderr, "wrexecd server: invalid request: %s", line);
+        else {
+            (void) Jget_str (o, "lua_pattern", &pattern);
+            server_preload (pattern);
+            server_fork_job (fp, id, kvspath);
+        }
+        if (o)
+            Jput (o);
+    }
+    free (line);
+    fclose (fp);
+    lua_stack_destroy (preloaded_stack);
+    free (preloaded_pattern);
+    return (0);
+}
+
+int main (int ac, char **av)
+{
+    int server_fd;
     struct prog_ctx *ctx = NULL;
     optparse_t *p;
     struct optparse_option opts [] = {
@@ -2403,6 +3334,12 @@ int main (int ac, char **av)
           .arginfo = "FD",
           .usage =   "Signal parent on file descriptor [FD]",
         },
+        { .name =    "server-fd",
+          .key =     1002,
+          .has_arg = 1,
+          .arginfo = "FD",
+          .usage =   "Run as resident server reading job requests from [FD]",
+        },
         OPTPARSE_TABLE_END,
     };
 
@@ -2416,6 +3353,9 @@ int main (int ac, char **av)
     if (optparse_parse_args (p, ac, av) < 0)
         wlog_fatal (ctx, 1, "parse args");
 
+    if ((server_fd = optparse_get_int (p, "server-fd", -1)) >= 0)
+        return (wrexecd_server (server_fd));
+
     daemonize ();
 
     ctx = prog_ctx_create ();
@@ -2424,42 +3364,7 @@ int main (int ac, char **av)
     if (prog_ctx_get_id (ctx, p) < 0)
         wlog_fatal (ctx, 1, "Failed to get lwj id from cmdline");
 
-    if (prog_ctx_init_from_cmb (ctx) < 0) /* Nothing to do here */
-        exit (0);
-
-    if (rexec_state_change (ctx, "starting") < 0)
-        wlog_fatal (ctx, 1, "rexec_state_change");
-
-    if ((parent_fd = optparse_get_int (p, "parent-fd", -1)) >= 0)
-        prog_ctx_signal_parent (parent_fd);
-    prog_ctx_reactor_init (ctx);
-
-    if (!prog_ctx_getopt (ctx, "no-pmi-server") && prog_ctx_initialize_pmi (ctx) < 0)
-        wlog_fatal (ctx, 1, "failed to initialize pmi-server");
-
-    exec_rc = exec_commands (ctx);
-
-    if (exec_rc == 0 && flux_reactor_run (flux_get_reactor (ctx->flux), 0) < 0)
-        wlog_err (ctx, "flux_reactor_run: %s", flux_strerror (errno));
-
-    if (ctx->nodeid == 0) {
-        /* At final job state, archive the completed lwj back to the
-         * its final resting place in lwj.<id>
-         */
-        if (archive_lwj (ctx) < 0)
-            wlog_err (ctx, "archive_lwj failed");
-    }
-
-    if (exec_rc == 0) {
-        rexec_state_change (ctx, "complete");
-        wlog_msg (ctx, "job complete. exiting...");
-
-        lua_stack_call (ctx->lua_stack, "rexecd_exit");
-    }
-
-    code = ctx->errnum;
-    prog_ctx_destroy (ctx);
-    return (code);
+    return (run_job (ctx, optparse_get_int (p, "parent-fd", -1)));
 }
 
 /*
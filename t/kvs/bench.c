@@ -0,0 +1,610 @@
+/*****************************************************************************\
+ *  Copyright (c) 2017 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/* bench - KVS benchmarks with machine readable results
+ *
+ * Each workload runs 'nprocs' threads, each with its own handle connected
+ * round-robin to the brokers of the instance (thread n uses rank n % size),
+ * and prints one line of JSON on stdout:
+ *
+ *   {"test":s, "params":{...}, "elapsed":f, "ops_per_sec":f,
+ *    "latency_ms":{"count":i, "min":f, "mean":f, "p50":f, "p90":f,
+ *                  "p99":f, "max":f}}
+ *
+ * Workloads:
+ *   put     each thread commits 'count' transactions of 'batch' keys
+ *   fence   each thread joins 'count' fences of nprocs participants
+ *   lookup  each thread looks up 'count' keys, with --cold dropping the
+ *           local broker's cache before each (untimed).  Since rank 0
+ *           only drops unreferenced objects, cold lookups skip rank 0
+ *           when size > 1.
+ *   watch   'count' commits to a key watched by each thread; latency is
+ *           from commit start to each watcher's notification
+ *   bigdir  like put, but each key is an entry of a directory that was
+ *           pre-populated with 'dirsize' entries
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <libgen.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/tsample.h"
+
+typedef struct {
+    pthread_t t;
+    pthread_attr_t attr;
+    int n;
+    char *uri;
+    flux_t *h;
+    tsample_t lat;
+} thd_t;
+
+struct workload {
+    const char *name;
+    void (*setup)(flux_t *h);
+    void (*prepare)(thd_t *t);
+    void *(*thread)(void *arg);
+    double (*nops)(void);
+};
+
+static int count = 100;
+static int nprocs = 1;
+static int batch = 1;
+static int dirsize = 1000;
+static bool cold = false;
+static const char *prefix = "bench";
+static uint32_t size = 1;
+static int setup_version;
+
+/* watch workload: the main thread commits a new value once all
+ * watchers have seen the previous one.
+ */
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t watch_cond = PTHREAD_COND_INITIALIZER;
+static int watch_ready;
+static int watch_seen;
+static struct timespec watch_t0;
+
+#define OPTIONS "c:n:b:d:Cp:"
+static const struct option longopts[] = {
+   {"count",   required_argument,   0, 'c'},
+   {"nprocs",  required_argument,   0, 'n'},
+   {"batch",   required_argument,   0, 'b'},
+   {"dirsize", required_argument,   0, 'd'},
+   {"cold",    no_argument,         0, 'C'},
+   {"prefix",  required_argument,   0, 'p'},
+   {0, 0, 0, 0},
+};
+
+static void usage (void)
+{
+    fprintf (stderr,
+"Usage: bench [--count N] [--nprocs N] [--batch N] [--dirsize N] [--cold]\n"
+"             [--prefix P] put|fence|lookup|watch|bigdir\n");
+    exit (1);
+}
+
+static json_t *samples_json (tsample_t *s)
+{
+    if (s->n == 0)
+        return json_pack ("{s:i}", "count", 0);
+    tsample_sort (s);
+    return json_pack ("{s:i s:f s:f s:f s:f s:f s:f}",
+                      "count", s->n,
+                      "min", s->v[0],
+                      "mean", tsample_sum (s) / s->n,
+                      "p50", tsample_percentile (s, 50),
+                      "p90", tsample_percentile (s, 90),
+                      "p99", tsample_percentile (s, 99),
+                      "max", s->v[s->n - 1]);
+}
+
+static char *rank_uri (flux_t *h, uint32_t rank)
+{
+    flux_future_t *f;
+    const char *uri;
+    char *cpy;
+
+    if (!(f = flux_rpc_pack (h, "attr.get", rank, 0, "{s:s}",
+                             "name", "local-uri"))
+            || flux_rpc_get_unpack (f, "{s:s}", "value", &uri) < 0)
+        log_err_exit ("attr.get local-uri rank %"PRIu32, rank);
+    cpy = xstrdup (uri);
+    flux_future_destroy (f);
+    return cpy;
+}
+
+static void commit_txn (flux_t *h, flux_kvs_txn_t *txn)
+{
+    flux_future_t *f;
+
+    if (!(f = flux_kvs_commit (h, 0, txn)) || flux_future_get (f, NULL) < 0)
+        log_err_exit ("flux_kvs_commit");
+    flux_future_destroy (f);
+}
+
+/* put
+ */
+static void *put_thread (void *arg)
+{
+    thd_t *t = arg;
+    flux_kvs_txn_t *txn;
+    struct timespec t0;
+    char *key;
+    int i, j;
+
+    for (i = 0; i < count; i++) {
+        if (!(txn = flux_kvs_txn_create ()))
+            log_err_exit ("flux_kvs_txn_create");
+        monotime (&t0);
+        for (j = 0; j < batch; j++) {
+            key = xasprintf ("%s.put.%d.%d.%d", prefix, t->n, i, j);
+            if (flux_kvs_txn_pack (txn, 0, key, "i", 42) < 0)
+                log_err_exit ("%s", key);
+            free (key);
+        }
+        commit_txn (t->h, txn);
+        tsample_push (&t->lat, monotime_since (t0));
+        flux_kvs_txn_destroy (txn);
+    }
+    return NULL;
+}
+
+static double put_nops (void)
+{
+    return (double)nprocs * count * batch;
+}
+
+/* fence
+ */
+static void *fence_thread (void *arg)
+{
+    thd_t *t = arg;
+    flux_kvs_txn_t *txn;
+    flux_future_t *f;
+    struct timespec t0;
+    char *key, *name;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (!(txn = flux_kvs_txn_create ()))
+            log_err_exit ("flux_kvs_txn_create");
+        key = xasprintf ("%s.fence.%d.%d", prefix, t->n, i);
+        name = xasprintf ("%s-fence-%d", prefix, i);
+        if (flux_kvs_txn_pack (txn, 0, key, "i", 42) < 0)
+            log_err_exit ("%s", key);
+        monotime (&t0);
+        if (!(f = flux_kvs_fence (t->h, 0, name, nprocs, txn))
+                || flux_future_get (f, NULL) < 0)
+            log_err_exit ("flux_kvs_fence");
+        tsample_push (&t->lat, monotime_since (t0));
+        flux_future_destroy (f);
+        flux_kvs_txn_destroy (txn);
+        free (name);
+        free (key);
+    }
+    return NULL;
+}
+
+static double fence_nops (void)
+{
+    return (double)count;
+}
+
+/* lookup
+ */
+static void lookup_setup (flux_t *h)
+{
+    flux_kvs_txn_t *txn;
+    char *key;
+    int i;
+
+    if (!(txn = flux_kvs_txn_create ()))
+        log_err_exit ("flux_kvs_txn_create");
+    for (i = 0; i < count; i++) {
+        key = xasprintf ("%s.lookup.%d", prefix, i);
+        if (flux_kvs_txn_pack (txn, 0, key, "i", i) < 0)
+            log_err_exit ("%s", key);
+        free (key);
+    }
+    commit_txn (h, txn);
+    flux_kvs_txn_destroy (txn);
+    if (kvs_get_version (h, &setup_version) < 0)
+        log_err_exit ("kvs_get_version");
+}
+
+static void lookup_one (flux_t *h, const char *key)
+{
+    flux_future_t *f;
+    const char *json_str;
+
+    if (!(f = flux_kvs_lookup (h, 0, key))
+            || flux_kvs_lookup_get (f, &json_str) < 0)
+        log_err_exit ("flux_kvs_lookup %s", key);
+    flux_future_destroy (f);
+}
+
+static void dropcache (flux_t *h)
+{
+    flux_future_t *f;
+
+    if (!(f = flux_rpc (h, "kvs.dropcache", NULL, FLUX_NODEID_ANY, 0))
+            || flux_future_get (f, NULL) < 0)
+        log_err_exit ("kvs.dropcache");
+    flux_future_destroy (f);
+}
+
+/* Make sure the root on this broker includes the keys, and for a warm
+ * run, that each key is cached.
+ */
+static void lookup_prepare (thd_t *t)
+{
+    char *key;
+    int i;
+
+    if (kvs_wait_version (t->h, setup_version) < 0)
+        log_err_exit ("kvs_wait_version");
+    if (cold)
+        return;
+    for (i = 0; i < count; i++) {
+        key = xasprintf ("%s.lookup.%d", prefix, i);
+        lookup_one (t->h, key);
+        free (key);
+    }
+}
+
+static void *lookup_thread (void *arg)
+{
+    thd_t *t = arg;
+    struct timespec t0;
+    char *key;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        key = xasprintf ("%s.lookup.%d", prefix, i);
+        if (cold)
+            dropcache (t->h);
+        monotime (&t0);
+        lookup_one (t->h, key);
+        tsample_push (&t->lat, monotime_since (t0));
+        free (key);
+    }
+    return NULL;
+}
+
+static double lookup_nops (void)
+{
+    return (double)nprocs * count;
+}
+
+/* watch
+ */
+static int watch_cb (const char *key, const char *json_str, void *arg,
+                     int errnum)
+{
+    thd_t *t = arg;
+    json_t *o;
+    int val;
+
+    if (errnum != 0) {
+        log_errn (errnum, "%d: %s", t->n, key);
+        return -1;
+    }
+    if (!(o = json_loads (json_str, JSON_DECODE_ANY, NULL)))
+        log_msg_exit ("%d: %s: could not decode value", t->n, key);
+    val = json_integer_value (o);
+    json_decref (o);
+    if (val < 0)
+        return 0;
+    pthread_mutex_lock (&watch_lock);
+    tsample_push (&t->lat, monotime_since (watch_t0));
+    watch_seen++;
+    pthread_cond_signal (&watch_cond);
+    pthread_mutex_unlock (&watch_lock);
+    if (val == count - 1)
+        flux_reactor_stop (flux_get_reactor (t->h));
+    return 0;
+}
+
+static void watch_setup (flux_t *h)
+{
+    flux_kvs_txn_t *txn;
+    char *key = xasprintf ("%s.watch", prefix);
+
+    if (!(txn = flux_kvs_txn_create ()))
+        log_err_exit ("flux_kvs_txn_create");
+    if (flux_kvs_txn_pack (txn, 0, key, "i", -1) < 0)
+        log_err_exit ("%s", key);
+    commit_txn (h, txn);
+    flux_kvs_txn_destroy (txn);
+    free (key);
+}
+
+/* The initial value (-1) is delivered synchronously.
+ */
+static void watch_prepare (thd_t *t)
+{
+    char *key = xasprintf ("%s.watch", prefix);
+
+    if (kvs_watch (t->h, key, watch_cb, t) < 0)
+        log_err_exit ("%d: kvs_watch", t->n);
+    free (key);
+}
+
+static void *watch_thread (void *arg)
+{
+    thd_t *t = arg;
+
+    pthread_mutex_lock (&watch_lock);
+    watch_ready++;
+    pthread_cond_signal (&watch_cond);
+    pthread_mutex_unlock (&watch_lock);
+    if (flux_reactor_run (flux_get_reactor (t->h), 0) < 0)
+        log_err_exit ("%d: flux_reactor_run", t->n);
+    return NULL;
+}
+
+static void watch_driver (flux_t *h)
+{
+    flux_kvs_txn_t *txn;
+    char *key = xasprintf ("%s.watch", prefix);
+    int i;
+
+    pthread_mutex_lock (&watch_lock);
+    while (watch_ready < nprocs)
+        pthread_cond_wait (&watch_cond, &watch_lock);
+    pthread_mutex_unlock (&watch_lock);
+
+    for (i = 0; i < count; i++) {
+        if (!(txn = flux_kvs_txn_create ()))
+            log_err_exit ("flux_kvs_txn_create");
+        if (flux_kvs_txn_pack (txn, 0, key, "i", i) < 0)
+            log_err_exit ("%s", key);
+        pthread_mutex_lock (&watch_lock);
+        watch_seen = 0;
+        monotime (&watch_t0);
+        pthread_mutex_unlock (&watch_lock);
+        commit_txn (h, txn);
+        pthread_mutex_lock (&watch_lock);
+        while (watch_seen < nprocs)
+            pthread_cond_wait (&watch_cond, &watch_lock);
+        pthread_mutex_unlock (&watch_lock);
+        flux_kvs_txn_destroy (txn);
+    }
+    free (key);
+}
+
+static double watch_nops (void)
+{
+    return (double)count;
+}
+
+/* bigdir
+ */
+static void bigdir_setup (flux_t *h)
+{
+    flux_kvs_txn_t *txn;
+    char *key;
+    int i;
+
+    if (!(txn = flux_kvs_txn_create ()))
+        log_err_exit ("flux_kvs_txn_create");
+    for (i = 0; i < dirsize; i++) {
+        key = xasprintf ("%s.bigdir.%d", prefix, i);
+        if (flux_kvs_txn_pack (txn, 0, key, "i", i) < 0)
+            log_err_exit ("%s", key);
+        free (key);
+    }
+    commit_txn (h, txn);
+    flux_kvs_txn_destroy (txn);
+}
+
+static void *bigdir_thread (void *arg)
+{
+    thd_t *t = arg;
+    flux_kvs_txn_t *txn;
+    struct timespec t0;
+    char *key;
+    int i, j;
+
+    for (i = 0; i < count; i++) {
+        if (!(txn = flux_kvs_txn_create ()))
+            log_err_exit ("flux_kvs_txn_create");
+        monotime (&t0);
+        for (j = 0; j < batch; j++) {
+            key = xasprintf ("%s.bigdir.%d", prefix,
+                             ((i * nprocs + t->n) * batch + j) % dirsize);
+            if (flux_kvs_txn_pack (txn, 0, key, "i", i) < 0)
+                log_err_exit ("%s", key);
+            free (key);
+        }
+        commit_txn (t->h, txn);
+        tsample_push (&t->lat, monotime_since (t0));
+        flux_kvs_txn_destroy (txn);
+    }
+    return NULL;
+}
+
+static struct workload workloads[] = {
+    { "put",    NULL,         NULL,           put_thread,     put_nops },
+    { "fence",  NULL,         NULL,           fence_thread,   fence_nops },
+    { "lookup", lookup_setup, lookup_prepare, lookup_thread,  lookup_nops },
+    { "watch",  watch_setup,  watch_prepare,  watch_thread,   watch_nops },
+    { "bigdir", bigdir_setup, NULL,           bigdir_thread,  put_nops },
+    { NULL, NULL, NULL, NULL, NULL },
+};
+
+static struct workload *workload_lookup (const char *name)
+{
+    struct workload *w;
+
+    for (w = &workloads[0]; w->name; w++)
+        if (!strcmp (w->name, name))
+            return w;
+    return NULL;
+}
+
+static void report (struct workload *w, tsample_t *lat, double elapsed)
+{
+    json_t *o, *l;
+    char *s;
+
+    if (!(l = samples_json (lat)))
+        log_msg_exit ("samples_json");
+    if (!(o = json_pack ("{s:s s:{s:i s:i s:i s:i s:b} s:f s:f s:o}",
+                         "test", w->name,
+                         "params",
+                           "size", (int)size,
+                           "nprocs", nprocs,
+                           "count", count,
+                           "batch", !strcmp (w->name, "bigdir")
+                                 || !strcmp (w->name, "put") ? batch : 1,
+                           "cold", cold,
+                         "elapsed", elapsed * 1E-3,
+                         "ops_per_sec", elapsed > 0 ? w->nops () * 1E3
+                                                    / elapsed : 0.,
+                         "latency_ms", l)))
+        log_msg_exit ("json_pack");
+    if (!strcmp (w->name, "bigdir")
+            && json_object_set_new (json_object_get (o, "params"), "dirsize",
+                                    json_integer (dirsize)) < 0)
+        log_msg_exit ("json_object_set_new");
+    if (!(s = json_dumps (o, JSON_COMPACT | JSON_SORT_KEYS)))
+        log_msg_exit ("json_dumps");
+    printf ("%s\n", s);
+    fflush (stdout);
+    free (s);
+    json_decref (o);
+}
+
+int main (int argc, char *argv[])
+{
+    thd_t *thd;
+    struct workload *w;
+    tsample_t lat;
+    struct timespec t0;
+    double elapsed;
+    uint32_t first = 0;
+    flux_t *h;
+    int i, j, rc, ch;
+
+    log_init (basename (argv[0]));
+
+    while ((ch = getopt_long (argc, argv, OPTIONS, longopts, NULL)) != -1) {
+        switch (ch) {
+            case 'c':
+                if ((count = strtoul (optarg, NULL, 10)) <= 0)
+                    log_msg_exit ("count must be > 0");
+                break;
+            case 'n':
+                if ((nprocs = strtoul (optarg, NULL, 10)) <= 0)
+                    log_msg_exit ("nprocs must be > 0");
+                break;
+            case 'b':
+                if ((batch = strtoul (optarg, NULL, 10)) <= 0)
+                    log_msg_exit ("batch must be > 0");
+                break;
+            case 'd':
+                if ((dirsize = strtoul (optarg, NULL, 10)) <= 0)
+                    log_msg_exit ("dirsize must be > 0");
+                break;
+            case 'C':
+                cold = true;
+                break;
+            case 'p':
+                prefix = optarg;
+                break;
+            default:
+                usage ();
+        }
+    }
+    if (argc - optind != 1)
+        usage ();
+    if (!(w = workload_lookup (argv[optind])))
+        usage ();
+
+    if (!(h = flux_open (NULL, 0)))
+        log_err_exit ("flux_open");
+    if (flux_get_size (h, &size) < 0)
+        log_err_exit ("flux_get_size");
+    if (w->setup)
+        w->setup (h);
+
+    if (cold && size > 1)
+        first = 1;
+    thd = xzmalloc (sizeof (*thd) * nprocs);
+    for (i = 0; i < nprocs; i++) {
+        thd[i].n = i;
+        thd[i].uri = rank_uri (h, first + i % (size - first));
+        if (!(thd[i].h = flux_open (thd[i].uri, 0)))
+            log_err_exit ("%d: flux_open %s", i, thd[i].uri);
+        if (w->prepare)
+            w->prepare (&thd[i]);
+    }
+
+    monotime (&t0);
+    for (i = 0; i < nprocs; i++) {
+        if ((rc = pthread_attr_init (&thd[i].attr)))
+            log_errn_exit (rc, "pthread_attr_init");
+        if ((rc = pthread_create (&thd[i].t, &thd[i].attr, w->thread,
+                                  &thd[i])))
+            log_errn_exit (rc, "pthread_create");
+    }
+    if (w->thread == watch_thread)
+        watch_driver (h);
+    for (i = 0; i < nprocs; i++) {
+        if ((rc = pthread_join (thd[i].t, NULL)))
+            log_errn_exit (rc, "pthread_join");
+    }
+    elapsed = monotime_since (t0);
+
+    memset (&lat, 0, sizeof (lat));
+    for (i = 0; i < nprocs; i++) {
+        for (j = 0; j < thd[i].lat.n; j++)
+            tsample_push (&lat, thd[i].lat.v[j]);
+        tsample_clear (&thd[i].lat);
+        flux_close (thd[i].h);
+        free (thd[i].uri);
+    }
+    report (w, &lat, elapsed);
+
+    tsample_clear (&lat);
+    free (thd);
+    flux_close (h);
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,110 @@
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/blobref.h"
+
+/* Measure blobref_hash() throughput for a range of blob sizes,
+ * with and without CPU SHA extensions, one blob at a time and batched
+ * with blobref_hash_vec().
+ */
+
+static const int blob_sizes[] = { 64, 256, 1024, 4096, 65536, 1048576 };
+static const size_t total_bytes = 64*1024*1024; // hashed per run
+static const int batch_size = 64;
+
+static void bench_single (const char *hashtype, const char *name,
+                          uint8_t *data, int size, int count)
+{
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    struct timespec t0;
+    double ms;
+    int i;
+
+    monotime (&t0);
+    for (i = 0; i < count; i++) {
+        if (blobref_hash (hashtype, data, size, ref, sizeof (ref)) < 0)
+            log_err_exit ("blobref_hash");
+    }
+    ms = monotime_since (t0);
+    printf ("%-8s %-6s %-6s %8d %10.1f\n", hashtype, name, "single", size,
+            ((double)size * count / (1024*1024)) / (ms / 1000));
+}
+
+static void bench_batch (const char *hashtype, const char *name,
+                         uint8_t *data, int size, int count)
+{
+    struct blobref_vec *vec = xzmalloc (sizeof (*vec) * batch_size);
+    struct timespec t0;
+    double ms;
+    int i, n;
+
+    for (i = 0; i < batch_size; i++) {
+        vec[i].data = data;
+        vec[i].len = size;
+    }
+    monotime (&t0);
+    for (i = 0; i < count; i += n) {
+        n = count - i < batch_size ? count - i : batch_size;
+        if (blobref_hash_vec (hashtype, vec, n) < 0)
+            log_err_exit ("blobref_hash_vec");
+    }
+    ms = monotime_since (t0);
+    printf ("%-8s %-6s %-6s %8d %10.1f\n", hashtype, name, "batch", size,
+            ((double)size * count / (1024*1024)) / (ms / 1000));
+    free (vec);
+}
+
+static void bench (const char *hashtype, const char *name, uint8_t *data)
+{
+    int i;
+
+    for (i = 0; i < sizeof (blob_sizes) / sizeof (blob_sizes[0]); i++) {
+        int size = blob_sizes[i];
+        int count = total_bytes / size;
+        bench_single (hashtype, name, data, size, count);
+        bench_batch (hashtype, name, data, size, count);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    const char *hashtypes[] = { "sha1", "sha256", NULL };
+    uint8_t *data;
+    int i, maxsize;
+
+    log_init ("hashbench");
+
+    maxsize = blob_sizes[sizeof (blob_sizes) / sizeof (blob_sizes[0]) - 1];
+    data = xzmalloc (maxsize);
+    srand (time (NULL));
+    for (i = 0; i < maxsize; i++)
+        data[i] = rand ();
+
+    printf ("%-8s %-6s %-6s %8s %10s\n", "HASH", "IMPL", "MODE", "SIZE",
+            "MB/s");
+    for (i = 0; hashtypes[i] != NULL; i++) {
+        if (blobref_set_accel (false) < 0)
+            log_err_exit ("blobref_set_accel false");
+        bench (hashtypes[i], "cpu", data);
+        if (blobref_set_accel (true) < 0)
+            log_msg ("SHA extensions are not available on this CPU");
+        else
+            bench (hashtypes[i], "sha-ni", data);
+    }
+
+    free (data);
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
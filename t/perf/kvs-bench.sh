@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# Run the KVS benchmarks in a single node instance of SIZE brokers and
+# write a JSON document with one result per workload to stdout:
+#
+#   {"size":N, "date":s, "host":s, "results":[{...}, ...]}
+#
+# Each result is the output of t/kvs/bench.  Set FLUX and KVS_BENCH to
+# the flux command and benchmark driver to use.  COUNT sets the number
+# of operations per thread (default 1000).
+#
+# Usage: kvs-bench.sh [SIZE]
+#
+
+FLUX=${FLUX:-flux}
+BENCH=${KVS_BENCH:-$(dirname $0)/../kvs/bench}
+SIZE=${1:-4}
+COUNT=${COUNT:-1000}
+
+die () {
+    echo "kvs-bench: $*" >&2
+    exit 1
+}
+
+# Re-run under a new instance, unless already there
+if test -z "$KVS_BENCH_INSTANCE"; then
+    KVS_BENCH_INSTANCE=1 FLUX=$FLUX KVS_BENCH=$BENCH COUNT=$COUNT \
+        exec $FLUX start --size=$SIZE -o,-Slog-stderr-level=3 $0 $SIZE
+fi
+
+test -x $BENCH || die "$BENCH is not executable"
+
+results=$(mktemp) || die "mktemp failed"
+trap "rm -f $results" EXIT
+
+run () {
+    $BENCH --prefix=bench$(date +%s%N) "$@" >>$results \
+        || die "$BENCH $* failed"
+}
+
+nprocs_list () {
+    n=1
+    while test $n -le $((SIZE*4)); do
+        echo $n
+        n=$((n*2))
+    done
+}
+
+for n in $(nprocs_list); do
+    run --count=$COUNT --nprocs=$n put
+done
+run --count=$COUNT --nprocs=$SIZE --batch=10 put
+for n in $(nprocs_list); do
+    run --count=$((COUNT/10)) --nprocs=$n fence
+done
+run --count=$COUNT --nprocs=$SIZE lookup
+run --count=$((COUNT/10)) --nprocs=$SIZE --cold lookup
+for n in 1 $SIZE $((SIZE*4)); do
+    run --count=$((COUNT/10)) --nprocs=$n watch
+done
+for d in 100 10000; do
+    run --count=$((COUNT/10)) --dirsize=$d bigdir
+done
+
+printf '{"size":%d, "date":"%s", "host":"%s", "results":[\n' \
+    $SIZE "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$(hostname)"
+sed '$!s/$/,/' $results
+printf ']}\n'
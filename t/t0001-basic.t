@@ -177,6 +177,18 @@ test_expect_success 'tbon.parent-endpoint can be read on not rank 0' '
        NUM=`flux start --size 4 flux exec flux getattr tbon.parent-endpoint | grep ipc | wc -l` &&
        test $NUM -eq 3
 '
+test_expect_success 'boot timing attributes are set on all ranks' '
+	NUM=`flux start --size 4 flux exec flux getattr boot.total-time | wc -l` &&
+	test $NUM -eq 4 &&
+	flux start ${ARGS} flux getattr boot.init-time &&
+	flux start ${ARGS} flux getattr boot.put-time &&
+	flux start ${ARGS} flux getattr boot.barrier-time &&
+	flux start ${ARGS} flux getattr boot.get-time
+'
+test_expect_success 'boot.get-batch staggers bootstrap PMI gets' '
+	GET_TIME=`flux start --size 4 -o,--setattr=boot.get-batch=1 -o,--setattr=boot.get-delay=0.1 flux exec -r 3 flux getattr boot.get-time` &&
+	echo $GET_TIME | awk "{ exit (\$1 < 0.3) }"
+'
 test_expect_success 'mcast.endpoint can be read' '
 	ATTR_VAL=`flux start flux getattr mcast.endpoint` &&
         echo $ATTR_VAL | grep "^tbon$"
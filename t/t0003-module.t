@@ -251,6 +251,25 @@ test_expect_success 'flux module stats --rusage --parse maxrss works' '
 	test "$RSS" -gt 0
 '
 
+test_expect_success 'flux module stats --profile works' '
+	flux module stats --rusage $TESTMOD >/dev/null &&
+	flux module stats --profile $TESTMOD >profile.stats &&
+	grep -q reactor profile.stats &&
+	grep -q "$TESTMOD.rusage" profile.stats &&
+	COUNT=$(flux module stats --profile --parse reactor.count $TESTMOD) &&
+	test "$COUNT" -gt 0
+'
+
+test_expect_success 'flux module stats --profile --clear works' '
+	flux module stats --profile --clear $TESTMOD &&
+	flux module stats --profile $TESTMOD >profile2.stats &&
+	! grep -q "$TESTMOD.rusage" profile2.stats
+'
+
+test_expect_success 'flux module stats --profile works on broker' '
+	flux module stats --profile --parse reactor cmb >/dev/null
+'
+
 # try to hit some error cases
 
 test_expect_success 'flux module with no arguments prints usage and fails' '
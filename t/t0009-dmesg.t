@@ -57,11 +57,41 @@ test_expect_success 'ring buffer wraps over old entries' '
 	! flux dmesg | grep -q hello_wrap1 &&
 	flux setattr log-ring-size $OLD_RINGSIZE
 '
+test_expect_success 'flux dmesg returns entries spanning many responses' '
+	OLD_RINGSIZE=`flux getattr log-ring-size` &&
+	flux setattr log-ring-size 1000 &&
+	flux dmesg -C &&
+	for i in `seq 1 300`; do flux logger hello_batch$i; done &&
+	flux dmesg | grep hello_batch >batch.out &&
+	test `wc -l <batch.out` -eq 300 &&
+	head -1 batch.out | grep -q "hello_batch1\$" &&
+	tail -1 batch.out | grep -q "hello_batch300\$" &&
+	flux setattr log-ring-size $OLD_RINGSIZE
+'
+test_expect_success 'shrinking ring keeps newest entries' '
+	OLD_RINGSIZE=`flux getattr log-ring-size` &&
+	flux logger hello_shrink1 &&
+	flux logger hello_shrink2 &&
+	flux setattr log-ring-size 1 &&
+	test `flux getattr log-ring-used` -eq 1 &&
+	flux dmesg | grep -q hello_shrink2 &&
+	flux setattr log-ring-size $OLD_RINGSIZE
+'
 
 # Try to make flux dmesg get an EPROTO error
 test_expect_success 'logged non-ascii characters handled ok' '
 	/bin/echo -n -e "\xFF\xFE\x82\x00" | flux logger &&
 	flux dmesg
 '
+test_expect_success 'entries around a non-UTF-8 entry are returned' '
+	flux dmesg -C &&
+	flux logger hello_before_bad &&
+	/bin/echo -n -e "bad\xFF\xFEentry" | flux logger &&
+	flux logger hello_after_bad &&
+	flux dmesg >badutf8.out &&
+	grep -q hello_before_bad badutf8.out &&
+	grep -q "bad??entry" badutf8.out &&
+	grep -q hello_after_bad badutf8.out
+'
 
 test_done
@@ -148,6 +148,116 @@ test_expect_success 'rank 0 cache is all valid' '
 	test $VALID -eq $TOTAL
 '
 
+test_expect_success 'cold clean entries are compressed on rank 1' '
+	seq 1 10000 >compress.store &&
+	flux exec -r 1 flux setattr content.compress-old-entry 1 &&
+	flux exec -r 1 sh -c "flux content store <compress.store" \
+						>compress.hash &&
+	for i in `seq 1 30`; do \
+	    N=`flux exec -r 1 flux module stats --type int \
+						--parse compressed content` &&
+	    test $N -gt 0 && break; sleep 1; \
+	done &&
+	test $N -gt 0 &&
+	SIZE=`flux exec -r 1 flux module stats --type int --parse size content` &&
+	STORED=`flux exec -r 1 flux module stats --type int \
+						--parse stored-size content` &&
+	test $STORED -lt $SIZE
+'
+
+test_expect_success 'compressed entry loads correctly on rank 1' '
+	HASHSTR=`cat compress.hash` &&
+	flux exec -r 1 flux content load ${HASHSTR} >compress.load &&
+	test_cmp compress.store compress.load
+'
+
+test_expect_success 'store a directory blob with a dirref on rank 0' '
+	echo prefetch-child | flux content store >child.hash &&
+	printf "{\"ver\":1,\"type\":\"dir\",\"data\":{\"a\":{\"ver\":1,\"type\":\"dirref\",\"data\":[\"%s\"]}}}" \
+		`cat child.hash` >dir.store &&
+	flux content store <dir.store >dir.hash
+'
+
+test_expect_success 'loading directory blob on rank 1 prefetches its dirref' '
+	flux exec -r 1 flux setattr content.prefetch-depth 1 &&
+	flux exec -r 1 flux content load `cat dir.hash` >/dev/null &&
+	for i in `seq 1 30`; do \
+	    N=`flux exec -r 1 flux module stats --type int \
+						--parse prefetch content` &&
+	    test $N -gt 0 && break; sleep 1; \
+	done &&
+	test $N -eq 1 &&
+	flux exec -r 1 flux content load `cat child.hash` >child.load &&
+	echo prefetch-child >child.expect &&
+	test_cmp child.expect child.load &&
+	flux exec -r 1 flux setattr content.prefetch-depth 0
+'
+
+rank1_prefetch_wait () {
+	for i in `seq 1 30`; do \
+	    N=`flux exec -r 1 flux module stats --type int \
+						--parse prefetch content` &&
+	    test $N -ge $1 && break; sleep 1; \
+	done &&
+	test $N -eq $1
+}
+
+store_dirref () {
+	printf "{\"ver\":1,\"type\":\"dir\",\"data\":{\"a\":{\"ver\":1,\"type\":\"dirref\",\"data\":[\"%s\"]}}}" \
+		`cat $1` | flux content store >$2
+}
+
+test_expect_success 'store a chain of four directory blobs on rank 0' '
+	echo prefetch-walk | flux content store >walk0.hash &&
+	store_dirref walk0.hash walk1.hash &&
+	store_dirref walk1.hash walk2.hash &&
+	store_dirref walk2.hash walk3.hash &&
+	store_dirref walk3.hash walk4.hash
+'
+
+test_expect_success 'walking the chain on rank 1 prefetches one level ahead' '
+	flux exec -r 1 flux setattr content.prefetch-depth 1 &&
+	P=`flux exec -r 1 flux module stats --type int \
+						--parse prefetch content` &&
+	flux exec -r 1 flux content load `cat walk4.hash` >/dev/null &&
+	rank1_prefetch_wait $(($P+1)) &&
+	flux exec -r 1 flux content load `cat walk3.hash` >/dev/null &&
+	rank1_prefetch_wait $(($P+2)) &&
+	flux exec -r 1 flux content load `cat walk2.hash` >/dev/null &&
+	rank1_prefetch_wait $(($P+3)) &&
+	flux exec -r 1 flux content load `cat walk1.hash` >/dev/null &&
+	rank1_prefetch_wait $(($P+4)) &&
+	MISSES=`flux exec -r 1 flux module stats --type int \
+						--parse load.misses content` &&
+	flux exec -r 1 flux content load `cat walk0.hash` >walk0.load &&
+	echo prefetch-walk >walk0.expect &&
+	test_cmp walk0.expect walk0.load &&
+	test `flux exec -r 1 flux module stats --type int \
+				--parse load.misses content` -eq $MISSES &&
+	flux exec -r 1 flux setattr content.prefetch-depth 0
+'
+
+rank1_load_stat () {
+	flux exec -r 1 flux module stats --type int --parse load.$1 content
+}
+
+test_expect_success 'repeated load on rank 1 misses once, then hits' '
+	echo coalesce-test | flux content store >coalesce.hash &&
+	MISSES=`rank1_load_stat misses` &&
+	HITS=`rank1_load_stat hits` &&
+	flux exec -r 1 flux content load `cat coalesce.hash` >/dev/null &&
+	flux exec -r 1 flux content load `cat coalesce.hash` >/dev/null &&
+	test `rank1_load_stat misses` -eq $(($MISSES+1)) &&
+	test `rank1_load_stat hits` -ge $(($HITS+1))
+'
+
+test_expect_success 'load from all ranks is counted on rank 1' '
+	echo coalesce-test2 | flux content store >coalesce2.hash &&
+	REQUESTS=`rank1_load_stat requests` &&
+	flux exec flux content load `cat coalesce2.hash` >/dev/null &&
+	test `rank1_load_stat requests` -gt $REQUESTS
+'
+
 # Write 8192 blobs, allowing 1024 requests to be outstanding
 test_expect_success 'store 8K blobs from rank 0 using async RPC' '
 	flux content spam 8192 1024
@@ -14,6 +14,7 @@ test_under_flux ${SIZE} minimal
 echo "# $0: flux session size will be ${SIZE}"
 
 BLOBREF=${FLUX_BUILD_DIR}/t/kvs/blobref
+KVSBASIC=${FLUX_BUILD_DIR}/t/kvs/basic
 
 MAXBLOB=`flux getattr content.blob-size-limit`
 HASHFUN=`flux getattr content.hash`
@@ -191,6 +192,13 @@ test_expect_success 'exercise batching of synchronous flush to backing store' '
 	test ${NDIRTY} -eq 0
 '
 
+test_expect_success 'flush window is bounded by flush-batch-limit' '
+	WINDOW=`flux getattr content.flush-batch-window` &&
+	test ${WINDOW} -le 5 &&
+	test ${WINDOW} -ge 1 &&
+	flux getattr content.flush-latency-us
+'
+
 test_expect_success 'exercise batching of asynchronous flush to backing store' '
         OLD_COUNT=`flux module stats --type int --parse count content` &&
 	flux module remove --rank 0 content-sqlite &&
@@ -207,5 +215,112 @@ test_expect_success 'remove content-sqlite module on rank 0' '
 	flux module remove --rank 0 content-sqlite
 '
 
+test_expect_success 'load content-sqlite module in WAL mode' '
+	flux module load --rank 0 content-sqlite wal readers=3 batch=16
+'
+
+test_expect_success 'flush rank 0 cache to WAL mode backing store' '
+	store_junk wal 200 &&
+	run_timeout 10 flux content flush &&
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	test $NDIRTY -eq 0
+'
+
+test_expect_success 'load blobs bypassing cache in WAL mode' '
+	HASHSTR=`cat 1m.0.hash` &&
+	flux content load --bypass-cache ${HASHSTR} >1m.0.load4 &&
+	test_cmp 1m.0.store 1m.0.load4 &&
+	HASHSTR=`cat 64.0.hash` &&
+	flux content load --bypass-cache ${HASHSTR} >64.0.load4 &&
+	test_cmp 64.0.store 64.0.load4 &&
+	HASHSTR=`echo wal:100 | $BLOBREF $HASHFUN` &&
+	flux content load --bypass-cache ${HASHSTR} >wal.load &&
+	echo wal:100 >wal.expect &&
+	test_cmp wal.expect wal.load
+'
+
+test_expect_success 'gc requires a root if KVS is not used' '
+	test_must_fail flux content gc --no-kvs
+'
+
+test_expect_success 'gc deletes unreachable blobs and keeps reachable ones' '
+	echo gc-child | flux content store >gc-child.hash &&
+	echo gc-value | flux content store >gc-value.hash &&
+	echo gc-garbage | flux content store >gc-garbage.hash &&
+	printf "{\"ver\":1,\"type\":\"dir\",\"data\":{\"d\":{\"ver\":1,\"type\":\"dirref\",\"data\":[\"%s\"]},\"v\":{\"ver\":1,\"type\":\"valref\",\"data\":[\"%s\"]}}}" \
+		`cat gc-child.hash` `cat gc-value.hash` >gc-root.store &&
+	flux content store <gc-root.store >gc-root.hash &&
+	flux content dropcache &&
+	flux content gc --no-kvs --batch 7 `cat gc-root.hash` >gc.out &&
+	grep "^marked 3," gc.out &&
+	flux content load --bypass-cache `cat gc-root.hash` >/dev/null &&
+	flux content load --bypass-cache `cat gc-child.hash` >/dev/null &&
+	flux content load --bypass-cache `cat gc-value.hash` >/dev/null &&
+	test_must_fail flux content load --bypass-cache `cat gc-garbage.hash`
+'
+
+test_expect_success 'gc with compaction succeeds' '
+	flux content gc --no-kvs --compact `cat gc-root.hash`
+'
+
+test_expect_success 'load kvs module on rank 0' '
+	flux module load -r 0 kvs
+'
+
+# The value is unlinked but stays in the KVS cache, so committing it again
+# while the gc runs reuses the cached object instead of storing it.
+test_expect_success 'gc keeps a cached value committed again while it runs' '
+	gcval=gc-value-abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz &&
+	flux kvs put gc.a=$gcval &&
+	${KVSBASIC} get-treeobj gc.a | grep -q \"valref\" &&
+	${KVSBASIC} get-treeobj gc.a | grep -o "${HASHFUN}-[0-9a-f]*" >gc-kvs.hash &&
+	flux kvs unlink gc.a &&
+	store_junk gc-kvs 200 &&
+	flux content flush &&
+	{ flux content gc --batch 1 >gc-kvs.out & } &&
+	pid=$! &&
+	for i in `seq 1 20`; do \
+		flux kvs put gc.b$i=$gcval || return 1; \
+	done &&
+	wait $pid &&
+	flux content load --bypass-cache `cat gc-kvs.hash` >/dev/null &&
+	flux content gc --batch 7 &&
+	flux content load --bypass-cache `cat gc-kvs.hash` >/dev/null &&
+	flux content dropcache &&
+	flux kvs get gc.b20 >gc-kvs.get &&
+	echo $gcval >gc-kvs.expect &&
+	test_cmp gc-kvs.expect gc-kvs.get
+'
+
+# The caches must forget deleted blobs, or committing the value again
+# after the gc would be satisfied from cache and never stored.
+test_expect_success 'value deleted by gc can be committed again' '
+	gcold=gc-old-abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz &&
+	flux kvs put gc.old=$gcold &&
+	${KVSBASIC} get-treeobj gc.old | grep -o "${HASHFUN}-[0-9a-f]*" >gc-old.hash &&
+	flux kvs unlink gc.old &&
+	flux content gc &&
+	test_must_fail flux content load --bypass-cache `cat gc-old.hash` &&
+	flux kvs put gc.new=$gcold &&
+	flux content flush &&
+	flux kvs dropcache &&
+	flux content dropcache &&
+	flux content load --bypass-cache `cat gc-old.hash` >/dev/null &&
+	flux kvs get gc.new >gc-old.get &&
+	echo $gcold >gc-old.expect &&
+	test_cmp gc-old.expect gc-old.get
+'
+
+test_expect_success 'remove kvs module on rank 0' '
+	flux module remove -r 0 kvs
+'
+
+test_expect_success 'remove content-sqlite module in WAL mode' '
+	flux module remove --rank 0 content-sqlite &&
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	ECOUNT=`flux module stats --type int --parse count content` &&
+	test $NDIRTY -eq $ECOUNT
+'
+
 
 test_done
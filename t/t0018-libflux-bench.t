@@ -0,0 +1,25 @@
+#!/bin/sh
+#
+
+test_description='Smoke test libflux message layer benchmarks
+
+Run each benchmark with a small count to verify it is built and runs.
+'
+
+. `dirname $0`/sharness.sh
+test_under_flux 1 minimal
+
+BENCH=${FLUX_BUILD_DIR}/src/common/libflux/bench
+
+test_expect_success 'libflux bench runs every test' '
+	${BENCH} --count=100 --sizes=0,1024 >bench.out &&
+	grep -q "\"test\":\"msg.sendfd\"" bench.out &&
+	grep -q "\"test\":\"dispatch\"" bench.out &&
+	grep -q "\"test\":\"rpc.local\",\"size\":1024" bench.out
+'
+
+test_expect_success 'libflux bench rejects unknown test' '
+	test_must_fail ${BENCH} --count=1 nosuchtest
+'
+
+test_done
@@ -389,6 +389,22 @@ test_expect_success 'kvs: 8 threads/rank each doing 100 put,fence in a loop, mix
 		$(basename ${SHARNESS_TEST_FILE})
 '
 
+# benchmark driver
+
+test_expect_success 'kvs: bench runs each workload and reports percentiles' '
+	BENCH=${FLUX_BUILD_DIR}/t/kvs/bench &&
+	P=$TEST.bench &&
+	${BENCH} --prefix=$P --count=10 --nprocs=${SIZE} --batch=2 put >bench.out &&
+	${BENCH} --prefix=$P --count=10 --nprocs=${SIZE} fence >>bench.out &&
+	${BENCH} --prefix=$P --count=10 --nprocs=${SIZE} lookup >>bench.out &&
+	${BENCH} --prefix=$P --count=10 --nprocs=2 --cold lookup >>bench.out &&
+	${BENCH} --prefix=$P --count=10 --nprocs=${SIZE} watch >>bench.out &&
+	${BENCH} --prefix=$P --count=10 --dirsize=100 bigdir >>bench.out &&
+	test $(wc -l <bench.out) -eq 6 &&
+	test $(grep -c "\"p99\":" bench.out) -eq 6 &&
+	grep "\"test\":\"watch\"" bench.out | grep -q "\"latency_ms\":{\"count\":$((${SIZE}*10)),"
+'
+
 # watch tests
 
 test_expect_success 'kvs: watch-mt: multi-threaded kvs watch program' '
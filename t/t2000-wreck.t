@@ -229,6 +229,46 @@ test_expect_success MULTICORE 'wreckrun: supports per-task affinity assignment'
 	EOF
 	test_cmp expected_cpus2 output_cpus2
 '
+test_expect_success 'wreckrun: -o fast-launch works' '
+	run_timeout 5 flux wreckrun -l -o fast-launch -n${SIZE} \
+	  printenv FLUX_TASK_RANK | sort >output_fast &&
+	for i in $(seq 0 $((${SIZE}-1))); do echo "$i: $i"; done \
+	  >expected_fast &&
+	test_cmp expected_fast output_fast
+'
+test_expect_success 'wreckrun: -o fast-launch propagates cwd and exit code' '
+	mypwd=$(pwd)/testdir &&
+	( cd testdir &&
+	  run_timeout 5 flux wreckrun -o fast-launch -N1 -n1 pwd ) \
+	  | grep "^$mypwd$" &&
+	test_expect_code 3 run_timeout 5 \
+	  flux wreckrun -o fast-launch -n${SIZE} sh -c "exit 3"
+'
+test_expect_success MULTICORE 'wreckrun: -o fast-launch supports per-task affinity' '
+	mask=$($cpus_allowed) &&
+	newmask=$($cpus_allowed first) &&
+	run_timeout 5 flux wreckrun -ln2 -o fast-launch \
+	  --pre-launch-hook="lwj[\"0.cpumask\"] = \"$newmask\"" \
+	  $cpus_allowed | sort > output_cpus_fast &&
+	cat <<-EOF >expected_cpus_fast &&
+	0: $newmask
+	1: $mask
+	EOF
+	test_cmp expected_cpus_fast output_cpus_fast
+'
+test_expect_success 'wreckrun: -o fast-launch reports exec failure' '
+	test_must_fail run_timeout 5 \
+	  flux wreckrun -o fast-launch -n1 /nonexistent/command 2>err_fast &&
+	grep "execvp" err_fast
+'
+test_expect_success 'wreckrun: launch timing is recorded per node' '
+	flux wreckrun -o fast-launch -N${SIZE} /bin/true &&
+	LWJ=$(last_job_path) &&
+	flux kvs get ${LWJ}.launch-timing.0 | grep posix_spawn &&
+	flux wreckrun -N${SIZE} /bin/true &&
+	LWJ=$(last_job_path) &&
+	flux kvs get ${LWJ}.launch-timing.$((${SIZE}-1)) | grep fork
+'
 test_expect_success 'wreckrun: top level environment' '
 	flux kvs put lwj.environ="{ \"TEST_ENV_VAR\": \"foo\" }" &&
 	run_timeout 5 flux wreckrun -n2 printenv TEST_ENV_VAR > output_top_env &&
@@ -407,6 +447,113 @@ test_expect_success 'wreck: can adjust lwj kvs hiearchy with broker attrs' '
     test "$result" = "hello"
 '
 
+test_expect_success 'flux-wreck: archive moves completed lwj directories' '
+    cat >archive.sh <<-\EOF &&
+	#!/bin/sh
+	flux wreckrun /bin/true &&
+	flux wreckrun /bin/true &&
+	flux wreckrun /bin/true &&
+	flux wreckrun /bin/true &&
+	flux wreckrun /bin/true &&
+	flux kvs unlink lwj.1.0.5.state &&
+	flux wreck archive --max=1 &&
+	flux wreck archive &&
+	flux kvs dir -R lwj &&
+	flux wreck kvs-path 3 &&
+	flux kvs get $(flux wreck kvs-path 3).state &&
+	flux module remove job &&
+	flux module load job &&
+	flux wreck kvs-path 3 &&
+	flux wreck archive
+	EOF
+    chmod +x archive.sh &&
+    flux start -o,-Swreck.lwj-dir-levels=2,-Swreck.lwj-bits-per-dir=1 \
+        ./archive.sh >archive.out 2>&1 &&
+    test_debug "cat archive.out" &&
+    grep "archived 1 lwj directories, first unarchived id 2" archive.out &&
+    grep "archived 2 lwj directories, first unarchived id 6" archive.out &&
+    test $(grep -c "^lwj-archive.0.1.3$" archive.out) -eq 2 &&
+    grep "^lwj\\.0 -> lwj-archive\\.0$" archive.out &&
+    grep "^lwj\\.1\\.0 -> lwj-archive\\.1\\.0$" archive.out &&
+    ! grep "^lwj\\.0\\." archive.out &&
+    grep "complete" archive.out &&
+    grep "archived 0 lwj directories, first unarchived id 6" archive.out
+'
+
+test_expect_success 'flux-wreck: purge removes archived jobs' '
+    cat >purge.sh <<-\EOF &&
+	#!/bin/sh
+	flux wreckrun /bin/true &&
+	flux wreckrun /bin/true &&
+	flux wreckrun /bin/true &&
+	flux wreck archive &&
+	flux wreck purge &&
+	flux wreck purge -R -t 0 &&
+	flux wreck purge &&
+	flux kvs dir -R lwj-archive
+	EOF
+    chmod +x purge.sh &&
+    flux start -o,-Swreck.lwj-dir-levels=2,-Swreck.lwj-bits-per-dir=1 \
+        ./purge.sh >purge.out 2>&1 &&
+    test_debug "cat purge.out" &&
+    grep "archived 2 lwj directories, first unarchived id 4" purge.out &&
+    grep "3 total job entries" purge.out &&
+    grep "removed 3 lwj entries" purge.out &&
+    grep "0 total job entries" purge.out &&
+    ! grep "state" purge.out
+'
+
+test_expect_success 'wreck: job module can use resident wrexecd server' '
+	flux module remove -r all job &&
+	flux module load -r all job wrexecd-server &&
+	hostname=$(hostname) &&
+	for j in $(seq 1 ${SIZE}); do echo $hostname; done >expected_server &&
+	run_timeout 5 flux wreckrun -n${SIZE} hostname >output_server.1 &&
+	run_timeout 5 flux wreckrun -n${SIZE} hostname >output_server.2 &&
+	test_cmp expected_server output_server.1 &&
+	test_cmp expected_server output_server.2 &&
+	test_expect_code 3 run_timeout 5 flux wreckrun -n${SIZE} sh -c "exit 3" &&
+	flux dmesg | grep "started wrexecd server"
+'
+test_expect_success 'wreck: resident wrexecd reloads plugins on lua_pattern change' '
+	saved_pattern=$(flux getattr wrexec.lua_pattern) &&
+	test_when_finished \
+	    "flux setattr wrexec.lua_pattern \"$saved_pattern\"" &&
+	mkdir -p server-plugins &&
+	cat <<-EOF >server-plugins/test.lua &&
+	function rexecd_init ()
+	    wreck:log_msg ("lwj.%d: server plugin reloaded", wreck.id)
+	end
+	EOF
+	flux setattr wrexec.lua_pattern "$(pwd)/server-plugins/*.lua" &&
+	flux wreckrun /bin/true &&
+	flux dmesg | grep "lwj.$(last_job_id): server plugin reloaded"
+'
+test_expect_success 'wreck: resident wrexecd runs plugin file scope per job' '
+	saved_pattern=$(flux getattr wrexec.lua_pattern) &&
+	test_when_finished \
+	    "flux setattr wrexec.lua_pattern \"$saved_pattern\"" &&
+	mkdir -p server-scope &&
+	cat <<-EOF >server-scope/test.lua &&
+	local id = wreck.id
+	function rexecd_init ()
+	    wreck:log_msg ("lwj.%d: file scope saw lwj.%d", wreck.id, id)
+	end
+	EOF
+	flux setattr wrexec.lua_pattern "$(pwd)/server-scope/*.lua" &&
+	flux wreckrun /bin/true &&
+	id=$(last_job_id) &&
+	flux dmesg | grep "lwj.$id: file scope saw lwj.$id" &&
+	flux wreckrun /bin/true &&
+	id=$(last_job_id) &&
+	flux dmesg | grep "lwj.$id: file scope saw lwj.$id"
+'
+test_expect_success 'wreck: reload job module without wrexecd server' '
+	flux module remove -r all job &&
+	flux module load -r all job &&
+	run_timeout 5 flux wreckrun -n${SIZE} /bin/true
+'
+
 test_debug "flux wreck ls"
 
 test_done
@@ -199,6 +199,19 @@ test_expect_success 'jstat 7.5: basic query works: pdesc' '
     flux jstat query 1 pdesc
 '
 
+test_expect_success 'jstat 7.6: pdesc query falls back to per-task records' '
+    run_timeout 4 flux wreckrun -n2 /bin/true &&
+    id=$(flux wreck last-jobid) &&
+    p=$(flux wreck kvs-path $id) &&
+    flux kvs unlink -R $p.procdesc &&
+    flux kvs put $p.0.procdesc="{\"command\":\"fake\",\"pid\":42,\"nodeid\":0}" \
+        $p.1.procdesc="{\"command\":\"fake\",\"pid\":43,\"nodeid\":0}" &&
+    flux jstat query $id pdesc >output.7.6 &&
+    test_debug "cat output.7.6" &&
+    grep "\"pid\": 42" output.7.6 &&
+    grep "\"pid\": 43" output.7.6
+'
+
 test_expect_success 'jstat 8: query detects bad inputs' '
     test_expect_code 42 flux jstat query 0 jobid &&
     test_expect_code 42 flux jstat query 99999 state-pair &&
@@ -206,6 +219,28 @@ test_expect_success 'jstat 8: query detects bad inputs' '
     test_expect_code 42 flux jstat query 99999 unknown
 '
 
+test_expect_success 'jstat 8.1: queries on active jobs are cached by job-index' '
+    id=$(flux wreckrun --detach sleep 100) &&
+    LWJ=$(flux wreck last-jobid -p) &&
+    ${SHARNESS_TEST_SRCDIR}/scripts/kvs-watch-until.lua -vt 1 $LWJ.state "v == \"running\"" &&
+    flux module stats --clear job-index &&
+    flux jstat query $id rdesc >output.8.1.a &&
+    flux jstat query $id rdesc >output.8.1.b &&
+    test_cmp output.8.1.a output.8.1.b &&
+    test $(flux module stats --parse hits job-index) -eq 1 &&
+    test $(flux module stats --parse misses job-index) -eq 1 &&
+    flux wreck kill -s SIGINT $id &&
+    ${SHARNESS_TEST_SRCDIR}/scripts/kvs-watch-until.lua -vt 1 $LWJ.state "v == \"complete\""
+'
+
+test_expect_success 'jstat 8.2: queries fall back to KVS without job-index' '
+    flux jstat query 1 rdesc >output.8.2.a &&
+    flux module remove -r 0 job-index &&
+    flux jstat query 1 rdesc >output.8.2.b &&
+    flux module load -r 0 job-index &&
+    test_cmp output.8.2.a output.8.2.b
+'
+
 test_expect_success 'jstat 9: update state-pair' "
     flux jstat update 1 state-pair '{\"state-pair\": {\"ostate\": 13, \"nstate\": 12}}' &&
     flux kvs get $(flux wreck kvs-path 1).state > output.9.1 &&
@@ -216,9 +251,9 @@ EOF
 "
 
 test_expect_success 'jstat 10: update procdescs' "
-    flux kvs get $(flux wreck kvs-path 1).0.procdesc > output.10.1 &&
+    flux kvs get $(flux wreck kvs-path 1).procdesc.0 > output.10.1 &&
     flux jstat update 1 pdesc '{\"pdesc\": {\"procsize\":1, \"hostnames\":[\"0\"], \"executables\":[\"fake\"], \"pdarray\":[{\"pid\":8482,\"eindx\":0,\"hindx\":0}]}}' &&
-    flux kvs get $(flux wreck kvs-path 1).0.procdesc > output.10.2 &&
+    flux kvs get $(flux wreck kvs-path 1).procdesc.0 > output.10.2 &&
     test_expect_code 1 diff output.10.1 output.10.2 
 "
 
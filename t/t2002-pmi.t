@@ -170,4 +170,25 @@ test_expect_success 'pmi: (put*16) / barrier / (get*16*size) pattern works' '
 	grep -q "get phase" output_kvstest4
 '
 
+test_expect_success 'pmi: (put*16) / barrier / (get*16*size) works with all tasks on one node' '
+	run_program 60 ${SIZE} 1 ${KVSTEST} -n -N 16 >output_kvstest5 &&
+	grep -q "put phase" output_kvstest5 &&
+	grep -q "get phase" output_kvstest5
+'
+
+test_expect_success 'pmi: (put*16) / barrier / (get*16*size) works with no-pmi-exchange' '
+	run_program 60 ${SIZE} ${SIZE} -o no-pmi-exchange \
+		${KVSTEST} -n -N 16 >output_kvstest6 &&
+	grep -q "put phase" output_kvstest6 &&
+	grep -q "get phase" output_kvstest6
+'
+
+test_expect_success 'pmi: kvs is used when barrier module is not loaded' '
+	flux module remove -r all barrier &&
+	run_program 60 ${SIZE} ${SIZE} ${KVSTEST} -n -N 16 >output_kvstest7 &&
+	flux module load -r all barrier &&
+	grep -q "put phase" output_kvstest7 &&
+	grep -q "get phase" output_kvstest7
+'
+
 test_done